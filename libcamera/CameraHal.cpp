@@ -20,6 +20,7 @@
 
 
 #include <cutils/properties.h>
+#include <cutils/atomic.h>
 #include "CameraHal.h"
 #include <time.h>
 #include <stdlib.h>
@@ -35,12 +36,18 @@ namespace android {
         mNotifyCb(NULL),
         mDataCb(NULL),
         mDataCbTimestamp(NULL),
+        mPPClient(-1),
         mCaptureFrameThread(NULL),
         mPostProcessThread(NULL),
         mPreviewShowFrameThread(NULL),
+        mPreviewCallbackThread(NULL),
         mEncodeFrameThread(NULL),
         mAutoFocusThread(NULL),
         mTakePicThread(NULL),
+        mWarm(false),
+        mPreviewStartTime(0),
+        mFirstFrameTime(0),
+        mPreviewWarmStart(false),
         mLock(),
         supportedPictureSizes(NULL),
         supportedPreviewSizes(NULL),
@@ -50,10 +57,22 @@ namespace android {
         mMsgEnabled(0),
         mPreviewHeap(0),
         mVideoBufNume(VIDEO_OUTPUT_BUFFER_NUM),
+        mVideoMetaDataMode(false),
+        mCapturePmemNum(0),
+        mCaptureMemoryType(CAPTURE_MEMORY_MMAP),
         mPPbufNum(0),
         mPreviewRunning(0),
         mPreviewFormat(V4L2_PIX_FMT_NV12), //the optimized selected format, hard code
         mPreviewFrameSize(0),
+        mPreviewCbFormat(V4L2_PIX_FMT_NV21),
+        mPreviewCbFrameSize(0),
+        mPreviewWidth(0),
+        mPreviewHeight(0),
+        mCallbackWidth(0),
+        mCallbackHeight(0),
+        mCallbackDivisor(1),
+        mCallbackFrameCount(0),
+        mCallbackScaleBuf(NULL),
         mTakePicFlag(false),
         mUvcSpecialCaptureFormat(V4L2_PIX_FMT_YUYV),
         mCaptureFrameSize(0),
@@ -67,27 +86,72 @@ namespace android {
         mCaptureDeviceOpen(false),
         mPPDeviceNeed(false),
         mPPDeviceNeedForPic(false),
+        mPPInline(false),
         mPowerLock(false),
+        mStageAborted(false),
+        mDisplayedFrame(-1),
+        mLastSequence(-1),
+        mSequenceGaps(0),
+        mRecordDrops(0),
+        mTraceFd(-1),
+        mZslEnabled(false),
+        mZslCount(0),
+        mPicturePath(PICTURE_FROM_CAPTURE),
+        mPictureRequest(0),
+        mPictureBusy(false),
+        mPictureThreads(0),
+        mPictureFramesHeld(false),
+        mPictureStreaming(false),
+        mJpegEncoderType(SOFTWARE_JPEG_ENC),
+        mBurstCount(1),
+        mBurstFrameSize(0),
+        mBurstSlotNum(0),
+        mBurstEncoderNum(0),
+        mBurstNextSeq(0),
+        mBurstCaptured(0),
+        mBurstCaptureDone(true),
         mPreviewRotate(CAMERA_PREVIEW_BACK_REF)
     {
         CAMERA_HAL_LOG_FUNC;
+        for (int i = 0; i < VIDEO_OUTPUT_BUFFER_NUM; i++)
+            mVideoBufferFrame[i] = -1;
+        for (int i = 0; i < BURST_QUEUE_DEPTH; i++)
+            mBurstSlots[i].frame = NULL;
+        memset(&mBurstStats, 0, sizeof(mBurstStats));
+        memset(mFrameTimestamp, 0, sizeof(mFrameTimestamp));
+        memset(mFrameSequence, 0, sizeof(mFrameSequence));
+        memset(mCaptureSequence, 0, sizeof(mCaptureSequence));
+        memset(&mWarmConfig, 0, sizeof(mWarmConfig));
         preInit();
     }
 
     CameraHal :: ~CameraHal()
     {
         CAMERA_HAL_LOG_FUNC;
+        WaitWarmup();
+        WaitPicture();
+        if (mWarm)
+            CoolDown();
+        ClosePPClient();
         CameraMiscDeInit();
         CloseCaptureDevice();
         FreeInterBuf();
         postDestroy();
+        //the buffers kept for the next session of this camera go back
+        CameraMemPool::getInstance()->trim();
+        if (mTraceFd >= 0)
+            close(mTraceFd);
     }
 
     void CameraHal :: release()
     {
         CAMERA_HAL_LOG_FUNC;
+        WaitWarmup();
+        WaitPicture();
         Mutex::Autolock lock(mLock);
 
+        if (mWarm)
+            CoolDown();
         mCameraReady = false;
         CameraHALStopPreview();
         UnLockWakeLock();
@@ -97,6 +161,14 @@ namespace android {
     void CameraHal :: preInit()
     {
         CAMERA_HAL_LOG_FUNC;
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("rw.camera.trace", value, "0");
+        if (strcmp(value, "1") == 0){
+            mTraceFd = open(CAMERA_TRACE_MARKER, O_WRONLY);
+            if (mTraceFd < 0)
+                CAMERA_HAL_ERR("Can not open %s", CAMERA_TRACE_MARKER);
+        }
 
     }
     void CameraHal :: postDestroy()
@@ -126,13 +198,15 @@ namespace android {
         return ret;
     }
 
-    CAMERA_HAL_ERR_RET CameraHal :: setJpegEncoder(sp<JpegEncoderInterface>jpegencoder)
+    CAMERA_HAL_ERR_RET CameraHal :: setJpegEncoder(sp<JpegEncoderInterface>jpegencoder, JPEG_ENCODER_TYPE type)
     {
         CAMERA_HAL_LOG_FUNC;
         CAMERA_HAL_ERR_RET ret = CAMERA_HAL_ERR_NONE;
-        if (mCameraReady == false)
+        if (mCameraReady == false){
             mJpegEncoder = jpegencoder;
-        else
+            //the burst creates more encoders of the same type
+            mJpegEncoderType = type;
+        }else
             ret = CAMERA_HAL_ERR_BAD_ALREADY_RUN;
         return ret;
     }
@@ -149,6 +223,8 @@ namespace android {
             return ret;
         if (mPPDeviceNeed == true && mPPDevice == NULL)
             return CAMERA_HAL_ERR_PP_NULL;
+        if (mPPDevice != NULL)
+            mPPScheduler = CameraPPScheduler::getInstance(mPPDevice);
         if ((ret = CameraMiscInit()) < 0)
             return ret;
 
@@ -190,6 +266,29 @@ namespace android {
             free(supportedFPS);
         if (supprotedThumbnailSizes)
             free(supprotedThumbnailSizes);
+        if (mCallbackScaleBuf)
+            free(mCallbackScaleBuf);
+        mCallbackScaleBuf = NULL;
+    }
+
+    /* false if the callback size is set but is not an even size within the preview */
+    bool CameraHal :: GetCallbackSize(const CameraParameters &params, int *pWidth, int *pHeight)
+    {
+        const char *size = params.get(CAMERA_KEY_PREVIEW_CB_SIZE);
+        int previewWidth, previewHeight;
+
+        params.getPreviewSize(&previewWidth, &previewHeight);
+        *pWidth = previewWidth;
+        *pHeight = previewHeight;
+        if (size == NULL || size[0] == '\0')
+            return true;
+        if (sscanf(size, "%dx%d", pWidth, pHeight) != 2 || *pWidth <= 0 || *pHeight <= 0 ||
+                (*pWidth & 1) || (*pHeight & 1) || *pWidth > previewWidth || *pHeight > previewHeight){
+            *pWidth = previewWidth;
+            *pHeight = previewHeight;
+            return false;
+        }
+        return true;
     }
 
     CAMERA_HAL_ERR_RET CameraHal :: InitCameraHalParam()
@@ -230,10 +329,16 @@ namespace android {
         unsigned int CapPreviewFmt[MAX_QUERY_FMT_TIMES];
         struct capture_config_t CaptureSizeFps;
         int  previewCnt= 0, pictureCnt = 0, i;
+        char previewFmt[32] = {0};
 
         pParam->setPreviewFormat(CameraParameters::PIXEL_FORMAT_YUV420SP);
         pParam->set(CameraParameters::KEY_VIDEO_FRAME_FORMAT, CameraParameters::PIXEL_FORMAT_YUV420SP);
-        pParam->set(CameraParameters::KEY_SUPPORTED_PREVIEW_FORMATS, CameraParameters::PIXEL_FORMAT_YUV420SP);
+        strcpy(previewFmt, CameraParameters::PIXEL_FORMAT_YUV420SP);
+        strcat(previewFmt, ",");
+        strcat(previewFmt, CameraParameters::PIXEL_FORMAT_YUV420P);
+        strcat(previewFmt, ",");
+        strcat(previewFmt, CameraParameters::PIXEL_FORMAT_RGB565);
+        pParam->set(CameraParameters::KEY_SUPPORTED_PREVIEW_FORMATS, previewFmt);
 
         //the Camera Open here will not be close immediately, for later preview.
         if (OpenCaptureDevice() < 0)
@@ -422,6 +527,12 @@ namespace android {
         //ratio of the maximum zoom value.
         pParam->set(CameraParameters::KEY_ZOOM_RATIOS, "100,200");
 
+        pParam->set(CAMERA_KEY_ZSL_VALUES, "off,on");
+        pParam->set(CAMERA_KEY_ZSL, "off");
+        pParam->set(CAMERA_KEY_BURST_COUNT_MAX, BURST_MAX_FRAMES);
+        pParam->set(CAMERA_KEY_BURST_COUNT, 1);
+        pParam->set(CAMERA_KEY_PREVIEW_CB_DIVISOR, 1);
+
         return CAMERA_HAL_ERR_NONE;
     }
 
@@ -439,12 +550,94 @@ namespace android {
 
     status_t CameraHal::dump(int fd, const Vector<String16>& args) const
     {
+        const size_t SIZE = 256;
+        char buffer[SIZE];
+        String8 result;
+        const CameraStageSignal *signals[] = {&avab_dequeue_frame, &avab_pp_in_frame};
+        const CameraFrameQueue *queues[] = {&mPPFreeQueue, &mShowQueue, &mCallbackQueue,
+            &mEncQueue, &mPictureQueue};
+
+        snprintf(buffer, SIZE, "Camera HAL: preview %s, record %s, error %d\n",
+                mPreviewRunning ? "running" : "stopped",
+                mRecordRunning ? "running" : "stopped", error_status);
+        result.append(buffer);
+        for (unsigned int i = 0; i < sizeof(signals)/sizeof(signals[0]); i++) {
+            snprintf(buffer, SIZE, "  stage %-12s pending %d posts %u wakeups %u\n",
+                    signals[i]->getName(), signals[i]->getCount(),
+                    signals[i]->getPosts(), signals[i]->getWakeups());
+            result.append(buffer);
+        }
+        for (unsigned int i = 0; i < sizeof(queues)/sizeof(queues[0]); i++) {
+            snprintf(buffer, SIZE, "  queue %-12s pending %d posts %u wakeups %u drops %u\n",
+                    queues[i]->getName(), queues[i]->getCount(),
+                    queues[i]->getPosts(), queues[i]->getWakeups(), queues[i]->getDrops());
+            result.append(buffer);
+        }
+        snprintf(buffer, SIZE, "  capture buffers queued %d, zsl %s with %d frames\n", nCameraBuffersQueued,
+                mZslEnabled ? "on" : "off", mZslCount);
+        result.append(buffer);
+        snprintf(buffer, SIZE, "  jpeg heaps allocated %u reused %u grown %u, %u bytes per kpixel\n",
+                mJpegHeapPool.getAllocs(), mJpegHeapPool.getReuses(), mJpegHeapPool.getGrows(),
+                mJpegHeapPool.getBytesPerKPixel());
+        result.append(buffer);
+        CameraMemPool::getInstance()->dump(result);
+        if (mPPScheduler != NULL)
+            mPPScheduler->dump(result);
+        if (mCaptureDevice != NULL)
+            mCaptureDevice->DevDump(result);
+        if (mFirstFrameTime != 0){
+            snprintf(buffer, SIZE, "  first frame %lld ms after startPreview, %s start\n",
+                    (long long)((mFirstFrameTime - mPreviewStartTime) / 1000000), mPreviewWarmStart ? "warm" : "cold");
+            result.append(buffer);
+        }
+        snprintf(buffer, SIZE, "  frames lost by the driver %d, no buffer for record %d\n",
+                android_atomic_acquire_load(&mSequenceGaps), android_atomic_acquire_load(&mRecordDrops));
+        result.append(buffer);
+        for (int i = 0; i < LATENCY_STAGE_NUM; i++) {
+            const CameraLatencyHistogram *pLatency = &mStageLatency[i];
+            if (pLatency->getCount() == 0)
+                continue;
+            snprintf(buffer, SIZE, "  latency %-12s frames %u p50 %u p90 %u p99 %u max %u us\n",
+                    pLatency->getName(), pLatency->getCount(), pLatency->getPercentile(50),
+                    pLatency->getPercentile(90), pLatency->getPercentile(99), pLatency->getMax());
+            result.append(buffer);
+        }
+
+        {
+            Mutex::Autolock lock(mBurstLock);
+            const BURST_STATS *pStats = &mBurstStats;
+            nsecs_t elapsed = pStats->lastDelivery - pStats->firstCapture;
+
+            if (pStats->delivered > 0){
+                //the fps counts from the first capture to the last picture sent
+                snprintf(buffer, SIZE, "  last burst %u/%u pictures, %d encoders, %lld.%02lld fps, "
+                        "latency avg %lld min %lld max %lld ms\n",
+                        pStats->delivered, pStats->requested, pStats->encoders,
+                        elapsed > 0 ? (long long)(pStats->delivered * 1000000000LL / elapsed) : 0LL,
+                        elapsed > 0 ? (long long)((pStats->delivered * 100000000000LL / elapsed) % 100) : 0LL,
+                        (long long)(pStats->latencySum / pStats->delivered / 1000000),
+                        (long long)(pStats->latencyMin / 1000000), (long long)(pStats->latencyMax / 1000000));
+                result.append(buffer);
+            }
+        }
+        write(fd, result.string(), result.size());
         return NO_ERROR;
     }
 
     status_t CameraHal::sendCommand(int32_t command, int32_t arg1,
             int32_t arg2)
     {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (command == CAMERA_CMD_BURST){
+            //the same as setting the burst-count parameter
+            if (arg1 < 0 || arg1 > BURST_MAX_FRAMES)
+                return BAD_VALUE;
+            Mutex::Autolock lock(mLock);
+            mParameters.set(CAMERA_KEY_BURST_COUNT, arg1 > 1 ? arg1 : 1);
+            CAMERA_HAL_LOG_INFO("burst of %d frames", arg1 > 1 ? arg1 : 1);
+            return NO_ERROR;
+        }
         return BAD_VALUE;
     }
 
@@ -503,9 +696,10 @@ namespace android {
             CAMERA_HAL_ERR("Invalid zoom setting, zoom %d, max zoom %d",zoom,max_zoom);
             return BAD_VALUE;
         }
-        if (!(strcmp(params.getPreviewFormat(), "yuv420sp") == 0) ||
-                (strcmp(params.getPreviewFormat(), "yuv422i") == 0)) {
-            CAMERA_HAL_ERR("Only yuv420 or yuv420i is supported");
+        if (!((strcmp(params.getPreviewFormat(), "yuv420sp") == 0) ||
+                (strcmp(params.getPreviewFormat(), "yuv420p") == 0) ||
+                (strcmp(params.getPreviewFormat(), "rgb565") == 0))) {
+            CAMERA_HAL_ERR("Only yuv420sp, yuv420p or rgb565 is supported, but input format is %s", params.getPreviewFormat());
             return BAD_VALUE;
         }
 
@@ -544,6 +738,29 @@ namespace android {
             return BAD_VALUE;
         }
 
+        if (params.get(CAMERA_KEY_BURST_COUNT) != NULL){
+            int burst = params.getInt(CAMERA_KEY_BURST_COUNT);
+            if (burst < 1 || burst > BURST_MAX_FRAMES){
+                CAMERA_HAL_ERR("The burst count %d is out of 1 to %d", burst, BURST_MAX_FRAMES);
+                return BAD_VALUE;
+            }
+        }
+
+        if (!GetCallbackSize(params, &w, &h)){
+            CAMERA_HAL_ERR("The preview callback size %s is not an even size within the preview",
+                    params.get(CAMERA_KEY_PREVIEW_CB_SIZE));
+            return BAD_VALUE;
+        }
+        if (params.get(CAMERA_KEY_PREVIEW_CB_DIVISOR) != NULL){
+            int divisor = params.getInt(CAMERA_KEY_PREVIEW_CB_DIVISOR);
+            if (divisor < 1 || divisor > PREVIEW_CB_MAX_DIVISOR){
+                CAMERA_HAL_ERR("The preview callback divisor %d is out of 1 to %d", divisor, PREVIEW_CB_MAX_DIVISOR);
+                return BAD_VALUE;
+            }
+            //it takes effect at once, the size at the next startPreview
+            mCallbackDivisor = divisor;
+        }
+
         mParameters = params;
 
         return NO_ERROR;
@@ -572,6 +789,7 @@ namespace android {
         CAMERA_HAL_LOG_FUNC;
         status_t ret = NO_ERROR;
 
+        WaitWarmup();
         Mutex::Autolock lock(mLock);
         if (mPreviewRunning) {
             return NO_ERROR;
@@ -626,17 +844,52 @@ namespace android {
         mRecordRunning = false;
     }
 
+    status_t CameraHal::storeMetaDataInBuffers(bool enable)
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (mRecordRunning) {
+            CAMERA_HAL_ERR("Can not change the video buffer mode while recording");
+            return INVALID_OPERATION;
+        }
+        mVideoMetaDataMode = enable;
+        CAMERA_HAL_LOG_INFO("Video buffers carry %s", enable ? "physical addresses" : "frame copies");
+        return NO_ERROR;
+    }
+
+    int32_t CameraHal::getNumberOfVideoBuffers() const
+    {
+        CAMERA_HAL_LOG_FUNC;
+        return mVideoBufNume;
+    }
+
+    sp<IMemory> CameraHal::getVideoBuffer(int32_t index) const
+    {
+        CAMERA_HAL_LOG_FUNC;
+        if (index < 0 || (unsigned int)index >= mVideoBufNume)
+            return NULL;
+        return mVideoBuffers[index];
+    }
+
     void CameraHal::releaseRecordingFrame(const sp<IMemory>& mem)
     {
         ssize_t offset;
         size_t  size;
         int index;
+        int frame;
 
         offset = mem->offset();
         size   = mem->size();
         index = offset / size;
+        if (index < 0 || index >= VIDEO_OUTPUT_BUFFER_NUM)
+            return;
 
+        Mutex::Autolock lock(mVideoLock);
+        frame = mVideoBufferFrame[index];
+        mVideoBufferFrame[index] = -1;
         mVideoBufferUsing[index] = 0;
+        if (frame >= 0)
+            releaseFrame(frame);
     }
 
     bool CameraHal::recordingEnabled()
@@ -670,14 +923,36 @@ namespace android {
     status_t CameraHal::takePicture()
     {
         CAMERA_HAL_LOG_FUNC;
+        WaitWarmup();
         Mutex::Autolock lock(mLock);
 
+        //the jpeg encoder and the picture buffers are not shared
+        {
+            Mutex::Autolock stateLock(mPictureStateLock);
+            if (mPictureBusy){
+                CAMERA_HAL_ERR("The last picture is not done yet");
+                return INVALID_OPERATION;
+            }
+            mPictureBusy = true;
+            mPictureThreads ++;
+        }
+
+        //the picture capture sets the device up on its own
+        if (mWarm)
+            CoolDown();
+
+        mPicturePath = SelectPicturePath();
+        //not joined, the last thread may still be sending its picture
         if (mTakePicThread != NULL)
             mTakePicThread.clear();
 
-        mTakePicThread= new TakePicThread(this);
-        if (mTakePicThread == NULL)
+        mTakePicThread= new TakePicThread(this, mPicturePath, systemTime(SYSTEM_TIME_MONOTONIC));
+        if (mTakePicThread == NULL){
+            Mutex::Autolock stateLock(mPictureStateLock);
+            mPictureBusy = false;
+            mPictureThreads --;
             return UNKNOWN_ERROR;
+        }
         return NO_ERROR;
     }
 
@@ -700,33 +975,395 @@ namespace android {
         return UNKNOWN_ERROR; //exit the thread
     }
 
-    int CameraHal::takepicThread()
+    int CameraHal::takepicThread(CAMERA_PICTURE_PATH path, nsecs_t shutterTime)
     {
         CAMERA_HAL_LOG_FUNC;
         CAMERA_HAL_LOG_INFO("Camera is taking picture!");
 
-        /* Stop preview, start picture capture, and then restart preview again for CSI camera*/
-        CameraHALStopPreview();
-        cameraHALTakePicture();
+        sp<MemoryBase> JpegMemBase = NULL;
 
+        {
+            //one picture at a time, the jpeg encoder is not shared
+            Mutex::Autolock lock(mPictureLock);
+            switch (path) {
+                case PICTURE_FROM_ZSL:
+                    cameraHALTakeZslPicture(shutterTime, JpegMemBase);
+                    break;
+                case PICTURE_FROM_PREVIEW:
+                    cameraHALTakePreviewPicture(JpegMemBase);
+                    break;
+                case PICTURE_FROM_BURST:
+                    cameraHALTakeBurst(mBurstCount);
+                    break;
+                case PICTURE_FROM_CAPTURE:
+                default:
+                    /* Stop preview, start picture capture, and then restart preview again for CSI camera*/
+                    cameraHALTakePicture(JpegMemBase);
+                    break;
+            }
+        }
+
+        //the encoder is free, the app may take the next picture from the callback
+        {
+            Mutex::Autolock stateLock(mPictureStateLock);
+            mPictureBusy = false;
+        }
+        SendPicture(JpegMemBase);
+
+        Mutex::Autolock stateLock(mPictureStateLock);
+        mPictureThreads --;
+        mPictureStateCond.broadcast();
         return UNKNOWN_ERROR;
     }
 
-    int CameraHal :: cameraHALTakePicture()
+    CAMERA_PICTURE_PATH CameraHal :: SelectPicturePath()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int width = 0, height = 0;
+
+        //a burst is never taken from the preview buffers
+        mBurstCount = mParameters.getInt(CAMERA_KEY_BURST_COUNT);
+        if (mBurstCount > 1)
+            return PICTURE_FROM_BURST;
+        if (!mPreviewRunning)
+            return PICTURE_FROM_CAPTURE;
+
+        mParameters.getPictureSize(&width, &height);
+        //the zsl buffers are only good for the picture size the preview started with
+        if (mZslEnabled){
+            if ((unsigned int)width == mCaptureDeviceCfg.width &&
+                    (unsigned int)height == mCaptureDeviceCfg.height)
+                return PICTURE_FROM_ZSL;
+            return PICTURE_FROM_CAPTURE;
+        }
+        //a preview frame of the picture size can be encoded as it is
+        if ((unsigned int)width == mPreviewWidth && (unsigned int)height == mPreviewHeight &&
+                EncoderSupportsFormat(mPreviewFormat))
+            return PICTURE_FROM_PREVIEW;
+        return PICTURE_FROM_CAPTURE;
+    }
+
+    bool CameraHal :: EncoderSupportsFormat(unsigned int fmt)
+    {
+        int i;
+
+        if (mJpegEncoder == NULL || GetJpegEncoderParam() < 0)
+            return false;
+        for (i = 0; i < MAX_QUERY_FMT_TIMES && mEncoderSupportedFormat[i] != 0; i++){
+            if (mEncoderSupportedFormat[i] == fmt)
+                return true;
+        }
+        return false;
+    }
+
+    /*
+     * Encode into a heap of mJpegHeapPool, sized from the recent pictures.
+     * If the jpeg does not fit it is encoded again into a larger heap, up
+     * to the size of the uncompressed frame.
+     */
+    int CameraHal :: EncodeToHeap(const sp<JpegEncoderInterface> &encoder, DMA_BUFFER *pInBuf, unsigned int size,
+            sp<MemoryBase> &JpegMemBase)
+    {
+        struct jpeg_encoding_conf JpegEncConf;
+        DMA_BUFFER Buf_output;
+        sp<MemoryHeapBase> JpegImageHeap;
+        unsigned int pixels = mJpegEncCfg.PicWidth * mJpegEncCfg.PicHeight;
+        int ret;
+
+        JpegImageHeap = mJpegHeapPool.acquire(pixels, size);
+        for (;;){
+            if (JpegImageHeap == NULL)
+                return NO_MEMORY;
+            Buf_output.virt_start = (unsigned char *)(JpegImageHeap->getBase());
+            Buf_output.phy_offset = 0;
+            Buf_output.length = JpegImageHeap->getSize();
+            ret = encoder->DoEncode(pInBuf, &Buf_output, &JpegEncConf);
+            if (ret != JPEG_ENC_ERROR_NO_SPACE)
+                break;
+            JpegImageHeap = mJpegHeapPool.grow(JpegImageHeap, size);
+        }
+        if (ret < 0)
+            return UNKNOWN_ERROR;
+
+        mJpegHeapPool.record(pixels, JpegEncConf.output_jpeg_size);
+        JpegMemBase = new MemoryBase(JpegImageHeap, 0, JpegEncConf.output_jpeg_size);
+        return NO_ERROR;
+    }
+
+    int CameraHal :: CopyPictureFrame(DMA_BUFFER *pSrc, unsigned int size, DMA_BUFFER *pCopy)
+    {
+        pCopy->virt_start = (unsigned char *)malloc(size);
+        if (pCopy->virt_start == NULL){
+            CAMERA_HAL_ERR("Can not copy a picture frame of %u bytes", size);
+            return NO_MEMORY;
+        }
+        memcpy(pCopy->virt_start, pSrc->virt_start, size);
+        pCopy->phy_offset = 0;
+        pCopy->length = size;
+        return NO_ERROR;
+    }
+
+    //taken while the preview still runs with the size and format of the buffer
+    void CameraHal :: SetThumbSource(DMA_BUFFER *pPreviewBuf)
+    {
+        if (pPreviewBuf != NULL){
+            mJpegEncCfg.ThumbSrc = pPreviewBuf->virt_start;
+            mJpegEncCfg.ThumbSrcWidth = mPreviewWidth;
+            mJpegEncCfg.ThumbSrcHeight = mPreviewHeight;
+            mJpegEncCfg.ThumbSrcFmt = mPreviewFormat;
+        }else{
+            mJpegEncCfg.ThumbSrc = NULL;
+        }
+    }
+
+    int CameraHal :: EncodePicture(DMA_BUFFER *pInBuf, unsigned int fmt, unsigned int size, sp<MemoryBase> &JpegMemBase)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int ret;
+
+        mPictureEncodeFormat = fmt;
+        if ((ret = PrepareJpegEncoder(mJpegEncoder)) < 0)
+            return ret;
+
+        return EncodeToHeap(mJpegEncoder, pInBuf, size, JpegMemBase);
+    }
+
+    void CameraHal :: SendPicture(const sp<MemoryBase> &JpegMemBase)
+    {
+        if ((JpegMemBase != NULL) && (mMsgEnabled & CAMERA_MSG_COMPRESSED_IMAGE)) {
+            CAMERA_HAL_LOG_INFO("==========CAMERA_MSG_COMPRESSED_IMAGE==================");
+            mDataCb(CAMERA_MSG_COMPRESSED_IMAGE, JpegMemBase, mCallbackCookie);
+        }
+    }
+
+    int CameraHal :: cameraHALTakeZslPicture(nsecs_t shutterTime, sp<MemoryBase> &JpegMemBase)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int ret = NO_ERROR;
+        int index, previewIndex = -1;
+        DMA_BUFFER picture, thumb;
+        unsigned int picFmt, frameSize;
+
+        HoldPictureFrames();
+        if ((index = ZslTakeFrame(shutterTime)) < 0){
+            ReleasePictureFrames();
+            return INVALID_OPERATION;
+        }
+
+        //the thumbnail is scaled from a preview frame, not from the full picture
+        android_atomic_release_store(1, &mPictureRequest);
+        if (!mPictureQueue.pop(&previewIndex))
+            previewIndex = -1;
+
+        //both frames are copied out, the stop of the preview only waits for this
+        picFmt = mPreviewCapturedFormat;
+        frameSize = mCaptureFrameSize;
+        thumb.virt_start = NULL;
+        ret = CopyPictureFrame(&mCaptureBuffers[index], frameSize, &picture);
+        if (ret == NO_ERROR && previewIndex >= 0 &&
+                CopyPictureFrame(getFrameBuffer(previewIndex), mPreviewFrameSize, &thumb) == NO_ERROR)
+            SetThumbSource(&thumb);
+        else
+            SetThumbSource(NULL);
+        if (previewIndex >= 0)
+            releaseFrame(previewIndex);
+        {
+            Mutex::Autolock lock(mZslLock);
+            QueueCaptureBuffer(index);
+        }
+        ReleasePictureFrames();
+        if (ret < 0)
+            return ret;
+
+        if (mMsgEnabled & CAMERA_MSG_SHUTTER) {
+            CAMERA_HAL_LOG_INFO("CAMERA_MSG_SHUTTER");
+            mNotifyCb(CAMERA_MSG_SHUTTER, 0, 0, mCallbackCookie);
+        }
+
+        ret = EncodePicture(&picture, picFmt, frameSize, JpegMemBase);
+        CAMERA_HAL_LOG_INFO("Generated a zsl picture from frame %d", index);
+        free(picture.virt_start);
+        if (thumb.virt_start != NULL)
+            free(thumb.virt_start);
+        return ret;
+    }
+
+    int CameraHal :: cameraHALTakePreviewPicture(sp<MemoryBase> &JpegMemBase)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int ret = NO_ERROR;
+        int index;
+        DMA_BUFFER picture;
+        unsigned int picFmt, frameSize;
+
+        //the next preview frame is handed to mPictureQueue as well
+        HoldPictureFrames();
+        android_atomic_release_store(1, &mPictureRequest);
+        if (!mPictureQueue.pop(&index)){
+            ReleasePictureFrames();
+            return INVALID_OPERATION;
+        }
+
+        picFmt = mPreviewFormat;
+        frameSize = mPreviewFrameSize;
+        ret = CopyPictureFrame(getFrameBuffer(index), frameSize, &picture);
+        SetThumbSource(NULL);
+        releaseFrame(index);
+        ReleasePictureFrames();
+        if (ret < 0)
+            return ret;
+
+        if (mMsgEnabled & CAMERA_MSG_SHUTTER) {
+            CAMERA_HAL_LOG_INFO("CAMERA_MSG_SHUTTER");
+            mNotifyCb(CAMERA_MSG_SHUTTER, 0, 0, mCallbackCookie);
+        }
+
+        ret = EncodePicture(&picture, picFmt, frameSize, JpegMemBase);
+        CAMERA_HAL_LOG_INFO("Generated a picture from preview frame %d", index);
+        free(picture.virt_start);
+        return ret;
+    }
+
+    void CameraHal :: HoldPictureFrames()
+    {
+        Mutex::Autolock lock(mPictureStateLock);
+        mPictureFramesHeld = true;
+    }
+
+    void CameraHal :: ReleasePictureFrames()
+    {
+        Mutex::Autolock lock(mPictureStateLock);
+        mPictureFramesHeld = false;
+        mPictureStateCond.broadcast();
+    }
+
+    /*
+     * Called with mLock held by the preview stop, after the stages were
+     * aborted. The picture thread neither takes mLock nor calls back while
+     * it holds the frames, so this can not deadlock.
+     */
+    void CameraHal :: WaitPictureFrames()
+    {
+        Mutex::Autolock lock(mPictureStateLock);
+        while (mPictureFramesHeld)
+            mPictureStateCond.wait(mPictureStateLock);
+    }
+
+    //the picture threads may call back, and the callbacks may need mLock
+    void CameraHal :: WaitPicture()
+    {
+        sp<TakePicThread> picThread;
+
+        {
+            Mutex::Autolock lock(mPictureStateLock);
+            while (mPictureThreads > 0)
+                mPictureStateCond.wait(mPictureStateLock);
+        }
+        {
+            Mutex::Autolock lock(mLock);
+            picThread = mTakePicThread;
+            mTakePicThread.clear();
+        }
+        if (picThread != 0)
+            picThread->requestExitAndWait();
+    }
+
+    bool CameraHal :: ZslAvailable()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        const char *pZslStr = mParameters.get(CAMERA_KEY_ZSL);
+
+        if (pZslStr == NULL || strcmp(pZslStr, "on") != 0)
+            return false;
+        if (mPPDevice == NULL || mJpegEncoder == NULL){
+            CAMERA_HAL_ERR("zsl needs the pp device and the jpeg encoder");
+            return false;
+        }
+
+        //the picture is encoded from the captured buffer itself
+        if (!EncoderSupportsFormat(mPreviewCapturedFormat)){
+            CAMERA_HAL_LOG_INFO("The jpeg encoder can not take the captured format, zsl is off");
+            return false;
+        }
+        return true;
+    }
+
+    void CameraHal :: ZslKeepFrame(int index)
+    {
+        Mutex::Autolock lock(mZslLock);
+
+        if (mZslCount == ZSL_RING_NUM){
+            QueueCaptureBuffer(mZslRing[0]);
+            for (unsigned int i = 1; i < ZSL_RING_NUM; i++)
+                mZslRing[i - 1] = mZslRing[i];
+            mZslCount --;
+        }
+        mZslRing[mZslCount++] = index;
+        mZslCond.signal();
+    }
+
+    int CameraHal :: ZslTakeFrame(nsecs_t shutterTime)
+    {
+        Mutex::Autolock lock(mZslLock);
+        unsigned int i, best = 0;
+        nsecs_t diff, bestDiff = 0;
+        int index;
+
+        while (mZslCount == 0 && !mStageAborted)
+            mZslCond.wait(mZslLock);
+        if (mStageAborted)
+            return -1;
+
+        //the frame captured the closest to the shutter
+        for (i = 0; i < mZslCount; i++){
+            diff = mCaptureTimestamp[mZslRing[i]] - shutterTime;
+            if (diff < 0)
+                diff = -diff;
+            if (i == 0 || diff < bestDiff){
+                best = i;
+                bestDiff = diff;
+            }
+        }
+        index = mZslRing[best];
+        for (i = best + 1; i < mZslCount; i++)
+            mZslRing[i - 1] = mZslRing[i];
+        mZslCount --;
+
+        CAMERA_HAL_LOG_INFO("zsl takes frame %d, %lld us from the shutter", index, (long long)(bestDiff / 1000));
+        return index;
+    }
+
+    void CameraHal :: QueueCaptureBuffer(int index)
+    {
+        if (mCaptureDevice->DevQueue(index) < 0){
+            CAMERA_HAL_ERR("The Capture device queue buf error !!!!");
+            return;
+        }
+        android_atomic_inc(&nCameraBuffersQueued);
+        avab_dequeue_frame.post();
+    }
+
+    /*
+     * Stop the preview if it runs and stream the capture device at the
+     * picture size. The frames are then read with CapturePictureFrame, and
+     * StopPictureCapture undoes all of it, also when this fails. Called
+     * with mLock held.
+     */
+    int CameraHal :: StartPictureCapture(bool *pRestartPreview)
     {
         CAMERA_HAL_LOG_FUNC;
         int ret = NO_ERROR;
         unsigned int DeQueBufIdx = 0;
-        struct jpeg_encoding_conf JpegEncConf;
-        DMA_BUFFER Buf_input, Buf_output;
-        sp<MemoryBase> JpegMemBase = NULL;
-        sp<MemoryHeapBase> JpegImageHeap = NULL;
         int  max_fps, min_fps;
 
-        if (mJpegEncoder == NULL){
-            CAMERA_HAL_ERR("the jpeg encoder is NULL");
-            return BAD_VALUE;
+        *pRestartPreview = false;
+        mPictureStreaming = false;
+        if (mPreviewRunning){
+            *pRestartPreview = true;
+            CameraHALStopThreads();
+            CameraHALStopMisc(false);
         }
+
         mParameters.getPictureSize((int *)&(mCaptureDeviceCfg.width),(int *)&(mCaptureDeviceCfg.height));
         mCaptureDeviceCfg.tv.numerator = 1;
         mCaptureDevice->GetDevName(mCameraSensorName);
@@ -760,6 +1397,7 @@ namespace android {
         }
         if ((ret = PrepareCaptureDevices()) < 0)
             return ret;
+        mPictureStreaming = true;
 
         if (mPPDeviceNeedForPic){
             if ((ret = PreparePreviwBuf()) < 0){
@@ -767,75 +1405,347 @@ namespace android {
                 return ret;
             }
         }
-        if ((ret = PrepareJpegEncoder()) < 0)
-            return ret;
 
         if (mCaptureDevice->DevStart()<0){
             CAMERA_HAL_ERR("the capture start up failed !!!!");
             return INVALID_OPERATION;
         }
 
-        for (unsigned int i =0;;){
+        //the sensor needs a few frames to settle after the stream on
+        for (unsigned int i = 1; i < mCaptureDeviceCfg.picture_waite_number; i++){
             if (mCaptureDevice->DevDequeue(&DeQueBufIdx) < 0){
                 LOGE("VIDIOC_DQBUF Failed!!!");
-                ret = UNKNOWN_ERROR;
-                goto Pic_out;
+                return UNKNOWN_ERROR;
             }
+            if (mCaptureDevice->DevQueue(DeQueBufIdx) < 0 )
+                return UNKNOWN_ERROR;
+        }
+        return ret;
+    }
 
-            if (++i == mCaptureDeviceCfg.picture_waite_number)
-                break;
+    /* the next frame, *pIndex has to go back to the driver with DevQueue */
+    int CameraHal :: CapturePictureFrame(DMA_BUFFER *pBuf, unsigned int *pIndex)
+    {
+        unsigned int DeQueBufIdx = 0;
 
-            if (mCaptureDevice->DevQueue(DeQueBufIdx) < 0 ){
-                ret = UNKNOWN_ERROR;
-                goto Pic_out;
-            }
+        if (mCaptureDevice->DevDequeue(&DeQueBufIdx) < 0){
+            LOGE("VIDIOC_DQBUF Failed!!!");
+            return UNKNOWN_ERROR;
         }
 
-        JpegImageHeap= new MemoryHeapBase(mCaptureFrameSize);
-        if (JpegImageHeap == NULL){
-            ret = NO_MEMORY;
-            goto Pic_out;
-        }
         // do the csc if necessary
         if (mPPDeviceNeedForPic){
             mPPInputParam.user_def_paddr = mCaptureBuffers[DeQueBufIdx].phy_offset;
             mPPOutputParam.user_def_paddr = mPPbuf[0].phy_offset;
-            mPPDevice->PPDeviceInit(&mPPInputParam, &mPPOutputParam);
-            mPPDevice->DoPorcess(&(mCaptureBuffers[DeQueBufIdx]), &(mPPbuf[0]));
-            mPPDevice->PPDeviceDeInit();
-            Buf_input = mPPbuf[0];
+            mPPScheduler->process(mPPClient, &mPPInputParam, &mPPOutputParam,
+                    &(mCaptureBuffers[DeQueBufIdx]), &(mPPbuf[0]));
+            *pBuf = mPPbuf[0];
         }else{
-            Buf_input = mCaptureBuffers[DeQueBufIdx];
+            *pBuf = mCaptureBuffers[DeQueBufIdx];
+        }
+        *pIndex = DeQueBufIdx;
+        return NO_ERROR;
+    }
+
+    void CameraHal :: StopPictureCapture(bool restartPreview)
+    {
+        if (mPictureStreaming){
+            if (mPPDeviceNeedForPic)
+                ClosePPClient();
+            mCaptureDevice->DevStop();
+            ReleaseCaptureBuffers();
+            mPictureStreaming = false;
+        }
+
+        if (restartPreview){
+            //the encoding runs while the preview is already back
+            if (CameraHALStartPreview() < 0)
+                CAMERA_HAL_ERR("Fail to restart the preview after the picture");
+        }else{
+            CloseCaptureDevice();
+        }
+    }
+
+    int CameraHal :: cameraHALTakePicture(sp<MemoryBase> &JpegMemBase)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int ret = NO_ERROR;
+        unsigned int DeQueBufIdx = 0;
+        DMA_BUFFER Buf_input;
+        bool restartPreview = false;
+        DMA_BUFFER picture;
+        unsigned int picFmt = 0, frameSize = 0;
+
+        if (mJpegEncoder == NULL){
+            CAMERA_HAL_ERR("the jpeg encoder is NULL");
+            return BAD_VALUE;
         }
+        picture.virt_start = NULL;
+
+        /*
+         * The preview is stopped and restarted with mLock held, so stopPreview
+         * and startPreview can not come in between. The capture device is
+         * kept open, only its configuration and buffers are changed. The
+         * callbacks and the encoding are done after mLock is released, the
+         * shutter callback calls back into the HAL.
+         */
+        mLock.lock();
+        if ((ret = StartPictureCapture(&restartPreview)) < 0)
+            goto Pic_stop;
+        picFmt = mPictureEncodeFormat;
+        frameSize = mCaptureFrameSize;
+
+        if ((ret = CapturePictureFrame(&Buf_input, &DeQueBufIdx)) < 0)
+            goto Pic_stop;
 
-        Buf_output.virt_start = (unsigned char *)(JpegImageHeap->getBase());
         CAMERA_HAL_LOG_INFO("Generated a picture");
 
-        if (mMsgEnabled & CAMERA_MSG_SHUTTER) {
-            CAMERA_HAL_LOG_INFO("CAMERA_MSG_SHUTTER");
-            mNotifyCb(CAMERA_MSG_SHUTTER, 0, 0, mCallbackCookie);
+        //take the frame out of the capture buffers, they go with the capture
+        if ((ret = CopyPictureFrame(&Buf_input, frameSize, &picture)) < 0)
+            goto Pic_stop;
+        SetThumbSource(NULL);
+
+Pic_stop:
+        StopPictureCapture(restartPreview);
+        mLock.unlock();
+
+        if (picture.virt_start != NULL){
+            if (mMsgEnabled & CAMERA_MSG_SHUTTER) {
+                CAMERA_HAL_LOG_INFO("CAMERA_MSG_SHUTTER");
+                mNotifyCb(CAMERA_MSG_SHUTTER, 0, 0, mCallbackCookie);
+            }
+            ret = EncodePicture(&picture, picFmt, frameSize, JpegMemBase);
+            free(picture.virt_start);
+        }
+
+        return ret;
+
+    }
+
+    /*
+     * A burst streams count frames at the picture size. Every frame is
+     * copied into a free slot and handed to the encode threads, one per
+     * encoder of the pool, so the capture only waits when all the slots
+     * are taken. The deliver thread sends the pictures in the capture
+     * order; it is the only one to call back, as the callback may need
+     * mLock, which is held while the frames are captured.
+     */
+    int CameraHal :: cameraHALTakeBurst(int count)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int ret = NO_ERROR;
+        int i, slot, captured = 0;
+        unsigned int DeQueBufIdx = 0;
+        DMA_BUFFER Buf_input;
+        bool restartPreview = false;
+
+        if (mJpegEncoder == NULL){
+            CAMERA_HAL_ERR("the jpeg encoder is NULL");
+            return BAD_VALUE;
+        }
+
+        mLock.lock();
+        if ((ret = StartPictureCapture(&restartPreview)) < 0)
+            goto Burst_stop;
+        if ((ret = StartBurst(count)) < 0)
+            goto Burst_stop;
+
+        for (i = 0; i < count; i++){
+            if (!mBurstFreeQueue.pop(&slot))
+                break;
+            if ((ret = CapturePictureFrame(&Buf_input, &DeQueBufIdx)) < 0){
+                mBurstFreeQueue.push(slot);
+                break;
+            }
+
+            mBurstShots[i].captureTime = systemTime(SYSTEM_TIME_MONOTONIC);
+            mBurstSlots[slot].seq = i;
+            memcpy(mBurstSlots[slot].frame, Buf_input.virt_start, mBurstFrameSize);
+            if (mCaptureDevice->DevQueue(DeQueBufIdx) < 0){
+                mBurstFreeQueue.push(slot);
+                ret = UNKNOWN_ERROR;
+                break;
+            }
+            mBurstEncQueue.push(slot);
+            captured ++;
+        }
+        CAMERA_HAL_LOG_INFO("burst captured %d of %d frames", captured, count);
+
+Burst_stop:
+        StopPictureCapture(restartPreview);
+        mLock.unlock();
+
+        //the last pictures are encoded while the preview runs
+        FinishBurst(captured);
+        return ret;
+    }
+
+    int CameraHal :: StartBurst(int count)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int i;
+
+        mBurstFrameSize = mCaptureFrameSize;
+        mBurstSlotNum = count < BURST_QUEUE_DEPTH ? count : BURST_QUEUE_DEPTH;
+        mBurstFreeQueue.reset("burst-free", mBurstSlotNum);
+        mBurstEncQueue.reset("burst-encode", mBurstSlotNum);
+        for (i = 0; i < mBurstSlotNum; i++){
+            mBurstSlots[i].frame = (unsigned char *)malloc(mBurstFrameSize);
+            if (mBurstSlots[i].frame == NULL)
+                return NO_MEMORY;
+            mBurstFreeQueue.push(i);
+        }
+
+        {
+            Mutex::Autolock lock(mBurstLock);
+            for (i = 0; i < count; i++){
+                mBurstShots[i].jpeg = NULL;
+                mBurstShots[i].ready = false;
+            }
+            mBurstNextSeq = 0;
+            mBurstCaptured = 0;
+            mBurstCaptureDone = false;
+            memset(&mBurstStats, 0, sizeof(mBurstStats));
+            mBurstStats.requested = count;
+        }
+
+        //the pool keeps its encoders, the first one is the picture encoder
+        mJpegEncCfg.ThumbSrc = NULL;
+        mBurstEncoders[0] = mJpegEncoder;
+        mBurstEncoderNum = count < BURST_ENCODER_NUM ? count : BURST_ENCODER_NUM;
+        for (i = 0; i < mBurstEncoderNum; i++){
+            if (mBurstEncoders[i] == NULL)
+                mBurstEncoders[i] = createJpegEncoder(mJpegEncoderType);
+            if (mBurstEncoders[i] == NULL || PrepareJpegEncoder(mBurstEncoders[i]) < 0){
+                CAMERA_HAL_ERR("burst: only %d jpeg encoders", i);
+                mBurstEncoders[i] = NULL;
+                break;
+            }
         }
+        mBurstEncoderNum = i;
+        if (mBurstEncoderNum == 0)
+            return UNKNOWN_ERROR;
+        {
+            Mutex::Autolock lock(mBurstLock);
+            mBurstStats.encoders = mBurstEncoderNum;
+        }
+
+        for (i = 0; i < mBurstEncoderNum; i++)
+            mBurstEncodeThreads[i] = new BurstEncodeThread(this, i);
+        mBurstDeliverThread = new BurstDeliverThread(this);
+        return NO_ERROR;
+    }
 
-        if (mJpegEncoder->DoEncode(&Buf_input,&Buf_output,&JpegEncConf) < 0){
-            ret = UNKNOWN_ERROR;
-            goto Pic_out;
+    void CameraHal :: FinishBurst(int captured)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int i;
+
+        {
+            Mutex::Autolock lock(mBurstLock);
+            mBurstCaptured = captured;
+            mBurstCaptureDone = true;
+            mBurstCond.broadcast();
+            //stopping the threads drops what is still queued, wait for every captured frame first
+            while (mBurstDeliverThread != 0 && mBurstNextSeq < mBurstCaptured)
+                mBurstCond.wait(mBurstLock);
+        }
+        if (mBurstDeliverThread != 0){
+            mBurstDeliverThread->requestExitAndWait();
+            mBurstDeliverThread.clear();
+        }
+
+        mBurstFreeQueue.abort();
+        mBurstEncQueue.abort();
+        for (i = 0; i < mBurstEncoderNum; i++){
+            if (mBurstEncodeThreads[i] != 0){
+                mBurstEncodeThreads[i]->requestExitAndWait();
+                mBurstEncodeThreads[i].clear();
+            }
         }
+        for (i = 0; i < mBurstSlotNum; i++){
+            if (mBurstSlots[i].frame != NULL)
+                free(mBurstSlots[i].frame);
+            mBurstSlots[i].frame = NULL;
+        }
+        mBurstSlotNum = 0;
+        mBurstEncoderNum = 0;
 
-        JpegMemBase = new MemoryBase(JpegImageHeap, 0, JpegEncConf.output_jpeg_size);
+        Mutex::Autolock lock(mBurstLock);
+        if (mBurstStats.delivered > 0)
+            CAMERA_HAL_LOG_INFO("burst: %u pictures in %lld ms", mBurstStats.delivered,
+                    (long long)((mBurstStats.lastDelivery - mBurstStats.firstCapture) / 1000000));
+    }
 
-Pic_out:
-        mCaptureDevice->DevStop();
-        mCaptureDevice->DevDeAllocate();
-        CloseCaptureDevice();
+    int CameraHal :: burstEncodeThread(int encoder)
+    {
+        DMA_BUFFER Buf_input;
+        sp<MemoryBase> JpegMemBase;
+        int slot, seq;
 
-        if ((JpegMemBase != NULL) && (mMsgEnabled & CAMERA_MSG_COMPRESSED_IMAGE)) {
-            CAMERA_HAL_LOG_INFO("==========CAMERA_MSG_COMPRESSED_IMAGE==================");
-            mDataCb(CAMERA_MSG_COMPRESSED_IMAGE, JpegMemBase, mCallbackCookie);
-        }
+        if (!mBurstEncQueue.pop(&slot))
+            return UNKNOWN_ERROR; //exit the thread
+        seq = mBurstSlots[slot].seq;
 
+        Buf_input.virt_start = mBurstSlots[slot].frame;
+        Buf_input.phy_offset = 0;
+        Buf_input.length = mBurstFrameSize;
+        if (EncodeToHeap(mBurstEncoders[encoder], &Buf_input, mBurstFrameSize, JpegMemBase) < 0)
+            JpegMemBase = NULL;
+        if (JpegMemBase == NULL)
+            CAMERA_HAL_ERR("burst: fail to encode picture %d", seq);
+        //the frame is not needed any more, the capture can take the slot
+        mBurstFreeQueue.push(slot);
 
-        return ret;
+        Mutex::Autolock lock(mBurstLock);
+        mBurstShots[seq].jpeg = JpegMemBase;
+        mBurstShots[seq].ready = true;
+        mBurstCond.broadcast();
+        return NO_ERROR;
+    }
+
+    int CameraHal :: burstDeliverThread()
+    {
+        sp<MemoryBase> JpegMemBase;
+        nsecs_t now, latency;
+        int seq;
 
+        {
+            Mutex::Autolock lock(mBurstLock);
+            for (;;){
+                if (mBurstNextSeq < BURST_MAX_FRAMES && mBurstShots[mBurstNextSeq].ready)
+                    break;
+                if (mBurstCaptureDone && mBurstNextSeq >= mBurstCaptured)
+                    return UNKNOWN_ERROR; //exit the thread
+                mBurstCond.wait(mBurstLock);
+            }
+            seq = mBurstNextSeq;
+            JpegMemBase = mBurstShots[seq].jpeg;
+            mBurstShots[seq].jpeg = NULL;
+        }
+
+        //the shutter of every picture comes with it, out of mLock
+        if (mMsgEnabled & CAMERA_MSG_SHUTTER)
+            mNotifyCb(CAMERA_MSG_SHUTTER, 0, 0, mCallbackCookie);
+        SendPicture(JpegMemBase);
+
+        Mutex::Autolock lock(mBurstLock);
+        now = systemTime(SYSTEM_TIME_MONOTONIC);
+        latency = now - mBurstShots[seq].captureTime;
+        if (mBurstStats.delivered == 0){
+            mBurstStats.firstCapture = mBurstShots[seq].captureTime;
+            mBurstStats.latencyMin = latency;
+        }
+        mBurstStats.delivered ++;
+        mBurstStats.lastDelivery = now;
+        mBurstStats.latencySum += latency;
+        if (latency < mBurstStats.latencyMin)
+            mBurstStats.latencyMin = latency;
+        if (latency > mBurstStats.latencyMax)
+            mBurstStats.latencyMax = latency;
+        mBurstNextSeq ++;
+        mBurstCond.broadcast();
+        return NO_ERROR;
     }
 
     int CameraHal :: GetJpegEncoderParam()
@@ -922,6 +1832,18 @@ Pic_out:
                 }
             }
 
+            if (i == MAX_QUERY_FMT_TIMES){
+                //some uvc cameras only give the other byte order
+                for(i =0; i< MAX_QUERY_FMT_TIMES; i ++){
+                    if (mCaptureSupportedFormat[i] == V4L2_PIX_FMT_UYVY){
+                        CAMERA_HAL_LOG_RUNTIME("get the correct format [%d] is %x", i, mCaptureSupportedFormat[i]);
+                        mPPDeviceNeed = true;
+                        mPreviewCapturedFormat = V4L2_PIX_FMT_UYVY;
+                        break;
+                    }
+                }
+            }
+
             CAMERA_HAL_LOG_INFO("mPreviewCapturedFormat :%c%c%c%c\n",
                     mPreviewCapturedFormat & 0xFF, (mPreviewCapturedFormat >> 8) & 0xFF,
                     (mPreviewCapturedFormat >> 16) & 0xFF, (mPreviewCapturedFormat >> 24) & 0xFF);
@@ -936,7 +1858,7 @@ Pic_out:
         return ret;
     }
 
-    int CameraHal :: PrepareJpegEncoder()
+    int CameraHal :: PrepareJpegEncoder(const sp<JpegEncoderInterface> &encoder)
     {
         int ret = NO_ERROR;
         struct jpeg_enc_make_info_t make_info;
@@ -961,6 +1883,11 @@ Pic_out:
         mParameters.getPictureSize((int *)&(mJpegEncCfg.PicWidth), (int *)&(mJpegEncCfg.PicHeight));
         mJpegEncCfg.ThumbWidth = (unsigned int)mParameters.getInt(CameraParameters::KEY_JPEG_THUMBNAIL_WIDTH);
         mJpegEncCfg.ThumbHeight =(unsigned int)mParameters.getInt(CameraParameters::KEY_JPEG_THUMBNAIL_HEIGHT);
+        //a missing key is -1, the encoder takes its default then
+        mJpegEncCfg.Quality = mParameters.getInt(CameraParameters::KEY_JPEG_QUALITY) > 0 ?
+            mParameters.getInt(CameraParameters::KEY_JPEG_QUALITY) : 0;
+        mJpegEncCfg.ThumbQuality = mParameters.getInt(CameraParameters::KEY_JPEG_THUMBNAIL_QUALITY) > 0 ?
+            mParameters.getInt(CameraParameters::KEY_JPEG_THUMBNAIL_QUALITY) : 0;
         CAMERA_HAL_LOG_INFO("the pic width %d, height %d, fmt %d", mJpegEncCfg.PicWidth, mJpegEncCfg.PicHeight, mJpegEncCfg.BufFmt);
         CAMERA_HAL_LOG_INFO("the thumbnail width is %d, height is %d", mJpegEncCfg.ThumbWidth, mJpegEncCfg.ThumbHeight);
         //set focallength info
@@ -1121,36 +2048,64 @@ Pic_out:
             mJpegEncCfg.pGps_info = NULL;
         }
 
-        if (mJpegEncoder->JpegEncoderInit(&mJpegEncCfg)< 0){
+        if (encoder->JpegEncoderInit(&mJpegEncCfg)< 0){
             CAMERA_HAL_ERR("Jpeg Encoder Init error !!!");
             return UNKNOWN_ERROR;
         }
 
         return ret;
     }
-    status_t CameraHal::CameraHALStartPreview()
+    void CameraHal :: GetPreviewConfig(PREVIEW_CONFIG *pConfig)
     {
-        CAMERA_HAL_LOG_FUNC;
-        status_t ret = NO_ERROR;
         int  max_fps, min_fps;
-        mParameters.getPreviewSize((int *)&(mCaptureDeviceCfg.width),(int *)&(mCaptureDeviceCfg.height));
-        mCaptureDeviceCfg.fmt = mPreviewCapturedFormat;
-        mCaptureDeviceCfg.rotate = (SENSOR_PREVIEW_ROTATE)mPreviewRotate;
-        mCaptureDeviceCfg.tv.numerator = 1;
+        const char *previewFormat = mParameters.getPreviewFormat();
+
+        memset(pConfig, 0, sizeof(PREVIEW_CONFIG));
+        mParameters.getPreviewSize(&pConfig->previewWidth, &pConfig->previewHeight);
+        GetCallbackSize(mParameters, &pConfig->callbackWidth, &pConfig->callbackHeight);
+        if (previewFormat != NULL)
+            strncpy(pConfig->previewFormat, previewFormat, sizeof(pConfig->previewFormat) - 1);
+
+        pConfig->capture.width = pConfig->previewWidth;
+        pConfig->capture.height = pConfig->previewHeight;
+        pConfig->capture.fmt = mPreviewCapturedFormat;
+        pConfig->capture.rotate = (SENSOR_PREVIEW_ROTATE)mPreviewRotate;
+
+        //in the zsl mode the pp device scales the full size frames for the preview
+        pConfig->zsl = ZslAvailable();
+        if (pConfig->zsl){
+            mParameters.getPictureSize((int *)&(pConfig->capture.width),(int *)&(pConfig->capture.height));
+            CAMERA_HAL_LOG_INFO("zsl preview: capture %dx%d, preview %dx%d",
+                    pConfig->capture.width, pConfig->capture.height,
+                    pConfig->previewWidth, pConfig->previewHeight);
+        }
+        pConfig->capture.tv.numerator = 1;
         mCaptureDevice->GetDevName(mCameraSensorName);
         if (strstr(mCameraSensorName, "uvc") == NULL){
         //according to google's doc getPreviewFrameRate & getPreviewFpsRange should support both.
         // so here just a walkaround, if the app set the frameRate, will follow this frame rate.
         if (mParameters.getPreviewFrameRate() >= 15)
-            mCaptureDeviceCfg.tv.denominator = mParameters.getPreviewFrameRate();
+            pConfig->capture.tv.denominator = mParameters.getPreviewFrameRate();
         else{
             mParameters.getPreviewFpsRange(&min_fps, &max_fps);
             CAMERA_HAL_LOG_INFO("###start the capture the fps is %d###", max_fps);
-            mCaptureDeviceCfg.tv.denominator = max_fps/1000;
+            pConfig->capture.tv.denominator = max_fps/1000;
         }
         }else{
-                mCaptureDeviceCfg.tv.denominator = 15;
+                pConfig->capture.tv.denominator = 15;
         }
+    }
+
+    status_t CameraHal :: CameraHALPreparePreview(const PREVIEW_CONFIG *pConfig)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        status_t ret = NO_ERROR;
+
+        mPreviewWidth = pConfig->previewWidth;
+        mPreviewHeight = pConfig->previewHeight;
+        mCaptureDeviceCfg = pConfig->capture;
+        mZslEnabled = pConfig->zsl;
+        mPPDeviceNeed = (mPreviewCapturedFormat != mPreviewFormat) || mZslEnabled;
         mCaptureBufNum = PREVIEW_CAPTURE_BUFFER_NUM;
         mPPbufNum = POST_PROCESS_BUFFER_NUM;
         mTakePicFlag = false;
@@ -1159,6 +2114,11 @@ Pic_out:
             CAMERA_HAL_ERR("PrepareCaptureDevices error ");
             return ret;
         }
+        mPPInline = mPPDeviceNeed && !mZslEnabled && CanConvertInline();
+        if (mPPDeviceNeed && !mPPInline && mPPDevice == NULL){
+            CAMERA_HAL_ERR("The preview needs a post process device");
+            return BAD_VALUE;
+        }
         if (mPPDeviceNeed){
             if ((ret = PreparePostProssDevice()) < 0){
                 CAMERA_HAL_ERR("PreparePostProssDevice error");
@@ -1169,6 +2129,27 @@ Pic_out:
             CAMERA_HAL_ERR("PreparePreviwBuf error");
             return ret;
         }
+        return ret;
+    }
+
+    status_t CameraHal::CameraHALStartPreview()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        status_t ret = NO_ERROR;
+        PREVIEW_CONFIG config;
+
+        mPreviewStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        mFirstFrameTime = 0;
+        GetPreviewConfig(&config);
+        mPreviewWarmStart = mWarm && memcmp(&config, &mWarmConfig, sizeof(config)) == 0;
+        if (mWarm && !mPreviewWarmStart){
+            CAMERA_HAL_LOG_INFO("The parameters changed after the warm-up, prepare the preview again");
+            CoolDown();
+        }
+        mWarm = false;
+
+        if (!mPreviewWarmStart && (ret = CameraHALPreparePreview(&config)) < 0)
+            return ret;
 
         if ((ret = PreparePreviwMisc()) < 0){
             CAMERA_HAL_ERR("PreparePreviwMisc error");
@@ -1181,12 +2162,71 @@ Pic_out:
         }
         return ret;
     }
+
+    void CameraHal :: startWarmup()
+    {
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("rw.camera.warmup", value, "0");
+        if (strcmp(value, "1") != 0)
+            return;
+        mWarmupThread = new WarmupThread(this);
+    }
+
+    /*
+     * The warm-up holds mLock, so setParameters waits for it. The other
+     * calls that touch the capture device join the thread first, a
+     * preview started with other parameters throws the warm-up away.
+     */
+    int CameraHal :: warmupThread()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        Mutex::Autolock lock(mLock);
+
+        if (mPreviewRunning || mWarm)
+            return NO_ERROR;
+
+        GetPreviewConfig(&mWarmConfig);
+        if (CameraHALPreparePreview(&mWarmConfig) < 0){
+            CAMERA_HAL_ERR("The preview warm-up failed, startPreview will prepare it again");
+            CoolDown();
+            return UNKNOWN_ERROR;
+        }
+        mWarm = true;
+        CAMERA_HAL_LOG_INFO("The preview is warmed up in %lld ms",
+                (long long)((systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000));
+        return NO_ERROR;
+    }
+
+    void CameraHal :: WaitWarmup()
+    {
+        if (mWarmupThread != 0){
+            mWarmupThread->requestExitAndWait();
+            mWarmupThread.clear();
+        }
+    }
+
+    void CameraHal :: CoolDown()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        //what the warm-up prepared goes back, the device stays open
+        mWarm = false;
+        if (mPmemAllocator != NULL){
+            for (unsigned int i = 0; i < mPPbufNum; i++)
+                mPmemAllocator->deAllocate(&mPPbuf[i]);
+            mPmemAllocator = NULL;
+        }
+        mCaptureDevice->DevStop();
+        ReleaseCaptureBuffers();
+    }
+
     void CameraHal::CameraHALStopPreview()
     {
         CAMERA_HAL_LOG_FUNC;
         if (mPreviewRunning != 0)	{
             CameraHALStopThreads();
-            CameraHALStopMisc();
+            CameraHALStopMisc(true);
             CAMERA_HAL_LOG_INFO("camera hal stop preview done");
         }else{
             CAMERA_HAL_LOG_INFO("Camera hal already stop preview");
@@ -1198,6 +2238,7 @@ Pic_out:
     {
         CAMERA_HAL_LOG_FUNC;
         mPreviewRunning = 0;
+        AbortStageSignals();
         if (mCaptureFrameThread!= 0){
             mCaptureFrameThread->requestExitAndWait();
             mCaptureFrameThread.clear();
@@ -1212,34 +2253,172 @@ Pic_out:
             mPreviewShowFrameThread->requestExitAndWait();
             mPreviewShowFrameThread.clear();
         }
+        if (mPreviewCallbackThread!= 0){
+            mPreviewCallbackThread->requestExitAndWait();
+            mPreviewCallbackThread.clear();
+        }
 
         if (mEncodeFrameThread!= 0){
             mEncodeFrameThread->requestExitAndWait();
             mEncodeFrameThread.clear();
         }
+        ReleaseVideoFrames(false);
+        //a zsl or preview picture copies its frames out of the preview buffers
+        WaitPictureFrames();
         return ;
     }
 
-    void CameraHal :: CameraHALStopMisc()
+    void CameraHal :: AbortStageSignals()
     {
         CAMERA_HAL_LOG_FUNC;
-        sem_destroy(&avab_dequeue_frame);
-        sem_destroy(&avab_show_frame);
-        sem_destroy(&avab_enc_frame);
-        sem_destroy(&avab_enc_frame_finish);
-        if(mPPDeviceNeed){
-            sem_destroy(&avab_pp_in_frame);
-            sem_destroy(&avab_pp_out_frame);
+        //wake up every stage thread, they will leave their loop
+        mStageAborted = true;
+        avab_dequeue_frame.abort();
+        avab_pp_in_frame.abort();
+        mPPFreeQueue.abort();
+        mShowQueue.abort();
+        mCallbackQueue.abort();
+        mEncQueue.abort();
+        mPictureQueue.abort();
+
+        Mutex::Autolock lock(mZslLock);
+        mZslCond.broadcast();
+    }
+
+    DMA_BUFFER *CameraHal :: getFrameBuffer(int index)
+    {
+        if (mPPDeviceNeed)
+            return &mPPbuf[index];
+        return &mCaptureBuffers[index];
+    }
+
+    void CameraHal :: dispatchFrame(int index, int captureIndex)
+    {
+        mFrameTimestamp[index] = mCaptureTimestamp[captureIndex];
+        mFrameSequence[index] = mCaptureSequence[captureIndex];
+        if (mPPDeviceNeed)
+            recordLatency(LATENCY_PP, mFrameTimestamp[index], mFrameSequence[index]);
+
+        //the producer holds one reference until every consumer has the frame
+        android_atomic_release_store(1, &mFrameRefs[index]);
+
+        sendFrame(&mShowQueue, index);
+        if (callbackDue())
+            sendFrame(&mCallbackQueue, index);
+        if (mMsgEnabled & CAMERA_MSG_PREVIEW_FRAME)
+            mCallbackFrameCount ++;
+        if ((mMsgEnabled & CAMERA_MSG_VIDEO_FRAME) && mRecordRunning)
+            sendFrame(&mEncQueue, index);
+        if (android_atomic_release_cas(1, 0, &mPictureRequest) == 0)
+            sendFrame(&mPictureQueue, index);
+
+        releaseFrame(index);
+    }
+
+    bool CameraHal :: callbackDue()
+    {
+        return (mMsgEnabled & CAMERA_MSG_PREVIEW_FRAME) && (mCallbackFrameCount % mCallbackDivisor) == 0;
+    }
+
+    int CameraHal :: nextPreviewHeapBuf()
+    {
+        return (uint32_t)android_atomic_inc(&preview_heap_buf_head) % mPreviewHeapBufNum;
+    }
+
+    bool CameraHal :: CanConvertInline()
+    {
+        //only a format change with no IPU to do it, the pp thread would be one more hop
+        if (mCaptureDeviceCfg.width != mPreviewWidth || mCaptureDeviceCfg.height != mPreviewHeight)
+            return false;
+        if (!isPacked422Convertible(mCaptureDeviceCfg.fmt, mPreviewFormat))
+            return false;
+        if (mPPDevice != NULL && mPPDevice->PPDeviceIsHardware())
+            return false;
+        CAMERA_HAL_LOG_INFO("The capture thread converts the preview frames");
+        return true;
+    }
+
+    int CameraHal :: convertInline(int captureIndex)
+    {
+        int index = 0, cbBuf = -1;
+        uint8_t *second = NULL;
+        int ret;
+
+        if (!mPPFreeQueue.pop(&index))
+            return UNKNOWN_ERROR;
+
+        //the callback buffer is written in the same pass when it needs no scaling
+        mFrameCbBuf[index] = -1;
+        if (callbackDue() && mCallbackScaleBuf == NULL && mPreviewCbFormat != V4L2_PIX_FMT_RGB565){
+            cbBuf = nextPreviewHeapBuf();
+            second = (uint8_t *)mPreviewBuffers[cbBuf]->pointer();
+        }
+        ret = convertPacked422((uint8_t *)mCaptureBuffers[captureIndex].virt_start, mCaptureDeviceCfg.fmt,
+                mPreviewWidth, mPreviewHeight, (uint8_t *)mPPbuf[index].virt_start, mPreviewFormat,
+                second, mPreviewCbFormat);
+        QueueCaptureBuffer(captureIndex);
+        if (ret < 0){
+            CAMERA_HAL_ERR("Convert the captured frame error");
+            mPPFreeQueue.push(index);
+            return NO_ERROR;
+        }
+        mFrameCbBuf[index] = cbBuf;
+
+        dispatchFrame(index, captureIndex);
+        return NO_ERROR;
+    }
+
+    void CameraHal :: recordLatency(CAMERA_LATENCY_STAGE stage, nsecs_t captureTime, unsigned int sequence)
+    {
+        nsecs_t latency = systemTime(SYSTEM_TIME_MONOTONIC) - captureTime;
+        char buffer[64];
+        int len;
+
+        mStageLatency[stage].record(latency);
+        if (mTraceFd >= 0){
+            len = snprintf(buffer, sizeof(buffer), "camera %s frame %u %lld us\n",
+                    mStageLatency[stage].getName(), sequence, (long long)(latency / 1000));
+            write(mTraceFd, buffer, len);
         }
+    }
+
+    void CameraHal :: sendFrame(CameraFrameQueue *queue, int index)
+    {
+        int dropped;
+
+        android_atomic_inc(&mFrameRefs[index]);
+        dropped = queue->push(index);
+        if (dropped >= 0){
+            CAMERA_HAL_LOG_RUNTIME("%s is late, drop frame %d", queue->getName(), dropped);
+            releaseFrame(dropped);
+        }
+    }
+
+    void CameraHal :: releaseFrame(int index)
+    {
+        if (android_atomic_dec(&mFrameRefs[index]) != 1)
+            return;
+
+        if (!mPPDeviceNeed)
+            QueueCaptureBuffer(index);
+        else
+            mPPFreeQueue.push(index);
+    }
+
+    void CameraHal :: CameraHALStopMisc(bool closeDevice)
+    {
+        CAMERA_HAL_LOG_FUNC;
         if(mPPDeviceNeed){
+            ClosePPClient();
             for (unsigned int i = 0; i < mPPbufNum; i++){
                 mPmemAllocator->deAllocate(&mPPbuf[i]);
             }
             mPmemAllocator = NULL;
         }
         mCaptureDevice->DevStop();
-        mCaptureDevice->DevDeAllocate();
-        CloseCaptureDevice();
+        ReleaseCaptureBuffers();
+        if (closeDevice)
+            CloseCaptureDevice();
 
     }
     status_t CameraHal :: PrepareCaptureDevices()
@@ -1258,7 +2437,7 @@ Pic_out:
         }
         mCaptureFrameSize = mCaptureDeviceCfg.framesize;
 
-        if (mCaptureDevice->DevAllocateBuf(mCaptureBuffers,&CaptureBufNum)< 0){
+        if (AllocateCaptureBuffers(&CaptureBufNum) < 0){
             CAMERA_HAL_ERR("capture device allocat buf error");
             return BAD_VALUE;
         }
@@ -1277,70 +2456,197 @@ Pic_out:
         return ret;
     }
 
+    /*
+     * With rw.camera.capture.memory=userptr the sensor DMAs straight into
+     * pmem slots of the HAL, which the post process and the encoders take
+     * by their physical address. The driver's own buffers are used when
+     * it is not set or the driver can not import them.
+     */
+    status_t CameraHal :: AllocateCaptureBuffers(unsigned int *pBufNum)
+    {
+        char value[PROPERTY_VALUE_MAX];
+        unsigned int i;
+
+        mCaptureMemoryType = CAPTURE_MEMORY_MMAP;
+        property_get("rw.camera.capture.memory", value, "mmap");
+        if (strcmp(value, "userptr") == 0){
+            mCapturePmemAllocator = new PmemAllocator(*pBufNum, mCaptureFrameSize);
+            if (mCapturePmemAllocator != NULL && mCapturePmemAllocator->err_ret >= 0){
+                for (i = 0; i < *pBufNum; i++){
+                    if (mCapturePmemAllocator->allocate(&mCaptureBuffers[i], mCaptureFrameSize) < 0)
+                        break;
+                    mCapturePmemNum ++;
+                }
+                if (mCapturePmemNum == *pBufNum &&
+                        mCaptureDevice->DevImportBuf(mCaptureBuffers, NULL, pBufNum, CAPTURE_MEMORY_USERPTR) >= 0){
+                    mCaptureMemoryType = CAPTURE_MEMORY_USERPTR;
+                    CAMERA_HAL_LOG_INFO("Capture into %d pmem buffers", *pBufNum);
+                    return NO_ERROR;
+                }
+            }
+            CAMERA_HAL_LOG_INFO("Can not import pmem buffers, capture into the driver's");
+            FreeCapturePmem();
+        }
+
+        if (mCaptureDevice->DevAllocateBuf(mCaptureBuffers, pBufNum) < 0)
+            return BAD_VALUE;
+        return NO_ERROR;
+    }
+
+    void CameraHal :: FreeCapturePmem()
+    {
+        //the driver may have taken fewer than were allocated
+        for (unsigned int i = 0; i < mCapturePmemNum; i++)
+            mCapturePmemAllocator->deAllocate(&mCaptureBuffers[i]);
+        mCapturePmemNum = 0;
+        mCapturePmemAllocator = NULL;
+    }
+
+    void CameraHal :: ReleaseCaptureBuffers()
+    {
+        mCaptureDevice->DevDeAllocate();
+        if (mCapturePmemAllocator != NULL)
+            FreeCapturePmem();
+        mCaptureMemoryType = CAPTURE_MEMORY_MMAP;
+    }
+
     status_t CameraHal::PreparePostProssDevice()
     {
 
         CAMERA_HAL_LOG_FUNC;
         status_t ret = NO_ERROR;
-        unsigned int targetFmt;
-        if (mTakePicFlag)
+        unsigned int targetFmt, outWidth, outHeight, cropWidth, cropHeight;
+        if (mTakePicFlag){
             targetFmt = mPictureEncodeFormat;
-        else
+            outWidth = mCaptureDeviceCfg.width;
+            outHeight = mCaptureDeviceCfg.height;
+        }else{
             targetFmt = mPreviewFormat;
+            outWidth = mPreviewWidth;
+            outHeight = mPreviewHeight;
+        }
+
+        //keep the aspect ratio of the output, take the center of the input
+        cropWidth = mCaptureDeviceCfg.width;
+        cropHeight = mCaptureDeviceCfg.height;
+        if (cropWidth * outHeight > cropHeight * outWidth)
+            cropWidth = (cropHeight * outWidth / outHeight) & ~1;
+        else
+            cropHeight = (cropWidth * outHeight / outWidth) & ~1;
 
         pthread_mutex_lock(&mPPIOParamMutex);
         mPPInputParam.width = mCaptureDeviceCfg.width;
         mPPInputParam.height= mCaptureDeviceCfg.height;
         mPPInputParam.fmt   = mCaptureDeviceCfg.fmt;
-        mPPInputParam.input_crop_win.pos.x = 0;
-        mPPInputParam.input_crop_win.pos.y = 0;
-        mPPInputParam.input_crop_win.win_w = mCaptureDeviceCfg.width;
-        mPPInputParam.input_crop_win.win_h = mCaptureDeviceCfg.height;
+        mPPInputParam.input_crop_win.pos.x = ((mCaptureDeviceCfg.width - cropWidth) >> 1) & ~1;
+        mPPInputParam.input_crop_win.pos.y = ((mCaptureDeviceCfg.height - cropHeight) >> 1) & ~1;
+        mPPInputParam.input_crop_win.win_w = cropWidth;
+        mPPInputParam.input_crop_win.win_h = cropHeight;
 
-        mPPOutputParam.width = mCaptureDeviceCfg.width;
-        mPPOutputParam.height= mCaptureDeviceCfg.height;
+        mPPOutputParam.width = outWidth;
+        mPPOutputParam.height= outHeight;
         mPPOutputParam.fmt   = targetFmt;
         mPPOutputParam.rot   = 0;
         mPPOutputParam.output_win.pos.x = 0;
         mPPOutputParam.output_win.pos.y = 0;
-        mPPOutputParam.output_win.win_w = mCaptureDeviceCfg.width;
-        mPPOutputParam.output_win.win_h = mCaptureDeviceCfg.height;
+        mPPOutputParam.output_win.win_w = outWidth;
+        mPPOutputParam.output_win.win_h = outHeight;
         pthread_mutex_unlock(&mPPIOParamMutex);
+
+        //the inline conversion of the preview does not use the device
+        if (mTakePicFlag || !mPPInline)
+            ret = OpenPPClient();
         return ret;
     }
 
+    status_t CameraHal :: OpenPPClient()
+    {
+        char name[PP_SCHED_NAME_LEN];
+        nsecs_t budget = 33000000LL;
+
+        if (mPPClient >= 0)
+            return NO_ERROR;
+        if (mPPScheduler == NULL){
+            CAMERA_HAL_ERR("There is no post process device");
+            return BAD_VALUE;
+        }
+        //a frame has to be done before the next one comes
+        if (mCaptureDeviceCfg.tv.denominator != 0 && mCaptureDeviceCfg.tv.numerator != 0)
+            budget = (nsecs_t)mCaptureDeviceCfg.tv.numerator * 1000000000LL / mCaptureDeviceCfg.tv.denominator;
+        //cut the sensor name so the stream still fits
+        snprintf(name, sizeof(name), "%.23s %s", mCameraSensorName, mTakePicFlag ? "picture" : "preview");
+        mPPClient = mPPScheduler->openClient(name, budget);
+        return mPPClient < 0 ? NO_MEMORY : NO_ERROR;
+    }
+
+    void CameraHal :: ClosePPClient()
+    {
+        if (mPPClient < 0)
+            return;
+        mPPScheduler->closeClient(mPPClient);
+        mPPClient = -1;
+    }
+
     status_t CameraHal::PreparePreviwBuf()
     {
         CAMERA_HAL_LOG_FUNC;
         status_t ret = NO_ERROR;
         unsigned int i =0;
+        unsigned int PPBufSize = mCaptureFrameSize;
 
         //temply hard code here
         if (mTakePicFlag == 0){
             if(V4L2_PIX_FMT_NV12)
-                mPreviewFrameSize = mCaptureDeviceCfg.width*mCaptureDeviceCfg.height*3/2;
+                mPreviewFrameSize = mPreviewWidth*mPreviewHeight*3/2;
             else 
-                mPreviewFrameSize = mCaptureDeviceCfg.width*mCaptureDeviceCfg.height *2;
+                mPreviewFrameSize = mPreviewWidth*mPreviewHeight *2;
+            //the full size capture buffers are scaled down to the preview ones
+            if (mZslEnabled)
+                PPBufSize = mPreviewFrameSize;
+
+            //the callback stream may be smaller than the preview, it is scaled down first
+            GetCallbackSize(mParameters, (int *)&mCallbackWidth, (int *)&mCallbackHeight);
+            if (mCallbackScaleBuf)
+                free(mCallbackScaleBuf);
+            mCallbackScaleBuf = NULL;
+            if (mCallbackWidth != mPreviewWidth || mCallbackHeight != mPreviewHeight){
+                mCallbackScaleBuf = (unsigned char *)malloc(mCallbackWidth * mCallbackHeight * 3 / 2);
+                if (mCallbackScaleBuf == NULL)
+                    return NO_MEMORY;
+                CAMERA_HAL_LOG_INFO("preview callbacks at %dx%d, every %d frames",
+                        mCallbackWidth, mCallbackHeight, mCallbackDivisor);
+            }
+
+            //the callback buffers hold the frame in the format the application asked for
+            if (strcmp(mParameters.getPreviewFormat(), "yuv420p") == 0) {
+                mPreviewCbFormat = V4L2_PIX_FMT_YVU420;
+                mPreviewCbFrameSize = getYV12FrameSize(mCallbackWidth, mCallbackHeight);
+            }else if (strcmp(mParameters.getPreviewFormat(), "rgb565") == 0) {
+                mPreviewCbFormat = V4L2_PIX_FMT_RGB565;
+                mPreviewCbFrameSize = mCallbackWidth*mCallbackHeight*2;
+            }else{
+                mPreviewCbFormat = V4L2_PIX_FMT_NV21;
+                mPreviewCbFrameSize = mCallbackWidth*mCallbackHeight*3/2;
+            }
 
-            //now the preview fmt is supposed to be YUV420SP, so, it is now hard code here
             mPreviewHeap.clear();
             for (i = 0; i< mPreviewHeapBufNum; i++)
                 mPreviewBuffers[i].clear();
-            mPreviewHeap = new MemoryHeapBase(mPreviewFrameSize * mPreviewHeapBufNum);
+            mPreviewHeap = new MemoryHeapBase(mPreviewCbFrameSize * mPreviewHeapBufNum);
             if (mPreviewHeap == NULL)
                 return NO_MEMORY;
             for (i = 0; i < mPreviewHeapBufNum; i++)
-                mPreviewBuffers[i] = new MemoryBase(mPreviewHeap, mPreviewFrameSize* i, mPreviewFrameSize);
+                mPreviewBuffers[i] = new MemoryBase(mPreviewHeap, mPreviewCbFrameSize* i, mPreviewCbFrameSize);
         }
         /*allocate the buffer for IPU process*/
         if (mPPDeviceNeed || mPPDeviceNeedForPic){
-            mPmemAllocator = new PmemAllocator(mPPbufNum, mCaptureFrameSize);
+            mPmemAllocator = new PmemAllocator(mPPbufNum, PPBufSize);
 
             if(mPmemAllocator == NULL || mPmemAllocator->err_ret < 0){
                 return NO_MEMORY;
             }
             for (i = 0; i < mPPbufNum; i++){
-                if(mPmemAllocator->allocate(&(mPPbuf[i]),mCaptureFrameSize) < 0){
+                if(mPmemAllocator->allocate(&(mPPbuf[i]),PPBufSize) < 0){
                     return NO_MEMORY;
                 }
             }
@@ -1354,21 +2660,36 @@ Pic_out:
         status_t ret = NO_ERROR;
         dequeue_head = 0;
         preview_heap_buf_head = 0;
-        display_head = 0;
-        enc_head     = 0;
+        mCallbackFrameCount = 0;
         pp_in_head   = 0;
-        pp_out_head  = 0;
         error_status = 0;
-        is_first_buffer = 1;
-        last_display_index = 0;
-
-        sem_init(&avab_dequeue_frame, 0, mCaptureBufNum);
-        sem_init(&avab_show_frame, 0, 0);
-        sem_init(&avab_enc_frame, 0, 0);
-        sem_init(&avab_enc_frame_finish, 0, 0);
+        mStageAborted = false;
+        mDisplayedFrame = -1;
+        mZslCount = 0;
+        for (unsigned int i = 0; i < CAMERA_FRAME_QUEUE_MAX; i++)
+            mFrameRefs[i] = 0;
+        mLastSequence = -1;
+        mSequenceGaps = 0;
+        mRecordDrops = 0;
+        mStageLatency[LATENCY_PP].reset("pp");
+        mStageLatency[LATENCY_DISPLAY].reset("display");
+        mStageLatency[LATENCY_PREVIEW_CB].reset("preview-cb");
+        mStageLatency[LATENCY_VIDEO_CB].reset("video-cb");
+
+        avab_dequeue_frame.reset("capture", mCaptureBufNum);
+        mShowQueue.reset("display", DISPLAY_QUEUE_DEPTH);
+        mCallbackQueue.reset("preview-cb", PREVIEW_CB_QUEUE_DEPTH);
+        mEncQueue.reset("encode", VIDEO_QUEUE_DEPTH);
+        mPictureQueue.reset("picture", 1);
+        mPictureRequest = 0;
+        for (unsigned int i = 0; i < CAMERA_FRAME_QUEUE_MAX; i++)
+            mFrameCbBuf[i] = -1;
+        //named and cleared even without pp, dump() lists them
+        avab_pp_in_frame.reset("pp-in", 0);
+        mPPFreeQueue.reset("pp-free", mPPbufNum);
         if(mPPDeviceNeed){
-            sem_init(&avab_pp_in_frame, 0, 0);
-            sem_init(&avab_pp_out_frame, 0, mPPbufNum);
+            for (unsigned int i = 0; i < mPPbufNum; i++)
+                mPPFreeQueue.push(i);
         }
         return ret;
     }
@@ -1382,8 +2703,9 @@ Pic_out:
 
         mCaptureFrameThread = new CaptureFrameThread(this);
         mPreviewShowFrameThread = new PreviewShowFrameThread(this);
+        mPreviewCallbackThread = new PreviewCallbackThread(this);
         mEncodeFrameThread = new EncodeFrameThread(this);
-        if(mPPDeviceNeed){
+        if(mPPDeviceNeed && !mPPInline){
             mPostProcessThread = new PostProcessThread(this);
             if (mPostProcessThread == NULL)
                 return UNKNOWN_ERROR;
@@ -1391,6 +2713,7 @@ Pic_out:
 
         if (mCaptureFrameThread == NULL ||
                 mPreviewShowFrameThread == NULL ||
+                mPreviewCallbackThread == NULL ||
                 mEncodeFrameThread == NULL){
             return UNKNOWN_ERROR;
         }
@@ -1405,29 +2728,41 @@ Pic_out:
         CAMERA_HAL_LOG_FUNC;
 
         unsigned int DeqBufIdx = 0;
-        struct timespec ts;
+        struct capture_frame_info_t frameInfo;
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_dequeue_frame, &ts) != 0) );
-
-        if(!mPreviewRunning || error_status)
+        if (!avab_dequeue_frame.wait())
             return UNKNOWN_ERROR;
 
-        mCaptureDevice->DevDequeue(&DeqBufIdx);
-
-        nCameraBuffersQueued--;
+        if (mCaptureDevice->DevDequeue(&DeqBufIdx) < 0){
+            CAMERA_HAL_ERR("The Capture device dequeue buf error !!!!");
+            error_status = 1;
+            AbortStageSignals();
+            return INVALID_OPERATION;
+        }
 
-        buffer_index_maps[dequeue_head]=DeqBufIdx;
-        dequeue_head ++;
-        dequeue_head %= mCaptureBufNum;
+        android_atomic_dec(&nCameraBuffersQueued);
+        mCaptureTimestamp[DeqBufIdx] = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mFirstFrameTime == 0){
+            mFirstFrameTime = mCaptureTimestamp[DeqBufIdx];
+            CAMERA_HAL_LOG_INFO("The first frame came %lld ms after startPreview, %s start",
+                    (long long)((mFirstFrameTime - mPreviewStartTime) / 1000000), mPreviewWarmStart ? "warm" : "cold");
+        }
+        if (mCaptureDevice->DevGetFrameInfo(DeqBufIdx, &frameInfo) == CAPTURE_DEVICE_ERR_NONE){
+            if (mLastSequence >= 0 && frameInfo.sequence > (unsigned int)mLastSequence + 1)
+                android_atomic_add(frameInfo.sequence - mLastSequence - 1, &mSequenceGaps);
+            mLastSequence = frameInfo.sequence;
+            mCaptureSequence[DeqBufIdx] = frameInfo.sequence;
+        }
 
         if(!mPPDeviceNeed){
-            sem_post(&avab_show_frame);
-            sem_post(&avab_enc_frame);
+            dispatchFrame(DeqBufIdx, DeqBufIdx);
+        }else if (mPPInline){
+            return convertInline(DeqBufIdx);
         }else{
-            sem_post(&avab_pp_in_frame);
+            buffer_index_maps[dequeue_head]=DeqBufIdx;
+            dequeue_head ++;
+            dequeue_head %= mCaptureBufNum;
+            avab_pp_in_frame.post();
         }
 
         return NO_ERROR;
@@ -1438,206 +2773,228 @@ Pic_out:
         CAMERA_HAL_LOG_FUNC;
         int PPInIdx = 0, PPoutIdx = 0;
         DMA_BUFFER PPInBuf, PPoutBuf;
-        struct timespec ts;
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_pp_in_frame, &ts) != 0) );
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_pp_out_frame, &ts) != 0) );
+        pp_input_param_t inParam;
+        pp_output_param_t outParam;
 
-
-        if(!mPreviewRunning || error_status)
+        if (!avab_pp_in_frame.wait())
+            return UNKNOWN_ERROR;
+        if (!mPPFreeQueue.pop(&PPoutIdx))
             return UNKNOWN_ERROR;
         PPInIdx = buffer_index_maps[pp_in_head];
         PPInBuf = mCaptureBuffers[PPInIdx];
         pp_in_head ++;
         pp_in_head %= mCaptureBufNum;
 
-        PPoutIdx = pp_out_head;
         PPoutBuf = mPPbuf[PPoutIdx];
-        pp_out_head ++;
-        pp_out_head %= mPPbufNum;
 
+        //the job takes a copy, a new config does not wait for the device
         pthread_mutex_lock(&mPPIOParamMutex);
         mPPInputParam.user_def_paddr = PPInBuf.phy_offset;
         mPPOutputParam.user_def_paddr = PPoutBuf.phy_offset;
-        mPPDevice->PPDeviceInit(&mPPInputParam, &mPPOutputParam);
-        mPPDevice->DoPorcess(&PPInBuf, &PPoutBuf);
-        mPPDevice->PPDeviceDeInit();
+        inParam = mPPInputParam;
+        outParam = mPPOutputParam;
         pthread_mutex_unlock(&mPPIOParamMutex);
+        mPPScheduler->process(mPPClient, &inParam, &outParam, &PPInBuf, &PPoutBuf);
 
-        sem_post(&avab_show_frame);
-        sem_post(&avab_enc_frame);
+        dispatchFrame(PPoutIdx, PPInIdx);
 
-        if (mCaptureDevice->DevQueue(PPInIdx) < 0){
-            CAMERA_HAL_ERR("queue buf back error");
-            return INVALID_OPERATION;
-        }
-        nCameraBuffersQueued ++;
-        sem_post(&avab_dequeue_frame);
+        if (mZslEnabled)
+            ZslKeepFrame(PPInIdx);
+        else
+            QueueCaptureBuffer(PPInIdx);
 
         return NO_ERROR;
     }
+
     int CameraHal ::previewshowFrameThread()
     {
         CAMERA_HAL_LOG_FUNC;
-        struct timespec ts;
         int display_index = 0;
-        DMA_BUFFER InBuf;
-        int queue_back_index = 0;
+        int release_index = -1;
+        int hidden_index = -1;
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (!error_status && mPreviewRunning &&(sem_timedwait(&avab_show_frame, &ts) != 0) );
-
-        if ((mPreviewRunning == 0) || error_status)
+        if (!mShowQueue.pop(&display_index))
             return UNKNOWN_ERROR;
 
-        if (!mPPDeviceNeed){
-            display_index = buffer_index_maps[display_head];
-            InBuf = mCaptureBuffers[display_index];
-            display_head ++;
-            display_head %= mCaptureBufNum;
+        pthread_mutex_lock(&mOverlayMutex);
+        if (mOverlay != 0) {
+            if (mOverlay->queueBuffer((overlay_buffer_t)getFrameBuffer(display_index)->phy_offset) < 0){
+                CAMERA_HAL_ERR("queueBuffer failed. May be bcos stream was not turned on yet.");
+            }else{
+                recordLatency(LATENCY_DISPLAY, mFrameTimestamp[display_index], mFrameSequence[display_index]);
+            }
+            //the overlay shows the buffer until the next one is queued
+            release_index = mDisplayedFrame;
+            mDisplayedFrame = display_index;
         }else{
-            display_index = display_head;
-            InBuf = mPPbuf[display_index];
-            display_head ++;
-            display_head %= mPPbufNum;
+            release_index = display_index;
+            hidden_index = mDisplayedFrame;
+            mDisplayedFrame = -1;
         }
+        pthread_mutex_unlock(&mOverlayMutex);
 
-        if (mMsgEnabled & CAMERA_MSG_PREVIEW_FRAME) {
-            convertNV12toYUV420SP((uint8_t*)(InBuf.virt_start),
-                    (uint8_t*)(mPreviewBuffers[preview_heap_buf_head]->pointer()),mCaptureDeviceCfg.width, mCaptureDeviceCfg.height);
-            mDataCb(CAMERA_MSG_PREVIEW_FRAME, mPreviewBuffers[preview_heap_buf_head], mCallbackCookie);
-            preview_heap_buf_head ++;
-            preview_heap_buf_head %= mPreviewHeapBufNum;
-        }
+        if (release_index >= 0)
+            releaseFrame(release_index);
+        if (hidden_index >= 0)
+            releaseFrame(hidden_index);
 
-        pthread_mutex_lock(&mOverlayMutex);
+        return NO_ERROR;
+    }
 
-        if (mOverlay != 0) {
-            if (mOverlay->queueBuffer((overlay_buffer_t)InBuf.phy_offset) < 0){
-                CAMERA_HAL_ERR("queueBuffer failed. May be bcos stream was not turned on yet.");
-            }
+    int CameraHal :: previewcallbackThread()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int cb_index = 0, heapBuf;
+        DMA_BUFFER *CbBuf;
+        uint8_t *src;
+        nsecs_t captureTime;
+        unsigned int sequence;
 
-            if (is_first_buffer) {
-                is_first_buffer = 0;
-                last_display_index = display_index;
-                pthread_mutex_unlock(&mOverlayMutex);
-                goto show_out;
-            }
-        }
+        if (!mCallbackQueue.pop(&cb_index))
+            return UNKNOWN_ERROR;
+        //the frame may go back before the callback
+        captureTime = mFrameTimestamp[cb_index];
+        sequence = mFrameSequence[cb_index];
 
-        if (!mPPDeviceNeed){
-            if (mOverlay != 0){
-                queue_back_index = last_display_index;
-            }else{
-                queue_back_index = display_index;
-            }
+        if (!(mMsgEnabled & CAMERA_MSG_PREVIEW_FRAME)) {
+            releaseFrame(cb_index);
+            return NO_ERROR;
         }
-        pthread_mutex_unlock(&mOverlayMutex);
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=200000; // 100ms
-        } while ((sem_timedwait(&avab_enc_frame_finish, &ts) != 0)&&!error_status && mPreviewRunning );
+        //the capture thread may have converted it already
+        heapBuf = mFrameCbBuf[cb_index];
+        if (heapBuf >= 0) {
+            releaseFrame(cb_index);
+            mDataCb(CAMERA_MSG_PREVIEW_FRAME, mPreviewBuffers[heapBuf], mCallbackCookie);
+            recordLatency(LATENCY_PREVIEW_CB, captureTime, sequence);
+            return NO_ERROR;
+        }
 
-        if (!mPPDeviceNeed){
-            //queue the v4l2 buf back
-            if(mCaptureDevice->DevQueue(queue_back_index) <0){
-                CAMERA_HAL_ERR("The Capture device queue buf error !!!!");
-                return INVALID_OPERATION;
+        CbBuf = getFrameBuffer(cb_index);
+        src = (uint8_t*)(CbBuf->virt_start);
+        if (mCallbackScaleBuf != NULL) {
+            //the preview frame can go back as soon as it is scaled down
+            if (scaleNV12(src, mPreviewWidth, mPreviewHeight, mCallbackScaleBuf,
+                        mCallbackWidth, mCallbackHeight) < 0) {
+                releaseFrame(cb_index);
+                return NO_ERROR;
             }
-            last_display_index = display_index;
-            nCameraBuffersQueued++;
-            sem_post(&avab_dequeue_frame);
-        }else{
-            sem_post(&avab_pp_out_frame);
+            releaseFrame(cb_index);
+            src = mCallbackScaleBuf;
         }
+        heapBuf = nextPreviewHeapBuf();
+        convertPreviewFrame(src, (uint8_t*)(mPreviewBuffers[heapBuf]->pointer()),
+                mCallbackWidth, mCallbackHeight);
+        mDataCb(CAMERA_MSG_PREVIEW_FRAME, mPreviewBuffers[heapBuf], mCallbackCookie);
+        recordLatency(LATENCY_PREVIEW_CB, captureTime, sequence);
 
-show_out:
-
+        if (mCallbackScaleBuf == NULL)
+            releaseFrame(cb_index);
         return NO_ERROR;
     }
 
     int CameraHal :: encodeframeThread()
     {
         CAMERA_HAL_LOG_FUNC;
-        struct timespec ts;
-        unsigned int enc_index = 0, i = 0;
-        DMA_BUFFER EncBuf;
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while ((sem_timedwait(&avab_enc_frame, &ts) != 0) && !error_status &&  mPreviewRunning );
+        unsigned int i = 0;
+        int enc_index = 0;
+        DMA_BUFFER *EncBuf;
 
-        if ((mPreviewRunning == 0) || error_status)
+        if (!mEncQueue.pop(&enc_index))
             return UNKNOWN_ERROR;
 
-        if (!mPPDeviceNeed){
-            enc_index = buffer_index_maps[enc_head];
-            EncBuf = mCaptureBuffers[enc_index];
-            enc_head ++;
-            enc_head %= mCaptureBufNum;
-        }else{
-            enc_index = enc_head;
-            EncBuf = mPPbuf[enc_index];
-            enc_head ++;
-            enc_head %= mPPbufNum;
-        }
-
         if ((mMsgEnabled & CAMERA_MSG_VIDEO_FRAME) && mRecordRunning) {
             nsecs_t timeStamp = systemTime(SYSTEM_TIME_MONOTONIC);
+            nsecs_t captureTime = mFrameTimestamp[enc_index];
+            unsigned int sequence = mFrameSequence[enc_index];
+            EncBuf = getFrameBuffer(enc_index);
+            mVideoLock.lock();
             for(i = 0 ; i < mVideoBufNume; i ++) {
                 if(mVideoBufferUsing[i] == 0) {
-                    memcpy(mVideoBuffers[i]->pointer(),
-                            (void*)EncBuf.virt_start, mPreviewFrameSize);
-
+                    if (mVideoMetaDataMode) {
+                        VIDEOFRAME_BUFFER_PHY *pVideoPhy = (VIDEOFRAME_BUFFER_PHY *)mVideoBuffers[i]->pointer();
+                        pVideoPhy->phy_offset = EncBuf->phy_offset;
+                        pVideoPhy->length = EncBuf->length;
+                        //the reference of the encode queue goes to the video buffer
+                        mVideoBufferFrame[i] = enc_index;
+                        enc_index = -1;
+                    }else{
+                        memcpy(mVideoBuffers[i]->pointer(),
+                                (void*)EncBuf->virt_start, mPreviewFrameSize);
+                    }
                     mVideoBufferUsing[i] = 1;
-                    mDataCbTimestamp(timeStamp, CAMERA_MSG_VIDEO_FRAME, mVideoBuffers[i], mCallbackCookie);
                     break;
                 }
             }
-            if (i == mVideoBufNume)
-                CAMERA_HAL_LOG_INFO("no Buffer can be used for record\n");
+            mVideoLock.unlock();
+
+            if (i < mVideoBufNume){
+                mDataCbTimestamp(timeStamp, CAMERA_MSG_VIDEO_FRAME, mVideoBuffers[i], mCallbackCookie);
+                recordLatency(LATENCY_VIDEO_CB, captureTime, sequence);
+            }else{
+                android_atomic_inc(&mRecordDrops);
+                CAMERA_HAL_LOG_RUNTIME("no Buffer can be used for record\n");
+            }
         }
 
-        sem_post(&avab_enc_frame_finish);
+        if (enc_index >= 0)
+            releaseFrame(enc_index);
         return NO_ERROR;
 
     }
 
-
     status_t CameraHal :: AllocateRecordVideoBuf()
     {
         status_t ret = NO_ERROR;
         unsigned int i = 0;
+        unsigned int frameNum, bufSize;
+
+        //the frames still held by the encoder from the last recording
+        ReleaseVideoFrames(true);
+
+        Mutex::Autolock lock(mVideoLock);
         mVideoHeap.clear();
-        for(i = 0; i < mVideoBufNume; i++) {
+        for(i = 0; i < VIDEO_OUTPUT_BUFFER_NUM; i++) {
             mVideoBuffers[i].clear();
             mVideoBufferUsing[i] = 0;
         }
 
-        CAMERA_HAL_LOG_RUNTIME("Init the video Memory size %d", mPreviewFrameSize);
-        mVideoHeap = new MemoryHeapBase(mPreviewFrameSize * mVideoBufNume);
+        if (mVideoMetaDataMode) {
+            //every frame held by the encoder is lost for the preview, leave two for it
+            frameNum = mPPDeviceNeed ? mPPbufNum : mCaptureBufNum;
+            mVideoBufNume = frameNum > 3 ? frameNum - 2 : 1;
+            if (mVideoBufNume > VIDEO_OUTPUT_BUFFER_NUM)
+                mVideoBufNume = VIDEO_OUTPUT_BUFFER_NUM;
+            bufSize = sizeof(VIDEOFRAME_BUFFER_PHY);
+        }else{
+            mVideoBufNume = VIDEO_OUTPUT_BUFFER_NUM;
+            bufSize = mPreviewFrameSize;
+        }
+
+        CAMERA_HAL_LOG_RUNTIME("Init the video Memory size %d", bufSize);
+        mVideoHeap = new MemoryHeapBase(bufSize * mVideoBufNume);
         if (mVideoHeap == NULL)
             return NO_MEMORY;
         for(i = 0; i < mVideoBufNume; i++) {
             CAMERA_HAL_LOG_RUNTIME("Init Video Buffer:%d ",i);
             mVideoBuffers[i] = new MemoryBase(mVideoHeap,
-                    mPreviewFrameSize * i, mPreviewFrameSize);
+                    bufSize * i, bufSize);
         }
 
         return ret;
     }
 
+    void CameraHal :: ReleaseVideoFrames(bool requeue)
+    {
+        Mutex::Autolock lock(mVideoLock);
+        for (unsigned int i = 0; i < VIDEO_OUTPUT_BUFFER_NUM; i++) {
+            //the frames of a stopped preview are not valid any more, only forget them
+            if (mVideoBufferFrame[i] >= 0 && requeue)
+                releaseFrame(mVideoBufferFrame[i]);
+            mVideoBufferFrame[i] = -1;
+        }
+    }
+
 
     void CameraHal :: LockWakeLock()
     {
@@ -1654,32 +3011,20 @@ show_out:
         }
     }
 
-    void CameraHal::convertNV12toYUV420SP(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height)
+    void CameraHal::convertPreviewFrame(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height)
     {
-        /* Color space conversion from I420 to YUV420SP */
-        int Ysize = 0, UVsize = 0;
-        uint8_t *Yin, *Uin, *Vin, *Yout, *Uout, *Vout;
-
-        Ysize = width * height;
-        UVsize = width *  height >> 2;
-
-        Yin = inputBuffer;
-        Uin = Yin + Ysize;
-        Vin = Uin + 1;
-
-        Yout = outputBuffer;
-        Vout = Yout + Ysize;
-        Uout = Vout + 1;
-
-        memcpy(Yout, Yin, Ysize);
-
-        for(int k = 0; k < UVsize; k++) {
-            *Uout = *Uin;
-            *Vout = *Vin;
-            Uout += 2;
-            Vout += 2;
-            Uin  += 2;
-            Vin += 2;
+        /* The preview frame is always NV12 here, convert it to the callback format */
+        switch (mPreviewCbFormat) {
+            case V4L2_PIX_FMT_YVU420:
+                convertNV12toYV12(inputBuffer, outputBuffer, width, height);
+                break;
+            case V4L2_PIX_FMT_RGB565:
+                convertNV12toRGB565(inputBuffer, outputBuffer, width, height);
+                break;
+            case V4L2_PIX_FMT_NV21:
+            default:
+                convertNV12toNV21(inputBuffer, outputBuffer, width, height);
+                break;
         }
     }
 
@@ -1798,6 +3143,9 @@ show_out:
         sp<CaptureDeviceInterface> pCaptureDevice = NULL;
         sp<PostProcessDeviceInterface> pPPDevice = NULL;
         sp<JpegEncoderInterface>pJpegEncoder = NULL;
+        JPEG_ENCODER_TYPE jpegEncoderType = SOFTWARE_JPEG_ENC;
+        char value[PROPERTY_VALUE_MAX];
+        bool physAddr;
 
         if (HAL_getNumberOfCameras() ==0 ){
             CAMERA_HAL_ERR("There is no configure for Cameras");
@@ -1807,13 +3155,24 @@ show_out:
         SelectedCameraName = Camera_name[sCameraInfo[cameraId].facing];
 
         pCaptureDevice = createCaptureDevice(SelectedCameraName);
-        pPPDevice = createPPDevice();
-        pJpegEncoder = createJpegEncoder(SOFTWARE_JPEG_ENC);
+        //the replay frames are in malloc'd buffers
+        physAddr = CameraMemPool::getInstance()->hasPhysAddr() &&
+            strncmp(SelectedCameraName, REPLAY_NAME_STRING, strlen(REPLAY_NAME_STRING)) != 0;
+        pPPDevice = createPPDevice(physAddr);
+        //rw.camera.jpeg.encoder=libjpeg picks the libjpeg encoder, to compare it with the fsl one
+        property_get("rw.camera.jpeg.encoder", value, "fsl");
+        if (strcmp(value, "libjpeg") == 0)
+            jpegEncoderType = TURBO_JPEG_ENC;
+        pJpegEncoder = createJpegEncoder(jpegEncoderType);
+        if (pJpegEncoder == NULL && jpegEncoderType != SOFTWARE_JPEG_ENC){
+            jpegEncoderType = SOFTWARE_JPEG_ENC;
+            pJpegEncoder = createJpegEncoder(jpegEncoderType);
+        }
 
         CameraHal *pCameraHal = new CameraHal();
         if (pCameraHal->setCaptureDevice(pCaptureDevice) < 0 ||
                 pCameraHal->setPostProcessDevice(pPPDevice) < 0 ||
-                pCameraHal->setJpegEncoder(pJpegEncoder) < 0)
+                pCameraHal->setJpegEncoder(pJpegEncoder, jpegEncoderType) < 0)
             return NULL;
 
         if (pCameraHal->Init() < 0)
@@ -1823,6 +3182,7 @@ show_out:
         if(strstr(SelectedCameraName, "ov") != NULL){
             pCameraHal->setPreviewRotate(CAMERA_PREVIEW_BACK_REF);
         }
+        pCameraHal->startWarmup();
 
         sp<CameraHardwareInterface> hardware(pCameraHal);
         CAMERA_HAL_LOG_INFO("created the fsl Camera hal");
@@ -34,16 +34,20 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <utils/threads.h>
+#include <utils/String8.h>
 #include <binder/MemoryBase.h>
 #include <binder/MemoryHeapBase.h>
 #include <camera/CameraHardwareInterface.h>
 #include <ui/Overlay.h>
-#include <semaphore.h>
 
 #include "Camera_pmem.h"
 #include "CaptureDeviceInterface.h"
 #include "PostProcessDeviceInterface.h"
+#include "Camera_ppsched.h"
 #include "JpegEncoderInterface.h"
+#include "Camera_convert.h"
+#include "Camera_stage.h"
+#include "Camera_heappool.h"
 
 
 #define EXIF_MAKENOTE "fsl_makernote"
@@ -55,6 +59,30 @@
 #define V4LSTREAM_WAKE_LOCK "V4LCapture"
 #define MAX_SENSOR_NAME 32
 
+/* zero shutter lag: the preview runs at the picture size, see ZslKeepFrame */
+#define CAMERA_KEY_ZSL          "zsl"
+#define CAMERA_KEY_ZSL_VALUES   "zsl-values"
+#define ZSL_RING_NUM            2
+
+/* burst: takePicture streams burst-count frames, see cameraHALTakeBurst */
+#define CAMERA_KEY_BURST_COUNT      "burst-count"
+#define CAMERA_KEY_BURST_COUNT_MAX  "burst-count-max"
+/* sendCommand, arg1 is the burst count, 0 or 1 for a single picture */
+#define CAMERA_CMD_BURST            0x1000
+#define BURST_MAX_FRAMES            32
+/* captured frames waiting for or in the encoders */
+#define BURST_QUEUE_DEPTH           4
+#define BURST_ENCODER_NUM           2
+
+/*
+ * preview callbacks: preview-callback-size (WxH, the preview size when
+ * not set) is taken at startPreview, only every Nth preview frame is
+ * sent with preview-callback-fps-divisor=N
+ */
+#define CAMERA_KEY_PREVIEW_CB_SIZE      "preview-callback-size"
+#define CAMERA_KEY_PREVIEW_CB_DIVISOR   "preview-callback-fps-divisor"
+#define PREVIEW_CB_MAX_DIVISOR          30
+
 #define PREVIEW_HEAP_BUF_NUM    5
 #define VIDEO_OUTPUT_BUFFER_NUM 5
 #define POST_PROCESS_BUFFER_NUM 5
@@ -63,6 +91,18 @@
 #define PREVIEW_CAPTURE_BUFFER_NUM 5
 #define PICTURE_CAPTURE_BUFFER_NUM 3
 
+/* frames a consumer may have queued before the oldest one is dropped */
+#define DISPLAY_QUEUE_DEPTH     1
+#define PREVIEW_CB_QUEUE_DEPTH  1
+#define VIDEO_QUEUE_DEPTH       2
+
+/* rw.camera.trace=1 writes the stage latencies of every frame here too */
+#define CAMERA_TRACE_MARKER     "/sys/kernel/debug/tracing/trace_marker"
+
+#if PREVIEW_CAPTURE_BUFFER_NUM > CAMERA_FRAME_QUEUE_MAX || POST_PROCESS_BUFFER_NUM > CAMERA_FRAME_QUEUE_MAX
+#error "the preview frames are counted in arrays of CAMERA_FRAME_QUEUE_MAX"
+#endif
+
 namespace android {
 
     typedef enum{
@@ -84,6 +124,55 @@ namespace android {
         CAMERA_PREVIEW_ROATE_LAST = 3
 	}CAMERA_PREVIEW_ROTATE;
 
+    typedef enum{
+        PICTURE_FROM_CAPTURE = 0,   /* stop the preview and capture at the picture size */
+        PICTURE_FROM_ZSL = 1,       /* a frame of the zsl ring */
+        PICTURE_FROM_PREVIEW = 2,   /* the preview frame already has the picture size */
+        PICTURE_FROM_BURST = 3      /* capture at the picture size, burst-count frames */
+    }CAMERA_PICTURE_PATH;
+
+    /* the stages the latency from the capture is measured to */
+    typedef enum{
+        LATENCY_PP = 0,
+        LATENCY_DISPLAY = 1,
+        LATENCY_PREVIEW_CB = 2,
+        LATENCY_VIDEO_CB = 3,
+        LATENCY_STAGE_NUM = 4
+    }CAMERA_LATENCY_STAGE;
+
+    /* what the preview is prepared for, zeroed first so it can be memcmp'd */
+    typedef struct {
+        struct capture_config_t capture;
+        bool zsl;
+        int previewWidth;
+        int previewHeight;
+        int callbackWidth;
+        int callbackHeight;
+        char previewFormat[16];
+    }PREVIEW_CONFIG;
+
+    typedef struct {
+        unsigned char *frame;
+        int seq;
+    }BURST_SLOT;
+
+    typedef struct {
+        sp<MemoryBase> jpeg;
+        nsecs_t captureTime;
+        bool ready;
+    }BURST_SHOT;
+
+    typedef struct {
+        unsigned int requested;
+        unsigned int delivered;
+        int encoders;
+        nsecs_t firstCapture;
+        nsecs_t lastDelivery;
+        nsecs_t latencySum;     /* from the capture to the callback */
+        nsecs_t latencyMin;
+        nsecs_t latencyMax;
+    }BURST_STATS;
+
     class CameraHal : public CameraHardwareInterface {
     public:
         virtual sp<IMemoryHeap> getPreviewHeap() const;
@@ -110,6 +199,9 @@ namespace android {
         virtual void        stopRecording();
         virtual bool        recordingEnabled();
         virtual void        releaseRecordingFrame(const sp<IMemory>& mem);
+        virtual status_t    storeMetaDataInBuffers(bool enable);
+        virtual int32_t     getNumberOfVideoBuffers() const;
+        virtual sp<IMemory> getVideoBuffer(int32_t index) const;
 
         virtual status_t    autoFocus();
         virtual status_t    cancelAutoFocus();
@@ -124,9 +216,11 @@ namespace android {
 
         CAMERA_HAL_ERR_RET setCaptureDevice(sp<CaptureDeviceInterface> capturedevice);
         CAMERA_HAL_ERR_RET setPostProcessDevice(sp<PostProcessDeviceInterface> postprocessdevice);
-        CAMERA_HAL_ERR_RET setJpegEncoder(sp<JpegEncoderInterface>jpegencoder);
+        CAMERA_HAL_ERR_RET setJpegEncoder(sp<JpegEncoderInterface>jpegencoder,
+                JPEG_ENCODER_TYPE type = SOFTWARE_JPEG_ENC);
         CAMERA_HAL_ERR_RET  Init();
         void  setPreviewRotate(CAMERA_PREVIEW_ROTATE previewRotate);
+        void  startWarmup();
 
         CameraHal();
         virtual             ~CameraHal();
@@ -143,7 +237,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->captureframeThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -157,7 +251,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->postprocessThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -172,7 +266,21 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->previewshowFrameThread();
-                return true;
+                return !mHardware->mStageAborted;
+            }
+        };
+
+        class PreviewCallbackThread : public Thread {
+            CameraHal* mHardware;
+        public:
+            PreviewCallbackThread(CameraHal* hw)
+                : Thread(false), mHardware(hw) { }
+            virtual void onFirstRef() {
+                run("PreviewCallbackThread", PRIORITY_URGENT_DISPLAY);
+            }
+            virtual bool threadLoop() {
+                mHardware->previewcallbackThread();
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -186,7 +294,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->encodeframeThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -209,14 +317,63 @@ namespace android {
 
         class TakePicThread : public Thread {
             CameraHal* mHardware;
+            CAMERA_PICTURE_PATH mPath;
+            nsecs_t mShutterTime;
         public:
-            TakePicThread(CameraHal* hw)
-                : Thread(false), mHardware(hw) { }
+            TakePicThread(CameraHal* hw, CAMERA_PICTURE_PATH path, nsecs_t shutterTime)
+                : Thread(false), mHardware(hw), mPath(path), mShutterTime(shutterTime) { }
             virtual void onFirstRef() {
                 run("TakePicThread", PRIORITY_URGENT_DISPLAY);
             }
             virtual bool threadLoop() {
-                if (mHardware->takepicThread()>=0)
+                if (mHardware->takepicThread(mPath, mShutterTime)>=0)
+                    return true;
+                else
+                    return false;
+            }
+        };
+
+        class BurstEncodeThread : public Thread {
+            CameraHal* mHardware;
+            int mEncoder;
+        public:
+            BurstEncodeThread(CameraHal* hw, int encoder)
+                : Thread(false), mHardware(hw), mEncoder(encoder) { }
+            virtual void onFirstRef() {
+                run("BurstEncodeThread", PRIORITY_URGENT_DISPLAY);
+            }
+            virtual bool threadLoop() {
+                if (mHardware->burstEncodeThread(mEncoder)>=0)
+                    return true;
+                else
+                    return false;
+            }
+        };
+
+        class WarmupThread : public Thread {
+            CameraHal* mHardware;
+        public:
+            WarmupThread(CameraHal* hw)
+                : Thread(false), mHardware(hw) { }
+            virtual void onFirstRef() {
+                run("CameraWarmupThread", PRIORITY_NORMAL);
+            }
+            virtual bool threadLoop() {
+                mHardware->warmupThread();
+                return false;
+            }
+        };
+
+        class BurstDeliverThread : public Thread {
+            CameraHal* mHardware;
+        public:
+            BurstDeliverThread(CameraHal* hw)
+                : Thread(false), mHardware(hw) { }
+            virtual void onFirstRef() {
+                run("BurstDeliverThread", PRIORITY_URGENT_DISPLAY);
+            }
+            virtual bool threadLoop() {
+                if (mHardware->burstDeliverThread()>=0)
                     return true;
                 else
                     return false;
@@ -231,6 +388,7 @@ namespace android {
 
         CAMERA_HAL_ERR_RET AolLocForInterBuf();
         void  FreeInterBuf();
+        bool  GetCallbackSize(const CameraParameters &params, int *pWidth, int *pHeight);
         CAMERA_HAL_ERR_RET InitCameraHalParam();
         CAMERA_HAL_ERR_RET GetCameraBaseParam(CameraParameters *pParam);
         CAMERA_HAL_ERR_RET GetPictureExifParam(CameraParameters *pParam);
@@ -240,11 +398,30 @@ namespace android {
         int captureframeThread();
         int postprocessThread();
         int previewshowFrameThread();
+        int previewcallbackThread();
         int encodeframeThread();
         status_t AllocateRecordVideoBuf();
+        void ReleaseVideoFrames(bool requeue);
 
         status_t CameraHALStartPreview();
         void     CameraHALStopPreview();
+        void     GetPreviewConfig(PREVIEW_CONFIG *pConfig);
+        status_t CameraHALPreparePreview(const PREVIEW_CONFIG *pConfig);
+        int      warmupThread();
+        void     WaitWarmup();
+        void     CoolDown();
+        void     AbortStageSignals();
+        DMA_BUFFER *getFrameBuffer(int index);
+        void     dispatchFrame(int index, int captureIndex);
+        bool     CanConvertInline();
+        status_t OpenPPClient();
+        void     ClosePPClient();
+        int      convertInline(int captureIndex);
+        bool     callbackDue();
+        int      nextPreviewHeapBuf();
+        void     recordLatency(CAMERA_LATENCY_STAGE stage, nsecs_t captureTime, unsigned int sequence);
+        void     sendFrame(CameraFrameQueue *queue, int index);
+        void     releaseFrame(int index);
 
         status_t PreparePreviwBuf();
         status_t PrepareCaptureDevices();
@@ -257,14 +434,43 @@ namespace android {
         void UnLockWakeLock();
 
         int autoFocusThread();
-        int takepicThread();
+        int takepicThread(CAMERA_PICTURE_PATH path, nsecs_t shutterTime);
 
         int GetJpegEncoderParam();
         int NegotiateCaptureFmt(bool TakePicFlag);
-        int cameraHALTakePicture();
-        void CameraHALStopMisc();
-        int PrepareJpegEncoder();
-        void convertNV12toYUV420SP(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height);
+        int cameraHALTakePicture(sp<MemoryBase> &JpegMemBase);
+        int StartPictureCapture(bool *pRestartPreview);
+        int CapturePictureFrame(DMA_BUFFER *pBuf, unsigned int *pIndex);
+        void StopPictureCapture(bool restartPreview);
+        int cameraHALTakeBurst(int count);
+        int StartBurst(int count);
+        void FinishBurst(int captured);
+        int burstEncodeThread(int encoder);
+        int burstDeliverThread();
+        int cameraHALTakeZslPicture(nsecs_t shutterTime, sp<MemoryBase> &JpegMemBase);
+        int cameraHALTakePreviewPicture(sp<MemoryBase> &JpegMemBase);
+        CAMERA_PICTURE_PATH SelectPicturePath();
+        bool EncoderSupportsFormat(unsigned int fmt);
+        int CopyPictureFrame(DMA_BUFFER *pSrc, unsigned int size, DMA_BUFFER *pCopy);
+        void SetThumbSource(DMA_BUFFER *pPreviewBuf);
+        int EncodePicture(DMA_BUFFER *pInBuf, unsigned int fmt, unsigned int size, sp<MemoryBase> &JpegMemBase);
+        int EncodeToHeap(const sp<JpegEncoderInterface> &encoder, DMA_BUFFER *pInBuf, unsigned int size,
+                sp<MemoryBase> &JpegMemBase);
+        void SendPicture(const sp<MemoryBase> &JpegMemBase);
+        void HoldPictureFrames();
+        void ReleasePictureFrames();
+        void WaitPictureFrames();
+        void WaitPicture();
+        bool ZslAvailable();
+        void ZslKeepFrame(int index);
+        int  ZslTakeFrame(nsecs_t shutterTime);
+        void QueueCaptureBuffer(int index);
+        void CameraHALStopMisc(bool closeDevice);
+        int PrepareJpegEncoder(const sp<JpegEncoderInterface> &encoder);
+        status_t AllocateCaptureBuffers(unsigned int *pBufNum);
+        void ReleaseCaptureBuffers();
+        void FreeCapturePmem();
+        void convertPreviewFrame(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height);
 
         int stringTodegree(char* cAttribute, unsigned int &degree, unsigned int &minute, unsigned int &second);
 
@@ -276,16 +482,34 @@ namespace android {
 
         sp<CaptureDeviceInterface> mCaptureDevice;
         sp<PostProcessDeviceInterface> mPPDevice;
+        /* the device is shared with the other cameras through the scheduler */
+        sp<CameraPPScheduler> mPPScheduler;
+        int                 mPPClient;
         sp<JpegEncoderInterface> mJpegEncoder;
 
 
         sp<CaptureFrameThread> mCaptureFrameThread;
         sp<PostProcessThread>  mPostProcessThread;
         sp<PreviewShowFrameThread> mPreviewShowFrameThread;
+        sp<PreviewCallbackThread> mPreviewCallbackThread;
         sp<EncodeFrameThread> mEncodeFrameThread;
         sp<AutoFocusThread>mAutoFocusThread;
         sp<TakePicThread> mTakePicThread;
 
+        /*
+         * With rw.camera.warmup=1 the preview is prepared on mWarmupThread
+         * once the camera is opened, mWarm says the capture buffers, the
+         * pp buffers and the preview heap are ready for mWarmConfig and
+         * startPreview only has to start the stream.
+         */
+        sp<WarmupThread>  mWarmupThread;
+        bool              mWarm;
+        PREVIEW_CONFIG    mWarmConfig;
+        /* from startPreview to the first frame dequeued */
+        nsecs_t           mPreviewStartTime;
+        nsecs_t           mFirstFrameTime;
+        bool              mPreviewWarmStart;
+
         mutable Mutex       mLock;
 
         char *supportedPictureSizes;
@@ -307,9 +531,21 @@ namespace android {
         sp<MemoryHeapBase>  mVideoHeap;
         sp<MemoryBase>      mVideoBuffers[VIDEO_OUTPUT_BUFFER_NUM];
         volatile  int       mVideoBufferUsing[VIDEO_OUTPUT_BUFFER_NUM];
+        /*
+         * In the metadata mode the video buffers only carry the physical
+         * address of a preview frame, the encoder reads the frame itself.
+         * The frame is held until releaseRecordingFrame.
+         */
+        bool                mVideoMetaDataMode;
+        int                 mVideoBufferFrame[VIDEO_OUTPUT_BUFFER_NUM];
+        mutable Mutex       mVideoLock;
 
 
         sp<PmemAllocator>   mPmemAllocator;
+        /* the capture buffers when they are imported, see AllocateCaptureBuffers */
+        sp<PmemAllocator>   mCapturePmemAllocator;
+        unsigned int        mCapturePmemNum;
+        CAPTURE_MEMORY_TYPE mCaptureMemoryType;
         DMA_BUFFER          mPPbuf[POST_PROCESS_BUFFER_NUM];
         unsigned int        mPPbufNum;
         pp_input_param_t    mPPInputParam;
@@ -318,7 +554,17 @@ namespace android {
         volatile bool       mPreviewRunning;
         unsigned int        mPreviewFormat;
         unsigned int 		mPreviewFrameSize;
+        unsigned int        mPreviewCbFormat;
+        unsigned int        mPreviewCbFrameSize;
         unsigned int        mPreviewCapturedFormat;
+        unsigned int        mPreviewWidth;
+        unsigned int        mPreviewHeight;
+        /* the callback frames, scaled in mCallbackScaleBuf when smaller than the preview */
+        unsigned int        mCallbackWidth;
+        unsigned int        mCallbackHeight;
+        volatile int        mCallbackDivisor;
+        unsigned int        mCallbackFrameCount;
+        unsigned char      *mCallbackScaleBuf;
 
         bool                mTakePicFlag;
         unsigned int        mEncoderSupportedFormat[MAX_QUERY_FMT_TIMES];
@@ -332,7 +578,7 @@ namespace android {
         unsigned int        mCaptureBufNum;
         bool                mRecordRunning;
         int                 mCurrentRecordFrame;
-        int 		        nCameraBuffersQueued;
+        volatile int32_t    nCameraBuffersQueued;
 
         unsigned int        mPreviewHeapBufNum;
         unsigned int        mTakePicBufQueNum;
@@ -342,27 +588,112 @@ namespace android {
         bool mCaptureDeviceOpen;
         bool mPPDeviceNeed;
         bool mPPDeviceNeedForPic;
+        /* the pp buffers are used, but the capture thread converts to them itself */
+        bool mPPInline;
         bool mPreviewStopped;
         bool mRecordStopped;
         bool mPowerLock;
 
         int error_status;
-        unsigned int preview_heap_buf_head;
-        unsigned int display_head;
-        unsigned int enc_head;
+        volatile bool mStageAborted;
+        volatile int32_t preview_heap_buf_head;
         unsigned int dequeue_head;
-        unsigned int is_first_buffer;
-        unsigned int last_display_index;
         unsigned int pp_in_head;
-        unsigned int pp_out_head;
         unsigned int buffer_index_maps[PREVIEW_CAPTURE_BUFFER_NUM];
 
-        sem_t avab_show_frame;
-        sem_t avab_dequeue_frame;
-        sem_t avab_enc_frame;
-        sem_t avab_enc_frame_finish;
-        sem_t avab_pp_in_frame;
-        sem_t avab_pp_out_frame;
+        CameraStageSignal avab_dequeue_frame;
+        CameraStageSignal avab_pp_in_frame;
+
+        /*
+         * A preview frame is a capture buffer, or a post process buffer
+         * when the pp device is used. Every consumer queue holds one
+         * reference on the frames in it, the frame goes back to the driver
+         * or to mPPFreeQueue when the last reference is released.
+         */
+        volatile int32_t  mFrameRefs[CAMERA_FRAME_QUEUE_MAX];
+        CameraFrameQueue  mShowQueue;
+        CameraFrameQueue  mCallbackQueue;
+        CameraFrameQueue  mEncQueue;
+        CameraFrameQueue  mPPFreeQueue;
+        /* the frame the overlay is showing, it is released by the next one */
+        int               mDisplayedFrame;
+
+        /*
+         * When each preview frame, by frame index, was dequeued and its
+         * driver sequence. The driver timestamps are not on the monotonic
+         * clock on every kernel, so the latencies count from the dequeue.
+         * A gap in the sequence is a frame the driver had no buffer for.
+         */
+        nsecs_t           mFrameTimestamp[CAMERA_FRAME_QUEUE_MAX];
+        unsigned int      mFrameSequence[CAMERA_FRAME_QUEUE_MAX];
+        /* the preview heap buffer the frame was converted to with it, or -1 */
+        int               mFrameCbBuf[CAMERA_FRAME_QUEUE_MAX];
+        unsigned int      mCaptureSequence[PREVIEW_CAPTURE_BUFFER_NUM];
+        int               mLastSequence;
+        CameraLatencyHistogram mStageLatency[LATENCY_STAGE_NUM];
+        volatile int32_t  mSequenceGaps;
+        volatile int32_t  mRecordDrops;
+        int               mTraceFd;
+
+        /*
+         * In the zsl mode the capture buffers are full resolution and the
+         * pp device scales them down for the preview. The last
+         * ZSL_RING_NUM buffers are kept from the driver, oldest first, so
+         * takePicture can encode one of them without stopping the preview.
+         */
+        bool              mZslEnabled;
+        nsecs_t           mCaptureTimestamp[PREVIEW_CAPTURE_BUFFER_NUM];
+        int               mZslRing[ZSL_RING_NUM];
+        unsigned int      mZslCount;
+        Mutex             mZslLock;
+        Condition         mZslCond;
+
+        /* how the last takePicture gets its frame, guarded by mLock */
+        CAMERA_PICTURE_PATH mPicturePath;
+        /* set to ask dispatchFrame for one frame in mPictureQueue */
+        volatile int32_t  mPictureRequest;
+        CameraFrameQueue  mPictureQueue;
+        Mutex             mPictureLock;
+        /*
+         * mPictureBusy is set by takePicture until the picture is encoded,
+         * another takePicture is refused meanwhile. mPictureThreads counts
+         * the picture threads that did not send their picture yet. The zsl
+         * and preview pictures copy their frames out before any callback,
+         * mPictureFramesHeld lets the preview stop wait for that, and only
+         * for that, so a picture thread is never joined under mLock.
+         */
+        Mutex             mPictureStateLock;
+        Condition         mPictureStateCond;
+        bool              mPictureBusy;
+        int               mPictureThreads;
+        bool              mPictureFramesHeld;
+        /* the capture device streams at the picture size */
+        bool              mPictureStreaming;
+        CameraJpegHeapPool mJpegHeapPool;
+
+        /*
+         * The burst slots hold the captured frames until they are encoded,
+         * the shots hold the pictures, by capture order, until they are
+         * sent. mBurstLock guards the shots and the stats.
+         */
+        JPEG_ENCODER_TYPE mJpegEncoderType;
+        int               mBurstCount;
+        unsigned int      mBurstFrameSize;
+        BURST_SLOT        mBurstSlots[BURST_QUEUE_DEPTH];
+        int               mBurstSlotNum;
+        CameraFrameQueue  mBurstFreeQueue;
+        CameraFrameQueue  mBurstEncQueue;
+        sp<JpegEncoderInterface> mBurstEncoders[BURST_ENCODER_NUM];
+        sp<BurstEncodeThread> mBurstEncodeThreads[BURST_ENCODER_NUM];
+        int               mBurstEncoderNum;
+        sp<BurstDeliverThread> mBurstDeliverThread;
+        BURST_SHOT        mBurstShots[BURST_MAX_FRAMES];
+        int               mBurstNextSeq;
+        int               mBurstCaptured;
+        bool              mBurstCaptureDone;
+        BURST_STATS       mBurstStats;
+        mutable Mutex     mBurstLock;
+        Condition         mBurstCond;
 
         pthread_mutex_t mOverlayMutex;
         pthread_mutex_t mMsgMutex;
@@ -0,0 +1,799 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <cutils/properties.h>
+#include <linux/videodev2.h>
+#include "Camera_utils.h"
+#include "Camera_convert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android {
+
+    static inline int sat16(int v)
+    {
+        return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+    }
+
+    static inline uint8_t clampToByte(int v)
+    {
+        v = (sat16(v) + 32) >> 6;
+        return v > 255 ? 255 : (v < 0 ? 0 : v);
+    }
+
+    static inline uint16_t packRGB565(int y, int rv, int guv, int bu)
+    {
+        uint8_t r = clampToByte(y + rv);
+        uint8_t g = clampToByte(y - guv);
+        uint8_t b = clampToByte(y + bu);
+        return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    }
+
+    static void scalarSwapUV(const uint8_t *src, uint8_t *dst, int pairs)
+    {
+        for (int i = 0; i < pairs; i++) {
+            uint8_t first = src[0];
+            dst[0] = src[1];
+            dst[1] = first;
+            src += 2;
+            dst += 2;
+        }
+    }
+
+    static void scalarSplitUV(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs)
+    {
+        for (int i = 0; i < pairs; i++) {
+            first[i] = src[0];
+            second[i] = src[1];
+            src += 2;
+        }
+    }
+
+    static void scalarMergeUV(const uint8_t *first, const uint8_t *second, uint8_t *dst, int pairs)
+    {
+        for (int i = 0; i < pairs; i++) {
+            dst[0] = first[i];
+            dst[1] = second[i];
+            dst += 2;
+        }
+    }
+
+    static void scalarNV12RowToRGB565(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width)
+    {
+        for (int i = 0; i < width; i += 2) {
+            int u = uv[0] - 128;
+            int v = uv[1] - 128;
+            int rv = YUV2RGB_RV * v;
+            int guv = YUV2RGB_GV * v + YUV2RGB_GU * u;
+            int bu = YUV2RGB_BU * u;
+
+            dst[0] = packRGB565(YUV2RGB_Y * (y[0] - 16), rv, guv, bu);
+            dst[1] = packRGB565(YUV2RGB_Y * (y[1] - 16), rv, guv, bu);
+            y += 2;
+            uv += 2;
+            dst += 2;
+        }
+    }
+
+    static void scalarAddRow(const uint8_t *src, uint16_t *acc, int n)
+    {
+        for (int i = 0; i < n; i++)
+            acc[i] += src[i];
+    }
+
+    static void scalarBlendRows(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int frac)
+    {
+        if (frac == 0) {
+            memcpy(dst, a, n);
+            return;
+        }
+        for (int i = 0; i < n; i++)
+            dst[i] = (a[i] * (256 - frac) + b[i] * frac + 128) >> 8;
+    }
+
+    static void scalarPackedRowsToNV12(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1,
+            uint8_t *uv, int pairs, int lumaOffset)
+    {
+        const int c = 1 - lumaOffset;
+
+        for (int i = 0; i < pairs; i++) {
+            y0[0] = row0[lumaOffset];
+            y0[1] = row0[lumaOffset + 2];
+            y1[0] = row1[lumaOffset];
+            y1[1] = row1[lumaOffset + 2];
+            uv[0] = (row0[c] + row1[c] + 1) >> 1;
+            uv[1] = (row0[c + 2] + row1[c + 2] + 1) >> 1;
+            row0 += 4;
+            row1 += 4;
+            y0 += 2;
+            y1 += 2;
+            uv += 2;
+        }
+    }
+
+    static const CONVERT_KERNELS gScalarConvertKernels = {
+        "scalar",
+        scalarSwapUV,
+        scalarSplitUV,
+        scalarMergeUV,
+        scalarNV12RowToRGB565,
+        scalarAddRow,
+        scalarBlendRows,
+        scalarPackedRowsToNV12,
+    };
+
+#if defined(__SSE2__)
+    static void sse2SwapUV(const uint8_t *src, uint8_t *dst, int pairs)
+    {
+        int i = 0;
+        for (; i + 8 <= pairs; i += 8) {
+            __m128i uv = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            uv = _mm_or_si128(_mm_slli_epi16(uv, 8), _mm_srli_epi16(uv, 8));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), uv);
+        }
+        scalarSwapUV(src + 2 * i, dst + 2 * i, pairs - i);
+    }
+
+    static void sse2SplitUV(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs)
+    {
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16) {
+            __m128i uv0 = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            __m128i uv1 = _mm_loadu_si128((const __m128i *)(src + 2 * i + 16));
+            __m128i a = _mm_packus_epi16(_mm_and_si128(uv0, lowMask), _mm_and_si128(uv1, lowMask));
+            __m128i b = _mm_packus_epi16(_mm_srli_epi16(uv0, 8), _mm_srli_epi16(uv1, 8));
+            _mm_storeu_si128((__m128i *)(first + i), a);
+            _mm_storeu_si128((__m128i *)(second + i), b);
+        }
+        scalarSplitUV(src + 2 * i, first + i, second + i, pairs - i);
+    }
+
+    static void sse2MergeUV(const uint8_t *first, const uint8_t *second, uint8_t *dst, int pairs)
+    {
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(first + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(second + i));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(a, b));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+        }
+        scalarMergeUV(first + i, second + i, dst + 2 * i, pairs - i);
+    }
+
+    static inline __m128i sse2Pack565(__m128i r, __m128i g, __m128i b)
+    {
+        /* r, g, b hold 8 pixels as 16 bit values in 0..255 */
+        r = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+        g = _mm_slli_epi16(_mm_srli_epi16(g, 2), 5);
+        b = _mm_srli_epi16(b, 3);
+        return _mm_or_si128(_mm_or_si128(r, g), b);
+    }
+
+    static void sse2NV12RowToRGB565(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        const __m128i c16 = _mm_set1_epi16(16);
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i round = _mm_set1_epi16(32);
+        int i = 0;
+
+        for (; i + 16 <= width; i += 16) {
+            __m128i yy = _mm_loadu_si128((const __m128i *)(y + i));
+            __m128i cc = _mm_loadu_si128((const __m128i *)(uv + i));
+            __m128i u = _mm_sub_epi16(_mm_and_si128(cc, lowMask), c128);
+            __m128i v = _mm_sub_epi16(_mm_srli_epi16(cc, 8), c128);
+            __m128i rv = _mm_mullo_epi16(v, _mm_set1_epi16(YUV2RGB_RV));
+            __m128i guv = _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(YUV2RGB_GV)),
+                    _mm_mullo_epi16(u, _mm_set1_epi16(YUV2RGB_GU)));
+            __m128i bu = _mm_mullo_epi16(u, _mm_set1_epi16(YUV2RGB_BU));
+            /* the even pixels are in the low byte of every 16 bit lane */
+            __m128i ye = _mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(yy, lowMask), c16),
+                    _mm_set1_epi16(YUV2RGB_Y));
+            __m128i yo = _mm_mullo_epi16(_mm_sub_epi16(_mm_srli_epi16(yy, 8), c16),
+                    _mm_set1_epi16(YUV2RGB_Y));
+            __m128i re = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ye, rv), round), 6), zero);
+            __m128i ro = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yo, rv), round), 6), zero);
+            __m128i ge = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(ye, guv), round), 6), zero);
+            __m128i go = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(yo, guv), round), 6), zero);
+            __m128i be = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ye, bu), round), 6), zero);
+            __m128i bo = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yo, bu), round), 6), zero);
+            /* interleave even and odd pixels back into display order */
+            __m128i r = _mm_unpacklo_epi8(re, ro);
+            __m128i g = _mm_unpacklo_epi8(ge, go);
+            __m128i b = _mm_unpacklo_epi8(be, bo);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                    sse2Pack565(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero)));
+            _mm_storeu_si128((__m128i *)(dst + i + 8),
+                    sse2Pack565(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero)));
+        }
+        scalarNV12RowToRGB565(y + i, uv + i, dst + i, width - i);
+    }
+
+    static void sse2AddRow(const uint8_t *src, uint16_t *acc, int n)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i lo = _mm_loadu_si128((const __m128i *)(acc + i));
+            __m128i hi = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+            _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(s, zero)));
+            _mm_storeu_si128((__m128i *)(acc + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(s, zero)));
+        }
+        scalarAddRow(src + i, acc + i, n - i);
+    }
+
+    static void sse2BlendRows(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int frac)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i wa = _mm_set1_epi16(256 - frac);
+        const __m128i wb = _mm_set1_epi16(frac);
+        const __m128i round = _mm_set1_epi16(128);
+        int i = 0;
+
+        if (frac == 0) {
+            memcpy(dst, a, n);
+            return;
+        }
+        for (; i + 16 <= n; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+            /* the sums stay below 65536, so the unsigned shift is exact */
+            __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                        _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb)), round);
+            __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                        _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb)), round);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                    _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+        }
+        scalarBlendRows(a + i, b + i, dst + i, n - i, frac);
+    }
+
+    static void sse2PackedRowsToNV12(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1,
+            uint8_t *uv, int pairs, int lumaOffset)
+    {
+        const __m128i low = _mm_set1_epi16(0x00FF);
+        int i = 0;
+
+        for (; i + 8 <= pairs; i += 8) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + 4 * i));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + 4 * i + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + 4 * i));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + 4 * i + 16));
+            __m128i ya, yb, ca, cb;
+
+            if (lumaOffset == 0) {
+                ya = _mm_packus_epi16(_mm_and_si128(a0, low), _mm_and_si128(a1, low));
+                yb = _mm_packus_epi16(_mm_and_si128(b0, low), _mm_and_si128(b1, low));
+                ca = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+                cb = _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+            }else{
+                ya = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+                yb = _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+                ca = _mm_packus_epi16(_mm_and_si128(a0, low), _mm_and_si128(a1, low));
+                cb = _mm_packus_epi16(_mm_and_si128(b0, low), _mm_and_si128(b1, low));
+            }
+            _mm_storeu_si128((__m128i *)(y0 + 2 * i), ya);
+            _mm_storeu_si128((__m128i *)(y1 + 2 * i), yb);
+            /* U and V stay interleaved, which is already the NV12 order */
+            _mm_storeu_si128((__m128i *)(uv + 2 * i), _mm_avg_epu8(ca, cb));
+        }
+        scalarPackedRowsToNV12(row0 + 4 * i, row1 + 4 * i, y0 + 2 * i, y1 + 2 * i,
+                uv + 2 * i, pairs - i, lumaOffset);
+    }
+
+    static const CONVERT_KERNELS gSse2ConvertKernels = {
+        "sse2",
+        sse2SwapUV,
+        sse2SplitUV,
+        sse2MergeUV,
+        sse2NV12RowToRGB565,
+        sse2AddRow,
+        sse2BlendRows,
+        sse2PackedRowsToNV12,
+    };
+#endif
+
+#ifdef CAMERA_CONVERT_HAVE_NEON
+    static bool cpuHasNeon()
+    {
+        char line[512];
+        bool found = false;
+        FILE *fp = fopen("/proc/cpuinfo", "r");
+        if (fp == NULL)
+            return false;
+        while (!found && fgets(line, sizeof(line), fp) != NULL) {
+            if (strncmp(line, "Features", 8) == 0 && strstr(line, " neon") != NULL)
+                found = true;
+        }
+        fclose(fp);
+        return found;
+    }
+#endif
+
+    static const CONVERT_KERNELS *gConvertKernels = &gScalarConvertKernels;
+    static pthread_once_t gConvertKernelsOnce = PTHREAD_ONCE_INIT;
+
+    static void selectConvertKernels()
+    {
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("rw.camera.convert", value, "");
+        if (strcmp(value, "scalar") == 0) {
+            gConvertKernels = &gScalarConvertKernels;
+        }else{
+#if defined(CAMERA_CONVERT_HAVE_NEON)
+            if (cpuHasNeon())
+                gConvertKernels = &gNeonConvertKernels;
+#elif defined(__SSE2__)
+            gConvertKernels = &gSse2ConvertKernels;
+#endif
+        }
+        CAMERA_HAL_LOG_INFO("Using the %s color conversion kernels", gConvertKernels->name);
+    }
+
+    const CONVERT_KERNELS *getConvertKernels()
+    {
+        pthread_once(&gConvertKernelsOnce, selectConvertKernels);
+        return gConvertKernels;
+    }
+
+    const CONVERT_KERNELS *getScalarConvertKernels()
+    {
+        return &gScalarConvertKernels;
+    }
+
+    unsigned int getYV12FrameSize(int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        return yStride * height + cStride * height;
+    }
+
+    void convertNV12toNV21(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int Ysize = width * height;
+
+        memcpy(dst, src, Ysize);
+        k->swapUV(src + Ysize, dst + Ysize, Ysize >> 2);
+    }
+
+    void convertNV12toI420(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int Ysize = width * height;
+
+        memcpy(dst, src, Ysize);
+        k->splitUV(src + Ysize, dst + Ysize, dst + Ysize + (Ysize >> 2), Ysize >> 2);
+    }
+
+    void convertNV12toYV12(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        const uint8_t *uvIn = src + width * height;
+        uint8_t *vOut = dst + yStride * height;
+        uint8_t *uOut = vOut + cStride * (height >> 1);
+        int i;
+
+        if (yStride == width) {
+            memcpy(dst, src, width * height);
+        }else{
+            for (i = 0; i < height; i++)
+                memcpy(dst + i * yStride, src + i * width, width);
+        }
+
+        for (i = 0; i < (height >> 1); i++) {
+            k->splitUV(uvIn, uOut, vOut, width >> 1);
+            uvIn += width;
+            uOut += cStride;
+            vOut += cStride;
+        }
+    }
+
+    void convertNV12toRGB565(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        const uint8_t *uv = src + width * height;
+        uint16_t *out = (uint16_t *)dst;
+
+        for (int i = 0; i < height; i++) {
+            k->nv12RowToRGB565(src + i * width, uv + (i >> 1) * width, out, width);
+            out += width;
+        }
+    }
+
+    typedef struct {
+        uint8_t *y;
+        uint8_t *uv;        /* semi-planar chroma, NULL for the planar formats */
+        uint8_t *u;
+        uint8_t *v;
+        int yStride;
+        int cStride;
+        bool swapped;       /* V before U in the semi-planar chroma */
+    }PLANES_420;
+
+    static bool setupPlanes420(PLANES_420 *p, uint8_t *base, unsigned int fmt, int width, int height)
+    {
+        memset(p, 0, sizeof(*p));
+        p->y = base;
+        switch (fmt) {
+            case V4L2_PIX_FMT_NV12:
+            case V4L2_PIX_FMT_NV21:
+                p->uv = base + width * height;
+                p->yStride = width;
+                p->cStride = width;
+                p->swapped = fmt == V4L2_PIX_FMT_NV21;
+                return true;
+            case V4L2_PIX_FMT_YUV420:
+                p->yStride = width;
+                p->cStride = width >> 1;
+                p->u = base + width * height;
+                p->v = p->u + p->cStride * (height >> 1);
+                return true;
+            case V4L2_PIX_FMT_YVU420:
+                p->yStride = CAMERA_ALIGN_16(width);
+                p->cStride = CAMERA_ALIGN_16(p->yStride / 2);
+                p->v = base + p->yStride * height;
+                p->u = p->v + p->cStride * (height >> 1);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /* writes chroma row i of p from a NV12 chroma row */
+    static void writeChroma420(const CONVERT_KERNELS *k, const PLANES_420 *p, int i,
+            const uint8_t *uv, int pairs)
+    {
+        if (p->uv == NULL)
+            k->splitUV(uv, p->u + i * p->cStride, p->v + i * p->cStride, pairs);
+        else if (p->swapped)
+            k->swapUV(uv, p->uv + i * p->cStride, pairs);
+        else if (p->uv + i * p->cStride != uv)
+            memcpy(p->uv + i * p->cStride, uv, pairs * 2);
+    }
+
+    bool isPacked422Convertible(unsigned int srcFmt, unsigned int dstFmt)
+    {
+        PLANES_420 p;
+        return (srcFmt == V4L2_PIX_FMT_YUYV || srcFmt == V4L2_PIX_FMT_UYVY) &&
+            setupPlanes420(&p, NULL, dstFmt, 2, 2);
+    }
+
+    int convertPacked422(const CONVERT_KERNELS *k, const uint8_t *src, unsigned int srcFmt, int width, int height,
+            uint8_t *dst, unsigned int dstFmt, uint8_t *second, unsigned int secondFmt)
+    {
+        PLANES_420 out[2];
+        int outNum = second != NULL ? 2 : 1;
+        const PLANES_420 *direct = NULL;
+        uint8_t *row = NULL;
+        int lumaOffset, pairs = width >> 1;
+        int i, j;
+
+        if (srcFmt == V4L2_PIX_FMT_YUYV)
+            lumaOffset = 0;
+        else if (srcFmt == V4L2_PIX_FMT_UYVY)
+            lumaOffset = 1;
+        else
+            return -1;
+        if (width <= 0 || height <= 0 || (width & 1) || (height & 1) ||
+                !setupPlanes420(&out[0], dst, dstFmt, width, height) ||
+                (second != NULL && !setupPlanes420(&out[1], second, secondFmt, width, height)))
+            return -1;
+
+        //the kernel writes straight into the first NV12 output, the others are copied from it
+        for (j = 0; j < outNum && direct == NULL; j++) {
+            if (out[j].uv != NULL && !out[j].swapped)
+                direct = &out[j];
+        }
+        if (direct == NULL) {
+            direct = &out[0];
+            row = (uint8_t *)malloc(width);
+            if (row == NULL)
+                return -1;
+        }
+
+        for (i = 0; i < (height >> 1); i++) {
+            const uint8_t *in = src + 2 * i * width * 2;
+            uint8_t *y0 = direct->y + 2 * i * direct->yStride;
+            uint8_t *uv = row != NULL ? row : direct->uv + i * direct->cStride;
+
+            k->packedRowsToNV12(in, in + width * 2, y0, y0 + direct->yStride, uv, pairs, lumaOffset);
+            //the rows are still in the cache for the other output
+            for (j = 0; j < outNum; j++) {
+                if (&out[j] != direct) {
+                    memcpy(out[j].y + 2 * i * out[j].yStride, y0, width);
+                    memcpy(out[j].y + (2 * i + 1) * out[j].yStride, y0 + direct->yStride, width);
+                }
+                writeChroma420(k, &out[j], i, uv, pairs);
+            }
+        }
+
+        if (row != NULL)
+            free(row);
+        return 0;
+    }
+
+    int convertPacked422(const uint8_t *src, unsigned int srcFmt, int width, int height,
+            uint8_t *dst, unsigned int dstFmt, uint8_t *second, unsigned int secondFmt)
+    {
+        return convertPacked422(getConvertKernels(), src, srcFmt, width, height,
+                dst, dstFmt, second, secondFmt);
+    }
+
+    void convertNV12toNV21(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toNV21(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toI420(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toI420(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toYV12(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toYV12(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toRGB565(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toRGB565(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertI420toYV12(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        int cWidth = width >> 1;
+        const uint8_t *uIn = src + width * height;
+        const uint8_t *vIn = uIn + cWidth * (height >> 1);
+        uint8_t *vOut = dst + yStride * height;
+        uint8_t *uOut = vOut + cStride * (height >> 1);
+        int i;
+
+        for (i = 0; i < height; i++)
+            memcpy(dst + i * yStride, src + i * width, width);
+        for (i = 0; i < (height >> 1); i++) {
+            memcpy(vOut + i * cStride, vIn + i * cWidth, cWidth);
+            memcpy(uOut + i * cStride, uIn + i * cWidth, cWidth);
+        }
+    }
+
+    /* 16.16 source position of the centre of output sample i */
+    static inline int scaleSourcePos(int i, int srcSize, int dstSize)
+    {
+        int pos = (int)((((int64_t)(2 * i + 1) * srcSize) << 15) / dstSize) - 32768;
+        return pos < 0 ? 0 : pos;
+    }
+
+    int scalePlane(const CONVERT_KERNELS *k, const uint8_t *src, int srcWidth, int srcHeight,
+            int channels, uint8_t **dst, int dstWidth, int dstHeight)
+    {
+        int fx, fy, xOff, yOff, boxWidth, boxHeight, rowBytes, boxBytes, area;
+        int boxIndex[2] = {-1, -1};
+        uint16_t *acc = NULL;
+        uint8_t *box = NULL, *blend = NULL, *xFrac = NULL;
+        int *xMap = NULL;
+        const uint8_t *rows[2];
+        int x, y, c, i, j, r;
+        int ret = -1;
+
+        if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0 ||
+                channels < 1 || channels > 4)
+            return -1;
+
+        fx = srcWidth / dstWidth;
+        fy = srcHeight / dstHeight;
+        if (fx < 1)
+            fx = 1;
+        if (fy < 1)
+            fy = 1;
+        //the row sums are 16 bit
+        if (fy > 257)
+            fy = 257;
+        boxWidth = srcWidth / fx;
+        boxHeight = srcHeight / fy;
+        xOff = (srcWidth - boxWidth * fx) / 2;
+        yOff = (srcHeight - boxHeight * fy) / 2;
+        rowBytes = srcWidth * channels;
+        boxBytes = boxWidth * channels;
+        area = fx * fy;
+
+        acc = (uint16_t *)malloc(rowBytes * sizeof(uint16_t));
+        box = (uint8_t *)malloc(boxBytes * 3);
+        xMap = (int *)malloc(dstWidth * sizeof(int));
+        xFrac = (uint8_t *)malloc(dstWidth);
+        if (acc == NULL || box == NULL || xMap == NULL || xFrac == NULL)
+            goto done;
+        blend = box + 2 * boxBytes;
+
+        for (x = 0; x < dstWidth; x++) {
+            int pos = scaleSourcePos(x, boxWidth, dstWidth);
+            xMap[x] = pos >> 16;
+            xFrac[x] = (pos >> 8) & 0xFF;
+            if (xMap[x] >= boxWidth - 1) {
+                xMap[x] = boxWidth - 1;
+                xFrac[x] = 0;
+            }
+        }
+
+        for (y = 0; y < dstHeight; y++) {
+            int pos = scaleSourcePos(y, boxHeight, dstHeight);
+            int r0 = pos >> 16;
+            int frac = (pos >> 8) & 0xFF;
+            if (r0 >= boxHeight - 1) {
+                r0 = boxHeight - 1;
+                frac = 0;
+            }
+
+            /* the two box rows this output row sits between */
+            for (i = 0; i < 2; i++) {
+                r = r0 + (i && frac ? 1 : 0);
+                if (fx == 1 && fy == 1) {
+                    rows[i] = src + (yOff + r) * rowBytes;
+                    continue;
+                }
+                rows[i] = box + (r & 1) * boxBytes;
+                if (boxIndex[r & 1] == r)
+                    continue;
+
+                memset(acc, 0, rowBytes * sizeof(uint16_t));
+                for (j = 0; j < fy; j++)
+                    k->addRow(src + (yOff + r * fy + j) * rowBytes, acc, rowBytes);
+                for (x = 0; x < boxWidth; x++) {
+                    const uint16_t *in = acc + (xOff + x * fx) * channels;
+                    for (c = 0; c < channels; c++) {
+                        int sum = 0;
+                        for (j = 0; j < fx; j++)
+                            sum += in[j * channels + c];
+                        box[(r & 1) * boxBytes + x * channels + c] = (sum + area / 2) / area;
+                    }
+                }
+                boxIndex[r & 1] = r;
+            }
+
+            k->blendRows(rows[0], rows[1], blend, boxBytes, frac);
+
+            for (c = 0; c < channels; c++) {
+                if (dst[c] == NULL)
+                    continue;
+                uint8_t *out = dst[c] + y * dstWidth;
+                const uint8_t *in = blend + c;
+                for (x = 0; x < dstWidth; x++) {
+                    int f = xFrac[x];
+                    int a = in[xMap[x] * channels];
+                    int b = in[(xMap[x] + (f ? 1 : 0)) * channels];
+                    out[x] = (a * (256 - f) + b * f + 128) >> 8;
+                }
+            }
+        }
+        ret = 0;
+
+done:
+        free(acc);
+        free(box);
+        free(xMap);
+        free(xFrac);
+        return ret;
+    }
+
+    int scaleI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        const CONVERT_KERNELS *k = getConvertKernels();
+        int srcCSize = (srcWidth >> 1) * (srcHeight >> 1);
+        int dstCSize = (dstWidth >> 1) * (dstHeight >> 1);
+        uint8_t *y = dst;
+        uint8_t *u = dst + dstWidth * dstHeight;
+        uint8_t *v = u + dstCSize;
+
+        if (scalePlane(k, src, srcWidth, srcHeight, 1, &y, dstWidth, dstHeight) < 0)
+            return -1;
+        src += srcWidth * srcHeight;
+        if (scalePlane(k, src, srcWidth >> 1, srcHeight >> 1, 1, &u, dstWidth >> 1, dstHeight >> 1) < 0)
+            return -1;
+        return scalePlane(k, src + srcCSize, srcWidth >> 1, srcHeight >> 1, 1, &v, dstWidth >> 1, dstHeight >> 1);
+    }
+
+    static int scaleSemiPlanarToI420(const uint8_t *src, int srcWidth, int srcHeight,
+            uint8_t *dst, int dstWidth, int dstHeight, bool vFirst, bool chroma422)
+    {
+        const CONVERT_KERNELS *k = getConvertKernels();
+        uint8_t *y = dst;
+        uint8_t *uv[2];
+
+        uv[0] = dst + dstWidth * dstHeight;
+        uv[1] = uv[0] + (dstWidth >> 1) * (dstHeight >> 1);
+        if (vFirst) {
+            uint8_t *t = uv[0];
+            uv[0] = uv[1];
+            uv[1] = t;
+        }
+        if (scalePlane(k, src, srcWidth, srcHeight, 1, &y, dstWidth, dstHeight) < 0)
+            return -1;
+        return scalePlane(k, src + srcWidth * srcHeight, srcWidth >> 1,
+                chroma422 ? srcHeight : srcHeight >> 1, 2, uv, dstWidth >> 1, dstHeight >> 1);
+    }
+
+    int scaleNV12toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        return scaleSemiPlanarToI420(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, false, false);
+    }
+
+    int scaleNV21toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        return scaleSemiPlanarToI420(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, true, false);
+    }
+
+    int scaleNV12(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        const CONVERT_KERNELS *k = getConvertKernels();
+        int cSize = (dstWidth >> 1) * (dstHeight >> 1);
+        uint8_t *y = dst;
+        uint8_t *uv = dst + dstWidth * dstHeight;
+        uint8_t *planes[2];
+        int i, ret;
+
+        if (scalePlane(k, src, srcWidth, srcHeight, 1, &y, dstWidth, dstHeight) < 0)
+            return -1;
+        planes[0] = (uint8_t *)malloc(cSize * 2);
+        if (planes[0] == NULL)
+            return -1;
+        planes[1] = planes[0] + cSize;
+        ret = scalePlane(k, src + srcWidth * srcHeight, srcWidth >> 1, srcHeight >> 1, 2,
+                planes, dstWidth >> 1, dstHeight >> 1);
+        if (ret == 0) {
+            for (i = 0; i < cSize; i++) {
+                uv[2 * i] = planes[0][i];
+                uv[2 * i + 1] = planes[1][i];
+            }
+        }
+        free(planes[0]);
+        return ret;
+    }
+
+    int scaleNV16toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        return scaleSemiPlanarToI420(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, false, true);
+    }
+
+    int scaleYUYVtoI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight)
+    {
+        const CONVERT_KERNELS *k = getConvertKernels();
+        uint8_t *y[2] = {dst, NULL};
+        uint8_t *yuyv[4];
+
+        //as Y0 U Y1 V groups the chroma is channel 1 and 3 of a half width plane
+        yuyv[0] = NULL;
+        yuyv[1] = dst + dstWidth * dstHeight;
+        yuyv[2] = NULL;
+        yuyv[3] = yuyv[1] + (dstWidth >> 1) * (dstHeight >> 1);
+        if (scalePlane(k, src, srcWidth, srcHeight, 2, y, dstWidth, dstHeight) < 0)
+            return -1;
+        return scalePlane(k, src, srcWidth >> 1, srcHeight, 4, yuyv, dstWidth >> 1, dstHeight >> 1);
+    }
+
+};
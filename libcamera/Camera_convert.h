@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_CONVERT_H
+#define CAMERA_CONVERT_H
+
+#include <stdint.h>
+
+#define CAMERA_ALIGN_16(x) (((x) + 15) & ~15)
+
+/*
+ * BT.601 limited range to full range RGB in 6 bit fixed point. The same
+ * constants are used by every kernel so that all of them give bit exact
+ * results:
+ *   R = (74 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+ *   G = (74 * (Y - 16) -  52 * (V - 128) - 25 * (U - 128) + 32) >> 6
+ *   B = (74 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+ * The sums are saturated to 16 bit before the shift, as the vector units do.
+ */
+#define YUV2RGB_Y   74
+#define YUV2RGB_RV  102
+#define YUV2RGB_GV  52
+#define YUV2RGB_GU  25
+#define YUV2RGB_BU  129
+
+namespace android {
+
+    /*
+     * Row kernels used by the frame converters below. One table exists per
+     * instruction set (scalar, NEON, SSE2); the best one supported by the
+     * running cpu is picked once, the first time a converter is called.
+     * Every kernel handles any tail that does not fill a full vector.
+     */
+    typedef struct {
+        const char *name;
+        /* swap every U/V byte pair: NV12 chroma row <-> NV21 chroma row */
+        void (*swapUV)(const uint8_t *src, uint8_t *dst, int pairs);
+        /* de-interleave one semi-planar chroma row into two planar rows */
+        void (*splitUV)(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs);
+        /* interleave two planar chroma rows into one semi-planar row */
+        void (*mergeUV)(const uint8_t *first, const uint8_t *second, uint8_t *dst, int pairs);
+        /* one output row of BT.601 NV12 -> RGB565, width must be even */
+        void (*nv12RowToRGB565)(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width);
+        /* acc[i] += src[i], sums the source rows of a box filter */
+        void (*addRow)(const uint8_t *src, uint16_t *acc, int n);
+        /* dst = (a * (256 - frac) + b * frac + 128) >> 8, frac in 0..255 */
+        void (*blendRows)(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int frac);
+        /*
+         * two YUYV (lumaOffset 0) or UYVY (lumaOffset 1) rows to their two
+         * luma rows and one NV12 chroma row, the average of both rows
+         */
+        void (*packedRowsToNV12)(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1,
+                uint8_t *uv, int pairs, int lumaOffset);
+    }CONVERT_KERNELS;
+
+    const CONVERT_KERNELS *getConvertKernels();
+    const CONVERT_KERNELS *getScalarConvertKernels();
+
+    /*
+     * Frame converters, all of them take a tightly packed NV12 (or I420)
+     * source of width x height. The YV12 output follows the android
+     * yuv420p layout: the Y stride is 16 aligned, the chroma stride is
+     * the 16 aligned half of the Y stride and V comes before U.
+     */
+    void convertNV12toNV21(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toI420(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toYV12(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertI420toYV12(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toRGB565(const uint8_t *src, uint8_t *dst, int width, int height);
+
+    unsigned int getYV12FrameSize(int width, int height);
+
+    /*
+     * Converts a packed 4:2:2 frame, V4L2_PIX_FMT_YUYV or UYVY, to a 4:2:0
+     * one: NV12, NV21, YUV420 (tightly packed I420) or YVU420 (the YV12
+     * layout above). When second is not NULL the frame is written to it
+     * as well, in secondFmt, from the same pass over the source. Width
+     * and height must be even, it returns -1 on a format it can not do.
+     */
+    int convertPacked422(const uint8_t *src, unsigned int srcFmt, int width, int height,
+            uint8_t *dst, unsigned int dstFmt, uint8_t *second, unsigned int secondFmt);
+    bool isPacked422Convertible(unsigned int srcFmt, unsigned int dstFmt);
+
+    /*
+     * Scalers to a tightly packed I420 frame of any size. The source is
+     * box filtered by the integer part of the ratio and the remainder is
+     * done bilinearly, so large ratios do not alias and a ratio that is
+     * not a whole number costs the same as one that is. They return -1
+     * on a bad size or when out of memory.
+     */
+    int scaleI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+    int scaleNV12toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+    int scaleNV21toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+    /* the same to a tightly packed NV12 frame */
+    int scaleNV12(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+    int scaleNV16toI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+    int scaleYUYVtoI420(const uint8_t *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+
+    /*
+     * Scales one plane of 1 to 4 interleaved channels. Every channel is
+     * written to its own tightly packed plane dst[channel], a channel
+     * with a NULL plane is dropped.
+     */
+    int scalePlane(const CONVERT_KERNELS *k, const uint8_t *src, int srcWidth, int srcHeight,
+            int channels, uint8_t **dst, int dstWidth, int dstHeight);
+
+    /* same as the converters above, but always with the given kernels */
+    void convertNV12toNV21(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toI420(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toYV12(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toRGB565(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    int convertPacked422(const CONVERT_KERNELS *k, const uint8_t *src, unsigned int srcFmt, int width, int height,
+            uint8_t *dst, unsigned int dstFmt, uint8_t *second, unsigned int secondFmt);
+
+#ifdef CAMERA_CONVERT_HAVE_NEON
+    extern const CONVERT_KERNELS gNeonConvertKernels;
+#endif
+
+}; //name space android
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <linux/mxc_v4l2.h>
+#include "Camera_devcache.h"
+
+namespace android {
+
+    Mutex CameraDeviceCache :: mLock;
+    bool CameraDeviceCache :: mLoaded = false;
+    CAMERA_CACHE_ENTRY CameraDeviceCache :: mEntries[CAMERA_CACHE_MAX_DEVICE];
+
+    void CameraDeviceCache :: load()
+    {
+        CAMERA_CACHE_HEADER header;
+        FILE *fp;
+
+        if (mLoaded)
+            return;
+        mLoaded = true;
+        memset(mEntries, 0, sizeof(mEntries));
+
+        fp = fopen(CAMERA_CACHE_FILE, "rb");
+        if (fp == NULL)
+            return;
+        if (fread(&header, sizeof(header), 1, fp) != 1 ||
+                header.magic != CAMERA_CACHE_MAGIC ||
+                header.version != CAMERA_CACHE_VERSION ||
+                header.entrySize != sizeof(CAMERA_CACHE_ENTRY) ||
+                header.entryNum > CAMERA_CACHE_MAX_DEVICE ||
+                fread(mEntries, sizeof(CAMERA_CACHE_ENTRY), header.entryNum, fp) != header.entryNum) {
+            CAMERA_HAL_LOG_INFO("Drop the stale capture device cache");
+            memset(mEntries, 0, sizeof(mEntries));
+        }
+        fclose(fp);
+
+        //never trust the file further than the table bounds
+        for (int i = 0; i < CAMERA_CACHE_MAX_DEVICE; i++) {
+            CAMERA_CACHE_ENTRY *entry = &mEntries[i];
+            bool bad = entry->fmtNum < -1 || entry->fmtNum > CAMERA_CACHE_MAX_FMT ||
+                entry->sizeTableNum < 0 || entry->sizeTableNum > CAMERA_CACHE_MAX_FMT;
+            for (int j = 0; !bad && j < entry->sizeTableNum; j++)
+                bad = entry->sizeTable[j].sizeNum < 0 || entry->sizeTable[j].sizeNum > CAMERA_CACHE_MAX_SIZE;
+            if (bad)
+                memset(entry, 0, sizeof(CAMERA_CACHE_ENTRY));
+            entry->name[CAMERA_CACHE_NAME_LENGTH - 1] = 0;
+            entry->sensor[CAMERA_CACHE_NAME_LENGTH - 1] = 0;
+            entry->node[CAMERA_CACHE_NODE_LENGTH - 1] = 0;
+        }
+    }
+
+    void CameraDeviceCache :: save()
+    {
+        CAMERA_CACHE_HEADER header;
+        char tmpName[sizeof(CAMERA_CACHE_FILE) + 4];
+        FILE *fp;
+        bool ok;
+
+        //write a new file and rename it, a reader never sees half a cache
+        sprintf(tmpName, "%s.tmp", CAMERA_CACHE_FILE);
+        fp = fopen(tmpName, "wb");
+        if (fp == NULL) {
+            CAMERA_HAL_LOG_RUNTIME("Can not write %s", tmpName);
+            return;
+        }
+        header.magic = CAMERA_CACHE_MAGIC;
+        header.version = CAMERA_CACHE_VERSION;
+        header.entrySize = sizeof(CAMERA_CACHE_ENTRY);
+        header.entryNum = CAMERA_CACHE_MAX_DEVICE;
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+            fwrite(mEntries, sizeof(CAMERA_CACHE_ENTRY), CAMERA_CACHE_MAX_DEVICE, fp) == CAMERA_CACHE_MAX_DEVICE;
+        if (fclose(fp) != 0)
+            ok = false;
+        if (!ok || rename(tmpName, CAMERA_CACHE_FILE) != 0) {
+            CAMERA_HAL_ERR("Fail to save the capture device cache");
+            unlink(tmpName);
+        }
+    }
+
+    CAMERA_CACHE_ENTRY *CameraDeviceCache :: findByName(const char *name)
+    {
+        for (int i = 0; i < CAMERA_CACHE_MAX_DEVICE; i++) {
+            if (mEntries[i].valid && strcmp(mEntries[i].name, name) == 0)
+                return &mEntries[i];
+        }
+        return NULL;
+    }
+
+    CAMERA_CACHE_ENTRY *CameraDeviceCache :: findByKey(const CAMERA_DEVICE_KEY *key)
+    {
+        for (int i = 0; i < CAMERA_CACHE_MAX_DEVICE; i++) {
+            if (mEntries[i].valid && memcmp(&mEntries[i].key, key, sizeof(CAMERA_DEVICE_KEY)) == 0)
+                return &mEntries[i];
+        }
+        return NULL;
+    }
+
+    bool CameraDeviceCache :: queryKey(int fd, CAMERA_DEVICE_KEY *key)
+    {
+        struct v4l2_capability v4l2_cap;
+        struct v4l2_dbg_chip_ident vid_chip;
+
+        memset(&v4l2_cap, 0, sizeof(v4l2_cap));
+        if (ioctl(fd, VIDIOC_QUERYCAP, &v4l2_cap) < 0)
+            return false;
+        memset(key, 0, sizeof(CAMERA_DEVICE_KEY));
+        //the driver does not have to terminate the strings
+        snprintf(key->driver, sizeof(key->driver), "%.*s", (int)sizeof(v4l2_cap.driver), (char *)v4l2_cap.driver);
+        snprintf(key->card, sizeof(key->card), "%.*s", (int)sizeof(v4l2_cap.card), (char *)v4l2_cap.card);
+        snprintf(key->bus_info, sizeof(key->bus_info), "%.*s", (int)sizeof(v4l2_cap.bus_info), (char *)v4l2_cap.bus_info);
+        key->version = v4l2_cap.version;
+        //queried on every open, the sensor may change behind the same node
+        memset(&vid_chip, 0, sizeof(vid_chip));
+        if (ioctl(fd, VIDIOC_DBG_G_CHIP_IDENT, &vid_chip) == 0) {
+            snprintf(key->chip, sizeof(key->chip), "%.*s", (int)sizeof(vid_chip.match.name), vid_chip.match.name);
+            key->chipIdent = vid_chip.ident;
+            key->chipRevision = vid_chip.revision;
+        }
+        return true;
+    }
+
+    bool CameraDeviceCache :: findNode(const char *name, char *node, char *sensor)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry;
+
+        load();
+        entry = findByName(name);
+        if (entry == NULL)
+            return false;
+        strcpy(node, entry->node);
+        strcpy(sensor, entry->sensor);
+        return true;
+    }
+
+    bool CameraDeviceCache :: verifyNode(const char *name, int fd, CAMERA_DEVICE_KEY *key)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry;
+        struct stat st;
+
+        load();
+        entry = findByName(name);
+        if (entry == NULL)
+            return false;
+        if (fstat(fd, &st) == 0 && (unsigned int)st.st_rdev == entry->rdev &&
+                queryKey(fd, key) && memcmp(key, &entry->key, sizeof(CAMERA_DEVICE_KEY)) == 0)
+            return true;
+
+        CAMERA_HAL_LOG_INFO("The capture device %s changed, probe it again", entry->node);
+        memset(entry, 0, sizeof(CAMERA_CACHE_ENTRY));
+        save();
+        return false;
+    }
+
+    void CameraDeviceCache :: addNode(const char *name, const char *sensor, const char *node, int fd)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry, *same;
+        CAMERA_DEVICE_KEY key;
+        struct stat st;
+        int i;
+
+        if (strlen(name) >= CAMERA_CACHE_NAME_LENGTH || strlen(sensor) >= CAMERA_CACHE_NAME_LENGTH ||
+                strlen(node) >= CAMERA_CACHE_NODE_LENGTH)
+            return;
+        if (fstat(fd, &st) != 0 || !queryKey(fd, &key))
+            return;
+
+        load();
+        entry = findByName(name);
+        if (entry == NULL) {
+            for (i = 0; i < CAMERA_CACHE_MAX_DEVICE - 1; i++) {
+                if (!mEntries[i].valid)
+                    break;
+            }
+            entry = &mEntries[i];
+        }
+        if (!entry->valid || memcmp(&entry->key, &key, sizeof(key)) != 0) {
+            //another name may have probed the same device already
+            same = findByKey(&key);
+            if (same != NULL && same != entry)
+                memcpy(entry, same, sizeof(CAMERA_CACHE_ENTRY));
+            else{
+                memset(entry, 0, sizeof(CAMERA_CACHE_ENTRY));
+                entry->fmtNum = -1;
+            }
+        }
+        entry->valid = 1;
+        strcpy(entry->name, name);
+        strcpy(entry->sensor, sensor);
+        strcpy(entry->node, node);
+        entry->rdev = (unsigned int)st.st_rdev;
+        entry->key = key;
+        save();
+    }
+
+    void CameraDeviceCache :: invalidate(const char *name)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry;
+
+        load();
+        entry = findByName(name);
+        if (entry != NULL) {
+            memset(entry, 0, sizeof(CAMERA_CACHE_ENTRY));
+            save();
+        }
+    }
+
+    bool CameraDeviceCache :: getFormats(const CAMERA_DEVICE_KEY *key, unsigned int *fmt, int *fmtNum)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry;
+
+        load();
+        entry = findByKey(key);
+        if (entry == NULL || entry->fmtNum < 0)
+            return false;
+        memcpy(fmt, entry->fmt, entry->fmtNum * sizeof(unsigned int));
+        *fmtNum = entry->fmtNum;
+        return true;
+    }
+
+    void CameraDeviceCache :: setFormats(const CAMERA_DEVICE_KEY *key, const unsigned int *fmt, int fmtNum)
+    {
+        Mutex::Autolock lock(mLock);
+        bool changed = false;
+
+        if (fmtNum > CAMERA_CACHE_MAX_FMT)
+            return;
+        load();
+        for (int i = 0; i < CAMERA_CACHE_MAX_DEVICE; i++) {
+            CAMERA_CACHE_ENTRY *entry = &mEntries[i];
+            if (!entry->valid || memcmp(&entry->key, key, sizeof(CAMERA_DEVICE_KEY)) != 0)
+                continue;
+            memcpy(entry->fmt, fmt, fmtNum * sizeof(unsigned int));
+            entry->fmtNum = fmtNum;
+            changed = true;
+        }
+        if (changed)
+            save();
+    }
+
+    bool CameraDeviceCache :: getSizes(const CAMERA_DEVICE_KEY *key, unsigned int fmt,
+            CAMERA_CACHE_SIZE_FPS *size, int *sizeNum)
+    {
+        Mutex::Autolock lock(mLock);
+        CAMERA_CACHE_ENTRY *entry;
+
+        load();
+        entry = findByKey(key);
+        if (entry == NULL)
+            return false;
+        for (int i = 0; i < entry->sizeTableNum; i++) {
+            if (entry->sizeTable[i].fmt == fmt) {
+                memcpy(size, entry->sizeTable[i].size,
+                        entry->sizeTable[i].sizeNum * sizeof(CAMERA_CACHE_SIZE_FPS));
+                *sizeNum = entry->sizeTable[i].sizeNum;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void CameraDeviceCache :: setSizes(const CAMERA_DEVICE_KEY *key, unsigned int fmt,
+            const CAMERA_CACHE_SIZE_FPS *size, int sizeNum)
+    {
+        Mutex::Autolock lock(mLock);
+        bool changed = false;
+        int i, j;
+
+        if (sizeNum > CAMERA_CACHE_MAX_SIZE)
+            return;
+        load();
+        for (i = 0; i < CAMERA_CACHE_MAX_DEVICE; i++) {
+            CAMERA_CACHE_ENTRY *entry = &mEntries[i];
+            if (!entry->valid || memcmp(&entry->key, key, sizeof(CAMERA_DEVICE_KEY)) != 0)
+                continue;
+            for (j = 0; j < entry->sizeTableNum; j++) {
+                if (entry->sizeTable[j].fmt == fmt)
+                    break;
+            }
+            if (j == CAMERA_CACHE_MAX_FMT)
+                continue;
+            if (j == entry->sizeTableNum)
+                entry->sizeTableNum ++;
+            entry->sizeTable[j].fmt = fmt;
+            entry->sizeTable[j].sizeNum = sizeNum;
+            memcpy(entry->sizeTable[j].size, size, sizeNum * sizeof(CAMERA_CACHE_SIZE_FPS));
+            changed = true;
+        }
+        if (changed)
+            save();
+    }
+
+};
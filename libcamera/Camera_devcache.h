@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_DEVICE_CACHE_H
+#define CAMERA_DEVICE_CACHE_H
+
+#include <utils/threads.h>
+#include "CaptureDeviceInterface.h"
+
+#define CAMERA_CACHE_FILE           "/data/misc/camera/capture_devices.cache"
+#define CAMERA_CACHE_MAGIC          0x43564443
+#define CAMERA_CACHE_VERSION        2
+#define CAMERA_CACHE_MAX_DEVICE     4
+#define CAMERA_CACHE_MAX_FMT        16
+#define CAMERA_CACHE_MAX_SIZE       32
+#define CAMERA_CACHE_NAME_LENGTH    32
+#define CAMERA_CACHE_NODE_LENGTH    64
+
+namespace android {
+
+    /*
+     * identity of a capture device, as reported by VIDIOC_QUERYCAP, and of
+     * the sensor behind it as reported by VIDIOC_DBG_G_CHIP_IDENT; the
+     * chip fields stay zero for a device without a chip ident, like UVC
+     */
+    typedef struct {
+        char            driver[16];
+        char            card[32];
+        char            bus_info[32];
+        unsigned int    version;
+        char            chip[32];
+        unsigned int    chipIdent;
+        unsigned int    chipRevision;
+    }CAMERA_DEVICE_KEY;
+
+    typedef struct {
+        unsigned int    width;
+        unsigned int    height;
+        struct timeval_fract tv;
+    }CAMERA_CACHE_SIZE_FPS;
+
+    typedef struct {
+        unsigned int            fmt;
+        int                     sizeNum;
+        CAMERA_CACHE_SIZE_FPS   size[CAMERA_CACHE_MAX_SIZE];
+    }CAMERA_CACHE_FMT;
+
+    typedef struct {
+        int                 valid;
+        /* the name the HAL looks the device up with, and what it resolved to */
+        char                name[CAMERA_CACHE_NAME_LENGTH];
+        char                sensor[CAMERA_CACHE_NAME_LENGTH];
+        char                node[CAMERA_CACHE_NODE_LENGTH];
+        unsigned int        rdev;
+        CAMERA_DEVICE_KEY   key;
+        /* -1 until the formats have been enumerated once */
+        int                 fmtNum;
+        unsigned int        fmt[CAMERA_CACHE_MAX_FMT];
+        int                 sizeTableNum;
+        CAMERA_CACHE_FMT    sizeTable[CAMERA_CACHE_MAX_FMT];
+    }CAMERA_CACHE_ENTRY;
+
+    /*
+     * Process wide cache of the capture devices found under
+     * /sys/class/video4linux, and of the formats, frame sizes and frame
+     * rates they reported. It is written to CAMERA_CACHE_FILE, so a later
+     * mediaserver does not have to walk and query every video node again.
+     *
+     * A cached node is trusted only while its device number and its
+     * QUERYCAP identity still match; on any difference the entry is
+     * dropped and the caller probes the hardware as before. A driver
+     * update changes the version in the key, and a sensor module swapped
+     * behind the same CSI node changes the chip ident, which drops the
+     * capability tables with it.
+     */
+    class CameraDeviceCache
+    {
+    public:
+        /* the cached node for a device name, false if there is none */
+        static bool findNode(const char *name, char *node, char *sensor);
+        /* checks that fd is still the device the name was resolved to */
+        static bool verifyNode(const char *name, int fd, CAMERA_DEVICE_KEY *key);
+        static void addNode(const char *name, const char *sensor, const char *node, int fd);
+        static void invalidate(const char *name);
+
+        /* false if the table was never filled for this device */
+        static bool getFormats(const CAMERA_DEVICE_KEY *key, unsigned int *fmt, int *fmtNum);
+        static void setFormats(const CAMERA_DEVICE_KEY *key, const unsigned int *fmt, int fmtNum);
+        static bool getSizes(const CAMERA_DEVICE_KEY *key, unsigned int fmt,
+                CAMERA_CACHE_SIZE_FPS *size, int *sizeNum);
+        static void setSizes(const CAMERA_DEVICE_KEY *key, unsigned int fmt,
+                const CAMERA_CACHE_SIZE_FPS *size, int sizeNum);
+
+        static bool queryKey(int fd, CAMERA_DEVICE_KEY *key);
+
+    private:
+        typedef struct {
+            unsigned int magic;
+            unsigned int version;
+            unsigned int entrySize;
+            unsigned int entryNum;
+        }CAMERA_CACHE_HEADER;
+
+        static void load();
+        static void save();
+        static CAMERA_CACHE_ENTRY *findByName(const char *name);
+        static CAMERA_CACHE_ENTRY *findByKey(const CAMERA_DEVICE_KEY *key);
+
+        static Mutex                mLock;
+        static bool                 mLoaded;
+        static CAMERA_CACHE_ENTRY   mEntries[CAMERA_CACHE_MAX_DEVICE];
+    };
+
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <sys/mman.h>
+#include "Camera_utils.h"
+#include "Camera_heappool.h"
+
+namespace android {
+
+    CameraJpegHeapPool :: CameraJpegHeapPool()
+        : mBytesPerKPixel(0),
+          mAllocs(0),
+          mReuses(0),
+          mGrows(0)
+    {
+    }
+
+    sp<MemoryHeapBase> CameraJpegHeapPool :: allocate(unsigned int size)
+    {
+        sp<MemoryHeapBase> heap;
+
+        size = (size + 4095) & ~4095;
+        heap = new MemoryHeapBase(size);
+        if (heap == NULL || heap->getHeapID() < 0 || heap->getBase() == MAP_FAILED){
+            CAMERA_HAL_ERR("Can not allocate a jpeg heap of %u bytes", size);
+            return NULL;
+        }
+        return heap;
+    }
+
+    sp<MemoryHeapBase> CameraJpegHeapPool :: acquire(unsigned int pixels, unsigned int maxSize)
+    {
+        Mutex::Autolock lock(mLock);
+        unsigned int size = maxSize;
+        int i, slot = -1;
+
+        //half as much again as the recent pictures needed
+        if (mBytesPerKPixel > 0){
+            size = (unsigned int)((unsigned long long)pixels * mBytesPerKPixel * 3 / 2 / 1024) +
+                JPEG_HEAP_HEADROOM;
+            if (size > maxSize)
+                size = maxSize;
+        }
+
+        for (i = 0; i < JPEG_HEAP_POOL_SIZE; i++){
+            if (mHeaps[i] == NULL){
+                if (slot < 0)
+                    slot = i;
+                continue;
+            }
+            //the pool holds the only reference, nobody reads the last picture any more
+            if (mHeaps[i]->getStrongCount() > 1)
+                continue;
+            if (mHeaps[i]->getSize() >= size && mHeaps[i]->getSize() <= size * 2){
+                mReuses ++;
+                return mHeaps[i];
+            }
+            //too small, or far larger than the pictures are now
+            slot = i;
+        }
+
+        mAllocs ++;
+        if (slot < 0){
+            //all heaps are still out, this one is not kept
+            return allocate(size);
+        }
+        mHeaps[slot] = allocate(size);
+        return mHeaps[slot];
+    }
+
+    sp<MemoryHeapBase> CameraJpegHeapPool :: grow(const sp<MemoryHeapBase> &heap, unsigned int maxSize)
+    {
+        Mutex::Autolock lock(mLock);
+        sp<MemoryHeapBase> larger;
+        unsigned int size;
+        int i;
+
+        if (heap == NULL || heap->getSize() >= maxSize)
+            return NULL;
+        size = heap->getSize() * 2;
+        if (size > maxSize)
+            size = maxSize;
+
+        mGrows ++;
+        larger = allocate(size);
+        for (i = 0; i < JPEG_HEAP_POOL_SIZE; i++){
+            if (mHeaps[i] == heap)
+                mHeaps[i] = larger;
+        }
+        CAMERA_HAL_LOG_INFO("The jpeg did not fit %u bytes, encode it again in %u", (unsigned int)heap->getSize(), size);
+        return larger;
+    }
+
+    void CameraJpegHeapPool :: record(unsigned int pixels, unsigned int jpegSize)
+    {
+        Mutex::Autolock lock(mLock);
+        unsigned int bytesPerKPixel;
+
+        if (pixels == 0)
+            return;
+        bytesPerKPixel = (unsigned int)((unsigned long long)jpegSize * 1024 / pixels) + 1;
+        if (mBytesPerKPixel == 0)
+            mBytesPerKPixel = bytesPerKPixel;
+        else
+            mBytesPerKPixel = (mBytesPerKPixel * 3 + bytesPerKPixel) / 4;
+    }
+
+    void CameraJpegHeapPool :: clear()
+    {
+        Mutex::Autolock lock(mLock);
+        for (int i = 0; i < JPEG_HEAP_POOL_SIZE; i++)
+            mHeaps[i] = NULL;
+    }
+
+    unsigned int CameraJpegHeapPool :: getAllocs() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mAllocs;
+    }
+
+    unsigned int CameraJpegHeapPool :: getReuses() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mReuses;
+    }
+
+    unsigned int CameraJpegHeapPool :: getGrows() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mGrows;
+    }
+
+    unsigned int CameraJpegHeapPool :: getBytesPerKPixel() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mBytesPerKPixel;
+    }
+
+};
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_HEAPPOOL_H
+#define CAMERA_HEAPPOOL_H
+
+#include <utils/threads.h>
+#include <binder/MemoryHeapBase.h>
+
+#define JPEG_HEAP_POOL_SIZE     4
+/* the exif header and the thumbnail come on top of the estimate */
+#define JPEG_HEAP_HEADROOM      (64 * 1024)
+
+namespace android {
+
+    /*
+     * The output heaps of the jpeg encoder, kept across pictures. A heap
+     * is free again once nothing but the pool holds it, that is once the
+     * MemoryBase given to the application is gone. New heaps are sized
+     * from a running estimate of the compressed size rather than the
+     * uncompressed frame; when the encoder runs out of room the caller
+     * asks grow() for a larger one and encodes again.
+     */
+    class CameraJpegHeapPool
+    {
+    public:
+        CameraJpegHeapPool();
+
+        /* maxSize is the uncompressed frame, no jpeg of it needs more */
+        sp<MemoryHeapBase> acquire(unsigned int pixels, unsigned int maxSize);
+        /* NULL if the heap already had maxSize */
+        sp<MemoryHeapBase> grow(const sp<MemoryHeapBase> &heap, unsigned int maxSize);
+        void record(unsigned int pixels, unsigned int jpegSize);
+        void clear();
+
+        unsigned int getAllocs() const;
+        unsigned int getReuses() const;
+        unsigned int getGrows() const;
+        unsigned int getBytesPerKPixel() const;
+
+    private:
+        static sp<MemoryHeapBase> allocate(unsigned int size);
+
+        mutable Mutex       mLock;
+        sp<MemoryHeapBase>  mHeaps[JPEG_HEAP_POOL_SIZE];
+        /* running average of the compressed bytes per 1024 pixels, 0 until the first picture */
+        unsigned int        mBytesPerKPixel;
+        unsigned int        mAllocs;
+        unsigned int        mReuses;
+        unsigned int        mGrows;
+    };
+
+};
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <linux/videodev2.h>
+#include "Camera_utils.h"
+#include "Camera_convert.h"
+#include "Camera_mjpeg.h"
+
+extern "C" {
+#include "jerror.h"
+}
+
+namespace android {
+
+    /* the tables of ITU T.81 K.3, which a MJPEG frame may leave out */
+    static const UINT8 gDcLumaBits[17] =
+        {0, 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    static const UINT8 gDcChromaBits[17] =
+        {0, 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    static const UINT8 gDcValues[12] =
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    static const UINT8 gAcLumaBits[17] =
+        {0, 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+    static const UINT8 gAcLumaValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+    static const UINT8 gAcChromaBits[17] =
+        {0, 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    static const UINT8 gAcChromaValues[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    static void setStdHuffTable(j_decompress_ptr cinfo, JHUFF_TBL **table, const UINT8 *bits, const UINT8 *values)
+    {
+        int count = 0;
+
+        if (*table != NULL)
+            return;
+        for (int i = 1; i <= 16; i++)
+            count += bits[i];
+        *table = jpeg_alloc_huff_table((j_common_ptr)cinfo);
+        memcpy((*table)->bits, bits, sizeof((*table)->bits));
+        memcpy((*table)->huffval, values, count);
+        (*table)->sent_table = FALSE;
+    }
+
+    CameraMjpegDecoder :: CameraMjpegDecoder()
+        : mCreated(false),
+          mRowBuf(NULL),
+          mRowBufSize(0)
+    {
+        memset(&mInfo, 0, sizeof(mInfo));
+        mInfo.err = jpeg_std_error(&mError.pub);
+        mError.pub.error_exit = errorExit;
+        mError.pub.output_message = outputMessage;
+        if (setjmp(mError.jump) == 0){
+            jpeg_create_decompress(&mInfo);
+            mCreated = true;
+        }
+
+        mSource.init_source = initSource;
+        mSource.fill_input_buffer = fillInputBuffer;
+        mSource.skip_input_data = skipInputData;
+        mSource.resync_to_restart = jpeg_resync_to_restart;
+        mSource.term_source = termSource;
+        mSource.next_input_byte = NULL;
+        mSource.bytes_in_buffer = 0;
+        mInfo.src = &mSource;
+    }
+
+    CameraMjpegDecoder :: ~CameraMjpegDecoder()
+    {
+        if (mCreated)
+            jpeg_destroy_decompress(&mInfo);
+        if (mRowBuf != NULL)
+            free(mRowBuf);
+    }
+
+    bool CameraMjpegDecoder :: isSupported(unsigned int fmt)
+    {
+        return fmt == V4L2_PIX_FMT_NV12 || fmt == V4L2_PIX_FMT_NV21 ||
+            fmt == V4L2_PIX_FMT_YUV420;
+    }
+
+    bool CameraMjpegDecoder :: allocRows(int size)
+    {
+        if (size <= mRowBufSize)
+            return true;
+        if (mRowBuf != NULL)
+            free(mRowBuf);
+        mRowBuf = (JSAMPLE *)malloc(size);
+        mRowBufSize = (mRowBuf != NULL) ? size : 0;
+        return mRowBuf != NULL;
+    }
+
+    void CameraMjpegDecoder :: errorExit(j_common_ptr cinfo)
+    {
+        char message[JMSG_LENGTH_MAX];
+
+        //broken frames are common on a busy usb bus, the caller counts them
+        (*cinfo->err->format_message)(cinfo, message);
+        CAMERA_HAL_LOG_RUNTIME("mjpeg: %s", message);
+        longjmp(((MJPEG_ERROR_MGR *)cinfo->err)->jump, 1);
+    }
+
+    void CameraMjpegDecoder :: outputMessage(j_common_ptr cinfo)
+    {
+        char message[JMSG_LENGTH_MAX];
+
+        (*cinfo->err->format_message)(cinfo, message);
+        CAMERA_HAL_LOG_RUNTIME("mjpeg: %s", message);
+    }
+
+    void CameraMjpegDecoder :: initSource(j_decompress_ptr cinfo)
+    {
+    }
+
+    /* the whole frame is in memory, needing more means it was cut */
+    boolean CameraMjpegDecoder :: fillInputBuffer(j_decompress_ptr cinfo)
+    {
+        ERREXIT(cinfo, JERR_INPUT_EOF);
+        return FALSE;
+    }
+
+    void CameraMjpegDecoder :: skipInputData(j_decompress_ptr cinfo, long numBytes)
+    {
+        if (numBytes <= 0)
+            return;
+        if ((size_t)numBytes > cinfo->src->bytes_in_buffer)
+            ERREXIT(cinfo, JERR_INPUT_EOF);
+        cinfo->src->next_input_byte += numBytes;
+        cinfo->src->bytes_in_buffer -= numBytes;
+    }
+
+    void CameraMjpegDecoder :: termSource(j_decompress_ptr cinfo)
+    {
+    }
+
+    void CameraMjpegDecoder :: fillHuffTables()
+    {
+        setStdHuffTable(&mInfo, &mInfo.dc_huff_tbl_ptrs[0], gDcLumaBits, gDcValues);
+        setStdHuffTable(&mInfo, &mInfo.dc_huff_tbl_ptrs[1], gDcChromaBits, gDcValues);
+        setStdHuffTable(&mInfo, &mInfo.ac_huff_tbl_ptrs[0], gAcLumaBits, gAcLumaValues);
+        setStdHuffTable(&mInfo, &mInfo.ac_huff_tbl_ptrs[1], gAcChromaBits, gAcChromaValues);
+    }
+
+    bool CameraMjpegDecoder :: decode(const uint8_t *src, unsigned int length, uint8_t *dst,
+            unsigned int fmt, int width, int height)
+    {
+        jpeg_component_info *comp;
+        bool raw;
+
+        if (!mCreated || src == NULL || dst == NULL || length == 0 || !isSupported(fmt) ||
+                width <= 0 || height <= 0 || (width & 1) || (height & 1))
+            return false;
+
+        if (setjmp(mError.jump)){
+            jpeg_abort_decompress(&mInfo);
+            return false;
+        }
+        mSource.next_input_byte = src;
+        mSource.bytes_in_buffer = length;
+        jpeg_read_header(&mInfo, TRUE);
+        if ((int)mInfo.image_width != width || (int)mInfo.image_height != height){
+            CAMERA_HAL_LOG_RUNTIME("mjpeg frame of %dx%d, %dx%d expected",
+                    mInfo.image_width, mInfo.image_height, width, height);
+            jpeg_abort_decompress(&mInfo);
+            return false;
+        }
+        fillHuffTables();
+        mInfo.dct_method = JDCT_IFAST;
+        mInfo.do_fancy_upsampling = FALSE;
+
+        comp = mInfo.comp_info;
+        raw = mInfo.num_components == 3 && mInfo.jpeg_color_space == JCS_YCbCr &&
+            comp[0].h_samp_factor == 2 && (comp[0].v_samp_factor == 1 || comp[0].v_samp_factor == 2) &&
+            comp[1].h_samp_factor == 1 && comp[1].v_samp_factor == 1 &&
+            comp[2].h_samp_factor == 1 && comp[2].v_samp_factor == 1;
+        if (raw)
+            decodeRaw(dst, fmt, width, height);
+        else
+            decodeScanlines(dst, fmt, width, height);
+
+        jpeg_finish_decompress(&mInfo);
+        return true;
+    }
+
+    /*
+     * 4:2:2 and 4:2:0 frames. libjpeg gives an iMCU row at a time, 8 or
+     * 16 luma rows and 8 chroma rows, each row padded to whole blocks. The
+     * luma goes straight to the frame when its width is a multiple of 8,
+     * the chroma rows are interleaved into place, and the two chroma rows
+     * of every output row of a 4:2:2 frame are averaged.
+     */
+    void CameraMjpegDecoder :: decodeRaw(uint8_t *dst, unsigned int fmt, int width, int height)
+    {
+        const CONVERT_KERNELS *k = getConvertKernels();
+        JSAMPROW yRows[2 * DCTSIZE], uRows[DCTSIZE], vRows[DCTSIZE];
+        JSAMPARRAY planes[3] = {yRows, uRows, vRows};
+        int vSamp = mInfo.comp_info[0].v_samp_factor;
+        int mcuRows = vSamp * DCTSIZE;
+        int padWidth = mInfo.comp_info[0].width_in_blocks * DCTSIZE;
+        int chromaPad = mInfo.comp_info[1].width_in_blocks * DCTSIZE;
+        int chromaWidth = width / 2, chromaHeight = height / 2;
+        bool direct = (padWidth == width);
+        uint8_t *uvPlane = dst + width * height;
+        uint8_t *vPlane = uvPlane + chromaWidth * chromaHeight;
+        JSAMPLE *yBuf, *uBuf, *vBuf;
+        int row, i, c;
+
+        if (!allocRows(padWidth * mcuRows + chromaPad * DCTSIZE * 2))
+            ERREXIT1(&mInfo, JERR_OUT_OF_MEMORY, 0);
+        yBuf = mRowBuf;
+        uBuf = yBuf + padWidth * mcuRows;
+        vBuf = uBuf + chromaPad * DCTSIZE;
+
+        mInfo.raw_data_out = TRUE;
+        mInfo.out_color_space = JCS_YCbCr;
+        jpeg_start_decompress(&mInfo);
+
+        for (row = 0; row < height; row += mcuRows){
+            for (i = 0; i < mcuRows; i++)
+                yRows[i] = (direct && row + i < height) ? dst + (row + i) * width : yBuf + i * padWidth;
+            for (i = 0; i < DCTSIZE; i++){
+                uRows[i] = uBuf + i * chromaPad;
+                vRows[i] = vBuf + i * chromaPad;
+            }
+            jpeg_read_raw_data(&mInfo, planes, mcuRows);
+
+            if (!direct){
+                for (i = 0; i < mcuRows && row + i < height; i++)
+                    memcpy(dst + (row + i) * width, yRows[i], width);
+            }
+            for (c = row / 2; c < (row + mcuRows) / 2 && c < chromaHeight; c++){
+                i = (2 * c - row) / vSamp;
+                if (vSamp == 1){
+                    k->blendRows(uRows[i], uRows[i + 1], uRows[i], chromaWidth, 128);
+                    k->blendRows(vRows[i], vRows[i + 1], vRows[i], chromaWidth, 128);
+                }
+                if (fmt == V4L2_PIX_FMT_NV12)
+                    k->mergeUV(uRows[i], vRows[i], uvPlane + c * width, chromaWidth);
+                else if (fmt == V4L2_PIX_FMT_NV21)
+                    k->mergeUV(vRows[i], uRows[i], uvPlane + c * width, chromaWidth);
+                else{
+                    memcpy(uvPlane + c * chromaWidth, uRows[i], chromaWidth);
+                    memcpy(vPlane + c * chromaWidth, vRows[i], chromaWidth);
+                }
+            }
+        }
+    }
+
+    /* any other jpeg, gray or 4:4:4, one upsampled YCbCr scanline at a time */
+    void CameraMjpegDecoder :: decodeScanlines(uint8_t *dst, unsigned int fmt, int width, int height)
+    {
+        bool gray = (mInfo.num_components == 1);
+        int chromaWidth = width / 2, chromaHeight = height / 2;
+        uint8_t *uvPlane = dst + width * height;
+        uint8_t *vPlane = uvPlane + chromaWidth * chromaHeight;
+        uint8_t *yRow, *uRow, *vRow;
+        JSAMPROW line;
+        int row, x, step;
+
+        if (!allocRows(width * 3))
+            ERREXIT1(&mInfo, JERR_OUT_OF_MEMORY, 0);
+        line = mRowBuf;
+
+        mInfo.raw_data_out = FALSE;
+        mInfo.out_color_space = gray ? JCS_GRAYSCALE : JCS_YCbCr;
+        jpeg_start_decompress(&mInfo);
+
+        while ((int)mInfo.output_scanline < height){
+            row = mInfo.output_scanline;
+            jpeg_read_scanlines(&mInfo, &line, 1);
+            yRow = dst + row * width;
+            if (gray){
+                memcpy(yRow, line, width);
+                if ((row & 1) == 0 && fmt == V4L2_PIX_FMT_YUV420){
+                    memset(uvPlane + (row / 2) * chromaWidth, 128, chromaWidth);
+                    memset(vPlane + (row / 2) * chromaWidth, 128, chromaWidth);
+                }else if ((row & 1) == 0)
+                    memset(uvPlane + (row / 2) * width, 128, width);
+                continue;
+            }
+            for (x = 0; x < width; x++)
+                yRow[x] = line[3 * x];
+            if (row & 1)
+                continue;
+            //the chroma of the even rows, every other pixel
+            if (fmt == V4L2_PIX_FMT_YUV420){
+                uRow = uvPlane + (row / 2) * chromaWidth;
+                vRow = vPlane + (row / 2) * chromaWidth;
+                step = 1;
+            }else{
+                uRow = uvPlane + (row / 2) * width + (fmt == V4L2_PIX_FMT_NV21 ? 1 : 0);
+                vRow = uvPlane + (row / 2) * width + (fmt == V4L2_PIX_FMT_NV21 ? 0 : 1);
+                step = 2;
+            }
+            for (x = 0; x < chromaWidth; x++){
+                uRow[x * step] = line[6 * x + 1];
+                vRow[x * step] = line[6 * x + 2];
+            }
+        }
+    }
+
+};
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_MJPEG_H
+#define CAMERA_MJPEG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+
+extern "C" {
+#include "jpeglib.h"
+}
+
+namespace android {
+
+    typedef struct {
+        struct jpeg_error_mgr pub;
+        jmp_buf jump;
+    }MJPEG_ERROR_MGR;
+
+    /*
+     * Decodes the frames of a MJPEG stream into tightly packed NV12, NV21
+     * or YU12 frames with libjpeg, which is libjpeg-turbo with its SIMD
+     * IDCT on the recent platforms. The 4:2:2 and 4:2:0 frames of the
+     * webcams are read as raw downsampled data, so there is no color
+     * conversion or upsampling, only the chroma is interleaved or
+     * decimated. Frames without huffman tables get the standard ones.
+     * The codec context is kept from frame to frame. An instance is only
+     * used by one thread at a time.
+     */
+    class CameraMjpegDecoder {
+    public:
+        CameraMjpegDecoder();
+        ~CameraMjpegDecoder();
+
+        static bool isSupported(unsigned int fmt);
+        /* false when the data is broken or not a width x height jpeg */
+        bool decode(const uint8_t *src, unsigned int length, uint8_t *dst,
+                unsigned int fmt, int width, int height);
+
+    private:
+        bool allocRows(int size);
+        void fillHuffTables();
+        void decodeRaw(uint8_t *dst, unsigned int fmt, int width, int height);
+        void decodeScanlines(uint8_t *dst, unsigned int fmt, int width, int height);
+
+        static void errorExit(j_common_ptr cinfo);
+        static void outputMessage(j_common_ptr cinfo);
+        static void initSource(j_decompress_ptr cinfo);
+        static boolean fillInputBuffer(j_decompress_ptr cinfo);
+        static void skipInputData(j_decompress_ptr cinfo, long numBytes);
+        static void termSource(j_decompress_ptr cinfo);
+
+        struct jpeg_decompress_struct mInfo;
+        MJPEG_ERROR_MGR mError;
+        struct jpeg_source_mgr mSource;
+        bool mCreated;
+
+        /* an iMCU row of padded luma and chroma, or one scanline */
+        JSAMPLE *mRowBuf;
+        int mRowBufSize;
+    };
+
+};
+
+#endif
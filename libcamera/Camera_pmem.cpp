@@ -17,147 +17,432 @@
  * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
  */
 
+#include <string.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <errno.h>
-#include <pthread.h>
-#include <semaphore.h>
-#include <linux/time.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
 #include <sys/mman.h>
-#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <linux/android_pmem.h>
+#include <cutils/properties.h>
 #include "Camera_pmem.h"
 
-
-/*
- *   input parameter: 
- */
+/* the dma-buf heap uapi, the kernel headers here do not have it */
+struct camera_dma_heap_allocation_data {
+    unsigned long long len;
+    unsigned int fd;
+    unsigned int fd_flags;
+    unsigned long long heap_flags;
+};
+#define CAMERA_DMA_HEAP_IOCTL_ALLOC _IOWR('H', 0x0, struct camera_dma_heap_allocation_data)
 
 using namespace android;
 
-PmemAllocator::PmemAllocator(int bufCount, int bufSize):
-    err_ret(0), mFD(0),mTotalSize(0),mBufCount(bufCount),mBufSize(bufSize),
-    mVirBase(NULL),mPhyBase(NULL)
+CameraMemPool *CameraMemPool::getInstance()
 {
+    static CameraMemPool sPool;
+    return &sPool;
+}
 
-    memset(mSlotAllocated, 0, sizeof(bool)*MAX_SLOT);
+CameraMemPool::CameraMemPool():
+    mBackend(CAMERA_MEM_MEMFD), mTick(0), mMappedBytes(0), mPeakBytes(0), mMaps(0)
+{
+    char value[PROPERTY_VALUE_MAX];
 
-    int err;
-    struct pmem_region region;
-    mFD = open(PMEM_DEV, O_RDWR);
-    if (mFD < 0) {
-        CAMERA_HAL_ERR("Error!PmemAllocator constructor");
-        err_ret = -1;
-        return;
+    memset(mClasses, 0, sizeof(mClasses));
+    property_get("rw.camera.mem.backend", value, "auto");
+    if (strcmp(value, "pmem") == 0)
+        mBackend = CAMERA_MEM_PMEM;
+    else if (strcmp(value, "dmaheap") == 0)
+        mBackend = CAMERA_MEM_DMA_HEAP;
+    else if (strcmp(value, "memfd") == 0)
+        mBackend = CAMERA_MEM_MEMFD;
+    //a backend that is there but out of memory must not fall through to one without physical addresses
+    else if (access(PMEM_DEV, F_OK) == 0)
+        mBackend = CAMERA_MEM_PMEM;
+    else if (access(CAMERA_DMA_HEAP_CMA, F_OK) == 0 || access(CAMERA_DMA_HEAP_SYSTEM, F_OK) == 0)
+        mBackend = CAMERA_MEM_DMA_HEAP;
+    else
+        mBackend = CAMERA_MEM_MEMFD;
+}
+
+int CameraMemPool::reserve(unsigned int bufSize, int count)
+{
+    Mutex::Autolock lock(mLock);
+    int cls = -1, idle = -1;
+
+    bufSize = (bufSize + DEFAULT_PMEM_ALIGN-1) & ~(DEFAULT_PMEM_ALIGN-1);
+    if (bufSize == 0 || count <= 0 || count > MAX_SLOT)
+        return -1;
+
+    for (int i = 0; i < CAMERA_MEM_MAX_CLASSES; i++) {
+        if (mClasses[i].bufSize == bufSize) {
+            cls = i;
+            break;
+        }
+        if (mClasses[i].bufSize == 0) {
+            if (idle < 0 || mClasses[idle].bufSize != 0)
+                idle = i;
+        }else if (mClasses[i].used == 0 && mClasses[i].reserved == 0 &&
+                (idle < 0 || (mClasses[idle].bufSize != 0 && mClasses[i].lastUse < mClasses[idle].lastUse))) {
+            idle = i;
+        }
     }
 
-    err = ioctl(mFD, PMEM_GET_TOTAL_SIZE, &region);
-    if (err == 0)
-    {
-        CAMERA_HAL_ERR("Info!get pmem total size %d",(int)region.len);
+    if (cls < 0) {
+        //a free class, or the least recently used idle one
+        if (idle < 0) {
+            CAMERA_HAL_ERR("No buffer class left for %d bytes", bufSize);
+            return -1;
+        }
+        if (mClasses[idle].bufSize != 0)
+            releaseClass(idle);
+        cls = idle;
+        mClasses[cls].bufSize = bufSize;
     }
-    else
-    {
-        CAMERA_HAL_ERR("Error!Cannot get total length in PmemAllocator constructor");
-        err_ret = -1;
-        return;
+
+    CAMERA_MEM_CLASS *pClass = &mClasses[cls];
+    if (pClass->freeNum - pClass->reserved < count &&
+            !grow(cls, count - (pClass->freeNum - pClass->reserved))) {
+        if (pClass->slotNum == 0)
+            pClass->bufSize = 0;
+        return -1;
     }
+    pClass->reserved += count;
+    pClass->lastUse = ++mTick;
+    return cls;
+}
 
-    mBufSize = (bufSize + DEFAULT_PMEM_ALIGN-1) & ~(DEFAULT_PMEM_ALIGN-1);
+void CameraMemPool::unreserve(int cls, int count)
+{
+    Mutex::Autolock lock(mLock);
 
-    mTotalSize = mBufSize*bufCount;
-    if((mTotalSize > region.len)||(mBufCount > MAX_SLOT)) {
-        CAMERA_HAL_ERR("Error!Out of PmemAllocator capability");
+    mClasses[cls].reserved -= count;
+    if (mClasses[cls].reserved < 0)
+        mClasses[cls].reserved = 0;
+}
+
+bool CameraMemPool::grow(int cls, int count)
+{
+    CAMERA_MEM_CLASS *pClass = &mClasses[cls];
+    CAMERA_MEM_REGION region;
+
+    if (pClass->chunkNum == CAMERA_MEM_MAX_CHUNKS || pClass->slotNum + count > MAX_SLOT) {
+        CAMERA_HAL_ERR("The %d bytes buffer class can not grow by %d", pClass->bufSize, count);
+        return false;
+    }
+    if (!mapBackend(mBackend, pClass->bufSize * count, &region)) {
+        //the memory may be held by idle classes of other sizes
+        trimLocked(cls);
+        if (!mapBackend(mBackend, pClass->bufSize * count, &region))
+            return false;
     }
-    else
-    {
-        uint8_t *virtualbase = (uint8_t*)mmap(0, mTotalSize,
-                PROT_READ|PROT_WRITE, MAP_SHARED, mFD, 0);
-
-        if (virtualbase == MAP_FAILED) {
-            CAMERA_HAL_ERR("Error!mmap(fd=%d, size=%u) failed (%s)",
-                    mFD, (unsigned int)mTotalSize, strerror(errno));
-            return;
-        }
 
-        memset(&region, 0, sizeof(region));
+    pClass->chunks[pClass->chunkNum] = region;
+    pClass->chunkFirst[pClass->chunkNum] = pClass->slotNum;
+    pClass->chunkNum ++;
+    for (int i = 0; i < count; i++) {
+        int slot = pClass->slotNum ++;
+        pClass->slotVir[slot] = region.vir + i * pClass->bufSize;
+        pClass->slotPhy[slot] = region.phy ? region.phy + i * pClass->bufSize : 0;
+        pClass->freeSlots[pClass->freeNum ++] = slot;
+    }
+    return true;
+}
 
-        if (ioctl(mFD, PMEM_GET_PHYS, &region) == -1)
-        {
-            CAMERA_HAL_ERR("Error!Failed to get physical address of source!\n");
-            munmap(virtualbase, mTotalSize);
-            return;
-        }
-        mVirBase = (void *)virtualbase;
-        mPhyBase = region.offset;
-        CAMERA_HAL_LOG_RUNTIME("Allocator total size %d, vir addr 0x%x, phy addr 0x%x",mTotalSize,mVirBase,mPhyBase);
+void CameraMemPool::releaseClass(int cls)
+{
+    CAMERA_MEM_CLASS *pClass = &mClasses[cls];
+
+    for (int i = 0; i < pClass->chunkNum; i++) {
+        mMappedBytes -= pClass->chunks[i].size;
+        unmapRegion(&pClass->chunks[i]);
     }
+    memset(pClass, 0, sizeof(CAMERA_MEM_CLASS));
 }
 
-PmemAllocator::~PmemAllocator()
+void CameraMemPool::trimLocked(int keep)
 {
-    CAMERA_HAL_LOG_FUNC;
+    for (int i = 0; i < CAMERA_MEM_MAX_CLASSES; i++) {
+        if (i != keep && mClasses[i].bufSize != 0 &&
+                mClasses[i].used == 0 && mClasses[i].reserved == 0)
+            releaseClass(i);
+    }
+}
+
+void CameraMemPool::trim()
+{
+    Mutex::Autolock lock(mLock);
+    trimLocked(-1);
+}
+
+int CameraMemPool::allocate(int cls, DMA_BUFFER *pBuf)
+{
+    Mutex::Autolock lock(mLock);
+    CAMERA_MEM_CLASS *pClass = &mClasses[cls];
+    int slot;
+
+    if (pClass->freeNum == 0)
+        return -1;
+    slot = pClass->freeSlots[-- pClass->freeNum];
+    if (pClass->reserved > 0)
+        pClass->reserved --;
+    pClass->used ++;
+    if (pClass->used > pClass->peakUsed)
+        pClass->peakUsed = pClass->used;
+    pClass->lastUse = ++mTick;
 
-    for(int index=0;index < MAX_SLOT;index ++) {
-        if(mSlotAllocated[index]) {
-            CAMERA_HAL_ERR("Error!Cannot deinit PmemAllocator before all memory back to allocator");
+    pBuf->virt_start = pClass->slotVir[slot];
+    pBuf->phy_offset = pClass->slotPhy[slot];
+    pBuf->length = pClass->bufSize;
+    return slot;
+}
+
+bool CameraMemPool::lookup(const DMA_BUFFER *pBuf, int *pCls, int *pSlot) const
+{
+    Mutex::Autolock lock(mLock);
+
+    for (int i = 0; i < CAMERA_MEM_MAX_CLASSES; i++) {
+        const CAMERA_MEM_CLASS *pClass = &mClasses[i];
+        for (int j = 0; j < pClass->chunkNum; j++) {
+            const CAMERA_MEM_REGION *pRegion = &pClass->chunks[j];
+            if (pBuf->virt_start >= pRegion->vir && pBuf->virt_start < pRegion->vir + pRegion->size) {
+                *pCls = i;
+                *pSlot = pClass->chunkFirst[j] + (pBuf->virt_start - pRegion->vir) / pClass->bufSize;
+                return true;
+            }
         }
     }
+    return false;
+}
+
+void CameraMemPool::free(int cls, int slot, bool keepReserved)
+{
+    Mutex::Autolock lock(mLock);
+    CAMERA_MEM_CLASS *pClass = &mClasses[cls];
 
-    if(mVirBase) {
-        munmap(mVirBase, mTotalSize);
+    pClass->freeSlots[pClass->freeNum ++] = slot;
+    pClass->used --;
+    if (keepReserved)
+        pClass->reserved ++;
+}
+
+void CameraMemPool::dump(String8 &result) const
+{
+    Mutex::Autolock lock(mLock);
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    static const char *backends[] = {"pmem", "dma-heap", "memfd"};
+
+    snprintf(buffer, SIZE, "  buffer pool %s: %u bytes mapped, peak %u, %u maps\n",
+            backends[mBackend],
+            mMappedBytes, mPeakBytes, mMaps);
+    result.append(buffer);
+    for (int i = 0; i < CAMERA_MEM_MAX_CLASSES; i++) {
+        const CAMERA_MEM_CLASS *pClass = &mClasses[i];
+        if (pClass->bufSize == 0)
+            continue;
+        snprintf(buffer, SIZE, "    %8u bytes: %d buffers, %d in use, peak %d, %d reserved\n",
+                pClass->bufSize, pClass->slotNum, pClass->used, pClass->peakUsed, pClass->reserved);
+        result.append(buffer);
+    }
+}
+
+bool CameraMemPool::mapBackend(CAMERA_MEM_BACKEND backend, unsigned int size, CAMERA_MEM_REGION *pRegion)
+{
+    bool ret;
+
+    memset(pRegion, 0, sizeof(CAMERA_MEM_REGION));
+    pRegion->fd = -1;
+    switch (backend) {
+        case CAMERA_MEM_PMEM:
+            ret = mapPmem(size, pRegion);
+            break;
+        case CAMERA_MEM_DMA_HEAP:
+            ret = mapDmaHeap(size, pRegion);
+            break;
+        case CAMERA_MEM_MEMFD:
+        default:
+            ret = mapMemfd(size, pRegion);
+            break;
+    }
+    if (!ret) {
+        unmapRegion(pRegion);
+        return false;
+    }
+    pRegion->size = size;
+    mMappedBytes += size;
+    if (mMappedBytes > mPeakBytes)
+        mPeakBytes = mMappedBytes;
+    mMaps ++;
+    return true;
+}
+
+bool CameraMemPool::mapPmem(unsigned int size, CAMERA_MEM_REGION *pRegion)
+{
+    struct pmem_region region;
+    void *vir;
+
+    pRegion->fd = open(PMEM_DEV, O_RDWR);
+    if (pRegion->fd < 0)
+        return false;
+
+    if (ioctl(pRegion->fd, PMEM_GET_TOTAL_SIZE, &region) != 0 || size > region.len) {
+        CAMERA_HAL_ERR("Error!Out of PmemAllocator capability");
+        return false;
+    }
+    vir = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, pRegion->fd, 0);
+    if (vir == MAP_FAILED) {
+        CAMERA_HAL_ERR("Error!mmap(fd=%d, size=%u) failed (%s)", pRegion->fd, size, strerror(errno));
+        return false;
+    }
+    pRegion->vir = (unsigned char *)vir;
+    pRegion->size = size;
+
+    memset(&region, 0, sizeof(region));
+    if (ioctl(pRegion->fd, PMEM_GET_PHYS, &region) == -1) {
+        CAMERA_HAL_ERR("Error!Failed to get physical address of source!\n");
+        return false;
+    }
+    pRegion->phy = region.offset;
+    return true;
+}
+
+bool CameraMemPool::mapDmaHeap(unsigned int size, CAMERA_MEM_REGION *pRegion)
+{
+    struct camera_dma_heap_allocation_data data;
+    void *vir;
+    int heap;
+
+    heap = open(CAMERA_DMA_HEAP_CMA, O_RDWR);
+    if (heap < 0)
+        heap = open(CAMERA_DMA_HEAP_SYSTEM, O_RDWR);
+    if (heap < 0)
+        return false;
+
+    memset(&data, 0, sizeof(data));
+    data.len = size;
+    data.fd_flags = O_RDWR | O_CLOEXEC;
+    if (ioctl(heap, CAMERA_DMA_HEAP_IOCTL_ALLOC, &data) < 0) {
+        CAMERA_HAL_ERR("dma-heap allocation of %u bytes failed (%s)", size, strerror(errno));
+        close(heap);
+        return false;
+    }
+    close(heap);
+    pRegion->fd = data.fd;
+
+    vir = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, pRegion->fd, 0);
+    if (vir == MAP_FAILED)
+        return false;
+    pRegion->vir = (unsigned char *)vir;
+    pRegion->size = size;
+    return true;
+}
+
+bool CameraMemPool::mapMemfd(unsigned int size, CAMERA_MEM_REGION *pRegion)
+{
+    void *vir;
+
+#ifdef __NR_memfd_create
+    pRegion->fd = syscall(__NR_memfd_create, "camera", 0);
+#endif
+    if (pRegion->fd >= 0) {
+        if (ftruncate(pRegion->fd, size) < 0)
+            return false;
+        vir = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, pRegion->fd, 0);
+    }else{
+        //a kernel older than memfd, plain shared memory then
+        vir = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
     }
-    if(mFD) {
-        close(mFD);
+    if (vir == MAP_FAILED)
+        return false;
+    pRegion->vir = (unsigned char *)vir;
+    pRegion->size = size;
+    return true;
+}
+
+void CameraMemPool::unmapRegion(CAMERA_MEM_REGION *pRegion)
+{
+    if (pRegion->vir != NULL)
+        munmap(pRegion->vir, pRegion->size);
+    if (pRegion->fd >= 0)
+        close(pRegion->fd);
+    pRegion->vir = NULL;
+    pRegion->fd = -1;
+}
+
+PmemAllocator::PmemAllocator(int bufCount, int bufSize):
+    err_ret(0), mClass(-1), mBufSize(0), mReserved(0)
+{
+    memset(mOwned, 0, sizeof(mOwned));
+
+    mBufSize = (bufSize + DEFAULT_PMEM_ALIGN-1) & ~(DEFAULT_PMEM_ALIGN-1);
+    mClass = CameraMemPool::getInstance()->reserve(mBufSize, bufCount);
+    if (mClass < 0) {
+        CAMERA_HAL_ERR("Error!Can not reserve %d buffers of %d bytes", bufCount, mBufSize);
+        err_ret = -1;
+        return;
     }
+    mReserved = bufCount;
+}
 
+PmemAllocator::~PmemAllocator()
+{
+    CAMERA_HAL_LOG_FUNC;
+    CameraMemPool *pPool = CameraMemPool::getInstance();
+
+    if (mClass < 0)
+        return;
+    for (int slot = 0; slot < MAX_SLOT; slot++) {
+        if (mOwned[slot]) {
+            CAMERA_HAL_ERR("Buffer %d was not given back to the PmemAllocator", slot);
+            pPool->free(mClass, slot, false);
+        }
+    }
+    if (mReserved > 0)
+        pPool->unreserve(mClass, mReserved);
 }
 
 int PmemAllocator::allocate(DMA_BUFFER *pbuf, int size)
 {
     CAMERA_HAL_LOG_FUNC;
+    int slot;
 
-    if((!mVirBase)||(!pbuf)||(size>mBufSize)) {
+    if ((mClass < 0)||(!pbuf)||(size>mBufSize)||(mReserved == 0)) {
         CAMERA_HAL_ERR("Error!No memory for allocator");
         return DMA_ALLOCATE_ERR_BAD_PARAM;
     }
 
-    for(int index=0;index < MAX_SLOT;index ++) {
-        if(!mSlotAllocated[index]) {
-            CAMERA_HAL_ERR("Free slot %d for allocating mBufSize %d request size %d",
-                    index,mBufSize,size);
-
-            pbuf->virt_start= (unsigned char *)mVirBase+index*mBufSize; 
-            pbuf->phy_offset= mPhyBase+index*mBufSize;
-            pbuf->length= mBufSize;
-            mSlotAllocated[index] = true;
-            return DMA_ALLOCATE_ERR_NONE;
-        }
-    }
-    return DMA_ALLOCATE_ERR_BAD_PARAM;
+    slot = CameraMemPool::getInstance()->allocate(mClass, pbuf);
+    if (slot < 0)
+        return DMA_ALLOCATE_ERR_BAD_PARAM;
+    mOwned[slot] = true;
+    mReserved --;
+    return DMA_ALLOCATE_ERR_NONE;
 }
 
 int PmemAllocator::deAllocate(DMA_BUFFER *pbuf)
 {
     CAMERA_HAL_LOG_FUNC;
-    if((!mVirBase)||(!pbuf)) {
+    CameraMemPool *pPool = CameraMemPool::getInstance();
+    int cls, slot;
+
+    if ((mClass < 0)||(!pbuf)) {
         CAMERA_HAL_ERR("Error!No memory for allocator");
         return DMA_ALLOCATE_ERR_BAD_PARAM;
     }
-    int nSlot = ((unsigned int)pbuf->virt_start- (unsigned int)mVirBase)/mBufSize;
-    if((nSlot<MAX_SLOT)&&(mSlotAllocated[nSlot])) {
-        CAMERA_HAL_ERR("Info!deAllocate for slot %d",nSlot);
-        mSlotAllocated[nSlot] = false;
-        return DMA_ALLOCATE_ERR_NONE;
-    }
-    else{
+    //the slot may belong to another allocator of the same size by now
+    if (!pPool->lookup(pbuf, &cls, &slot) || cls != mClass || !mOwned[slot]) {
         CAMERA_HAL_ERR("Error!Not a valid buffer");
         return DMA_ALLOCATE_ERR_BAD_PARAM;
     }
+    //the allocator can take it again
+    mOwned[slot] = false;
+    pPool->free(mClass, slot, true);
+    mReserved ++;
+    return DMA_ALLOCATE_ERR_NONE;
 }
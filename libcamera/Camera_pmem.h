@@ -22,32 +22,122 @@
 
 #include "Camera_utils.h"
 #include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/String8.h>
 
 
 #define DEFAULT_PMEM_ALIGN (4096)
 #define PMEM_DEV "/dev/pmem_adsp"
+/* the buffers of one size class */
 #define MAX_SLOT 64
+#define CAMERA_MEM_MAX_CLASSES  8
+/* the mappings a size class can grow by */
+#define CAMERA_MEM_MAX_CHUNKS   4
+#define CAMERA_DMA_HEAP_CMA     "/dev/dma_heap/linux,cma"
+#define CAMERA_DMA_HEAP_SYSTEM  "/dev/dma_heap/system"
 
 namespace android {
 
-class PmemAllocator : public virtual RefBase
-{
-public:
-    PmemAllocator(int bufCount,int bufSize);
-    virtual ~PmemAllocator();
-    virtual int allocate(DMA_BUFFER *p_buf, int size);
-    virtual int deAllocate(DMA_BUFFER *p_buf);
-	int err_ret;
-private:
-    int mFD;
-    unsigned long mTotalSize;
-    int mBufCount;
-    int mBufSize;
-    void *mVirBase;
-    unsigned int mPhyBase;
-    bool mSlotAllocated[MAX_SLOT];
-	
-};
+    /*
+     * Where the buffers come from. Only pmem gives physical addresses,
+     * the other two let the HAL run with the software post process on a
+     * kernel without pmem. rw.camera.mem.backend picks one, else the
+     * first one the kernel has.
+     */
+    typedef enum{
+        CAMERA_MEM_PMEM = 0,
+        CAMERA_MEM_DMA_HEAP = 1,
+        CAMERA_MEM_MEMFD = 2
+    }CAMERA_MEM_BACKEND;
+
+    typedef struct {
+        int fd;
+        unsigned char *vir;
+        size_t phy;
+        unsigned int size;
+    }CAMERA_MEM_REGION;
+
+    typedef struct {
+        unsigned int bufSize;       /* 0 for an unused class */
+        int chunkNum;
+        CAMERA_MEM_REGION chunks[CAMERA_MEM_MAX_CHUNKS];
+        int chunkFirst[CAMERA_MEM_MAX_CHUNKS];
+        int slotNum;
+        unsigned char *slotVir[MAX_SLOT];
+        size_t slotPhy[MAX_SLOT];
+        int freeSlots[MAX_SLOT];    /* a stack, allocate and free are O(1) */
+        int freeNum;
+        int reserved;               /* promised to an allocator, not taken yet */
+        int used;
+        int peakUsed;
+        unsigned int lastUse;
+    }CAMERA_MEM_CLASS;
+
+    /*
+     * The process wide buffer pool, one class per buffer size. The
+     * mappings stay after the sessions that made them, so the next
+     * preview or picture of the same size does not open, map and look
+     * up the physical address again. An idle class is unmapped when its
+     * slot is needed for another size, when the backend runs out of
+     * memory, or on trim().
+     */
+    class CameraMemPool
+    {
+    public:
+        static CameraMemPool *getInstance();
+
+        /* makes sure count more buffers of bufSize can be allocated, returns the class */
+        int reserve(unsigned int bufSize, int count);
+        void unreserve(int cls, int count);
+        /* returns the slot, or -1 */
+        int allocate(int cls, DMA_BUFFER *pBuf);
+        bool lookup(const DMA_BUFFER *pBuf, int *pCls, int *pSlot) const;
+        void free(int cls, int slot, bool keepReserved);
+        void trim();
+        void dump(String8 &result) const;
+        /* only pmem gives the physical addresses the IPU and the CSI DMA need */
+        bool hasPhysAddr() const { return mBackend == CAMERA_MEM_PMEM; }
+
+    private:
+        CameraMemPool();
+
+        bool grow(int cls, int count);
+        void releaseClass(int cls);
+        void trimLocked(int keep);
+        bool mapBackend(CAMERA_MEM_BACKEND backend, unsigned int size, CAMERA_MEM_REGION *pRegion);
+        static bool mapPmem(unsigned int size, CAMERA_MEM_REGION *pRegion);
+        static bool mapDmaHeap(unsigned int size, CAMERA_MEM_REGION *pRegion);
+        static bool mapMemfd(unsigned int size, CAMERA_MEM_REGION *pRegion);
+        static void unmapRegion(CAMERA_MEM_REGION *pRegion);
+
+        mutable Mutex       mLock;
+        CAMERA_MEM_BACKEND  mBackend;
+        CAMERA_MEM_CLASS    mClasses[CAMERA_MEM_MAX_CLASSES];
+        unsigned int        mTick;
+        unsigned int        mMappedBytes;
+        unsigned int        mPeakBytes;
+        unsigned int        mMaps;
+    };
+
+    /*
+     * The buffers of one session, taken from CameraMemPool. The count
+     * given here is reserved at once, so allocate only fails on a bad
+     * size. What is not deAllocated goes back with the allocator.
+     */
+    class PmemAllocator : public virtual RefBase
+    {
+    public:
+        PmemAllocator(int bufCount,int bufSize);
+        virtual ~PmemAllocator();
+        virtual int allocate(DMA_BUFFER *p_buf, int size);
+        virtual int deAllocate(DMA_BUFFER *p_buf);
+        int err_ret;
+    private:
+        int mClass;
+        int mBufSize;
+        int mReserved;
+        bool mOwned[MAX_SLOT];
+    };
 };
 
 #endif
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "Camera_utils.h"
+#include "Camera_ppsched.h"
+
+namespace android {
+
+    Mutex CameraPPScheduler :: mInstanceLock;
+    wp<CameraPPScheduler> CameraPPScheduler :: mInstances[PP_SCHED_MAX_DEVICES];
+
+    sp<CameraPPScheduler> CameraPPScheduler :: getInstance(const sp<PostProcessDeviceInterface> &device)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mInstanceLock);
+        sp<CameraPPScheduler> sched;
+        int freeSlot = -1;
+
+        if (device == NULL)
+            return NULL;
+        for (int i = 0; i < PP_SCHED_MAX_DEVICES; i++) {
+            sched = mInstances[i].promote();
+            if (sched == 0) {
+                if (freeSlot < 0)
+                    freeSlot = i;
+                continue;
+            }
+            if (sched->mDevice == device)
+                return sched;
+        }
+        if (freeSlot < 0) {
+            CAMERA_HAL_ERR("Too many post process devices");
+            return NULL;
+        }
+
+        sched = new CameraPPScheduler(device);
+        mInstances[freeSlot] = sched;
+        return sched;
+    }
+
+    CameraPPScheduler :: CameraPPScheduler(const sp<PostProcessDeviceInterface> &device)
+        : mDevice(device),
+          mHardware(device->PPDeviceIsHardware()),
+          mClientNum(0),
+          mPending(NULL),
+          mBusy(false),
+          mConfigured(false),
+          mBatchRun(0),
+          mConfigSwitches(0),
+          mBatched(0)
+    {
+        for (int i = 0; i < PP_SCHED_MAX_CLIENTS; i++) {
+            mClients[i].used = false;
+            mClients[i].name[0] = '\0';
+        }
+        memset(&mCurrent, 0, sizeof(mCurrent));
+    }
+
+    CameraPPScheduler :: ~CameraPPScheduler()
+    {
+        if (mConfigured)
+            mDevice->PPDeviceDeInit();
+    }
+
+    int CameraPPScheduler :: openClient(const char *name, nsecs_t budget)
+    {
+        Mutex::Autolock lock(mLock);
+
+        for (int i = 0; i < PP_SCHED_MAX_CLIENTS; i++) {
+            PP_SCHED_CLIENT *pClient = &mClients[i];
+            if (pClient->used)
+                continue;
+            pClient->used = true;
+            strncpy(pClient->name, name, PP_SCHED_NAME_LEN - 1);
+            pClient->name[PP_SCHED_NAME_LEN - 1] = '\0';
+            pClient->budget = budget;
+            pClient->jobs = 0;
+            pClient->late = 0;
+            pClient->errors = 0;
+            pClient->delay.reset(pClient->name);
+            mClientNum ++;
+            CAMERA_HAL_LOG_INFO("pp client %d %s, %lld us per job", i, pClient->name, (long long)(budget / 1000));
+            return i;
+        }
+        CAMERA_HAL_ERR("No pp client slot for %s", name);
+        return -1;
+    }
+
+    void CameraPPScheduler :: closeClient(int client)
+    {
+        Mutex::Autolock lock(mLock);
+
+        if (client < 0 || client >= PP_SCHED_MAX_CLIENTS || !mClients[client].used)
+            return;
+        //the stats stay for dump until the slot is taken again
+        mClients[client].used = false;
+        mClientNum --;
+        //a job still running deinits the device when it is done, see process()
+        if (mClientNum == 0 && !mBusy && mConfigured) {
+            mDevice->PPDeviceDeInit();
+            mConfigured = false;
+        }
+    }
+
+    bool CameraPPScheduler :: sameConfig(const PP_SCHED_JOB *a, const PP_SCHED_JOB *b)
+    {
+        pp_input_param_t in = a->in;
+        pp_output_param_t out = a->out;
+
+        //the buffer address is not part of the config, the structures have no padding
+        in.user_def_paddr = b->in.user_def_paddr;
+        out.user_def_paddr = b->out.user_def_paddr;
+        return memcmp(&in, &b->in, sizeof(in)) == 0 && memcmp(&out, &b->out, sizeof(out)) == 0;
+    }
+
+    PP_SCHED_JOB *CameraPPScheduler :: pickJob(nsecs_t now)
+    {
+        PP_SCHED_JOB *first = NULL, *batch = NULL;
+
+        for (PP_SCHED_JOB *job = mPending; job != NULL; job = job->next) {
+            if (first == NULL || job->deadline < first->deadline)
+                first = job;
+            if (mConfigured && sameConfig(job, &mCurrent) &&
+                    (batch == NULL || job->deadline < batch->deadline))
+                batch = job;
+        }
+
+        if (batch == NULL || batch == first) {
+            mBatchRun = 0;
+            return first;
+        }
+        //another config waits, keep the task while it is not late and not starved
+        if (first->deadline > now && mBatchRun < PP_SCHED_BATCH_MAX) {
+            mBatchRun ++;
+            mBatched ++;
+            return batch;
+        }
+        mBatchRun = 0;
+        return first;
+    }
+
+    void CameraPPScheduler :: runJob(PP_SCHED_JOB *job)
+    {
+        PP_SCHED_CLIENT *pClient = &mClients[job->client];
+        PPDEVICE_ERR_RET ret = PPDEVICE_ERROR_NONE;
+        bool setup = !mConfigured || !sameConfig(job, &mCurrent);
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC), end;
+
+        pClient->delay.record(start - job->submitTime);
+        if (setup) {
+            mConfigSwitches ++;
+            mCurrent = *job;
+            mConfigured = false;
+        }
+
+        mLock.unlock();
+        if (setup)
+            ret = mDevice->PPDeviceInit(&job->in, &job->out);
+        if (ret == PPDEVICE_ERROR_NONE)
+            ret = mDevice->DoPorcess(job->inBuf, job->outBuf);
+        end = systemTime(SYSTEM_TIME_MONOTONIC);
+        mLock.lock();
+
+        //a failed task is set up again by the next job
+        mConfigured = ret == PPDEVICE_ERROR_NONE;
+        pClient->jobs ++;
+        if (ret != PPDEVICE_ERROR_NONE)
+            pClient->errors ++;
+        if (end > job->deadline)
+            pClient->late ++;
+        job->ret = ret;
+    }
+
+    PPDEVICE_ERR_RET CameraPPScheduler :: process(int client, const pp_input_param_t *in,
+            const pp_output_param_t *out, DMA_BUFFER *inBuf, DMA_BUFFER *outBuf)
+    {
+        PP_SCHED_JOB job, **tail;
+        Mutex::Autolock lock(mLock);
+
+        if (client < 0 || client >= PP_SCHED_MAX_CLIENTS || !mClients[client].used)
+            return PPDEVICE_ERROR_PROCESS;
+        //the hardware would read or write physical address 0
+        if (mHardware && (inBuf->phy_offset == 0 || outBuf->phy_offset == 0)){
+            CAMERA_HAL_ERR("The pp buffers have no physical address");
+            return PPDEVICE_ERROR_PROCESS;
+        }
+
+        job.client = client;
+        job.in = *in;
+        job.out = *out;
+        job.inBuf = inBuf;
+        job.outBuf = outBuf;
+        job.submitTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        job.deadline = job.submitTime + mClients[client].budget;
+        job.ret = PPDEVICE_ERROR_NONE;
+        job.done = false;
+        job.next = NULL;
+        for (tail = &mPending; *tail != NULL; tail = &(*tail)->next)
+            ;
+        *tail = &job;
+
+        //whoever gets the device runs the next job, which may be the one of another thread
+        while (!job.done) {
+            if (mBusy || mPending == NULL) {
+                mCond.wait(mLock);
+                continue;
+            }
+            PP_SCHED_JOB *next = pickJob(systemTime(SYSTEM_TIME_MONOTONIC));
+            for (tail = &mPending; *tail != next; tail = &(*tail)->next)
+                ;
+            *tail = next->next;
+
+            mBusy = true;
+            runJob(next);
+            mBusy = false;
+            //the last client closed while the job ran
+            if (mClientNum == 0 && mConfigured) {
+                mDevice->PPDeviceDeInit();
+                mConfigured = false;
+            }
+            next->done = true;
+            mCond.broadcast();
+        }
+        return job.ret;
+    }
+
+    void CameraPPScheduler :: dump(String8 &result) const
+    {
+        Mutex::Autolock lock(mLock);
+        const size_t SIZE = 256;
+        char buffer[SIZE];
+
+        snprintf(buffer, SIZE, "  pp scheduler %s: %d clients, %u config switches, %u jobs batched\n",
+                mHardware ? "ipu" : "cpu", mClientNum, mConfigSwitches, mBatched);
+        result.append(buffer);
+        for (int i = 0; i < PP_SCHED_MAX_CLIENTS; i++) {
+            const PP_SCHED_CLIENT *pClient = &mClients[i];
+            if (pClient->name[0] == '\0')
+                continue;
+            snprintf(buffer, SIZE, "    %-24s %s jobs %u late %u errors %u queue p50 %u us p99 %u us max %u us\n",
+                    pClient->name, pClient->used ? "open  " : "closed", pClient->jobs, pClient->late,
+                    pClient->errors, pClient->delay.getPercentile(50), pClient->delay.getPercentile(99),
+                    pClient->delay.getMax());
+            result.append(buffer);
+        }
+    }
+
+};
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_PP_SCHED_H
+#define CAMERA_PP_SCHED_H
+
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/String8.h>
+
+#include "PostProcessDeviceInterface.h"
+#include "Camera_stage.h"
+
+#define PP_SCHED_MAX_CLIENTS    8
+#define PP_SCHED_MAX_DEVICES    2
+#define PP_SCHED_NAME_LEN       32
+/* jobs run in a row on the current config while a job of another one waits */
+#define PP_SCHED_BATCH_MAX      4
+
+namespace android {
+
+    typedef struct PP_SCHED_JOB {
+        int client;
+        pp_input_param_t in;
+        pp_output_param_t out;
+        DMA_BUFFER *inBuf;
+        DMA_BUFFER *outBuf;
+        nsecs_t submitTime;
+        nsecs_t deadline;
+        PPDEVICE_ERR_RET ret;
+        bool done;
+        struct PP_SCHED_JOB *next;
+    }PP_SCHED_JOB;
+
+    typedef struct {
+        bool used;
+        char name[PP_SCHED_NAME_LEN];
+        nsecs_t budget;
+        unsigned int jobs;
+        unsigned int late;
+        unsigned int errors;
+        CameraLatencyHistogram delay;
+    }PP_SCHED_CLIENT;
+
+    /*
+     * Owns one post process device for all the cameras of the process.
+     * Every user (a preview, a picture) opens a client with a time budget
+     * per job, the deadline of a job is its submit time plus the budget.
+     * The threads waiting in process() take turns on the device, the one
+     * which gets it runs the pending job with the earliest deadline, so
+     * there is no extra thread hop. A job on the config the device is set
+     * up for is preferred over an earlier one that is not late yet, up to
+     * PP_SCHED_BATCH_MAX in a row, which saves setting up the IPU task
+     * again for every frame of two streams.
+     */
+    class CameraPPScheduler : public virtual RefBase
+    {
+    public:
+        /* the scheduler of the device, made on the first call */
+        static sp<CameraPPScheduler> getInstance(const sp<PostProcessDeviceInterface> &device);
+
+        /* returns the client id, or -1 when all the slots are used */
+        int openClient(const char *name, nsecs_t budget);
+        /* the device is shut down with the last client */
+        void closeClient(int client);
+
+        /* runs one job for the client and returns when it is done */
+        PPDEVICE_ERR_RET process(int client, const pp_input_param_t *in, const pp_output_param_t *out,
+                DMA_BUFFER *inBuf, DMA_BUFFER *outBuf);
+        bool isHardware() const { return mHardware; }
+        void dump(String8 &result) const;
+
+        virtual ~CameraPPScheduler();
+
+    private:
+        CameraPPScheduler(const sp<PostProcessDeviceInterface> &device);
+
+        static bool sameConfig(const PP_SCHED_JOB *a, const PP_SCHED_JOB *b);
+        PP_SCHED_JOB *pickJob(nsecs_t now);
+        void runJob(PP_SCHED_JOB *job);
+
+        static Mutex mInstanceLock;
+        static wp<CameraPPScheduler> mInstances[PP_SCHED_MAX_DEVICES];
+
+        sp<PostProcessDeviceInterface> mDevice;
+        bool                mHardware;
+
+        mutable Mutex       mLock;
+        Condition           mCond;
+        PP_SCHED_CLIENT     mClients[PP_SCHED_MAX_CLIENTS];
+        int                 mClientNum;
+        PP_SCHED_JOB       *mPending;
+        bool                mBusy;
+
+        /* the config the device is set up for, valid when mConfigured */
+        PP_SCHED_JOB        mCurrent;
+        bool                mConfigured;
+        int                 mBatchRun;
+        unsigned int        mConfigSwitches;
+        unsigned int        mBatched;
+    };
+
+};
+
+#endif
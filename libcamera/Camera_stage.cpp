@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <cutils/atomic.h>
+
+#include "Camera_stage.h"
+
+namespace android {
+
+    CameraStageSignal :: CameraStageSignal()
+        : mName(""),
+          mCount(0),
+          mAborted(false),
+          mWakeups(0),
+          mPosts(0)
+    {
+    }
+
+    void CameraStageSignal :: reset(const char *name, int count)
+    {
+        Mutex::Autolock lock(mLock);
+        mName = name;
+        mCount = count;
+        mAborted = false;
+        mWakeups = 0;
+        mPosts = 0;
+    }
+
+    bool CameraStageSignal :: wait()
+    {
+        Mutex::Autolock lock(mLock);
+        while (mCount == 0 && !mAborted) {
+            mCond.wait(mLock);
+            mWakeups ++;
+        }
+        if (mAborted)
+            return false;
+        mCount --;
+        return true;
+    }
+
+    void CameraStageSignal :: post()
+    {
+        Mutex::Autolock lock(mLock);
+        mCount ++;
+        mPosts ++;
+        mCond.signal();
+    }
+
+    void CameraStageSignal :: abort()
+    {
+        Mutex::Autolock lock(mLock);
+        mAborted = true;
+        mCond.broadcast();
+    }
+
+    int CameraStageSignal :: getCount() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mCount;
+    }
+
+    unsigned int CameraStageSignal :: getWakeups() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mWakeups;
+    }
+
+    unsigned int CameraStageSignal :: getPosts() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mPosts;
+    }
+
+    CameraFrameQueue :: CameraFrameQueue()
+        : mName(""),
+          mDepth(1),
+          mHead(0),
+          mCount(0),
+          mAborted(false),
+          mWakeups(0),
+          mPosts(0),
+          mDrops(0)
+    {
+    }
+
+    void CameraFrameQueue :: reset(const char *name, int depth)
+    {
+        Mutex::Autolock lock(mLock);
+        if (depth < 1)
+            depth = 1;
+        if (depth > CAMERA_FRAME_QUEUE_MAX)
+            depth = CAMERA_FRAME_QUEUE_MAX;
+        mName = name;
+        mDepth = depth;
+        mHead = 0;
+        mCount = 0;
+        mAborted = false;
+        mWakeups = 0;
+        mPosts = 0;
+        mDrops = 0;
+    }
+
+    int CameraFrameQueue :: push(int index)
+    {
+        Mutex::Autolock lock(mLock);
+        int dropped = -1;
+
+        if (mCount == mDepth) {
+            dropped = mFrames[mHead];
+            mHead = (mHead + 1) % mDepth;
+            mCount --;
+            mDrops ++;
+        }
+        mFrames[(mHead + mCount) % mDepth] = index;
+        mCount ++;
+        mPosts ++;
+        mCond.signal();
+        return dropped;
+    }
+
+    bool CameraFrameQueue :: pop(int *index)
+    {
+        Mutex::Autolock lock(mLock);
+        while (mCount == 0 && !mAborted) {
+            mCond.wait(mLock);
+            mWakeups ++;
+        }
+        if (mAborted)
+            return false;
+        *index = mFrames[mHead];
+        mHead = (mHead + 1) % mDepth;
+        mCount --;
+        return true;
+    }
+
+    bool CameraFrameQueue :: flush(int *index)
+    {
+        Mutex::Autolock lock(mLock);
+        if (mCount == 0)
+            return false;
+        *index = mFrames[mHead];
+        mHead = (mHead + 1) % mDepth;
+        mCount --;
+        return true;
+    }
+
+    void CameraFrameQueue :: abort()
+    {
+        Mutex::Autolock lock(mLock);
+        mAborted = true;
+        mCond.broadcast();
+    }
+
+    int CameraFrameQueue :: getCount() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mCount;
+    }
+
+    unsigned int CameraFrameQueue :: getWakeups() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mWakeups;
+    }
+
+    unsigned int CameraFrameQueue :: getPosts() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mPosts;
+    }
+
+    unsigned int CameraFrameQueue :: getDrops() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mDrops;
+    }
+
+    CameraLatencyHistogram :: CameraLatencyHistogram()
+        : mName(""),
+          mCount(0),
+          mMax(0)
+    {
+        for (int i = 0; i < CAMERA_LATENCY_BUCKETS; i++)
+            mBuckets[i] = 0;
+    }
+
+    void CameraLatencyHistogram :: reset(const char *name)
+    {
+        mName = name;
+        for (int i = 0; i < CAMERA_LATENCY_BUCKETS; i++)
+            android_atomic_release_store(0, &mBuckets[i]);
+        android_atomic_release_store(0, &mCount);
+        android_atomic_release_store(0, &mMax);
+    }
+
+    void CameraLatencyHistogram :: record(nsecs_t latency)
+    {
+        int32_t us, max;
+        int bucket = 0;
+
+        if (latency < 0)
+            latency = 0;
+        us = latency / 1000 > 0x7FFFFFFF ? 0x7FFFFFFF : (int32_t)(latency / 1000);
+        while (bucket < CAMERA_LATENCY_BUCKETS - 1 && (us >> (bucket + 1)) != 0)
+            bucket ++;
+        android_atomic_inc(&mBuckets[bucket]);
+        android_atomic_inc(&mCount);
+
+        do {
+            max = android_atomic_acquire_load(&mMax);
+        } while (us > max && android_atomic_cmpxchg(max, us, &mMax) != 0);
+    }
+
+    unsigned int CameraLatencyHistogram :: getCount() const
+    {
+        return android_atomic_acquire_load(&mCount);
+    }
+
+    unsigned int CameraLatencyHistogram :: getPercentile(int percent) const
+    {
+        unsigned int count = getCount(), sum = 0, target;
+
+        if (count == 0)
+            return 0;
+        target = (count * percent + 99) / 100;
+        for (int i = 0; i < CAMERA_LATENCY_BUCKETS - 1; i++) {
+            sum += android_atomic_acquire_load(&mBuckets[i]);
+            if (sum >= target)
+                return (2U << i) < getMax() ? (2U << i) : getMax();
+        }
+        return getMax();
+    }
+
+    unsigned int CameraLatencyHistogram :: getMax() const
+    {
+        return android_atomic_acquire_load(&mMax);
+    }
+
+};
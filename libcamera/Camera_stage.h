@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_STAGE_H
+#define CAMERA_STAGE_H
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#define CAMERA_FRAME_QUEUE_MAX 8
+/* bucket i counts the latencies of [2^i, 2^(i+1)) us, the last one is open */
+#define CAMERA_LATENCY_BUCKETS 24
+
+namespace android {
+
+    /*
+     * Counting signal between two pipeline stages. It replaces the
+     * sem_timedwait polling: wait() blocks without any timeout until a
+     * post() or an abort(). Once aborted, every wait() returns false at
+     * once until the signal is reset, so the stage threads can leave
+     * cleanly on stop or on error.
+     */
+    class CameraStageSignal
+    {
+    public:
+        CameraStageSignal();
+
+        void reset(const char *name, int count);
+        bool wait();
+        void post();
+        void abort();
+
+        const char *getName() const { return mName; }
+        int getCount() const;
+        unsigned int getWakeups() const;
+        unsigned int getPosts() const;
+
+    private:
+        mutable Mutex   mLock;
+        Condition       mCond;
+        const char     *mName;
+        int             mCount;
+        bool            mAborted;
+        /* how many times a waiter blocked and was woken up again */
+        unsigned int    mWakeups;
+        unsigned int    mPosts;
+    };
+
+    /*
+     * Bounded FIFO of frame indexes in front of one consumer stage. The
+     * producer never waits on it: pushing into a full queue pushes out the
+     * oldest frame, which is handed back so the caller can drop its
+     * reference. A slow consumer then only loses frames, it does not hold
+     * back the capture or the other consumers.
+     */
+    class CameraFrameQueue
+    {
+    public:
+        CameraFrameQueue();
+
+        void reset(const char *name, int depth);
+        /* returns the index pushed out of a full queue, or -1 */
+        int push(int index);
+        /* blocks for the oldest frame, returns false once aborted */
+        bool pop(int *index);
+        /* takes a queued frame without blocking, returns false if empty */
+        bool flush(int *index);
+        void abort();
+
+        const char *getName() const { return mName; }
+        int getCount() const;
+        unsigned int getWakeups() const;
+        unsigned int getPosts() const;
+        unsigned int getDrops() const;
+
+    private:
+        mutable Mutex   mLock;
+        Condition       mCond;
+        const char     *mName;
+        int             mFrames[CAMERA_FRAME_QUEUE_MAX];
+        int             mDepth;
+        int             mHead;
+        int             mCount;
+        bool            mAborted;
+        unsigned int    mWakeups;
+        unsigned int    mPosts;
+        unsigned int    mDrops;
+    };
+
+    /*
+     * Latency histogram of one stage. record() only does atomic adds, so
+     * the stage threads never wait on each other or on dump(). The
+     * percentiles are the upper bound of their bucket, good to a factor
+     * of two, which is enough to see where the time goes.
+     */
+    class CameraLatencyHistogram
+    {
+    public:
+        CameraLatencyHistogram();
+
+        void reset(const char *name);
+        void record(nsecs_t latency);
+
+        const char *getName() const { return mName; }
+        unsigned int getCount() const;
+        /* in us, 0 before the first record */
+        unsigned int getPercentile(int percent) const;
+        unsigned int getMax() const;
+
+    private:
+        const char       *mName;
+        volatile int32_t  mBuckets[CAMERA_LATENCY_BUCKETS];
+        volatile int32_t  mCount;
+        volatile int32_t  mMax;
+    };
+
+};
+
+#endif
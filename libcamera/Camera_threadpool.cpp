@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+#include "Camera_utils.h"
+#include "Camera_threadpool.h"
+
+namespace android {
+
+    Mutex CameraThreadPool :: mInstanceLock;
+    wp<CameraThreadPool> CameraThreadPool :: mInstance;
+
+    sp<CameraThreadPool> CameraThreadPool :: getInstance()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mInstanceLock);
+        sp<CameraThreadPool> pool = mInstance.promote();
+        if (pool != 0)
+            return pool;
+
+        char value[PROPERTY_VALUE_MAX];
+        int threadNum = 0;
+        property_get("rw.camera.threads", value, "0");
+        threadNum = atoi(value);
+        if (threadNum <= 0)
+            threadNum = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+        pool = new CameraThreadPool(threadNum);
+        mInstance = pool;
+        return pool;
+    }
+
+    CameraThreadPool :: CameraThreadPool(int threadNum)
+        : mThreadNum(threadNum),
+          mExit(false),
+          mTask(NULL),
+          mTaskArg(NULL),
+          mItemCount(0),
+          mNextItem(0),
+          mItemsDone(0),
+          mActiveWorkers(0),
+          mGeneration(0)
+    {
+        if (mThreadNum < 1)
+            mThreadNum = 1;
+        if (mThreadNum > MAX_POOL_THREAD_NUM)
+            mThreadNum = MAX_POOL_THREAD_NUM;
+
+        //the caller of parallelFor is the first worker
+        for (int i = 1; i < mThreadNum; i++) {
+            mWorkers[i] = new WorkerThread(this);
+            if (mWorkers[i]->run("CameraPoolWorker", PRIORITY_URGENT_DISPLAY) != NO_ERROR) {
+                CAMERA_HAL_ERR("Fail to start the pool worker %d", i);
+                mWorkers[i].clear();
+                mThreadNum = i;
+                break;
+            }
+        }
+        CAMERA_HAL_LOG_INFO("Camera thread pool with %d threads", mThreadNum);
+    }
+
+    CameraThreadPool :: ~CameraThreadPool()
+    {
+        {
+            Mutex::Autolock lock(mLock);
+            mExit = true;
+            mWorkCond.broadcast();
+        }
+        for (int i = 1; i < mThreadNum; i++) {
+            if (mWorkers[i] != 0) {
+                mWorkers[i]->requestExitAndWait();
+                mWorkers[i].clear();
+            }
+        }
+    }
+
+    void CameraThreadPool :: runItems()
+    {
+        int done = 0;
+        int index;
+
+        while ((index = android_atomic_inc(&mNextItem)) < mItemCount) {
+            mTask(mTaskArg, index);
+            done ++;
+        }
+
+        Mutex::Autolock lock(mLock);
+        mItemsDone += done;
+        mActiveWorkers --;
+        if (mItemsDone == mItemCount && mActiveWorkers == 0)
+            mDoneCond.broadcast();
+    }
+
+    bool CameraThreadPool :: workerLoop(unsigned int *pGeneration)
+    {
+        {
+            Mutex::Autolock lock(mLock);
+            while (!mExit && (mTask == NULL || mGeneration == *pGeneration))
+                mWorkCond.wait(mLock);
+            if (mExit)
+                return false;
+            //the job can not be finished while this worker is active on it
+            *pGeneration = mGeneration;
+            mActiveWorkers ++;
+        }
+        runItems();
+        return true;
+    }
+
+    void CameraThreadPool :: parallelFor(POOL_TASK task, void *arg, int count)
+    {
+        if (count <= 0)
+            return;
+        if (mThreadNum == 1 || count == 1) {
+            for (int i = 0; i < count; i++)
+                task(arg, i);
+            return;
+        }
+
+        Mutex::Autolock jobLock(mJobLock);
+        {
+            Mutex::Autolock lock(mLock);
+            mTask = task;
+            mTaskArg = arg;
+            mItemCount = count;
+            mItemsDone = 0;
+            mActiveWorkers = 1;
+            android_atomic_release_store(0, &mNextItem);
+            mGeneration ++;
+            mWorkCond.broadcast();
+        }
+
+        runItems();
+
+        Mutex::Autolock lock(mLock);
+        while (mItemsDone < mItemCount || mActiveWorkers > 0)
+            mDoneCond.wait(mLock);
+        mTask = NULL;
+    }
+
+};
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_THREAD_POOL_H
+#define CAMERA_THREAD_POOL_H
+
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+
+#define MAX_POOL_THREAD_NUM 8
+
+namespace android {
+
+    /*
+     * A small fixed pool of worker threads for splitting one piece of work
+     * (a frame, a slice of a jpeg) into independent items. The calling
+     * thread takes part in the work, so a pool of one thread is the same
+     * as a plain loop. Jobs are run one after the other.
+     */
+    class CameraThreadPool : public virtual RefBase
+    {
+    public:
+        typedef void (*POOL_TASK)(void *arg, int index);
+
+        /* the process wide pool, sized by rw.camera.threads or the cpu count */
+        static sp<CameraThreadPool> getInstance();
+
+        CameraThreadPool(int threadNum);
+        virtual ~CameraThreadPool();
+
+        /* run task(arg, i) for every i in [0, count) and wait for all of them */
+        void parallelFor(POOL_TASK task, void *arg, int count);
+        int getThreadNum() { return mThreadNum; }
+
+    private:
+        class WorkerThread : public Thread {
+            CameraThreadPool* mPool;
+            unsigned int mGeneration;
+        public:
+            WorkerThread(CameraThreadPool* pool)
+                : Thread(false), mPool(pool), mGeneration(0) { }
+
+            virtual bool threadLoop() {
+                return mPool->workerLoop(&mGeneration);
+            }
+        };
+
+        bool workerLoop(unsigned int *pGeneration);
+        void runItems();
+
+        static Mutex mInstanceLock;
+        static wp<CameraThreadPool> mInstance;
+
+        Mutex               mJobLock;
+        Mutex               mLock;
+        Condition           mWorkCond;
+        Condition           mDoneCond;
+        int                 mThreadNum;
+        sp<WorkerThread>    mWorkers[MAX_POOL_THREAD_NUM];
+        bool                mExit;
+
+        /* the job being run, all guarded by mLock except mNextItem */
+        POOL_TASK           mTask;
+        void               *mTaskArg;
+        int                 mItemCount;
+        volatile int32_t    mNextItem;
+        int                 mItemsDone;
+        int                 mActiveWorkers;
+        unsigned int        mGeneration;
+    };
+
+};
+
+#endif
@@ -54,6 +54,12 @@ namespace android {
         unsigned int length;
     }DMA_BUFFER;
 
+    // If struct change. Need info Camera Source.
+    typedef struct {
+        size_t phy_offset;
+        unsigned int length;
+    }VIDEOFRAME_BUFFER_PHY;
+
 }; //name space android
 
 #endif
@@ -19,10 +19,17 @@
  */
 #include "V4l2UVCDevice.h"
 #include "V4l2CsiDevice.h"
+#include "ReplayCapDevice.h"
 namespace android{
     extern "C" sp<CaptureDeviceInterface> createCaptureDevice(char *deviceName)
     {
-        if(strstr(deviceName, UVC_NAME_STRING)){
+        if(strncmp(deviceName, REPLAY_NAME_STRING, strlen(REPLAY_NAME_STRING)) == 0){
+            CAMERA_HAL_LOG_INFO("It is the replay device");
+
+            sp<CaptureDeviceInterface>  device(new ReplayCapDevice());
+            device->SetDevName(deviceName);
+            return device;
+        }else if(strstr(deviceName, UVC_NAME_STRING)){
             CAMERA_HAL_LOG_INFO("It is the UVC device");
 
             sp<CaptureDeviceInterface>  device(new V4l2UVCDevice());
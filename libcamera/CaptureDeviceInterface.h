@@ -22,11 +22,14 @@
 #define CAPTURE_DEVICE_INTERFACE_H
 
 #include <utils/RefBase.h>
+#include <utils/Timers.h>
+#include <utils/String8.h>
 #include "Camera_utils.h"
 
 
 namespace android {
 #define UVC_NAME_STRING "uvc"
+#define REPLAY_NAME_STRING "replay"
 
     typedef enum{
         CAPTURE_DEVICE_ERR_ALRADY_OPENED  = 3,
@@ -60,6 +63,13 @@ namespace android {
         SENSOR_PREVIEW_ROATE_LAST = 3
 	}SENSOR_PREVIEW_ROTATE;
 
+    /* who owns the capture buffers, see DevImportBuf */
+    typedef enum{
+        CAPTURE_MEMORY_MMAP = 0,
+        CAPTURE_MEMORY_USERPTR = 1,
+        CAPTURE_MEMORY_DMABUF = 2
+    }CAPTURE_MEMORY_TYPE;
+
     struct timeval_fract{
         unsigned int numerator;
         unsigned int denominator;
@@ -75,6 +85,12 @@ namespace android {
 		SENSOR_PREVIEW_ROTATE rotate;
     };
 
+    /* what the driver told about the last frame dequeued in a buffer */
+    struct capture_frame_info_t{
+        unsigned int sequence;
+        nsecs_t timestamp;
+    };
+
 
     class CaptureDeviceInterface : public virtual RefBase{
     public:
@@ -85,13 +101,23 @@ namespace android {
         virtual CAPTURE_DEVICE_ERR_RET EnumDevParam(DevParamType devParamType, void *retParam)=0;
         virtual CAPTURE_DEVICE_ERR_RET DevSetConfig(struct capture_config_t *pCapcfg)=0;
         virtual CAPTURE_DEVICE_ERR_RET DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum)=0;
+        /*
+         * Capture into the caller's buffers instead of the driver's: USERPTR
+         * takes DevBufQue[i] as it is, DMABUF the dma-buf fd in pDmaFd[i].
+         * The buffers stay the caller's, DevDeAllocate only lets them go.
+         */
+        virtual CAPTURE_DEVICE_ERR_RET DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+                unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType)=0;
         virtual CAPTURE_DEVICE_ERR_RET DevPrepare()=0;
         virtual CAPTURE_DEVICE_ERR_RET DevStart()=0;
         virtual CAPTURE_DEVICE_ERR_RET DevDequeue(unsigned int *pBufQueIdx)=0;
         virtual CAPTURE_DEVICE_ERR_RET DevQueue(unsigned int BufQueIdx)=0;
+        virtual CAPTURE_DEVICE_ERR_RET DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo)=0;
         virtual CAPTURE_DEVICE_ERR_RET DevStop()=0;
         virtual CAPTURE_DEVICE_ERR_RET DevDeAllocate()=0;
         virtual CAPTURE_DEVICE_ERR_RET DevClose()=0;
+        /* the device's own counters for the HAL's dump, if it has any */
+        virtual void DevDump(String8 &result)=0;
 
         virtual ~ CaptureDeviceInterface(){}
     };
@@ -18,6 +18,7 @@
  * Copyright 2009-2011 Freescale Semiconductor, Inc. 
  */
 #include "JpegEncoderSoftware.h"
+#include "JpegEncoderTurbo.h"
 namespace android{
 
     extern "C" sp<JpegEncoderInterface> createJpegEncoder(JPEG_ENCODER_TYPE jpeg_enc_type)
@@ -26,6 +27,10 @@ namespace android{
             CAMERA_HAL_LOG_INFO("Create the software encoder");
             return JpegEncoderSoftware::createInstance();
         }
+        else if (jpeg_enc_type == TURBO_JPEG_ENC){
+            CAMERA_HAL_LOG_INFO("Create the libjpeg encoder");
+            return JpegEncoderTurbo::createInstance();
+        }
         else{
             CAMERA_HAL_ERR("the hardware encoder is not supported");
             return NULL;
@@ -73,13 +73,15 @@ namespace android{
 
     typedef enum{
         SOFTWARE_JPEG_ENC = 0,
-        HARDWARE_JPEG_ENC = 1
+        HARDWARE_JPEG_ENC = 1,
+        TURBO_JPEG_ENC = 2      /* libjpeg, see JpegEncoderTurbo */
     }JPEG_ENCODER_TYPE;
 
     typedef enum{
         JPEG_ENC_ERROR_NONE = 0,
         JPEG_ENC_ERROR_BAD_PARAM = -1,
-        JPEG_ENC_ERROR_ALOC_BUF = -2
+        JPEG_ENC_ERROR_ALOC_BUF = -2,
+        JPEG_ENC_ERROR_NO_SPACE = -3    /* the jpeg does not fit outBuf->length */
     }JPEG_ENC_ERR_RET;
 
 
@@ -141,6 +143,8 @@ namespace android{
         unsigned int ThumbWidth;
         unsigned int ThumbHeight;
         unsigned int BufFmt;
+        unsigned int Quality;       /* 1 to 100, 0 for the encoder default */
+        unsigned int ThumbQuality;
         JPEG_ENCODER_ROTATION RotationInfo;
         JPEG_ENCODER_WHITEBALANCE WhiteBalanceInfo;
         JPEG_ENCODER_FLASH FlashInfo;
@@ -150,6 +154,11 @@ namespace android{
         struct jpeg_enc_model_info_t *pModelInfo;
         struct jpeg_enc_datetime_info_t *pDatetimeInfo;
         struct jpeg_enc_gps_param *pGps_info;
+        /* optional smaller frame of the same scene to build the thumbnail from */
+        unsigned char *ThumbSrc;
+        unsigned int ThumbSrcWidth;
+        unsigned int ThumbSrcHeight;
+        unsigned int ThumbSrcFmt;
     }enc_cfg_param;
 
     struct jpeg_encoding_conf{
@@ -23,6 +23,7 @@
 #include <dlfcn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <linux/time.h>
 #include <linux/videodev2.h>
 #include <linux/mxcfb.h>
@@ -32,26 +33,42 @@
 #include <sys/stat.h>
 #include <utils/threads.h>
 #include <dirent.h>
+#include <cutils/properties.h>
+#include <utils/Timers.h>
 
 #include "JpegEncoderSoftware.h"
+#include "Camera_convert.h"
 
 namespace android{
 
-    JPEG_ENC_UINT32 JpegEncoderSoftware::g_JpegDataSize = 0;//Total size of g_JpegData
-    JPEG_ENC_UINT32 JpegEncoderSoftware::g_JpegDataLen = 0;//Valid data len of g_JpegData
-    JPEG_ENC_UINT8 *JpegEncoderSoftware::g_JpegData = NULL;//Buffer to hold jpeg data
-
     JpegEncoderSoftware :: JpegEncoderSoftware()
         :mSupportedTypeIdx(0),
         pEncCfgLocal(NULL),
-        pEncObj(NULL)
+        pEncObj(NULL),
+        mSliceMode(JPEG_ENC_MAIN_ONLY),
+        mSliceBuffer(NULL),
+        mSliceNum(0),
+        mRestartInterval(0),
+        mSliceOutBuf(NULL),
+        mSliceOutSize(0),
+        mThumbBuffer(NULL),
+        mThumbBufferSize(0),
+        mChromaBuffer(NULL),
+        mChromaBufferSize(0)
     {
+        //YU12 first, it is what a post process stage converts to
         mSupportedType[0] = v4l2_fourcc('Y','U','1','2');
+        mSupportedType[1] = v4l2_fourcc('N','V','1','2');
+        mSupportedType[2] = v4l2_fourcc('N','V','2','1');
+        mSupportedType[3] = v4l2_fourcc('N','V','1','6');
+        mSupportedType[4] = v4l2_fourcc('Y','U','Y','V');
+        mThreadPool = CameraThreadPool::getInstance();
+        memset(mContexts, 0, sizeof(mContexts));
     }
 
     JpegEncoderSoftware :: ~JpegEncoderSoftware()
     {
-
+        JpegEncoderDeInit();
     }
 
     JPEG_ENC_ERR_RET  JpegEncoderSoftware :: EnumJpegEncParam(JPEEG_QUERY_TYPE QueryType, void * pQueryRet)
@@ -91,6 +108,13 @@ namespace android{
             return JPEG_ENC_ERROR_BAD_PARAM;
         }
 
+        //the codec contexts are kept for as long as the picture keeps its shape
+        if (pEncCfgLocal == NULL || pEncCfgLocal->PicWidth != pEncCfg->PicWidth ||
+                pEncCfgLocal->PicHeight != pEncCfg->PicHeight || pEncCfgLocal->BufFmt != pEncCfg->BufFmt ||
+                pEncCfgLocal->ThumbWidth != pEncCfg->ThumbWidth || pEncCfgLocal->ThumbHeight != pEncCfg->ThumbHeight)
+            flushContexts();
+        freeEncCfg();
+
         pEncCfgLocal = (enc_cfg_param *)malloc(sizeof(enc_cfg_param));
 
         if (pEncCfgLocal == NULL){
@@ -190,6 +214,7 @@ namespace android{
 INT_ERR_RET:
         if(pEncCfgLocal)
             free(pEncCfgLocal);
+        pEncCfgLocal = NULL;
         if(pFoclLength)
             free(pFoclLength);
         if(pMakeInfo)
@@ -207,7 +232,7 @@ INT_ERR_RET:
     }
 
     JPEG_ENC_ERR_RET JpegEncoderSoftware :: DoEncode( DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, struct jpeg_encoding_conf *pJpegEncCfg){
-        if (inBuf == NULL || outBuf == NULL || inBuf->virt_start == NULL || outBuf->virt_start == NULL){
+        if (pEncCfgLocal == NULL || inBuf == NULL || outBuf == NULL || inBuf->virt_start == NULL || outBuf->virt_start == NULL){
             return JPEG_ENC_ERROR_BAD_PARAM;
         }else{
             return encodeImge(inBuf,outBuf, &(pJpegEncCfg->output_jpeg_size));
@@ -216,8 +241,25 @@ INT_ERR_RET:
 
     JPEG_ENC_ERR_RET JpegEncoderSoftware :: JpegEncoderDeInit(){
         CAMERA_HAL_LOG_FUNC;
-        JPEG_ENC_ERR_RET ret = JPEG_ENC_ERROR_NONE;
 
+        freeEncCfg();
+        flushContexts();
+        if (mSliceOutBuf != NULL)
+            free(mSliceOutBuf);
+        mSliceOutBuf = NULL;
+        mSliceOutSize = 0;
+        if (mThumbBuffer != NULL)
+            free(mThumbBuffer);
+        mThumbBuffer = NULL;
+        mThumbBufferSize = 0;
+        if (mChromaBuffer != NULL)
+            free(mChromaBuffer);
+        mChromaBuffer = NULL;
+        mChromaBufferSize = 0;
+        return JPEG_ENC_ERROR_NONE;
+    }
+
+    void JpegEncoderSoftware :: freeEncCfg(){
         if (pEncCfgLocal != NULL ){
             if (pEncCfgLocal->pFoclLength != NULL)
                 free(pEncCfgLocal->pFoclLength);
@@ -232,10 +274,19 @@ INT_ERR_RET:
             if (pEncCfgLocal->pGps_info != NULL)
                 free(pEncCfgLocal->pGps_info);
             free(pEncCfgLocal);
+            pEncCfgLocal = NULL;
         }
+    }
 
-        return ret;
-
+    /* the buffer is only ever grown, the picture size rarely changes */
+    unsigned char *JpegEncoderSoftware :: growBuffer(unsigned char **buffer, unsigned int *size, unsigned int needed){
+        if (*size < needed){
+            if (*buffer != NULL)
+                free(*buffer);
+            *buffer = (unsigned char *)malloc(needed);
+            *size = (*buffer != NULL) ? needed : 0;
+        }
+        return *buffer;
     }
 
     JPEG_ENC_ERR_RET JpegEncoderSoftware :: CheckEncParm(){
@@ -268,98 +319,72 @@ INT_ERR_RET:
         return ret;
     }
 
-    JPEG_ENC_ERR_RET JpegEncoderSoftware :: encodeImge(DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, unsigned int *pEncSize){
-
-        CAMERA_HAL_LOG_FUNC;
-
-        JPEG_ENC_ERR_RET ret = JPEG_ENC_ERROR_NONE;
-        int width, height, size,index;
-        JPEG_ENC_UINT8 * i_buff = NULL;
-        JPEG_ENC_UINT8 * y_buff = NULL;
-        JPEG_ENC_UINT8 * u_buff = NULL;
-        JPEG_ENC_UINT8 * v_buff = NULL;
-        JPEG_ENC_RET_TYPE return_val;
-        jpeg_enc_parameters * params = NULL;
-        jpeg_enc_object * obj_ptr = NULL;
-        JPEG_ENC_UINT8 number_mem_info;
-        jpeg_enc_memory_info * mem_info = NULL;
-        unsigned char *thumbnail_buffer,*temp_buffer=NULL;
-        int thumbnail_width, thumbnail_height;
-        unsigned char *buffer = inBuf->virt_start;
-
-        bool mEncodeThumbnailFlag = true;
-
-        width = pEncCfgLocal->PicWidth;
-        height = pEncCfgLocal->PicHeight;
-
-        thumbnail_width = pEncCfgLocal->ThumbWidth;
-        thumbnail_height = pEncCfgLocal->ThumbHeight;
-
-
-        if (thumbnail_width <= 0 || thumbnail_height<= 0)
-            mEncodeThumbnailFlag = false;
-
-        g_JpegDataSize = 0;//Total size of g_JpegData
-        g_JpegDataLen = 0;//Valid data len of g_JpegData
-        g_JpegData = NULL;//Buffer to hold jpeg data
-        size = width * height * 3 / 2;
+    bool JpegEncoderSoftware :: isSemiPlanar(unsigned int fmt)
+    {
+        return fmt == v4l2_fourcc('N','V','1','2') || fmt == v4l2_fourcc('N','V','2','1') ||
+            fmt == v4l2_fourcc('N','V','1','6');
+    }
 
-        g_JpegData = outBuf->virt_start;
-        g_JpegDataSize = size;
-        if(!g_JpegData)
-        {
-            return JPEG_ENC_ERROR_BAD_PARAM;
-        }
+    bool JpegEncoderSoftware :: isChroma422(unsigned int fmt)
+    {
+        return fmt == v4l2_fourcc('Y','U','Y','V') || fmt == v4l2_fourcc('N','V','1','6');
+    }
 
-        /* --------------------------------------------
-         * Allocate memory for Encoder Object
-         * -------------------------------------------*/
-        obj_ptr = (jpeg_enc_object *) malloc(sizeof(jpeg_enc_object));
-        if(!obj_ptr)
-        {
-            return JPEG_ENC_ERROR_ALOC_BUF;
+    /*
+     * The codec takes planar or YUYV input. The luma of a semi-planar
+     * frame is used in place and its chroma comes from mChromaBuffer,
+     * which splitChroma fills with the planes a YU12 (or 4:2:2 planar)
+     * frame would have.
+     */
+    void JpegEncoderSoftware :: setupPlanes(unsigned int fmt, unsigned char *buffer, int width, int height, int firstRow,
+            JPEG_ENC_UINT8 **i_buff, JPEG_ENC_UINT8 **y_buff, JPEG_ENC_UINT8 **u_buff, JPEG_ENC_UINT8 **v_buff)
+    {
+        if (fmt == v4l2_fourcc('Y','U','Y','V')){
+            *i_buff = (JPEG_ENC_UINT8 *)buffer + firstRow * width * 2;
+            *y_buff = NULL;
+            *u_buff = NULL;
+            *v_buff = NULL;
+        }else{
+            unsigned char *chroma = isSemiPlanar(fmt) ? mChromaBuffer : buffer + width * height;
+            int chromaRow = isChroma422(fmt) ? firstRow : firstRow / 2;
+            int chromaSize = (width / 2) * (isChroma422(fmt) ? height : height / 2);
+
+            *i_buff = NULL;
+            *y_buff = (JPEG_ENC_UINT8 *)buffer + firstRow * width;
+            *u_buff = (JPEG_ENC_UINT8 *)chroma + chromaRow * (width / 2);
+            *v_buff = (JPEG_ENC_UINT8 *)chroma + chromaSize + chromaRow * (width / 2);
         }
-        memset(obj_ptr, 0, sizeof(jpeg_enc_object));
-
-        /* Assign the function for streaming output */
-        obj_ptr->jpeg_enc_push_output = pushJpegOutput;
-        obj_ptr->context=NULL;   //user can put private variables into it
-        /* --------------------------------------------
-         * Fill up the parameter structure of JPEG Encoder
-         * -------------------------------------------*/
-        params = &(obj_ptr->parameters);
-
-        if(mEncodeThumbnailFlag==true)
-        {
-
-            //need resizing code here!!!
-            thumbnail_buffer = (unsigned char *)malloc(thumbnail_width * thumbnail_height * 3 / 2);
-            if(!thumbnail_buffer)
-            {
-                return JPEG_ENC_ERROR_ALOC_BUF;
-            }
-
-            yuv_resize((unsigned char *)thumbnail_buffer, thumbnail_width, thumbnail_height, buffer, width, height);
-
-            width = thumbnail_width;
-            height = thumbnail_height;
-
-            temp_buffer = buffer;
-            buffer = thumbnail_buffer;
+    }
 
-            params->mode = JPEG_ENC_THUMB;
-        }
+    /* split the interleaved chroma of the rows [firstRow, firstRow + rows) into mChromaBuffer */
+    void JpegEncoderSoftware :: splitChroma(unsigned int fmt, unsigned char *buffer, int width, int height,
+            int firstRow, int rows)
+    {
+        int chromaRow = isChroma422(fmt) ? firstRow : firstRow / 2;
+        int chromaRows = isChroma422(fmt) ? rows : (rows + 1) / 2;
+        int chromaSize = (width / 2) * (isChroma422(fmt) ? height : height / 2);
+        const uint8_t *src = buffer + width * height + chromaRow * width;
+        uint8_t *u = mChromaBuffer + chromaRow * (width / 2);
+        uint8_t *v = u + chromaSize;
+
+        //the rows are tightly packed, so the band is split in one go
+        if (fmt == v4l2_fourcc('N','V','2','1'))
+            getConvertKernels()->splitUV(src, v, u, (width / 2) * chromaRows);
         else
-        {
-            params->mode = JPEG_ENC_MAIN_ONLY;
-        }
+            getConvertKernels()->splitUV(src, u, v, (width / 2) * chromaRows);
+    }
 
-encodeframe:
+    void JpegEncoderSoftware :: fillParams(jpeg_enc_parameters *params, JPEG_ENC_MODE mode, unsigned int fmt,
+            int width, int height, int restartInterval, bool exif)
+    {
+        unsigned int quality = (mode == JPEG_ENC_THUMB) ? pEncCfgLocal->ThumbQuality : pEncCfgLocal->Quality;
 
+        params->mode = mode;
         params->compression_method = JPEG_ENC_SEQUENTIAL;
-        params->quality = 75;
-        params->restart_markers = 0;
-        if (pEncCfgLocal->BufFmt == v4l2_fourcc('Y','U','1','2')){
+        params->quality = (quality > 0 && quality <= 100) ? quality : 75;
+        params->restart_markers = restartInterval;
+        if (fmt == v4l2_fourcc('Y','U','1','2') || fmt == v4l2_fourcc('N','V','1','2') ||
+                fmt == v4l2_fourcc('N','V','2','1')){
             params->y_width = width;
             params->y_height = height;
             params->u_width = params->y_width/2;
@@ -369,7 +394,7 @@ encodeframe:
             params->primary_image_height = height;
             params->primary_image_width = width;
             params->yuv_format = JPEG_ENC_YUV_420_NONINTERLEAVED;
-        }else if (pEncCfgLocal->BufFmt == v4l2_fourcc('Y','U','Y','V')){
+        }else if (fmt == v4l2_fourcc('Y','U','Y','V')){
             params->y_width = width;
             params->y_height = height;
             params->u_width = params->y_width/2;
@@ -379,8 +404,18 @@ encodeframe:
             params->primary_image_height = height;
             params->primary_image_width = width;
             params->yuv_format = JPEG_ENC_YU_YV_422_INTERLEAVED;
+        }else if (fmt == v4l2_fourcc('N','V','1','6')){
+            params->y_width = width;
+            params->y_height = height;
+            params->u_width = params->y_width/2;
+            params->u_height = params->y_height;
+            params->v_width = params->y_width/2;
+            params->v_height = params->y_height;
+            params->primary_image_height = height;
+            params->primary_image_width = width;
+            params->yuv_format = JPEG_ENC_YUV_422_NONINTERLEAVED;
         }
-        params->exif_flag = 1;
+        params->exif_flag = exif ? 1 : 0;
 
         params->y_left = 0;
         params->y_top = 0;
@@ -413,58 +448,146 @@ encodeframe:
         /* Pixel aspect ratio is square by default */
         params->jfif_params.X_density = 1;
         params->jfif_params.Y_density = 1;
-        if (params->yuv_format == JPEG_ENC_YUV_420_NONINTERLEAVED){
-            y_buff = (JPEG_ENC_UINT8 *)buffer;
-            u_buff = y_buff+width*height;
-            v_buff = u_buff+width*height/4;
-            i_buff = NULL;
-        }else if (params->yuv_format == JPEG_ENC_YU_YV_422_INTERLEAVED){
-            y_buff = NULL;
-            u_buff = NULL;
-            v_buff = NULL;
-            i_buff = (JPEG_ENC_UINT8 *)buffer;
+    }
+
+    JPEG_ENC_CONTEXT *JpegEncoderSoftware :: acquireContext(JPEG_ENC_MODE mode, unsigned int fmt,
+            int width, int height, int restartInterval, bool exif)
+    {
+        Mutex::Autolock lock(mContextLock);
+        JPEG_ENC_CONTEXT *ctx = NULL, *spare = NULL;
+        jpeg_enc_memory_info *mem_info;
+        JPEG_ENC_RET_TYPE return_val;
+        int i, index;
+
+        for (i = 0; i < MAX_JPEG_ENC_CONTEXT_NUM; i++){
+            JPEG_ENC_CONTEXT *c = &mContexts[i];
+            if (c->busy)
+                continue;
+            if (c->obj != NULL && c->mode == mode && c->fmt == fmt && c->width == width &&
+                    c->height == height && c->restartInterval == restartInterval && c->exif == exif){
+                c->busy = true;
+                return c;
+            }
+            //prefer an empty slot to dropping a context that may be wanted again
+            if (spare == NULL || (spare->obj != NULL && c->obj == NULL))
+                spare = c;
         }
-        CAMERA_HAL_LOG_RUNTIME("version: %s\n", jpege_CodecVersionInfo());
+        if (spare == NULL)
+            return NULL;
+
+        ctx = spare;
+        destroyContext(ctx);
+        ctx->obj = (jpeg_enc_object *)malloc(sizeof(jpeg_enc_object));
+        if (ctx->obj == NULL)
+            return NULL;
+        memset(ctx->obj, 0, sizeof(jpeg_enc_object));
+        fillParams(&ctx->obj->parameters, mode, fmt, width, height, restartInterval, exif);
 
         /* --------------------------------------------
          * QUERY MEMORY REQUIREMENTS
          * -------------------------------------------*/
-        return_val = jpeg_enc_query_mem_req(obj_ptr);
-
+        return_val = jpeg_enc_query_mem_req(ctx->obj);
         if(return_val != JPEG_ENC_ERR_NO_ERROR)
         {
             CAMERA_HAL_LOG_RUNTIME("JPEG encoder returned an error when jpeg_enc_query_mem_req was called \n");
             CAMERA_HAL_LOG_RUNTIME("Return Val %d\n",return_val);
-            goto done;
+            destroyContext(ctx);
+            return NULL;
         }
-        CAMERA_HAL_LOG_RUNTIME("jpeg_enc_query_mem_req success");
         /* --------------------------------------------
          * ALLOCATE MEMORY REQUESTED BY CODEC
          * -------------------------------------------*/
-        number_mem_info = obj_ptr->mem_infos.no_entries;
-        for(index = 0; index < number_mem_info; index++)
+        for(index = 0; index < ctx->obj->mem_infos.no_entries; index++)
         {
             /* This example code ignores the 'alignment' and
              * 'memory_type', but some other applications might want
              * to allocate memory based on them */
-            mem_info = &(obj_ptr->mem_infos.mem_info[index]);
+            mem_info = &(ctx->obj->mem_infos.mem_info[index]);
             mem_info->memptr = (void *) malloc(mem_info->size);
             if(mem_info->memptr==NULL) {
                 CAMERA_HAL_LOG_RUNTIME("Malloc error after query\n");
-                goto done;
+                destroyContext(ctx);
+                return NULL;
             }
         }
 
+        CAMERA_HAL_LOG_RUNTIME("new jpeg context %dx%d mode %d", width, height, mode);
+        ctx->mode = mode;
+        ctx->fmt = fmt;
+        ctx->width = width;
+        ctx->height = height;
+        ctx->restartInterval = restartInterval;
+        ctx->exif = exif;
+        ctx->busy = true;
+        return ctx;
+    }
+
+    void JpegEncoderSoftware :: releaseContext(JPEG_ENC_CONTEXT *ctx, bool keep)
+    {
+        Mutex::Autolock lock(mContextLock);
+        //a context the codec failed on is not trusted again
+        if (!keep)
+            destroyContext(ctx);
+        ctx->busy = false;
+    }
+
+    void JpegEncoderSoftware :: destroyContext(JPEG_ENC_CONTEXT *ctx)
+    {
+        int index;
+
+        if (ctx->obj == NULL)
+            return;
+        /* --------------------------------------------
+         * FREE MEMORY REQUESTED BY CODEC
+         * -------------------------------------------*/
+        for(index = 0; index < ctx->obj->mem_infos.no_entries; index++)
+        {
+            if(ctx->obj->mem_infos.mem_info[index].memptr)
+                free(ctx->obj->mem_infos.mem_info[index].memptr);
+        }
+        free(ctx->obj);
+        ctx->obj = NULL;
+    }
+
+    void JpegEncoderSoftware :: flushContexts()
+    {
+        Mutex::Autolock lock(mContextLock);
+        for (int i = 0; i < MAX_JPEG_ENC_CONTEXT_NUM; i++)
+            destroyContext(&mContexts[i]);
+    }
+
+    JPEG_ENC_ERR_RET JpegEncoderSoftware :: encodeFrame(JPEG_ENC_MODE mode, unsigned int fmt, JPEG_ENC_UINT8 *i_buff,
+            JPEG_ENC_UINT8 *y_buff, JPEG_ENC_UINT8 *u_buff, JPEG_ENC_UINT8 *v_buff,
+            int width, int height, int restartInterval, bool exif, JPEG_ENC_OUTPUT *out)
+    {
+        JPEG_ENC_ERR_RET ret = JPEG_ENC_ERROR_NONE;
+        JPEG_ENC_RET_TYPE return_val;
+        JPEG_ENC_CONTEXT *ctx;
+        jpeg_enc_object * obj_ptr = NULL;
+
+        ctx = acquireContext(mode, fmt, width, height, restartInterval, exif);
+        if (ctx == NULL)
+            return JPEG_ENC_ERROR_ALOC_BUF;
+        obj_ptr = ctx->obj;
+
+        /* Assign the function for streaming output */
+        obj_ptr->jpeg_enc_push_output = pushJpegOutput;
+        obj_ptr->context = out;
+        //the codec may have changed them while encoding the last frame
+        fillParams(&obj_ptr->parameters, mode, fmt, width, height, restartInterval, exif);
+        CAMERA_HAL_LOG_RUNTIME("version: %s\n", jpege_CodecVersionInfo());
+
         return_val = jpeg_enc_init(obj_ptr);
         if(return_val != JPEG_ENC_ERR_NO_ERROR)
         {
             CAMERA_HAL_LOG_RUNTIME("JPEG encoder returned an error when jpeg_enc_init was called \n");
             CAMERA_HAL_LOG_RUNTIME("Return Val %d\n",return_val);
+            ret = JPEG_ENC_ERROR_BAD_PARAM;
             goto done;
         }
 
         CAMERA_HAL_LOG_RUNTIME("jpeg_enc_init success");
-        if(params->mode == JPEG_ENC_THUMB)
+        if(mode == JPEG_ENC_THUMB)
             createJpegExifTags(obj_ptr);
 
         return_val = jpeg_enc_encodeframe(obj_ptr, i_buff,
@@ -474,96 +597,385 @@ encodeframe:
         {
             CAMERA_HAL_LOG_RUNTIME("JPEG encoder returned an error in jpeg_enc_encodeframe \n");
             CAMERA_HAL_LOG_RUNTIME("Return Val %d\n",return_val);
+            ret = out->overflow ? JPEG_ENC_ERROR_NO_SPACE : JPEG_ENC_ERROR_BAD_PARAM;
             goto done;
         }
 
-        if(params->mode == JPEG_ENC_THUMB)
+        if(mode == JPEG_ENC_THUMB)
         {
-            JPEG_ENC_UINT8 num_entries;
-            JPEG_ENC_UINT32 *offset_tbl_ptr = (JPEG_ENC_UINT32 *)malloc(sizeof(JPEG_ENC_UINT32)*JPEG_ENC_NUM_OF_OFFSETS);
-            JPEG_ENC_UINT8 *value_tbl_ptr = (JPEG_ENC_UINT8 *)malloc(sizeof(JPEG_ENC_UINT8)*JPEG_ENC_NUM_OF_OFFSETS);
+            JPEG_ENC_UINT8 num_entries = 0;
+            JPEG_ENC_UINT32 offset_tbl[JPEG_ENC_NUM_OF_OFFSETS];
+            JPEG_ENC_UINT8 value_tbl[JPEG_ENC_NUM_OF_OFFSETS];
 
-            jpeg_enc_find_length_position(obj_ptr, offset_tbl_ptr,value_tbl_ptr,&num_entries);
+            jpeg_enc_find_length_position(obj_ptr, offset_tbl, value_tbl, &num_entries);
 
             for(int i = 0; i < num_entries; i++)
             {
-                *((JPEG_ENC_UINT8 *)g_JpegData+offset_tbl_ptr[i]) = value_tbl_ptr[i];
+                *((JPEG_ENC_UINT8 *)out->data+offset_tbl[i]) = value_tbl[i];
             }
+        }
+        CAMERA_HAL_LOG_RUNTIME("jpeg_enc_encodeframe success");
 
-            free(offset_tbl_ptr);
-            free(value_tbl_ptr);
-
-            free(buffer);
+done:
+        releaseContext(ctx, ret == JPEG_ENC_ERROR_NONE);
+        return ret;
+    }
 
-            number_mem_info = obj_ptr->mem_infos.no_entries;
-            for(index = 0; index < number_mem_info; index++)
-            {
-                mem_info = &(obj_ptr->mem_infos.mem_info[index]);
-                if(mem_info)
-                    free(mem_info->memptr);
-            }
+    JPEG_ENC_ERR_RET JpegEncoderSoftware :: encodeImge(DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, unsigned int *pEncSize){
 
-            g_JpegData += g_JpegDataLen;
-            g_JpegDataSize -= g_JpegDataLen;
+        CAMERA_HAL_LOG_FUNC;
 
+        JPEG_ENC_ERR_RET ret = JPEG_ENC_ERROR_NONE;
+        int width, height;
+        JPEG_ENC_UINT8 *i_buff, *y_buff, *u_buff, *v_buff;
+        JPEG_ENC_MODE mode = JPEG_ENC_MAIN_ONLY;
+        JPEG_ENC_OUTPUT out;
+        unsigned char *thumbnail_buffer;
+        int thumbnail_width, thumbnail_height;
+        unsigned char *buffer = inBuf->virt_start;
+        int sliceNum;
+        nsecs_t start;
 
-            //recover to build the main jpeg
-            params->mode = JPEG_ENC_MAIN;
+        width = pEncCfgLocal->PicWidth;
+        height = pEncCfgLocal->PicHeight;
 
-            buffer = temp_buffer;
-            width = pEncCfgLocal->PicWidth;
-            height = pEncCfgLocal->PicHeight;
+        thumbnail_width = pEncCfgLocal->ThumbWidth;
+        thumbnail_height = pEncCfgLocal->ThumbHeight;
 
-            goto encodeframe;
+        out.data = outBuf->virt_start;
+        //a caller that does not know the size of its buffer gets the old assumption
+        out.size = outBuf->length > 0 ? outBuf->length : width * height * 3 / 2;
+        out.len = 0;
+        out.overflow = false;
+        if(!out.data)
+        {
+            return JPEG_ENC_ERROR_BAD_PARAM;
         }
-        CAMERA_HAL_LOG_RUNTIME("jpeg_enc_encodeframe success");
-        // Make an IMemory for each frame
-        //jpegPtr = new MemoryBase(mJpegImageHeap, 0, g_JpegDataLen);
-        *pEncSize = g_JpegDataLen;
 
-done:
-        /* --------------------------------------------
-         * FREE MEMORY REQUESTED BY CODEC
-         * -------------------------------------------*/
-        if(obj_ptr)
+        if (thumbnail_width > 0 && thumbnail_height > 0)
         {
-            number_mem_info = obj_ptr->mem_infos.no_entries;
-            for(index = 0; index < number_mem_info; index++)
+            thumbnail_buffer = growBuffer(&mThumbBuffer, &mThumbBufferSize,
+                    thumbnail_width * thumbnail_height * 3 / 2);
+            if(!thumbnail_buffer)
             {
-                mem_info = &(obj_ptr->mem_infos.mem_info[index]);
-                if(mem_info)
-                    free(mem_info->memptr);
+                return JPEG_ENC_ERROR_ALOC_BUF;
             }
-            free(obj_ptr);
+
+            if (makeThumbnail(thumbnail_buffer, thumbnail_width, thumbnail_height, buffer) == 0){
+                setupPlanes(v4l2_fourcc('Y','U','1','2'), thumbnail_buffer, thumbnail_width, thumbnail_height, 0,
+                        &i_buff, &y_buff, &u_buff, &v_buff);
+                ret = encodeFrame(JPEG_ENC_THUMB, v4l2_fourcc('Y','U','1','2'), i_buff, y_buff, u_buff, v_buff,
+                        thumbnail_width, thumbnail_height, 0, true, &out);
+                if (ret != JPEG_ENC_ERROR_NONE)
+                    return ret;
+
+                //the main jpeg follows the exif header with the thumbnail
+                mode = JPEG_ENC_MAIN;
+            }else{
+                CAMERA_HAL_ERR("Can not scale the thumbnail, encode the picture without it");
+            }
+        }
+
+        if (isSemiPlanar(pEncCfgLocal->BufFmt) &&
+                growBuffer(&mChromaBuffer, &mChromaBufferSize,
+                    (isChroma422(pEncCfgLocal->BufFmt) ? width * height : width * height / 2)) == NULL)
+            return JPEG_ENC_ERROR_ALOC_BUF;
+
+        start = systemTime(SYSTEM_TIME_MONOTONIC);
+        sliceNum = encodeSlices(mode, buffer, &out);
+        if (sliceNum < 0)
+            return JPEG_ENC_ERROR_NO_SPACE;
+        if (sliceNum == 0){
+            sliceNum = 1;
+            if (isSemiPlanar(pEncCfgLocal->BufFmt))
+                splitChroma(pEncCfgLocal->BufFmt, buffer, width, height, 0, height);
+            setupPlanes(pEncCfgLocal->BufFmt, buffer, width, height, 0, &i_buff, &y_buff, &u_buff, &v_buff);
+            ret = encodeFrame(mode, pEncCfgLocal->BufFmt, i_buff, y_buff, u_buff, v_buff,
+                    width, height, 0, true, &out);
+            if (ret != JPEG_ENC_ERROR_NONE)
+                return ret;
         }
+        CAMERA_HAL_LOG_INFO("Jpeg %dx%d encoded in %lld ms with %d slices, %d bytes",
+                width, height, (systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000LL,
+                sliceNum, (int)out.len);
 
+        *pEncSize = out.len;
         return ret;
     }
 
+    int JpegEncoderSoftware :: getSliceThreads()
+    {
+        char value[PROPERTY_VALUE_MAX];
+        int threads;
+
+        property_get("rw.camera.jpeg.threads", value, "0");
+        threads = atoi(value);
+        if (threads <= 0)
+            threads = mThreadPool->getThreadNum();
+        if (threads > MAX_JPEG_ENC_SLICE_NUM)
+            threads = MAX_JPEG_ENC_SLICE_NUM;
+        return threads;
+    }
+
+    /*
+     * Split the main image into bands of JPEG_ENC_SLICE_MCU_ROWS MCU rows
+     * and encode every band as its own jpeg on the thread pool, with one
+     * restart interval per MCU row. The scans are then joined with the
+     * restart marker the single stream would have had at that place.
+     * Returns the number of slices, 0 if the caller has to encode the
+     * image in one piece, or -1 if the jpeg does not fit the output.
+     */
+    int JpegEncoderSoftware :: encodeSlices(JPEG_ENC_MODE mode, unsigned char *buffer, JPEG_ENC_OUTPUT *out)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        int width = pEncCfgLocal->PicWidth;
+        int height = pEncCfgLocal->PicHeight;
+        int mcuHeight = isChroma422(pEncCfgLocal->BufFmt) ? 8 : 16;
+        int band = mcuHeight * JPEG_ENC_SLICE_MCU_ROWS;
+        int bandNum = (height + band - 1) / band;
+        int sliceNum = getSliceThreads();
+        unsigned int sliceSize, total = 0;
+        unsigned char *slicesBuffer;
+        bool ok;
+        int i;
+
+        if (sliceNum > bandNum)
+            sliceNum = bandNum;
+        if (sliceNum < 2)
+            return 0;
+
+        for (i = 0; i < sliceNum; i++){
+            int firstBand = i * bandNum / sliceNum;
+            int lastBand = (i + 1) * bandNum / sliceNum;
+            JPEG_ENC_SLICE *slice = &mSlices[i];
+
+            slice->firstRow = firstBand * band;
+            slice->rows = lastBand * band;
+            if (slice->rows > height)
+                slice->rows = height;
+            slice->rows -= slice->firstRow;
+            slice->ret = JPEG_ENC_ERROR_NONE;
+            if (i > 0)
+                total += width * slice->rows * 3 / 2 + JPEG_ENC_SLICE_HEADER_SIZE;
+        }
+
+        slicesBuffer = growBuffer(&mSliceOutBuf, &mSliceOutSize, total);
+        if (slicesBuffer == NULL)
+            return 0;
+
+        //the first slice goes straight behind the exif header
+        mSlices[0].out.data = out->data + out->len;
+        mSlices[0].out.size = out->size - out->len;
+        mSlices[0].out.len = 0;
+        mSlices[0].out.overflow = false;
+        for (i = 1, total = 0; i < sliceNum; i++){
+            sliceSize = width * mSlices[i].rows * 3 / 2 + JPEG_ENC_SLICE_HEADER_SIZE;
+            mSlices[i].out.data = slicesBuffer + total;
+            mSlices[i].out.size = sliceSize;
+            mSlices[i].out.len = 0;
+            mSlices[i].out.overflow = false;
+            total += sliceSize;
+        }
+
+        mSliceMode = mode;
+        mSliceBuffer = buffer;
+        mSliceNum = sliceNum;
+        mRestartInterval = (width + 15) / 16;
+        mThreadPool->parallelFor(EncodeSlice, this, sliceNum);
+
+        ok = joinSlices(out);
+        //encoding it in one piece would not fit either
+        if (mSlices[0].out.overflow || out->overflow){
+            out->overflow = true;
+            return -1;
+        }
+        if (!ok){
+            CAMERA_HAL_LOG_INFO("Can not join the jpeg slices, encode the picture in one piece");
+            return 0;
+        }
+        return sliceNum;
+    }
+
+    void JpegEncoderSoftware :: EncodeSlice(void *arg, int index)
+    {
+        ((JpegEncoderSoftware *)arg)->doSlice(index);
+    }
+
+    void JpegEncoderSoftware :: doSlice(int index)
+    {
+        JPEG_ENC_SLICE *slice = &mSlices[index];
+        JPEG_ENC_UINT8 *i_buff, *y_buff, *u_buff, *v_buff;
+
+        //the band's chroma is split on its own thread, just before the codec reads it
+        if (isSemiPlanar(pEncCfgLocal->BufFmt))
+            splitChroma(pEncCfgLocal->BufFmt, mSliceBuffer, pEncCfgLocal->PicWidth, pEncCfgLocal->PicHeight,
+                    slice->firstRow, slice->rows);
+        setupPlanes(pEncCfgLocal->BufFmt, mSliceBuffer, pEncCfgLocal->PicWidth, pEncCfgLocal->PicHeight,
+                slice->firstRow, &i_buff, &y_buff, &u_buff, &v_buff);
+        slice->ret = encodeFrame(index == 0 ? mSliceMode : JPEG_ENC_MAIN_ONLY, pEncCfgLocal->BufFmt,
+                i_buff, y_buff, u_buff, v_buff, pEncCfgLocal->PicWidth, slice->rows,
+                mRestartInterval, index == 0, &slice->out);
+    }
+
+    bool JpegEncoderSoftware :: parseStream(JPEG_ENC_UINT8 *data, JPEG_ENC_UINT32 len, JPEG_STREAM_INFO *info)
+    {
+        JPEG_ENC_UINT32 pos = 0, segLen;
+        JPEG_ENC_UINT8 marker;
+        bool sofFound = false;
+
+        info->restartInterval = 0;
+        info->tableNum = 0;
+        while (pos + 4 <= len){
+            if (data[pos] != 0xFF)
+                return false;
+            marker = data[pos + 1];
+            if (marker == 0xFF){
+                pos ++;
+                continue;
+            }
+            //markers without a length
+            if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)){
+                pos += 2;
+                continue;
+            }
+            segLen = (data[pos + 2] << 8) | data[pos + 3];
+            if (segLen < 2 || pos + 2 + segLen > len)
+                return false;
+
+            switch (marker){
+                case 0xC0:
+                    if (segLen < 7)
+                        return false;
+                    info->sof = pos;
+                    info->sofLen = segLen + 2;
+                    sofFound = true;
+                    break;
+                case 0xC4:
+                case 0xDB:
+                case 0xDD:
+                case 0xDA:
+                    if (info->tableNum == JPEG_ENC_MAX_TABLE_SEGMENTS)
+                        return false;
+                    if (marker == 0xDD)
+                        info->restartInterval = (data[pos + 4] << 8) | data[pos + 5];
+                    info->tables[info->tableNum] = pos;
+                    info->tableLen[info->tableNum] = segLen + 2;
+                    info->tableNum ++;
+                    break;
+                default:
+                    //only the baseline and extended sequential frames can be joined
+                    if (marker >= 0xC1 && marker <= 0xCF && marker != 0xC8)
+                        return false;
+                    break;
+            }
+
+            if (marker == 0xDA){
+                info->scan = pos + 2 + segLen;
+                if (!sofFound || len < info->scan + 2 ||
+                        data[len - 2] != 0xFF || data[len - 1] != 0xD9)
+                    return false;
+                info->scanEnd = len - 2;
+                return true;
+            }
+            pos += 2 + segLen;
+        }
+        return false;
+    }
+
+    bool JpegEncoderSoftware :: sameHeaders(JPEG_ENC_UINT8 *a, JPEG_STREAM_INFO *infoA,
+            JPEG_ENC_UINT8 *b, JPEG_STREAM_INFO *infoB)
+    {
+        int i;
+
+        //everything but the frame height has to match
+        if (infoA->sofLen != infoB->sofLen || infoA->tableNum != infoB->tableNum ||
+                memcmp(a + infoA->sof, b + infoB->sof, 5) != 0 ||
+                memcmp(a + infoA->sof + 7, b + infoB->sof + 7, infoA->sofLen - 7) != 0)
+            return false;
+        for (i = 0; i < infoA->tableNum; i++){
+            if (infoA->tableLen[i] != infoB->tableLen[i] ||
+                    memcmp(a + infoA->tables[i], b + infoB->tables[i], infoA->tableLen[i]) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool JpegEncoderSoftware :: joinSlices(JPEG_ENC_OUTPUT *out)
+    {
+        JPEG_STREAM_INFO first, info;
+        JPEG_ENC_UINT8 *base = mSlices[0].out.data;
+        JPEG_ENC_UINT8 *dst, *end = out->data + out->size;
+        int mcuHeight = isChroma422(pEncCfgLocal->BufFmt) ? 8 : 16;
+        unsigned int height = pEncCfgLocal->PicHeight;
+        JPEG_ENC_UINT32 scanLen;
+        int i;
+
+        for (i = 0; i < mSliceNum; i++){
+            if (mSlices[i].ret != JPEG_ENC_ERROR_NONE)
+                return false;
+        }
+        //the encoder has to have put one restart interval on every MCU row
+        if (!parseStream(base, mSlices[0].out.len, &first) ||
+                first.restartInterval != mRestartInterval)
+            return false;
+
+        dst = base + first.scanEnd;
+        for (i = 1; i < mSliceNum; i++){
+            JPEG_ENC_UINT8 *data = mSlices[i].out.data;
+
+            if (!parseStream(data, mSlices[i].out.len, &info) ||
+                    !sameHeaders(base, &first, data, &info))
+                return false;
+            scanLen = info.scanEnd - info.scan;
+            if (dst + 2 + scanLen + 2 > end){
+                out->overflow = true;
+                return false;
+            }
+            /*
+             * The slices start on a multiple of eight MCU rows, so their own
+             * RST0..RST7 already count on from the slice above; only the
+             * marker between the two scans is missing.
+             */
+            *dst++ = 0xFF;
+            *dst++ = 0xD0 + ((mSlices[i].firstRow / mcuHeight - 1) & 7);
+            memcpy(dst, data + info.scan, scanLen);
+            dst += scanLen;
+        }
+        *dst++ = 0xFF;
+        *dst++ = 0xD9;
+
+        base[first.sof + 5] = (height >> 8) & 0xFF;
+        base[first.sof + 6] = height & 0xFF;
+        out->len += dst - base;
+        return true;
+    }
+
     JPEG_ENC_UINT8 JpegEncoderSoftware::pushJpegOutput(JPEG_ENC_UINT8 ** out_buf_ptrptr,JPEG_ENC_UINT32 *out_buf_len_ptr,
             JPEG_ENC_UINT8 flush, void * context, JPEG_ENC_MODE enc_mode)
     {
-        JPEG_ENC_UINT32 i;
+        JPEG_ENC_OUTPUT *out = (JPEG_ENC_OUTPUT *)context;
+
         if(*out_buf_ptrptr == NULL)
         {
             /* This function is called for the 1'st time from the
-             * codec */
-            *out_buf_ptrptr = g_JpegData;
-            *out_buf_len_ptr = g_JpegDataSize;
+             * codec, or again after a flush */
+            *out_buf_ptrptr = out->data + out->len;
+            *out_buf_len_ptr = out->size - out->len;
         }
 
         else if(flush == 1)
         {
             /* Flush the buffer*/
-            g_JpegDataLen += *out_buf_len_ptr;
-            CAMERA_HAL_LOG_RUNTIME("jpeg output data len %d",(int)g_JpegDataLen);
+            out->len += *out_buf_len_ptr;
+            CAMERA_HAL_LOG_RUNTIME("jpeg output data len %d",(int)out->len);
 
             *out_buf_ptrptr = NULL;
-            *out_buf_len_ptr = NULL;
+            *out_buf_len_ptr = 0;
         }
         else
         {
             CAMERA_HAL_LOG_RUNTIME("Not enough buffer for encoding");
+            out->overflow = true;
             return 0;
         }
 
@@ -574,82 +986,70 @@ done:
     {
         CAMERA_HAL_LOG_RUNTIME("version: %s\n", jpege_CodecVersionInfo());
 
-        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_ORIENTATION, (unsigned int)(&(pEncCfgLocal->RotationInfo)));
-        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_WHITEBALANCE, (unsigned int)(&(pEncCfgLocal->WhiteBalanceInfo)));
-        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_FLASH, (unsigned int)(&(pEncCfgLocal->FlashInfo)));
+        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_ORIENTATION, (unsigned int)(uintptr_t)(&(pEncCfgLocal->RotationInfo)));
+        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_WHITEBALANCE, (unsigned int)(uintptr_t)(&(pEncCfgLocal->WhiteBalanceInfo)));
+        jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_FLASH, (unsigned int)(uintptr_t)(&(pEncCfgLocal->FlashInfo)));
 
         if(pEncCfgLocal->pMakeInfo)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MAKE, (unsigned int)(pEncCfgLocal->pMakeInfo));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MAKE, (unsigned int)(uintptr_t)(pEncCfgLocal->pMakeInfo));
         if(pEncCfgLocal->pMakeNote)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MAKERNOTE, (unsigned int)(pEncCfgLocal->pMakeNote));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MAKERNOTE, (unsigned int)(uintptr_t)(pEncCfgLocal->pMakeNote));
         if(pEncCfgLocal->pModelInfo)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MODEL, (unsigned int)(pEncCfgLocal->pModelInfo));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_MODEL, (unsigned int)(uintptr_t)(pEncCfgLocal->pModelInfo));
         if(pEncCfgLocal->pDatetimeInfo)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_DATETIME, (unsigned int)(pEncCfgLocal->pDatetimeInfo));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_DATETIME, (unsigned int)(uintptr_t)(pEncCfgLocal->pDatetimeInfo));
         if(pEncCfgLocal->pFoclLength)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_FOCALLENGTH, (unsigned int)(pEncCfgLocal->pFoclLength));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_FOCALLENGTH, (unsigned int)(uintptr_t)(pEncCfgLocal->pFoclLength));
 
         if (pEncCfgLocal->pGps_info)
-            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_GPS, (unsigned int)(pEncCfgLocal->pGps_info));
+            jpeg_enc_set_exifheaderinfo(obj_ptr, JPEGE_ENC_SET_HEADER_GPS, (unsigned int)(uintptr_t)(pEncCfgLocal->pGps_info));
 
         return;
     }
 
-    int JpegEncoderSoftware::yuv_resize(unsigned char *dst_ptr, int dst_width, int dst_height, unsigned char *src_ptr, int src_width, int src_height)
+    /*
+     * The thumbnail is filtered down from the preview sized frame the HAL
+     * passed along when there is one, it has far fewer pixels to read
+     * than the picture itself.
+     */
+    int JpegEncoderSoftware :: makeThumbnail(unsigned char *dst, int width, int height, unsigned char *picture)
     {
-        int i,j,s;
-        int h_offset;
-        int v_offset;
-        unsigned char *ptr,cc;
-        int h_scale_ratio;
-        int v_scale_ratio;
-
-        s = 0;
-
-_resize_begin:
-
-        if(!dst_width) return -1;
-        if(!dst_height) return -1;
-
-        h_scale_ratio = src_width / dst_width;
-        if(!h_scale_ratio) return -1;
-
-        v_scale_ratio = src_height / dst_height;
-        if(!v_scale_ratio) return -1;
-
-        h_offset = (src_width - dst_width * h_scale_ratio) / 2;
-        v_offset = (src_height - dst_height * v_scale_ratio) / 2;
-
-        for(i = 0; i < dst_height * v_scale_ratio; i += v_scale_ratio)
-        {
-            for(j = 0; j < dst_width * h_scale_ratio; j += h_scale_ratio)
-            {
-                ptr = src_ptr + i * src_width + j + v_offset * src_width + h_offset;
-                cc = ptr[0];
-
-                ptr = dst_ptr + (i / v_scale_ratio) * dst_width + (j / h_scale_ratio);
-                ptr[0] = cc;
-            }
+        CAMERA_HAL_LOG_FUNC;
+        unsigned char *src = picture;
+        unsigned int fmt = pEncCfgLocal->BufFmt;
+        int srcWidth = pEncCfgLocal->PicWidth;
+        int srcHeight = pEncCfgLocal->PicHeight;
+        int ret = -1;
+
+        if (pEncCfgLocal->ThumbSrc != NULL && (int)pEncCfgLocal->ThumbSrcWidth >= width &&
+                (int)pEncCfgLocal->ThumbSrcHeight >= height){
+            src = pEncCfgLocal->ThumbSrc;
+            fmt = pEncCfgLocal->ThumbSrcFmt;
+            srcWidth = pEncCfgLocal->ThumbSrcWidth;
+            srcHeight = pEncCfgLocal->ThumbSrcHeight;
         }
 
-        src_ptr += src_width*src_height;
-        dst_ptr += dst_width*dst_height;
-
-        if(s < 2)
-        {
-            if(!s++)
-            {
-                src_width >>= 1;
-                src_height >>= 1;
-
-                dst_width >>= 1;
-                dst_height >>= 1;
-            }
-
-            goto _resize_begin;
+        for (;;){
+            if (fmt == v4l2_fourcc('Y','U','1','2'))
+                ret = scaleI420(src, srcWidth, srcHeight, dst, width, height);
+            else if (fmt == v4l2_fourcc('N','V','1','2'))
+                ret = scaleNV12toI420(src, srcWidth, srcHeight, dst, width, height);
+            else if (fmt == v4l2_fourcc('N','V','2','1'))
+                ret = scaleNV21toI420(src, srcWidth, srcHeight, dst, width, height);
+            else if (fmt == v4l2_fourcc('N','V','1','6'))
+                ret = scaleNV16toI420(src, srcWidth, srcHeight, dst, width, height);
+            else if (fmt == v4l2_fourcc('Y','U','Y','V'))
+                ret = scaleYUYVtoI420(src, srcWidth, srcHeight, dst, width, height);
+            if (ret == 0 || src == picture)
+                break;
+            //the preview frame is of a format the scaler does not take
+            src = picture;
+            fmt = pEncCfgLocal->BufFmt;
+            srcWidth = pEncCfgLocal->PicWidth;
+            srcHeight = pEncCfgLocal->PicHeight;
         }
-
-        return 0;
+        CAMERA_HAL_LOG_RUNTIME("thumbnail %dx%d from a %dx%d frame", width, height, srcWidth, srcHeight);
+        return ret;
     }
 
     sp<JpegEncoderInterface> JpegEncoderSoftware::createInstance(){
@@ -35,12 +35,62 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <utils/threads.h>
+
 #include "JpegEncoderInterface.h"
+#include "Camera_threadpool.h"
 #include "jpeg_enc_interface.h"
 
 
 namespace android{
-#define MAX_ENC_SUPPORTED_YUV_TYPE  1
+#define MAX_ENC_SUPPORTED_YUV_TYPE  5
+#define MAX_JPEG_ENC_SLICE_NUM      MAX_POOL_THREAD_NUM
+/* a slice is a multiple of 8 MCU rows, so its RST0..RST7 numbering fits the whole image */
+#define JPEG_ENC_SLICE_MCU_ROWS     8
+#define JPEG_ENC_SLICE_HEADER_SIZE  4096
+#define JPEG_ENC_MAX_TABLE_SEGMENTS 16
+/* one context per slice plus the thumbnail and the serial main image */
+#define MAX_JPEG_ENC_CONTEXT_NUM    (MAX_JPEG_ENC_SLICE_NUM + 2)
+
+    /* where the codec writes to, passed as the context of pushJpegOutput */
+    typedef struct {
+        JPEG_ENC_UINT8 *data;
+        JPEG_ENC_UINT32 size;
+        JPEG_ENC_UINT32 len;
+        bool overflow;
+    }JPEG_ENC_OUTPUT;
+
+    typedef struct {
+        int firstRow;
+        int rows;
+        JPEG_ENC_OUTPUT out;
+        JPEG_ENC_ERR_RET ret;
+    }JPEG_ENC_SLICE;
+
+    /* offsets of the segments of an encoded slice */
+    typedef struct {
+        JPEG_ENC_UINT32 sof;
+        JPEG_ENC_UINT32 sofLen;
+        JPEG_ENC_UINT32 scan;       /* first byte of the entropy coded data */
+        JPEG_ENC_UINT32 scanEnd;    /* the EOI marker */
+        int restartInterval;
+        /* DQT, DHT, DRI and SOS, which all slices must share */
+        int tableNum;
+        JPEG_ENC_UINT32 tables[JPEG_ENC_MAX_TABLE_SEGMENTS];
+        JPEG_ENC_UINT32 tableLen[JPEG_ENC_MAX_TABLE_SEGMENTS];
+    }JPEG_STREAM_INFO;
+
+    /* a codec object with its memory, kept for the next frame of the same shape */
+    typedef struct {
+        jpeg_enc_object *obj;
+        bool busy;
+        JPEG_ENC_MODE mode;
+        unsigned int fmt;
+        int width;
+        int height;
+        int restartInterval;
+        bool exif;
+    }JPEG_ENC_CONTEXT;
 
     class JpegEncoderSoftware : public JpegEncoderInterface{
     public:
@@ -57,6 +107,32 @@ namespace android{
 
         virtual JPEG_ENC_ERR_RET CheckEncParm();
         virtual JPEG_ENC_ERR_RET encodeImge(DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, unsigned int *pEncSize);
+        JPEG_ENC_ERR_RET encodeFrame(JPEG_ENC_MODE mode, unsigned int fmt, JPEG_ENC_UINT8 *i_buff,
+                JPEG_ENC_UINT8 *y_buff, JPEG_ENC_UINT8 *u_buff, JPEG_ENC_UINT8 *v_buff,
+                int width, int height, int restartInterval, bool exif, JPEG_ENC_OUTPUT *out);
+        void setupPlanes(unsigned int fmt, unsigned char *buffer, int width, int height, int firstRow,
+                JPEG_ENC_UINT8 **i_buff, JPEG_ENC_UINT8 **y_buff, JPEG_ENC_UINT8 **u_buff, JPEG_ENC_UINT8 **v_buff);
+        void splitChroma(unsigned int fmt, unsigned char *buffer, int width, int height, int firstRow, int rows);
+        static bool isSemiPlanar(unsigned int fmt);
+        static bool isChroma422(unsigned int fmt);
+        void fillParams(jpeg_enc_parameters *params, JPEG_ENC_MODE mode, unsigned int fmt,
+                int width, int height, int restartInterval, bool exif);
+        JPEG_ENC_CONTEXT *acquireContext(JPEG_ENC_MODE mode, unsigned int fmt,
+                int width, int height, int restartInterval, bool exif);
+        void releaseContext(JPEG_ENC_CONTEXT *ctx, bool keep);
+        void destroyContext(JPEG_ENC_CONTEXT *ctx);
+        void flushContexts();
+        void freeEncCfg();
+        static unsigned char *growBuffer(unsigned char **buffer, unsigned int *size, unsigned int needed);
+
+        int getSliceThreads();
+        int encodeSlices(JPEG_ENC_MODE mode, unsigned char *buffer, JPEG_ENC_OUTPUT *out);
+        static void EncodeSlice(void *arg, int index);
+        void doSlice(int index);
+        bool joinSlices(JPEG_ENC_OUTPUT *out);
+        static bool parseStream(JPEG_ENC_UINT8 *data, JPEG_ENC_UINT32 len, JPEG_STREAM_INFO *info);
+        static bool sameHeaders(JPEG_ENC_UINT8 *a, JPEG_STREAM_INFO *infoA,
+                JPEG_ENC_UINT8 *b, JPEG_STREAM_INFO *infoB);
 
 
         static JPEG_ENC_UINT8 pushJpegOutput(JPEG_ENC_UINT8 ** out_buf_ptrptr,
@@ -65,7 +141,7 @@ namespace android{
                 void * context, 
                 JPEG_ENC_MODE enc_mode);
         void createJpegExifTags(jpeg_enc_object * obj_ptr);
-        int yuv_resize(unsigned char *dst_ptr, int dst_width, int dst_height, unsigned char *src_ptr, int src_width, int src_height);
+        int makeThumbnail(unsigned char *dst, int width, int height, unsigned char *picture);
 
 
         unsigned int mSupportedType[MAX_ENC_SUPPORTED_YUV_TYPE];
@@ -73,10 +149,22 @@ namespace android{
         enc_cfg_param *pEncCfgLocal;
         jpeg_enc_object *pEncObj;
 
-
-        static JPEG_ENC_UINT32 g_JpegDataSize ;//Total size of g_JpegData
-        static JPEG_ENC_UINT32 g_JpegDataLen ;//Valid data len of g_JpegData
-        static JPEG_ENC_UINT8 *g_JpegData ;//Buffer to hold jpeg data
+        sp<CameraThreadPool> mThreadPool;
+        JPEG_ENC_SLICE mSlices[MAX_JPEG_ENC_SLICE_NUM];
+        JPEG_ENC_MODE mSliceMode;
+        unsigned char *mSliceBuffer;
+        int mSliceNum;
+        int mRestartInterval;
+        unsigned char *mSliceOutBuf;
+        unsigned int mSliceOutSize;
+
+        Mutex mContextLock;
+        JPEG_ENC_CONTEXT mContexts[MAX_JPEG_ENC_CONTEXT_NUM];
+        unsigned char *mThumbBuffer;
+        unsigned int mThumbBufferSize;
+        /* the chroma of a semi-planar frame, split to planes as the codec takes them */
+        unsigned char *mChromaBuffer;
+        unsigned int mChromaBufferSize;
 
     }; 
 };
@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <utils/Timers.h>
+#include "JpegEncoderTurbo.h"
+#include "Camera_convert.h"
+
+/* tiff field types */
+#define EXIF_TYPE_BYTE      1
+#define EXIF_TYPE_ASCII     2
+#define EXIF_TYPE_SHORT     3
+#define EXIF_TYPE_LONG      4
+#define EXIF_TYPE_RATIONAL  5
+#define EXIF_TYPE_UNDEFINED 7
+
+#define EXIF_HEADER_SIZE    6   /* "Exif\0\0" before the tiff header */
+#define TIFF_HEADER_SIZE    8
+
+namespace android{
+
+    static inline void put16(JOCTET *p, unsigned int v)
+    {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+    }
+
+    static inline void put32(JOCTET *p, unsigned int v)
+    {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    JpegEncoderTurbo :: JpegEncoderTurbo()
+        :mSupportedTypeIdx(0),
+        mConfigured(false),
+        mRowBuf(NULL),
+        mRowWidth(0),
+        mThumbBuf(NULL),
+        mThumbBufSize(0),
+        mThumbJpeg(NULL),
+        mApp1(NULL)
+    {
+        mSupportedType[0] = v4l2_fourcc('Y','U','1','2');
+        mSupportedType[1] = v4l2_fourcc('N','V','1','2');
+        mSupportedType[2] = v4l2_fourcc('N','V','2','1');
+        memset(&mCfg, 0, sizeof(mCfg));
+    }
+
+    JpegEncoderTurbo :: ~JpegEncoderTurbo()
+    {
+        JpegEncoderDeInit();
+    }
+
+    JPEG_ENC_ERR_RET JpegEncoderTurbo :: EnumJpegEncParam(JPEEG_QUERY_TYPE QueryType, void * pQueryRet)
+    {
+        int * pSupportedType = (int *)pQueryRet;
+        switch(QueryType){
+            case SUPPORTED_FMT:
+                if (mSupportedTypeIdx < MAX_TURBO_SUPPORTED_YUV_TYPE){
+                    *pSupportedType = mSupportedType[mSupportedTypeIdx];
+                    mSupportedTypeIdx ++;
+                }else{
+                    mSupportedTypeIdx = 0;
+                    return JPEG_ENC_ERROR_BAD_PARAM;
+                }
+                break;
+            default:
+                return JPEG_ENC_ERROR_BAD_PARAM;
+        }
+
+        return JPEG_ENC_ERROR_NONE;
+    }
+
+    bool JpegEncoderTurbo :: isSupported(unsigned int fmt)
+    {
+        for (int i = 0; i < MAX_TURBO_SUPPORTED_YUV_TYPE; i++){
+            if (mSupportedType[i] == fmt)
+                return true;
+        }
+        return false;
+    }
+
+    JPEG_ENC_ERR_RET JpegEncoderTurbo :: JpegEncoderInit(enc_cfg_param *pEncCfg)
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (pEncCfg == NULL)
+            return JPEG_ENC_ERROR_BAD_PARAM;
+
+        mConfigured = false;
+        //the 4:2:0 chroma needs even sizes
+        if (pEncCfg->PicWidth == 0 || pEncCfg->PicHeight == 0 ||
+                (pEncCfg->PicWidth & 1) || (pEncCfg->PicHeight & 1) ||
+                pEncCfg->ThumbWidth > pEncCfg->PicWidth || pEncCfg->ThumbHeight > pEncCfg->PicHeight ||
+                (pEncCfg->ThumbWidth & 1) || (pEncCfg->ThumbHeight & 1)){
+            CAMERA_HAL_ERR("The input widht and height is wrong");
+            return JPEG_ENC_ERROR_BAD_PARAM;
+        }
+        if (!isSupported(pEncCfg->BufFmt)){
+            CAMERA_HAL_ERR("The libjpeg encoder does not take the format %x", pEncCfg->BufFmt);
+            return JPEG_ENC_ERROR_BAD_PARAM;
+        }
+
+        memcpy(&mCfg, pEncCfg, sizeof(enc_cfg_param));
+        if (mCfg.Quality == 0 || mCfg.Quality > 100)
+            mCfg.Quality = TURBO_DEFAULT_QUALITY;
+        if (mCfg.ThumbQuality == 0 || mCfg.ThumbQuality > 100)
+            mCfg.ThumbQuality = TURBO_DEFAULT_QUALITY;
+
+        if (pEncCfg->pFoclLength != NULL){
+            mFoclLength = *pEncCfg->pFoclLength;
+            mCfg.pFoclLength = &mFoclLength;
+        }
+        if (pEncCfg->pMakeInfo != NULL){
+            mMakeInfo = *pEncCfg->pMakeInfo;
+            mCfg.pMakeInfo = &mMakeInfo;
+        }
+        if (pEncCfg->pMakeNote != NULL){
+            mMakeNote = *pEncCfg->pMakeNote;
+            mCfg.pMakeNote = &mMakeNote;
+        }
+        if (pEncCfg->pModelInfo != NULL){
+            mModelInfo = *pEncCfg->pModelInfo;
+            mCfg.pModelInfo = &mModelInfo;
+        }
+        if (pEncCfg->pDatetimeInfo != NULL){
+            mDatetimeInfo = *pEncCfg->pDatetimeInfo;
+            mCfg.pDatetimeInfo = &mDatetimeInfo;
+        }
+        if (pEncCfg->pGps_info != NULL){
+            mGpsInfo = *pEncCfg->pGps_info;
+            mCfg.pGps_info = &mGpsInfo;
+        }
+
+        if (mApp1 == NULL)
+            mApp1 = (JOCTET *)malloc(EXIF_APP1_MAX_SIZE);
+        if (mThumbJpeg == NULL)
+            mThumbJpeg = (JOCTET *)malloc(EXIF_APP1_MAX_SIZE);
+        if (mApp1 == NULL || mThumbJpeg == NULL)
+            return JPEG_ENC_ERROR_ALOC_BUF;
+
+        mConfigured = true;
+        return JPEG_ENC_ERROR_NONE;
+    }
+
+    JPEG_ENC_ERR_RET JpegEncoderTurbo :: DoEncode( DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, struct jpeg_encoding_conf *pJpegEncCfg)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        JOCTET *thumb = NULL;
+        unsigned int app1Len;
+        int thumbLen = 0, len;
+        nsecs_t start;
+
+        if (!mConfigured || inBuf == NULL || outBuf == NULL || inBuf->virt_start == NULL || outBuf->virt_start == NULL)
+            return JPEG_ENC_ERROR_BAD_PARAM;
+
+        start = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mCfg.ThumbWidth > 0 && mCfg.ThumbHeight > 0){
+            thumbLen = makeThumbnail(inBuf->virt_start, &thumb);
+            if (thumbLen < 0)
+                CAMERA_HAL_ERR("Can not make the thumbnail, encode the picture without it");
+        }
+        app1Len = makeExif(mApp1, thumbLen > 0 ? thumb : NULL, thumbLen > 0 ? thumbLen : 0);
+
+        //without a length, the same output size the software encoder assumes
+        len = encodeYuv(inBuf->virt_start, mCfg.BufFmt, mCfg.PicWidth, mCfg.PicHeight, mCfg.Quality,
+                mApp1, app1Len, outBuf->virt_start,
+                outBuf->length > 0 ? outBuf->length : mCfg.PicWidth * mCfg.PicHeight * 3 / 2);
+        if (len == 0)
+            return JPEG_ENC_ERROR_NO_SPACE;
+        if (len < 0)
+            return JPEG_ENC_ERROR_ALOC_BUF;
+
+        CAMERA_HAL_LOG_INFO("Jpeg %dx%d encoded by libjpeg in %lld ms, quality %d, %d bytes",
+                mCfg.PicWidth, mCfg.PicHeight, (systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000LL,
+                mCfg.Quality, len);
+        pJpegEncCfg->output_jpeg_size = len;
+        return JPEG_ENC_ERROR_NONE;
+    }
+
+    JPEG_ENC_ERR_RET JpegEncoderTurbo :: JpegEncoderDeInit()
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        mConfigured = false;
+        freeRows();
+        if (mThumbBuf != NULL)
+            free(mThumbBuf);
+        mThumbBuf = NULL;
+        mThumbBufSize = 0;
+        if (mThumbJpeg != NULL)
+            free(mThumbJpeg);
+        mThumbJpeg = NULL;
+        if (mApp1 != NULL)
+            free(mApp1);
+        mApp1 = NULL;
+        return JPEG_ENC_ERROR_NONE;
+    }
+
+    /* 16 luma rows and 8 rows of each chroma plane, all padded to whole blocks */
+    bool JpegEncoderTurbo :: allocRows(int width)
+    {
+        if (width <= mRowWidth)
+            return true;
+        freeRows();
+        mRowBuf = (JSAMPLE *)malloc(width * 16 + (width / 2) * 8 * 2);
+        if (mRowBuf == NULL)
+            return false;
+        mRowWidth = width;
+        return true;
+    }
+
+    void JpegEncoderTurbo :: freeRows()
+    {
+        if (mRowBuf != NULL)
+            free(mRowBuf);
+        mRowBuf = NULL;
+        mRowWidth = 0;
+    }
+
+    void JpegEncoderTurbo :: errorExit(j_common_ptr cinfo)
+    {
+        char message[JMSG_LENGTH_MAX];
+
+        (*cinfo->err->format_message)(cinfo, message);
+        CAMERA_HAL_ERR("libjpeg: %s", message);
+        longjmp(((TURBO_ERROR_MGR *)cinfo->err)->jump, 1);
+    }
+
+    void JpegEncoderTurbo :: initDestination(j_compress_ptr cinfo)
+    {
+        TURBO_DEST_MGR *dest = (TURBO_DEST_MGR *)cinfo->dest;
+
+        dest->pub.next_output_byte = dest->data;
+        dest->pub.free_in_buffer = dest->size;
+        dest->overflow = false;
+    }
+
+    /* only called when the output buffer is full, the rest is thrown away */
+    boolean JpegEncoderTurbo :: emptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        TURBO_DEST_MGR *dest = (TURBO_DEST_MGR *)cinfo->dest;
+
+        dest->overflow = true;
+        dest->pub.next_output_byte = dest->spill;
+        dest->pub.free_in_buffer = sizeof(dest->spill);
+        return TRUE;
+    }
+
+    void JpegEncoderTurbo :: termDestination(j_compress_ptr cinfo)
+    {
+    }
+
+    /*
+     * Encode a 4:2:0 frame, planar or semi-planar, of even size. The
+     * libjpeg raw data interface takes an MCU row of 16 luma and 8 chroma
+     * rows at a time, each padded to whole 8x8 blocks. The planar rows
+     * are used in place when the width is a multiple of 16, otherwise
+     * they are copied with the last pixel repeated. Returns the size of
+     * the jpeg, 0 if it does not fit the output, or -1.
+     */
+    int JpegEncoderTurbo :: encodeYuv(unsigned char *src, unsigned int fmt, int width, int height, int quality,
+            const JOCTET *app1, unsigned int app1Len, JOCTET *out, unsigned int size)
+    {
+        struct jpeg_compress_struct cinfo;
+        TURBO_ERROR_MGR jerr;
+        TURBO_DEST_MGR dest;
+        JSAMPROW yRows[16], uRows[8], vRows[8];
+        JSAMPARRAY planes[3] = {yRows, uRows, vRows};
+        const CONVERT_KERNELS *k = getConvertKernels();
+        int padWidth = CAMERA_ALIGN_16(width);
+        int chromaWidth = width / 2, chromaHeight = height / 2;
+        bool direct = (padWidth == width) && (fmt == v4l2_fourcc('Y','U','1','2'));
+        bool semiPlanar = (fmt != v4l2_fourcc('Y','U','1','2'));
+        bool vFirst = (fmt == v4l2_fourcc('N','V','2','1'));
+        unsigned char *uPlane = src + width * height;
+        unsigned char *vPlane = uPlane + chromaWidth * chromaHeight;
+        JSAMPLE *yBuf, *uBuf, *vBuf;
+        int row, i, r;
+
+        if (!allocRows(padWidth))
+            return -1;
+        yBuf = mRowBuf;
+        uBuf = yBuf + padWidth * 16;
+        vBuf = uBuf + (padWidth / 2) * 8;
+
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = errorExit;
+        if (setjmp(jerr.jump)){
+            jpeg_destroy_compress(&cinfo);
+            return -1;
+        }
+        jpeg_create_compress(&cinfo);
+
+        dest.pub.init_destination = initDestination;
+        dest.pub.empty_output_buffer = emptyOutputBuffer;
+        dest.pub.term_destination = termDestination;
+        dest.data = out;
+        dest.size = size;
+        cinfo.dest = &dest.pub;
+
+        cinfo.image_width = width;
+        cinfo.image_height = height;
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_YCbCr;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        cinfo.raw_data_in = TRUE;
+        cinfo.dct_method = JDCT_IFAST;
+        //the exif APP1 has to be the first segment, there is no JFIF then
+        cinfo.write_JFIF_header = (app1Len == 0);
+        cinfo.comp_info[0].h_samp_factor = 2;
+        cinfo.comp_info[0].v_samp_factor = 2;
+        cinfo.comp_info[1].h_samp_factor = 1;
+        cinfo.comp_info[1].v_samp_factor = 1;
+        cinfo.comp_info[2].h_samp_factor = 1;
+        cinfo.comp_info[2].v_samp_factor = 1;
+
+        jpeg_start_compress(&cinfo, TRUE);
+        if (app1Len > 0)
+            jpeg_write_marker(&cinfo, JPEG_APP0 + 1, app1, app1Len);
+
+        for (row = 0; row < height; row += 16){
+            for (i = 0; i < 16; i++){
+                r = (row + i < height) ? row + i : height - 1;
+                if (direct){
+                    yRows[i] = src + r * width;
+                }else{
+                    yRows[i] = yBuf + i * padWidth;
+                    memcpy(yRows[i], src + r * width, width);
+                    memset(yRows[i] + width, yRows[i][width - 1], padWidth - width);
+                }
+            }
+            for (i = 0; i < 8; i++){
+                r = (row / 2 + i < chromaHeight) ? row / 2 + i : chromaHeight - 1;
+                if (direct){
+                    uRows[i] = uPlane + r * chromaWidth;
+                    vRows[i] = vPlane + r * chromaWidth;
+                    continue;
+                }
+                uRows[i] = uBuf + i * (padWidth / 2);
+                vRows[i] = vBuf + i * (padWidth / 2);
+                if (semiPlanar){
+                    //one interleaved plane right after the luma, NV21 has V first
+                    if (vFirst)
+                        k->splitUV(uPlane + r * width, vRows[i], uRows[i], chromaWidth);
+                    else
+                        k->splitUV(uPlane + r * width, uRows[i], vRows[i], chromaWidth);
+                }else{
+                    memcpy(uRows[i], uPlane + r * chromaWidth, chromaWidth);
+                    memcpy(vRows[i], vPlane + r * chromaWidth, chromaWidth);
+                }
+                memset(uRows[i] + chromaWidth, uRows[i][chromaWidth - 1], padWidth / 2 - chromaWidth);
+                memset(vRows[i] + chromaWidth, vRows[i][chromaWidth - 1], padWidth / 2 - chromaWidth);
+            }
+            jpeg_write_raw_data(&cinfo, planes, 16);
+        }
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        if (dest.overflow){
+            CAMERA_HAL_LOG_INFO("The jpeg does not fit the %d bytes of the output", size);
+            return 0;
+        }
+        return size - dest.pub.free_in_buffer;
+    }
+
+    /*
+     * The thumbnail is scaled from the preview sized frame the HAL passed
+     * along when there is one, else from the picture, and encoded on its
+     * own for the exif IFD1. Returns the size of its jpeg, or -1.
+     */
+    int JpegEncoderTurbo :: makeThumbnail(unsigned char *picture, JOCTET **thumb)
+    {
+        unsigned char *src = picture;
+        unsigned int fmt = mCfg.BufFmt;
+        int srcWidth = mCfg.PicWidth;
+        int srcHeight = mCfg.PicHeight;
+        int width = mCfg.ThumbWidth, height = mCfg.ThumbHeight;
+        unsigned int needed = width * height * 3 / 2;
+        int ret = -1;
+
+        if (mThumbBufSize < needed){
+            if (mThumbBuf != NULL)
+                free(mThumbBuf);
+            mThumbBuf = (JSAMPLE *)malloc(needed);
+            mThumbBufSize = (mThumbBuf != NULL) ? needed : 0;
+            if (mThumbBuf == NULL)
+                return -1;
+        }
+
+        if (mCfg.ThumbSrc != NULL && (int)mCfg.ThumbSrcWidth >= width &&
+                (int)mCfg.ThumbSrcHeight >= height){
+            src = mCfg.ThumbSrc;
+            fmt = mCfg.ThumbSrcFmt;
+            srcWidth = mCfg.ThumbSrcWidth;
+            srcHeight = mCfg.ThumbSrcHeight;
+        }
+
+        for (;;){
+            if (fmt == v4l2_fourcc('Y','U','1','2'))
+                ret = scaleI420(src, srcWidth, srcHeight, mThumbBuf, width, height);
+            else if (fmt == v4l2_fourcc('N','V','1','2'))
+                ret = scaleNV12toI420(src, srcWidth, srcHeight, mThumbBuf, width, height);
+            else if (fmt == v4l2_fourcc('N','V','2','1'))
+                ret = scaleNV21toI420(src, srcWidth, srcHeight, mThumbBuf, width, height);
+            if (ret == 0 || src == picture)
+                break;
+            src = picture;
+            fmt = mCfg.BufFmt;
+            srcWidth = mCfg.PicWidth;
+            srcHeight = mCfg.PicHeight;
+        }
+        if (ret < 0)
+            return -1;
+
+        *thumb = mThumbJpeg;
+        return encodeYuv(mThumbBuf, v4l2_fourcc('Y','U','1','2'), width, height, mCfg.ThumbQuality,
+                NULL, 0, mThumbJpeg, EXIF_APP1_MAX_SIZE);
+    }
+
+    int JpegEncoderTurbo :: exifAdd(EXIF_IFD *ifd, unsigned short tag, unsigned short type,
+            unsigned int count, const void *data, unsigned int len)
+    {
+        int i = ifd->num;
+
+        if (i == EXIF_MAX_IFD_ENTRIES || ifd->poolLen + len > EXIF_IFD_POOL_SIZE){
+            CAMERA_HAL_ERR("exif: no room for the tag %x", tag);
+            return -1;
+        }
+        ifd->tag[i] = tag;
+        ifd->type[i] = type;
+        ifd->count[i] = count;
+        ifd->len[i] = len;
+        ifd->offset[i] = ifd->poolLen;
+        memcpy(ifd->pool + ifd->poolLen, data, len);
+        ifd->poolLen += len;
+        ifd->num ++;
+        return i;
+    }
+
+    int JpegEncoderTurbo :: exifAddShort(EXIF_IFD *ifd, unsigned short tag, unsigned short value)
+    {
+        JOCTET data[2];
+
+        put16(data, value);
+        return exifAdd(ifd, tag, EXIF_TYPE_SHORT, 1, data, sizeof(data));
+    }
+
+    int JpegEncoderTurbo :: exifAddLong(EXIF_IFD *ifd, unsigned short tag, unsigned int value)
+    {
+        JOCTET data[4];
+
+        put32(data, value);
+        return exifAdd(ifd, tag, EXIF_TYPE_LONG, 1, data, sizeof(data));
+    }
+
+    /* pairs holds num numerator, denominator pairs */
+    int JpegEncoderTurbo :: exifAddRationals(EXIF_IFD *ifd, unsigned short tag, const unsigned int *pairs, int num)
+    {
+        JOCTET data[8 * 3];
+
+        if (num > 3)
+            num = 3;
+        for (int i = 0; i < num * 2; i++)
+            put32(data + i * 4, pairs[i]);
+        return exifAdd(ifd, tag, EXIF_TYPE_RATIONAL, num, data, num * 8);
+    }
+
+    /* the count takes the terminating NUL, which str does not need to have */
+    int JpegEncoderTurbo :: exifAddAscii(EXIF_IFD *ifd, unsigned short tag, const char *str, unsigned int len)
+    {
+        char data[MAX_JPEG_MAKERNOTE_BYTES + 1];
+
+        if (len > MAX_JPEG_MAKERNOTE_BYTES)
+            len = MAX_JPEG_MAKERNOTE_BYTES;
+        memcpy(data, str, len);
+        data[len] = '\0';
+        return exifAdd(ifd, tag, EXIF_TYPE_ASCII, len + 1, data, len + 1);
+    }
+
+    unsigned int JpegEncoderTurbo :: exifIfdSize(const EXIF_IFD *ifd)
+    {
+        unsigned int size = 2 + ifd->num * 12 + 4;
+
+        for (int i = 0; i < ifd->num; i++){
+            if (ifd->len[i] > 4)
+                size += (ifd->len[i] + 1) & ~1;
+        }
+        return size;
+    }
+
+    /*
+     * Write the IFD at offset of the tiff header, with the values that do
+     * not fit an entry right after it. next is the offset of the next IFD
+     * of the chain, or 0. Returns exifIfdSize.
+     */
+    unsigned int JpegEncoderTurbo :: exifWriteIfd(const EXIF_IFD *ifd, JOCTET *tiff, unsigned int offset, unsigned int next)
+    {
+        JOCTET *entry = tiff + offset + 2;
+        unsigned int data = offset + 2 + ifd->num * 12 + 4;
+
+        put16(tiff + offset, ifd->num);
+        for (int i = 0; i < ifd->num; i++, entry += 12){
+            put16(entry, ifd->tag[i]);
+            put16(entry + 2, ifd->type[i]);
+            put32(entry + 4, ifd->count[i]);
+            memset(entry + 8, 0, 4);
+            if (ifd->len[i] <= 4){
+                memcpy(entry + 8, ifd->pool + ifd->offset[i], ifd->len[i]);
+            }else{
+                put32(entry + 8, data);
+                memcpy(tiff + data, ifd->pool + ifd->offset[i], ifd->len[i]);
+                if (ifd->len[i] & 1)
+                    tiff[data + ifd->len[i]] = 0;
+                data += (ifd->len[i] + 1) & ~1;
+            }
+        }
+        put32(entry, next);
+        return data - offset;
+    }
+
+    /*
+     * Build the APP1 segment, without its marker and length, with the
+     * same tags the fsl codec writes: IFD0, the exif IFD, the GPS IFD and
+     * the IFD1 of the thumbnail. The thumbnail is left out when it would
+     * not fit the segment. Returns the size of the segment.
+     */
+    unsigned int JpegEncoderTurbo :: makeExif(JOCTET *app1, const JOCTET *thumb, unsigned int thumbLen)
+    {
+        EXIF_IFD *ifd0, *exif, *gps, *ifd1;
+        EXIF_IFD ifds[4];
+        JOCTET *tiff = app1 + EXIF_HEADER_SIZE;
+        unsigned int exifOffset, gpsOffset, ifd1Offset, thumbOffset, end;
+        int exifEntry, gpsEntry = -1, thumbEntry = -1;
+        unsigned int pairs[6];
+        JOCTET bytes[4];
+
+        memset(ifds, 0, sizeof(ifds));
+        ifd0 = &ifds[0];
+        exif = &ifds[1];
+        gps = &ifds[2];
+        ifd1 = &ifds[3];
+
+        //the tags of every IFD are added in ascending order
+        if (mCfg.pMakeInfo != NULL)
+            exifAddAscii(ifd0, 0x010F, (const char *)mMakeInfo.make, mMakeInfo.make_bytes);
+        if (mCfg.pModelInfo != NULL)
+            exifAddAscii(ifd0, 0x0110, (const char *)mModelInfo.model, mModelInfo.model_bytes);
+        exifAddShort(ifd0, 0x0112, mCfg.RotationInfo);
+        if (mCfg.pDatetimeInfo != NULL)
+            exifAddAscii(ifd0, 0x0132, (const char *)mDatetimeInfo.datetime,
+                    strnlen((const char *)mDatetimeInfo.datetime, TIME_FMT_LENGTH - 1));
+        exifEntry = exifAddLong(ifd0, 0x8769, 0);
+        if (mCfg.pGps_info != NULL)
+            gpsEntry = exifAddLong(ifd0, 0x8825, 0);
+
+        exifAdd(exif, 0x9000, EXIF_TYPE_UNDEFINED, 4, "0220", 4);
+        if (mCfg.pDatetimeInfo != NULL)
+            exifAddAscii(exif, 0x9003, (const char *)mDatetimeInfo.datetime,
+                    strnlen((const char *)mDatetimeInfo.datetime, TIME_FMT_LENGTH - 1));
+        exifAddShort(exif, 0x9209, mCfg.FlashInfo);
+        if (mCfg.pFoclLength != NULL){
+            pairs[0] = mFoclLength.numerator;
+            pairs[1] = mFoclLength.denominator;
+            exifAddRationals(exif, 0x920A, pairs, 1);
+        }
+        if (mCfg.pMakeNote != NULL)
+            exifAdd(exif, 0x927C, EXIF_TYPE_UNDEFINED, mMakeNote.makernote_bytes,
+                    mMakeNote.makernote, mMakeNote.makernote_bytes);
+        exifAddShort(exif, 0xA001, 1);
+        exifAddLong(exif, 0xA002, mCfg.PicWidth);
+        exifAddLong(exif, 0xA003, mCfg.PicHeight);
+        exifAddShort(exif, 0xA403, mCfg.WhiteBalanceInfo);
+
+        if (mCfg.pGps_info != NULL){
+            unsigned int methodBytes = (unsigned char)mGpsInfo.processmethod_bytes;
+            JOCTET method[8 + MAX_GPS_PROCESSING_BYTES];
+
+            bytes[0] = (mGpsInfo.version >> 24) & 0xFF;
+            bytes[1] = (mGpsInfo.version >> 16) & 0xFF;
+            bytes[2] = (mGpsInfo.version >> 8) & 0xFF;
+            bytes[3] = mGpsInfo.version & 0xFF;
+            exifAdd(gps, 0x0000, EXIF_TYPE_BYTE, 4, bytes, 4);
+            exifAddAscii(gps, 0x0001, mGpsInfo.latitude_ref, 1);
+            pairs[0] = mGpsInfo.latitude_degree[0];
+            pairs[1] = mGpsInfo.latitude_degree[1];
+            pairs[2] = mGpsInfo.latitude_minute[0];
+            pairs[3] = mGpsInfo.latitude_minute[1];
+            pairs[4] = mGpsInfo.latitude_second[0];
+            pairs[5] = mGpsInfo.latitude_second[1];
+            exifAddRationals(gps, 0x0002, pairs, 3);
+            exifAddAscii(gps, 0x0003, mGpsInfo.longtitude_ref, 1);
+            pairs[0] = mGpsInfo.longtitude_degree[0];
+            pairs[1] = mGpsInfo.longtitude_degree[1];
+            pairs[2] = mGpsInfo.longtitude_minute[0];
+            pairs[3] = mGpsInfo.longtitude_minute[1];
+            pairs[4] = mGpsInfo.longtitude_second[0];
+            pairs[5] = mGpsInfo.longtitude_second[1];
+            exifAddRationals(gps, 0x0004, pairs, 3);
+            bytes[0] = mGpsInfo.altitude_ref;
+            exifAdd(gps, 0x0005, EXIF_TYPE_BYTE, 1, bytes, 1);
+            exifAddRationals(gps, 0x0006, mGpsInfo.altitude, 1);
+            pairs[0] = mGpsInfo.hour[0];
+            pairs[1] = mGpsInfo.hour[1];
+            pairs[2] = mGpsInfo.minute[0];
+            pairs[3] = mGpsInfo.minute[1];
+            pairs[4] = mGpsInfo.seconds[0];
+            pairs[5] = mGpsInfo.seconds[1];
+            exifAddRationals(gps, 0x0007, pairs, 3);
+            //the character code of the method comes first
+            if (methodBytes > MAX_GPS_PROCESSING_BYTES)
+                methodBytes = MAX_GPS_PROCESSING_BYTES;
+            memcpy(method, "ASCII\0\0\0", 8);
+            memcpy(method + 8, mGpsInfo.processmethod, methodBytes);
+            exifAdd(gps, 0x001B, EXIF_TYPE_UNDEFINED, 8 + methodBytes, method, 8 + methodBytes);
+            exifAddAscii(gps, 0x001D, mGpsInfo.datestamp, 10);
+        }
+
+        if (thumb != NULL){
+            exifAddShort(ifd1, 0x0103, 6);
+            thumbEntry = exifAddLong(ifd1, 0x0201, 0);
+            exifAddLong(ifd1, 0x0202, thumbLen);
+        }
+
+        exifOffset = TIFF_HEADER_SIZE + exifIfdSize(ifd0);
+        gpsOffset = exifOffset + exifIfdSize(exif);
+        ifd1Offset = gpsOffset + (gps->num > 0 ? exifIfdSize(gps) : 0);
+        thumbOffset = ifd1Offset + (thumbEntry >= 0 ? exifIfdSize(ifd1) : 0);
+        if (thumbEntry >= 0 && EXIF_HEADER_SIZE + thumbOffset + thumbLen > EXIF_APP1_MAX_SIZE){
+            CAMERA_HAL_ERR("The %d bytes thumbnail does not fit the exif header", thumbLen);
+            thumbEntry = -1;
+            thumbOffset = ifd1Offset;
+        }
+        if (exifEntry >= 0)
+            put32(ifd0->pool + ifd0->offset[exifEntry], exifOffset);
+        if (gpsEntry >= 0)
+            put32(ifd0->pool + ifd0->offset[gpsEntry], gpsOffset);
+        if (thumbEntry >= 0)
+            put32(ifd1->pool + ifd1->offset[thumbEntry], thumbOffset);
+
+        memcpy(app1, "Exif\0\0", EXIF_HEADER_SIZE);
+        memcpy(tiff, "II", 2);
+        put16(tiff + 2, 42);
+        put32(tiff + 4, TIFF_HEADER_SIZE);
+        exifWriteIfd(ifd0, tiff, TIFF_HEADER_SIZE, thumbEntry >= 0 ? ifd1Offset : 0);
+        exifWriteIfd(exif, tiff, exifOffset, 0);
+        if (gps->num > 0)
+            exifWriteIfd(gps, tiff, gpsOffset, 0);
+        end = thumbOffset;
+        if (thumbEntry >= 0){
+            exifWriteIfd(ifd1, tiff, ifd1Offset, 0);
+            memcpy(tiff + thumbOffset, thumb, thumbLen);
+            end += thumbLen;
+        }
+        return EXIF_HEADER_SIZE + end;
+    }
+
+    sp<JpegEncoderInterface> JpegEncoderTurbo::createInstance(){
+        sp<JpegEncoderInterface> encoder(new JpegEncoderTurbo());
+        return encoder;
+    }
+
+};
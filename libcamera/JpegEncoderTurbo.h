@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef JPEG_ENCODER_TURBO_H
+#define JPEG_ENCODER_TURBO_H
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <utils/threads.h>
+
+#include "JpegEncoderInterface.h"
+
+extern "C" {
+#include "jpeglib.h"
+}
+
+namespace android{
+#define MAX_TURBO_SUPPORTED_YUV_TYPE    3
+#define TURBO_DEFAULT_QUALITY           90
+/* the whole APP1 segment, with the thumbnail, has to fit a 16 bit length */
+#define EXIF_APP1_MAX_SIZE              65533
+#define EXIF_MAX_IFD_ENTRIES            20
+#define EXIF_IFD_POOL_SIZE              1024
+
+    /* the tags of one IFD, their values larger than 4 bytes go to the pool */
+    typedef struct {
+        int num;
+        unsigned short tag[EXIF_MAX_IFD_ENTRIES];
+        unsigned short type[EXIF_MAX_IFD_ENTRIES];
+        unsigned int count[EXIF_MAX_IFD_ENTRIES];
+        unsigned int len[EXIF_MAX_IFD_ENTRIES];
+        unsigned int offset[EXIF_MAX_IFD_ENTRIES];
+        unsigned int poolLen;
+        unsigned char pool[EXIF_IFD_POOL_SIZE];
+    }EXIF_IFD;
+
+    typedef struct {
+        struct jpeg_error_mgr pub;
+        jmp_buf jump;
+    }TURBO_ERROR_MGR;
+
+    typedef struct {
+        struct jpeg_destination_mgr pub;
+        JOCTET *data;
+        unsigned int size;
+        bool overflow;
+        JOCTET spill[256];
+    }TURBO_DEST_MGR;
+
+    /*
+     * JpegEncoderInterface on top of libjpeg, which is libjpeg-turbo with
+     * its SIMD DCT and color code on the recent platforms. The planes are
+     * passed to the codec as raw downsampled data, so planar frames are
+     * not copied and semi-planar ones only have their chroma split one
+     * MCU row at a time. The EXIF header is written here.
+     */
+    class JpegEncoderTurbo : public JpegEncoderInterface{
+    public:
+        virtual  JPEG_ENC_ERR_RET  EnumJpegEncParam(JPEEG_QUERY_TYPE QueryType, void * pQueryRet);
+        virtual  JPEG_ENC_ERR_RET JpegEncoderInit(enc_cfg_param *pEncCfg);
+        virtual  JPEG_ENC_ERR_RET DoEncode( DMA_BUFFER *inBuf, DMA_BUFFER *outBuf, struct jpeg_encoding_conf *pJpegEncCfg);
+        virtual  JPEG_ENC_ERR_RET JpegEncoderDeInit();
+
+        static sp<JpegEncoderInterface>createInstance();
+    private:
+
+        JpegEncoderTurbo();
+        virtual ~JpegEncoderTurbo();
+
+        bool isSupported(unsigned int fmt);
+        int encodeYuv(unsigned char *src, unsigned int fmt, int width, int height, int quality,
+                const JOCTET *app1, unsigned int app1Len, JOCTET *out, unsigned int size);
+        bool allocRows(int width);
+        void freeRows();
+        int makeThumbnail(unsigned char *picture, JOCTET **thumb);
+        unsigned int makeExif(JOCTET *app1, const JOCTET *thumb, unsigned int thumbLen);
+
+        static int exifAdd(EXIF_IFD *ifd, unsigned short tag, unsigned short type,
+                unsigned int count, const void *data, unsigned int len);
+        static int exifAddShort(EXIF_IFD *ifd, unsigned short tag, unsigned short value);
+        static int exifAddLong(EXIF_IFD *ifd, unsigned short tag, unsigned int value);
+        static int exifAddRationals(EXIF_IFD *ifd, unsigned short tag, const unsigned int *pairs, int num);
+        static int exifAddAscii(EXIF_IFD *ifd, unsigned short tag, const char *str, unsigned int len);
+        static unsigned int exifIfdSize(const EXIF_IFD *ifd);
+        static unsigned int exifWriteIfd(const EXIF_IFD *ifd, JOCTET *tiff, unsigned int offset, unsigned int next);
+
+        static void errorExit(j_common_ptr cinfo);
+        static void initDestination(j_compress_ptr cinfo);
+        static boolean emptyOutputBuffer(j_compress_ptr cinfo);
+        static void termDestination(j_compress_ptr cinfo);
+
+        unsigned int mSupportedType[MAX_TURBO_SUPPORTED_YUV_TYPE];
+        unsigned int mSupportedTypeIdx;
+        enc_cfg_param mCfg;
+        bool mConfigured;
+
+        /* the exif data the HAL passed, copied as the pointers are its stack */
+        struct jpeg_enc_focallength_t mFoclLength;
+        struct jpeg_enc_make_info_t mMakeInfo;
+        struct jpeg_enc_makernote_info_t mMakeNote;
+        struct jpeg_enc_model_info_t mModelInfo;
+        struct jpeg_enc_datetime_info_t mDatetimeInfo;
+        struct jpeg_enc_gps_param mGpsInfo;
+
+        /* an MCU row of padded luma and split chroma */
+        JSAMPLE *mRowBuf;
+        int mRowWidth;
+        JSAMPLE *mThumbBuf;
+        unsigned int mThumbBufSize;
+        JOCTET *mThumbJpeg;
+        JOCTET *mApp1;
+    };
+};
+
+#endif
@@ -25,20 +25,54 @@ namespace android{
 
     wp<PostProcessDeviceInterface> PPIpuLib :: singleton;
 
-    PPIpuLib :: PPIpuLib(){
+    PPIpuLib :: PPIpuLib()
+        : mTaskReady(false),
+          mTaskInitCount(0){
+        memset(&mIPUInputParam, 0, sizeof(ipu_lib_input_param_t));
+        memset(&mIPUOutputParam, 0, sizeof(ipu_lib_output_param_t));
+        memset(&mIPUHandle, 0, sizeof(ipu_lib_handle_t));
         return;
     }
 
     PPIpuLib :: ~PPIpuLib(){
 
+        PPDeviceDeInit();
         singleton.clear();
     }
+    bool PPIpuLib :: IsSameConfig(pp_input_param_t *pp_input, pp_output_param_t *pp_output){
+        //the buffer address is not part of the config, it is updated per frame
+        return mIPUInputParam.width == (int)pp_input->width &&
+            mIPUInputParam.height == (int)pp_input->height &&
+            mIPUInputParam.fmt == (int)pp_input->fmt &&
+            mIPUInputParam.input_crop_win.pos.x == pp_input->input_crop_win.pos.x &&
+            mIPUInputParam.input_crop_win.pos.y == pp_input->input_crop_win.pos.y &&
+            mIPUInputParam.input_crop_win.win_w == (int)pp_input->input_crop_win.win_w &&
+            mIPUInputParam.input_crop_win.win_h == (int)pp_input->input_crop_win.win_h &&
+            mIPUOutputParam.width == (int)pp_output->width &&
+            mIPUOutputParam.height == (int)pp_output->height &&
+            mIPUOutputParam.fmt == (int)pp_output->fmt &&
+            mIPUOutputParam.rot == (int)pp_output->rot &&
+            mIPUOutputParam.output_win.pos.x == pp_output->output_win.pos.x &&
+            mIPUOutputParam.output_win.pos.y == pp_output->output_win.pos.y &&
+            mIPUOutputParam.output_win.win_w == (int)pp_output->output_win.win_w &&
+            mIPUOutputParam.output_win.win_h == (int)pp_output->output_win.win_h;
+    }
+
     PPDEVICE_ERR_RET PPIpuLib :: PPDeviceInit(pp_input_param_t *pp_input, pp_output_param_t *pp_output){
         CAMERA_HAL_LOG_FUNC;
         PPDEVICE_ERR_RET ret = PPDEVICE_ERROR_NONE;
 
         int mIPURet;
 
+        Mutex::Autolock lock(mLock);
+        //The IPU task is kept between frames, only set it up again when the config changes
+        if (mTaskReady) {
+            if (IsSameConfig(pp_input, pp_output))
+                return ret;
+            mxc_ipu_lib_task_uninit(&mIPUHandle);
+            mTaskReady = false;
+        }
+
         memset(&mIPUHandle, 0, sizeof(ipu_lib_handle_t));
         //Setting input format
         mIPUInputParam.width = pp_input->width;
@@ -86,6 +120,9 @@ namespace android{
             CAMERA_HAL_ERR("Error! convertYUYVtoNV12, mxc_ipu_lib_task_init ret %d!",mIPURet);
             return PPDEVICE_ERROR_INIT;
         }  
+        mTaskReady = true;
+        mTaskInitCount ++;
+        CAMERA_HAL_LOG_INFO("IPU task init %d times", mTaskInitCount);
 
         return ret;
     }
@@ -95,15 +132,21 @@ namespace android{
         PPDEVICE_ERR_RET ret = PPDEVICE_ERROR_NONE;
 
         int mIPURet;
+        Mutex::Autolock lock(mLock);
+        if (!mTaskReady) {
+            CAMERA_HAL_ERR("Error! the IPU task is not initialized");
+            return PPDEVICE_ERROR_PROCESS;
+        }
         mIPUInputParam.user_def_paddr[0] = pp_input_addr->phy_offset;
 
         mIPUOutputParam.user_def_paddr[0] = pp_output_addr->phy_offset;
 
-        mIPURet = mxc_ipu_lib_task_buf_update(&mIPUHandle,pp_input_addr->phy_offset,pp_output_addr->phy_offset,NULL,NULL,NULL);
+        mIPURet = mxc_ipu_lib_task_buf_update(&mIPUHandle,pp_input_addr->phy_offset,pp_output_addr->phy_offset,0,NULL,NULL);
         if (mIPURet < 0) {
             CAMERA_HAL_ERR("Error! convertYUYVtoNV12, mxc_ipu_lib_task_buf_update ret %d!",mIPURet);
             mxc_ipu_lib_task_uninit(&mIPUHandle);
             memset(&mIPUHandle, 0, sizeof(ipu_lib_handle_t));
+            mTaskReady = false;
             return PPDEVICE_ERROR_PROCESS;
         }
 
@@ -115,12 +158,20 @@ namespace android{
         CAMERA_HAL_LOG_FUNC;
         PPDEVICE_ERR_RET ret = PPDEVICE_ERROR_NONE;
 
+        Mutex::Autolock lock(mLock);
+        if (!mTaskReady)
+            return ret;
         mxc_ipu_lib_task_uninit(&mIPUHandle);
         memset(&mIPUHandle, 0, sizeof(ipu_lib_handle_t));
+        mTaskReady = false;
 
         return ret;
     }
 
+    bool PPIpuLib :: PPDeviceIsHardware(){
+        return true;
+    }
+
     sp<PostProcessDeviceInterface> PPIpuLib :: createInstance(){
         CAMERA_HAL_LOG_FUNC;
         if (singleton != 0) {
@@ -24,6 +24,7 @@ extern "C" {
 #include "mxc_ipu_hl_lib.h" 
 } 
 
+#include <utils/threads.h>
 #include "PostProcessDeviceInterface.h"
 
 namespace android{
@@ -33,12 +34,18 @@ namespace android{
         virtual PPDEVICE_ERR_RET PPDeviceInit(pp_input_param_t *pp_input, pp_output_param_t *pp_output);
         virtual PPDEVICE_ERR_RET DoPorcess(DMA_BUFFER *pp_input_addr, DMA_BUFFER *pp_output_addr);
         virtual PPDEVICE_ERR_RET PPDeviceDeInit();
+        virtual bool PPDeviceIsHardware();
         static sp<PostProcessDeviceInterface> createInstance();
     private:
         PPIpuLib();
         virtual ~PPIpuLib();
+        bool IsSameConfig(pp_input_param_t *pp_input, pp_output_param_t *pp_output);
         static wp<PostProcessDeviceInterface> singleton;
 
+        Mutex                   mLock;
+        bool                    mTaskReady;
+        unsigned int            mTaskInitCount;
+
         ipu_lib_input_param_t mIPUInputParam;	
         ipu_lib_output_param_t mIPUOutputParam; 
         ipu_lib_handle_t			mIPUHandle;
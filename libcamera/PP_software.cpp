@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#include "PP_software.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace android{
+
+    wp<PostProcessDeviceInterface> PPSoftware :: singleton;
+
+    PPSoftware :: PPSoftware()
+        : mConfigured(false),
+          mColMap(NULL),
+          mRowMap(NULL),
+          mTransposed(false),
+          mTilesPerRow(0),
+          mTileNum(0){
+        memset(&mInput, 0, sizeof(pp_input_param_t));
+        memset(&mOutput, 0, sizeof(pp_output_param_t));
+        mThreadPool = CameraThreadPool::getInstance();
+    }
+
+    PPSoftware :: ~PPSoftware(){
+        FreeMaps();
+        singleton.clear();
+    }
+
+    void PPSoftware :: FreeMaps(){
+        if (mColMap != NULL)
+            free(mColMap);
+        if (mRowMap != NULL)
+            free(mRowMap);
+        mColMap = NULL;
+        mRowMap = NULL;
+    }
+
+    bool PPSoftware :: IsFormatSupported(unsigned int fmt){
+        return fmt == V4L2_PIX_FMT_YUYV || fmt == V4L2_PIX_FMT_UYVY ||
+            fmt == V4L2_PIX_FMT_NV12 || fmt == V4L2_PIX_FMT_YUV420;
+    }
+
+    void PPSoftware :: SetupPlanes(PP_PLANES *planes, unsigned char *base,
+            unsigned int fmt, unsigned int width, unsigned int height){
+        switch (fmt) {
+            case V4L2_PIX_FMT_YUYV:
+                planes->y = base;
+                planes->u = base + 1;
+                planes->v = base + 3;
+                planes->yStride = width * 2;
+                planes->yStep = 2;
+                planes->cStride = width * 2;
+                planes->cStep = 4;
+                planes->cShiftY = 0;
+                break;
+            case V4L2_PIX_FMT_UYVY:
+                planes->y = base + 1;
+                planes->u = base;
+                planes->v = base + 2;
+                planes->yStride = width * 2;
+                planes->yStep = 2;
+                planes->cStride = width * 2;
+                planes->cStep = 4;
+                planes->cShiftY = 0;
+                break;
+            case V4L2_PIX_FMT_NV12:
+                planes->y = base;
+                planes->u = base + width * height;
+                planes->v = planes->u + 1;
+                planes->yStride = width;
+                planes->yStep = 1;
+                planes->cStride = width;
+                planes->cStep = 2;
+                planes->cShiftY = 1;
+                break;
+            case V4L2_PIX_FMT_YUV420:
+            default:
+                planes->y = base;
+                planes->u = base + width * height;
+                planes->v = planes->u + (width >> 1) * (height >> 1);
+                planes->yStride = width;
+                planes->yStep = 1;
+                planes->cStride = width >> 1;
+                planes->cStep = 1;
+                planes->cShiftY = 1;
+                break;
+        }
+    }
+
+    PPDEVICE_ERR_RET PPSoftware :: PPDeviceInit(pp_input_param_t *pp_input, pp_output_param_t *pp_output){
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int outW, outH, preW, preH, i;
+        struct win_t *crop = &pp_input->input_crop_win;
+        struct win_t *win = &pp_output->output_win;
+
+        Mutex::Autolock lock(mLock);
+        if (mConfigured &&
+                memcmp(&mInput.input_crop_win, crop, sizeof(struct win_t)) == 0 &&
+                memcmp(&mOutput.output_win, win, sizeof(struct win_t)) == 0 &&
+                mInput.width == pp_input->width && mInput.height == pp_input->height &&
+                mInput.fmt == pp_input->fmt && mOutput.width == pp_output->width &&
+                mOutput.height == pp_output->height && mOutput.fmt == pp_output->fmt &&
+                mOutput.rot == pp_output->rot)
+            return PPDEVICE_ERROR_NONE;
+
+        mConfigured = false;
+        FreeMaps();
+
+        if (!IsFormatSupported(pp_input->fmt) || !IsFormatSupported(pp_output->fmt)) {
+            CAMERA_HAL_ERR("Software pp does not support the format in %x out %x", pp_input->fmt, pp_output->fmt);
+            return PPDEVICE_ERROR_INIT;
+        }
+        if (crop->win_w == 0 || crop->win_h == 0 ||
+                crop->pos.x + crop->win_w > pp_input->width ||
+                crop->pos.y + crop->win_h > pp_input->height) {
+            CAMERA_HAL_ERR("The input crop window is out of the input frame");
+            return PPDEVICE_ERROR_INIT;
+        }
+        //the chroma is sampled per 2x2 block, so the output window has to be even
+        if (win->win_w == 0 || win->win_h == 0 || (win->win_w & 1) || (win->win_h & 1) ||
+                (win->pos.x & 1) || (win->pos.y & 1) ||
+                win->pos.x + win->win_w > pp_output->width ||
+                win->pos.y + win->win_h > pp_output->height || pp_output->rot > 7) {
+            CAMERA_HAL_ERR("The output window or the rotation is not correct");
+            return PPDEVICE_ERROR_INIT;
+        }
+
+        outW = win->win_w;
+        outH = win->win_h;
+        mTransposed = (pp_output->rot & PP_ROTATE_90_RIGHT) != 0;
+        preW = mTransposed ? outH : outW;
+        preH = mTransposed ? outW : outH;
+
+        mColMap = (int *)malloc(outW * sizeof(int));
+        mRowMap = (int *)malloc(outH * sizeof(int));
+        if (mColMap == NULL || mRowMap == NULL) {
+            FreeMaps();
+            return PPDEVICE_ERROR_INIT;
+        }
+
+        /*
+         * The flips apply to the image before the 90 degree rotation. After
+         * the rotation the output column ox comes from the source row
+         * preH - 1 - ox, and the output row oy from the source column oy.
+         */
+        for (i = 0; i < preW; i++) {
+            unsigned int px = (pp_output->rot & PP_ROTATE_HFLIP) ? preW - 1 - i : i;
+            int sx = crop->pos.x + px * crop->win_w / preW;
+            if (mTransposed)
+                mRowMap[i] = sx;
+            else
+                mColMap[i] = sx;
+        }
+        for (i = 0; i < preH; i++) {
+            unsigned int py = (pp_output->rot & PP_ROTATE_VFLIP) ? preH - 1 - i : i;
+            int sy = crop->pos.y + py * crop->win_h / preH;
+            if (mTransposed)
+                mColMap[preH - 1 - i] = sy;
+            else
+                mRowMap[i] = sy;
+        }
+
+        mTilesPerRow = (outW + PP_TILE_WIDTH - 1) / PP_TILE_WIDTH;
+        mTileNum = mTilesPerRow * ((outH + PP_TILE_HEIGHT - 1) / PP_TILE_HEIGHT);
+        mInput = *pp_input;
+        mOutput = *pp_output;
+        mConfigured = true;
+
+        CAMERA_HAL_LOG_INFO("Software pp: %dx%d -> %dx%d rot %d, %d tiles on %d threads",
+                crop->win_w, crop->win_h, outW, outH, pp_output->rot, mTileNum,
+                mThreadPool->getThreadNum());
+        return PPDEVICE_ERROR_NONE;
+    }
+
+    void PPSoftware :: ProcessTile(void *arg, int index){
+        ((PPSoftware *)arg)->DoTile(index);
+    }
+
+    void PPSoftware :: DoTile(int index){
+        int x0 = (index % mTilesPerRow) * PP_TILE_WIDTH;
+        int y0 = (index / mTilesPerRow) * PP_TILE_HEIGHT;
+        int x1 = x0 + PP_TILE_WIDTH;
+        int y1 = y0 + PP_TILE_HEIGHT;
+        int posX = mOutput.output_win.pos.x;
+        int posY = mOutput.output_win.pos.y;
+        const PP_PLANES *in = &mInPlanes;
+        const PP_PLANES *out = &mOutPlanes;
+        int ox, oy, sx, sy;
+
+        if (x1 > (int)mOutput.output_win.win_w)
+            x1 = mOutput.output_win.win_w;
+        if (y1 > (int)mOutput.output_win.win_h)
+            y1 = mOutput.output_win.win_h;
+
+        for (oy = y0; oy < y1; oy++) {
+            unsigned char *dst = out->y + (posY + oy) * out->yStride + posX * out->yStep;
+            if (!mTransposed) {
+                const unsigned char *src = in->y + mRowMap[oy] * in->yStride;
+                for (ox = x0; ox < x1; ox++)
+                    dst[ox * out->yStep] = src[mColMap[ox] * in->yStep];
+            }else{
+                const unsigned char *src = in->y + mRowMap[oy] * in->yStep;
+                for (ox = x0; ox < x1; ox++)
+                    dst[ox * out->yStep] = src[mColMap[ox] * in->yStride];
+            }
+        }
+
+        for (oy = y0; oy < y1; oy += 1 << out->cShiftY) {
+            int dstRow = ((posY + oy) >> out->cShiftY) * out->cStride;
+            for (ox = x0; ox < x1; ox += 2) {
+                int srcOffset, dstOffset;
+                if (!mTransposed) {
+                    sx = mColMap[ox];
+                    sy = mRowMap[oy];
+                }else{
+                    sx = mRowMap[oy];
+                    sy = mColMap[ox];
+                }
+                srcOffset = (sy >> in->cShiftY) * in->cStride + (sx >> 1) * in->cStep;
+                dstOffset = dstRow + ((posX + ox) >> 1) * out->cStep;
+                out->u[dstOffset] = in->u[srcOffset];
+                out->v[dstOffset] = in->v[srcOffset];
+            }
+        }
+    }
+
+    PPDEVICE_ERR_RET PPSoftware :: DoPorcess(DMA_BUFFER *pp_input_addr, DMA_BUFFER *pp_output_addr){
+        CAMERA_HAL_LOG_FUNC;
+
+        Mutex::Autolock lock(mLock);
+        if (!mConfigured) {
+            CAMERA_HAL_ERR("Error! the software pp is not initialized");
+            return PPDEVICE_ERROR_PROCESS;
+        }
+        if (pp_input_addr->virt_start == NULL || pp_output_addr->virt_start == NULL)
+            return PPDEVICE_ERROR_PROCESS;
+
+        SetupPlanes(&mInPlanes, pp_input_addr->virt_start, mInput.fmt, mInput.width, mInput.height);
+        SetupPlanes(&mOutPlanes, pp_output_addr->virt_start, mOutput.fmt, mOutput.width, mOutput.height);
+        mThreadPool->parallelFor(ProcessTile, this, mTileNum);
+
+        return PPDEVICE_ERROR_NONE;
+    }
+
+    PPDEVICE_ERR_RET PPSoftware :: PPDeviceDeInit(){
+        CAMERA_HAL_LOG_FUNC;
+
+        Mutex::Autolock lock(mLock);
+        FreeMaps();
+        mConfigured = false;
+        return PPDEVICE_ERROR_NONE;
+    }
+
+    bool PPSoftware :: PPDeviceIsHardware(){
+        return false;
+    }
+
+    sp<PostProcessDeviceInterface> PPSoftware :: createInstance(){
+        CAMERA_HAL_LOG_FUNC;
+        if (singleton != 0) {
+            sp<PostProcessDeviceInterface> device = singleton.promote();
+            if (device != 0) {
+                return device;
+            }
+        }
+        sp<PostProcessDeviceInterface> device(new PPSoftware());
+
+        singleton = device;
+        return device;
+    }
+
+};
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef PP_SOFTWARE_H
+#define PP_SOFTWARE_H
+
+#include <utils/threads.h>
+#include "PostProcessDeviceInterface.h"
+#include "Camera_threadpool.h"
+
+/* the rot field follows the IPU convention: bit0 vflip, bit1 hflip, bit2 90 degree clockwise */
+#define PP_ROTATE_VFLIP     1
+#define PP_ROTATE_HFLIP     2
+#define PP_ROTATE_90_RIGHT  4
+
+#define PP_TILE_WIDTH       128
+#define PP_TILE_HEIGHT      32
+
+namespace android{
+
+    typedef struct {
+        unsigned char *y;
+        unsigned char *u;
+        unsigned char *v;
+        int yStride;
+        int yStep;          /* bytes between two luma samples in a row */
+        int cStride;
+        int cStep;          /* bytes between two chroma samples in a row */
+        int cShiftY;        /* 1 for 4:2:0, 0 for 4:2:2 */
+    }PP_PLANES;
+
+    /*
+     * CPU implementation of the post process device. It does the YUYV, UYVY,
+     * NV12 and I420 conversions, cropping, scaling and rotation of the
+     * IPU task, with nearest neighbour sampling. The output window is
+     * split into tiles which are spread over the camera thread pool.
+     */
+    class PPSoftware : public PostProcessDeviceInterface
+    {
+    public:
+        virtual PPDEVICE_ERR_RET PPDeviceInit(pp_input_param_t *pp_input, pp_output_param_t *pp_output);
+        virtual PPDEVICE_ERR_RET DoPorcess(DMA_BUFFER *pp_input_addr, DMA_BUFFER *pp_output_addr);
+        virtual PPDEVICE_ERR_RET PPDeviceDeInit();
+        virtual bool PPDeviceIsHardware();
+        static sp<PostProcessDeviceInterface> createInstance();
+    private:
+        PPSoftware();
+        virtual ~PPSoftware();
+        static wp<PostProcessDeviceInterface> singleton;
+
+        static bool IsFormatSupported(unsigned int fmt);
+        static void SetupPlanes(PP_PLANES *planes, unsigned char *base,
+                unsigned int fmt, unsigned int width, unsigned int height);
+        static void ProcessTile(void *arg, int index);
+        void DoTile(int index);
+        void FreeMaps();
+
+        Mutex                   mLock;
+        sp<CameraThreadPool>    mThreadPool;
+        bool                    mConfigured;
+        pp_input_param_t        mInput;
+        pp_output_param_t       mOutput;
+
+        /* source column/row for every output column/row of the window */
+        int                    *mColMap;
+        int                    *mRowMap;
+        bool                    mTransposed;
+        int                     mTilesPerRow;
+        int                     mTileNum;
+
+        PP_PLANES               mInPlanes;
+        PP_PLANES               mOutPlanes;
+    };
+};
+#endif
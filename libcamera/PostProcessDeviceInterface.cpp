@@ -17,9 +17,24 @@
 /*
  * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
  */
+#include <unistd.h>
+#include <string.h>
+#include <cutils/properties.h>
 #include "PP_ipulib.h" 
+#include "PP_software.h"
+
+#define IPU_DEV_NAME "/dev/mxc_ipu"
+
 namespace android{
-    extern "C" sp<PostProcessDeviceInterface> createPPDevice(){
+    extern "C" sp<PostProcessDeviceInterface> createPPDevice(bool physAddr){
+        char value[PROPERTY_VALUE_MAX];
+
+        //use the cpu when asked to, when there is no IPU at all, or no physical address for it
+        property_get("rw.camera.pp", value, "");
+        if (strcmp(value, "software") == 0 || !physAddr || access(IPU_DEV_NAME, F_OK) != 0) {
+            CAMERA_HAL_LOG_INFO("Use the software post process device");
+            return PPSoftware :: createInstance();
+        }
         return PPIpuLib :: createInstance();
     }
 
@@ -68,10 +68,13 @@ namespace android {
         virtual  PPDEVICE_ERR_RET PPDeviceInit(pp_input_param_t *pp_input, pp_output_param_t *pp_output)=0;
         virtual  PPDEVICE_ERR_RET DoPorcess(DMA_BUFFER *pp_input_addr, DMA_BUFFER *pp_output_addr)=0;
         virtual  PPDEVICE_ERR_RET PPDeviceDeInit()=0;
+        /* false when the device only runs on the cpu */
+        virtual  bool PPDeviceIsHardware()=0;
 
         virtual ~PostProcessDeviceInterface(){}
     }; 
-    extern "C" sp<PostProcessDeviceInterface> createPPDevice();
+    /* physAddr is false when the buffers may have no physical address, the IPU can not take them */
+    extern "C" sp<PostProcessDeviceInterface> createPPDevice(bool physAddr);
 
 };
 #endif
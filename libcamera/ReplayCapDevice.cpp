@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cutils/properties.h>
+
+#include "ReplayCapDevice.h"
+
+namespace android{
+
+    static const unsigned int sReplayFmt[REPLAY_ENUM_FMT_NUM] = {
+        V4L2_PIX_FMT_NV12,
+        V4L2_PIX_FMT_YUV420,
+        V4L2_PIX_FMT_YUYV
+    };
+
+    //what a MJPEG file is decoded to
+    static const unsigned int sReplayMjpegFmt[REPLAY_MJPEG_FMT_NUM] = {
+        V4L2_PIX_FMT_NV12,
+        V4L2_PIX_FMT_YUV420
+    };
+
+    static const unsigned int sReplaySize[REPLAY_ENUM_SIZE_NUM][2] = {
+        {640, 480},
+        {1280, 720},
+        {1920, 1080},
+        {2592, 1944}
+    };
+
+    //75% color bars, Y U V
+    static const unsigned char sReplayBars[8][3] = {
+        {180, 128, 128},
+        {162,  44, 142},
+        {131, 156,  44},
+        {112,  72,  58},
+        { 84, 184, 198},
+        { 65, 100, 212},
+        { 35, 212, 114},
+        { 16, 128, 128}
+    };
+
+    ReplayCapDevice :: ReplayCapDevice()
+        : mOpened(false),
+          mStreaming(false),
+          mFmtParamIdx(0),
+          mSizeFPSParamIdx(0),
+          mFps(REPLAY_DEFAULT_FPS),
+          mFileData(NULL),
+          mFileSize(0),
+          mFileFmt(0),
+          mFileWidth(0),
+          mFileHeight(0),
+          mFileFrames(0),
+          mBufQueNum(0),
+          mOwnBuffers(false),
+          mQueuedHead(0),
+          mQueuedNum(0),
+          mStartTime(0),
+          mFrameCount(0)
+    {
+        memset(mDevName, 0, sizeof(mDevName));
+        memset(&mCapCfg, 0, sizeof(mCapCfg));
+        memset(mBuffers, 0, sizeof(mBuffers));
+        memset(mFrameInfo, 0, sizeof(mFrameInfo));
+    }
+
+    ReplayCapDevice :: ~ReplayCapDevice()
+    {
+        DevStop();
+        DevDeAllocate();
+        DevClose();
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: SetDevName(char * deviceName)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        if (deviceName == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        strncpy(mDevName, deviceName, REPLAY_NAME_LENGTH - 1);
+        mDevName[REPLAY_NAME_LENGTH - 1] = '\0';
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: GetDevName(char * deviceName)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        if (deviceName == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        strcpy(deviceName, mDevName);
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevOpen()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        char value[PROPERTY_VALUE_MAX];
+        int fps;
+
+        if (mOpened)
+            return CAPTURE_DEVICE_ERR_ALRADY_OPENED;
+
+        property_get("rw.camera.replay.fps", value, "");
+        fps = atoi(value);
+        mFps = (fps > 0 && fps <= 120) ? fps : REPLAY_DEFAULT_FPS;
+
+        property_get("rw.camera.replay.file", value, "");
+        if (value[0] != '\0' && openFile(value) != CAPTURE_DEVICE_ERR_NONE)
+            return CAPTURE_DEVICE_ERR_OPEN;
+
+        mFmtParamIdx = 0;
+        mSizeFPSParamIdx = 0;
+        mOpened = true;
+        CAMERA_HAL_LOG_INFO("Replay device opened, %s at %d fps",
+                mFileData != NULL ? value : "color bars", mFps);
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: openFile(const char *path)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        char value[PROPERTY_VALUE_MAX];
+        struct stat st;
+        int fd;
+
+        fd = open(path, O_RDONLY);
+        if (fd < 0){
+            CAMERA_HAL_ERR("Can not open the replay file %s", path);
+            return CAPTURE_DEVICE_ERR_OPEN;
+        }
+        if (fstat(fd, &st) < 0 || st.st_size <= 0){
+            close(fd);
+            return CAPTURE_DEVICE_ERR_OPEN;
+        }
+        mFileSize = st.st_size;
+        mFileData = (unsigned char *)mmap(NULL, mFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mFileData == MAP_FAILED){
+            mFileData = NULL;
+            return CAPTURE_DEVICE_ERR_SYS_CALL;
+        }
+
+        property_get("rw.camera.replay.fmt", value, REPLAY_DEFAULT_FMT);
+        mFileFmt = parseFourcc(value);
+        if (mFileSize > 2 && mFileData[0] == 0xFF && mFileData[1] == 0xD8)
+            mFileFmt = V4L2_PIX_FMT_MJPEG;
+
+        if (mFileFmt == V4L2_PIX_FMT_MJPEG){
+            if (indexJpegFrames() <= 0){
+                CAMERA_HAL_ERR("No jpeg frame found in %s", path);
+                closeFile();
+                return CAPTURE_DEVICE_ERR_OPEN;
+            }
+        }else{
+            property_get("rw.camera.replay.size", value, REPLAY_DEFAULT_SIZE);
+            if (sscanf(value, "%ux%u", &mFileWidth, &mFileHeight) != 2 ||
+                    frameSize(mFileFmt, mFileWidth, mFileHeight) == 0 ||
+                    mFileSize < frameSize(mFileFmt, mFileWidth, mFileHeight)){
+                CAMERA_HAL_ERR("The replay file does not hold a %s frame", value);
+                closeFile();
+                return CAPTURE_DEVICE_ERR_OPEN;
+            }
+            mFileFrames = mFileSize / frameSize(mFileFmt, mFileWidth, mFileHeight);
+        }
+        CAMERA_HAL_LOG_INFO("Replay %d frames of %dx%d", mFileFrames, mFileWidth, mFileHeight);
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    void ReplayCapDevice :: closeFile()
+    {
+        if (mFileData != NULL)
+            munmap(mFileData, mFileSize);
+        mFileData = NULL;
+        mFileSize = 0;
+        mFileFrames = 0;
+    }
+
+    /*
+     * Walk the markers to find where every picture ends, a plain search for
+     * EOI would stop at the one of an exif thumbnail. The first SOF gives
+     * the size.
+     */
+    int ReplayCapDevice :: indexJpegFrames()
+    {
+        const unsigned char *data = mFileData;
+        size_t size = mFileSize;
+        size_t pos = 0, p;
+        unsigned int len;
+        unsigned char marker;
+
+        mFileFrames = 0;
+        while (pos + 4 <= size && mFileFrames < REPLAY_MAX_FRAMES){
+            if (data[pos] != 0xFF || data[pos + 1] != 0xD8){
+                pos ++;
+                continue;
+            }
+            p = pos + 2;
+            while (p + 4 <= size){
+                if (data[p] != 0xFF){
+                    p ++;
+                    continue;
+                }
+                marker = data[p + 1];
+                if (marker == 0xFF){
+                    p ++;
+                    continue;
+                }
+                if (marker == 0xD9)
+                    break;
+                if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)){
+                    p += 2;
+                    continue;
+                }
+                len = (data[p + 2] << 8) | data[p + 3];
+                if ((marker == 0xC0 || marker == 0xC1 || marker == 0xC2) &&
+                        mFileWidth == 0 && p + 9 <= size){
+                    mFileHeight = (data[p + 5] << 8) | data[p + 6];
+                    mFileWidth = (data[p + 7] << 8) | data[p + 8];
+                }
+                p += 2 + len;
+                if (marker == 0xDA){
+                    //the entropy coded data, only stuffed or restart FFs in it
+                    while (p + 1 < size && !(data[p] == 0xFF && data[p + 1] != 0 &&
+                                (data[p + 1] < 0xD0 || data[p + 1] > 0xD7)))
+                        p ++;
+                }
+            }
+            if (p + 2 > size)
+                break;
+            mJpegOffset[mFileFrames] = pos;
+            mJpegLength[mFileFrames] = p + 2 - pos;
+            mFileFrames ++;
+            pos = p + 2;
+        }
+        if (mFileWidth == 0 || mFileHeight == 0)
+            mFileFrames = 0;
+        return mFileFrames;
+    }
+
+    unsigned int ReplayCapDevice :: frameSize(unsigned int fmt, unsigned int width, unsigned int height)
+    {
+        switch (fmt){
+            case V4L2_PIX_FMT_NV12:
+            case V4L2_PIX_FMT_YUV420:
+                return width * height * 3 / 2;
+            case V4L2_PIX_FMT_YUYV:
+                return width * height * 2;
+            case V4L2_PIX_FMT_MJPEG:
+                //the bound the uvc driver uses for sizeimage
+                return width * height * 2;
+            default:
+                return 0;
+        }
+    }
+
+    unsigned int ReplayCapDevice :: parseFourcc(const char *str)
+    {
+        if (strlen(str) < 4)
+            return 0;
+        return v4l2_fourcc(str[0], str[1], str[2], str[3]);
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: EnumDevParam(DevParamType devParamType, void *retParam)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret = CAPTURE_DEVICE_ERR_NONE;
+
+        if (!mOpened)
+            return CAPTURE_DEVICE_ERR_OPEN;
+        if (retParam == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        switch (devParamType){
+            case OUTPU_FMT:
+                {
+                    unsigned int *pParamVal = (unsigned int *)retParam;
+                    const unsigned int *fmts = sReplayFmt;
+                    unsigned int num = REPLAY_ENUM_FMT_NUM;
+                    if (mFileData != NULL && mFileFmt == V4L2_PIX_FMT_MJPEG){
+                        fmts = sReplayMjpegFmt;
+                        num = REPLAY_MJPEG_FMT_NUM;
+                    }else if (mFileData != NULL){
+                        fmts = &mFileFmt;
+                        num = 1;
+                    }
+                    if (mFmtParamIdx < num){
+                        *pParamVal = fmts[mFmtParamIdx];
+                        mFmtParamIdx ++;
+                        ret = CAPTURE_DEVICE_ERR_ENUM_CONTINUE;
+                    }else{
+                        mFmtParamIdx = 0;
+                        ret = CAPTURE_DEVICE_ERR_GET_PARAM;
+                    }
+                }
+                break;
+            case FRAME_SIZE_FPS:
+                {
+                    struct capture_config_t *pCapCfg = (struct capture_config_t *)retParam;
+                    unsigned int num = mFileData != NULL ? 1 : REPLAY_ENUM_SIZE_NUM;
+                    if (mSizeFPSParamIdx < num){
+                        if (mFileData != NULL){
+                            pCapCfg->width = mFileWidth;
+                            pCapCfg->height = mFileHeight;
+                        }else{
+                            pCapCfg->width = sReplaySize[mSizeFPSParamIdx][0];
+                            pCapCfg->height = sReplaySize[mSizeFPSParamIdx][1];
+                        }
+                        pCapCfg->tv.numerator = 1;
+                        pCapCfg->tv.denominator = mFps;
+                        mSizeFPSParamIdx ++;
+                        ret = CAPTURE_DEVICE_ERR_ENUM_CONTINUE;
+                    }else{
+                        mSizeFPSParamIdx = 0;
+                        ret = CAPTURE_DEVICE_ERR_SET_PARAM;
+                    }
+                }
+                break;
+            default:
+                ret = CAPTURE_DEVICE_ERR_BAD_PARAM;
+                break;
+        }
+        return ret;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevSetConfig(struct capture_config_t *pCapcfg)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int i;
+
+        if (!mOpened || pCapcfg == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        if (mFileData != NULL){
+            if (mFileFmt == V4L2_PIX_FMT_MJPEG){
+                for (i = 0; i < REPLAY_MJPEG_FMT_NUM; i++)
+                    if (sReplayMjpegFmt[i] == pCapcfg->fmt)
+                        break;
+                if (i == REPLAY_MJPEG_FMT_NUM)
+                    return CAPTURE_DEVICE_ERR_SET_PARAM;
+            }else if (pCapcfg->fmt != mFileFmt){
+                return CAPTURE_DEVICE_ERR_SET_PARAM;
+            }
+            if (pCapcfg->width != mFileWidth ||
+                    pCapcfg->height != mFileHeight){
+                CAMERA_HAL_ERR("The replay file is %dx%d only", mFileWidth, mFileHeight);
+                return CAPTURE_DEVICE_ERR_SET_PARAM;
+            }
+        }else{
+            for (i = 0; i < REPLAY_ENUM_FMT_NUM; i++)
+                if (sReplayFmt[i] == pCapcfg->fmt)
+                    break;
+            if (i == REPLAY_ENUM_FMT_NUM || pCapcfg->width == 0 || pCapcfg->height == 0 ||
+                    (pCapcfg->width & 1) || (pCapcfg->height & 1))
+                return CAPTURE_DEVICE_ERR_SET_PARAM;
+        }
+
+        pCapcfg->tv.numerator = 1;
+        pCapcfg->tv.denominator = mFps;
+        pCapcfg->framesize = frameSize(pCapcfg->fmt, pCapcfg->width, pCapcfg->height);
+        pCapcfg->picture_waite_number = 1;
+        mCapCfg = *pCapcfg;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int i, length;
+
+        if (!mOpened)
+            return CAPTURE_DEVICE_ERR_OPEN;
+        if (DevBufQue == NULL || pBufQueNum == NULL || *pBufQueNum == 0 || mCapCfg.framesize == 0)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        if (*pBufQueNum > REPLAY_MAX_BUF_QUE_NUM)
+            *pBufQueNum = REPLAY_MAX_BUF_QUE_NUM;
+        length = (mCapCfg.framesize + 4095) & ~4095;
+        for (i = 0; i < *pBufQueNum; i++){
+            mBuffers[i].virt_start = (unsigned char *)malloc(length);
+            if (mBuffers[i].virt_start == NULL){
+                mBufQueNum = i;
+                mOwnBuffers = true;
+                DevDeAllocate();
+                return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+            }
+            //no physical memory behind them, the HAL picks the software pp device for replay
+            mBuffers[i].phy_offset = 0;
+            mBuffers[i].length = length;
+            DevBufQue[i] = mBuffers[i];
+        }
+        mBufQueNum = *pBufQueNum;
+        mOwnBuffers = true;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+            unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int i;
+
+        if (!mOpened)
+            return CAPTURE_DEVICE_ERR_OPEN;
+        if (DevBufQue == NULL || pBufQueNum == NULL || *pBufQueNum == 0 ||
+                *pBufQueNum > REPLAY_MAX_BUF_QUE_NUM)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        //there is no one to map a dma-buf fd
+        if (memType != CAPTURE_MEMORY_USERPTR)
+            return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+
+        for (i = 0; i < *pBufQueNum; i++){
+            if (DevBufQue[i].virt_start == NULL || DevBufQue[i].length < mCapCfg.framesize)
+                return CAPTURE_DEVICE_ERR_BAD_PARAM;
+            mBuffers[i] = DevBufQue[i];
+        }
+        mBufQueNum = *pBufQueNum;
+        mOwnBuffers = false;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevPrepare()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mLock);
+
+        if (mBufQueNum == 0)
+            return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+        for (unsigned int i = 0; i < mBufQueNum; i++)
+            mQueued[i] = i;
+        mQueuedHead = 0;
+        mQueuedNum = mBufQueNum;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevStart()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mLock);
+
+        if (mBufQueNum == 0)
+            return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+        mStartTime = systemTime();
+        mFrameCount = 0;
+        mStreaming = true;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    /*
+     * Like a sensor the frames keep their time: when the pipeline fell
+     * behind the missed ones are dropped, not delivered late one by one.
+     */
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevDequeue(unsigned int *pBufQueIdx)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int index, frame;
+        nsecs_t period, now, due;
+
+        if (pBufQueIdx == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        {
+            Mutex::Autolock lock(mLock);
+            while (mStreaming && mQueuedNum == 0){
+                if (mQueuedCond.waitRelative(mLock, REPLAY_DEQUEUE_TIMEOUT) != NO_ERROR){
+                    CAMERA_HAL_ERR("No buffer was queued to the replay device");
+                    return CAPTURE_DEVICE_ERR_SYS_CALL;
+                }
+            }
+            if (!mStreaming)
+                return CAPTURE_DEVICE_ERR_SYS_CALL;
+            index = mQueued[mQueuedHead];
+            mQueuedHead = (mQueuedHead + 1) % REPLAY_MAX_BUF_QUE_NUM;
+            mQueuedNum --;
+        }
+
+        period = 1000000000LL / mFps;
+        now = systemTime();
+        frame = (unsigned int)((now - mStartTime) / period);
+        if (frame < mFrameCount)
+            frame = mFrameCount;
+        due = mStartTime + (nsecs_t)frame * period;
+        if (due > now)
+            usleep((useconds_t)((due - now) / 1000));
+        mFrameCount = frame + 1;
+
+        fillFrame(mBuffers[index].virt_start, mBuffers[index].length, frame);
+        mFrameInfo[index].sequence = frame;
+        mFrameInfo[index].timestamp = due;
+        *pBufQueIdx = index;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevQueue(unsigned int BufQueIdx)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mLock);
+
+        if (BufQueIdx >= mBufQueNum || mQueuedNum == mBufQueNum)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        mQueued[(mQueuedHead + mQueuedNum) % REPLAY_MAX_BUF_QUE_NUM] = BufQueIdx;
+        mQueuedNum ++;
+        mQueuedCond.signal();
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo)
+    {
+        if (pInfo == NULL || BufQueIdx >= mBufQueNum)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        *pInfo = mFrameInfo[BufQueIdx];
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevStop()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        Mutex::Autolock lock(mLock);
+
+        mStreaming = false;
+        mQueuedNum = 0;
+        mQueuedCond.broadcast();
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevDeAllocate()
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (mOwnBuffers){
+            for (unsigned int i = 0; i < mBufQueNum; i++)
+                free(mBuffers[i].virt_start);
+        }
+        memset(mBuffers, 0, sizeof(mBuffers));
+        mBufQueNum = 0;
+        mOwnBuffers = false;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET ReplayCapDevice :: DevClose()
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        closeFile();
+        mFileWidth = 0;
+        mFileHeight = 0;
+        mOpened = false;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    void ReplayCapDevice :: DevDump(String8 &result)
+    {
+        char buffer[256];
+
+        snprintf(buffer, sizeof(buffer), "  replay of %s at %u fps, at frame %u\n",
+                mFileData != NULL ? "a file" : "color bars", mFps, mFrameCount);
+        result.append(buffer);
+    }
+
+    void ReplayCapDevice :: fillFrame(unsigned char *dst, unsigned int length, unsigned int frame)
+    {
+        unsigned int size;
+
+        if (mFileData == NULL){
+            fillPattern(dst, frame);
+            return;
+        }
+
+        frame %= mFileFrames;
+        if (mFileFmt == V4L2_PIX_FMT_MJPEG){
+            if (!mDecoder.decode(mFileData + mJpegOffset[frame], mJpegLength[frame], dst,
+                        mCapCfg.fmt, mCapCfg.width, mCapCfg.height))
+                CAMERA_HAL_ERR("Can not decode the replay frame %u", frame);
+        }else{
+            size = mCapCfg.framesize < length ? mCapCfg.framesize : length;
+            memcpy(dst, mFileData + (size_t)frame * mCapCfg.framesize, size);
+        }
+    }
+
+    /*
+     * The bars move by 8 pixels a frame so a stuck or reordered frame
+     * shows. Every row is the same, so one is drawn and copied down.
+     */
+    void ReplayCapDevice :: fillPattern(unsigned char *dst, unsigned int frame)
+    {
+        unsigned int width = mCapCfg.width, height = mCapCfg.height;
+        unsigned int shift = (frame * 8) % width;
+        unsigned int x, y, bar;
+        unsigned char *row, *uRow, *vRow;
+
+        switch (mCapCfg.fmt){
+            case V4L2_PIX_FMT_YUYV:
+                row = dst;
+                for (x = 0; x < width; x += 2){
+                    bar = ((x + shift) % width) * 8 / width;
+                    row[x * 2] = sReplayBars[bar][0];
+                    row[x * 2 + 1] = sReplayBars[bar][1];
+                    row[x * 2 + 2] = sReplayBars[bar][0];
+                    row[x * 2 + 3] = sReplayBars[bar][2];
+                }
+                for (y = 1; y < height; y++)
+                    memcpy(dst + y * width * 2, row, width * 2);
+                break;
+            case V4L2_PIX_FMT_NV12:
+            case V4L2_PIX_FMT_YUV420:
+                row = dst;
+                for (x = 0; x < width; x++)
+                    row[x] = sReplayBars[((x + shift) % width) * 8 / width][0];
+                for (y = 1; y < height; y++)
+                    memcpy(dst + y * width, row, width);
+
+                uRow = dst + width * height;
+                if (mCapCfg.fmt == V4L2_PIX_FMT_NV12){
+                    for (x = 0; x < width; x += 2){
+                        bar = ((x + shift) % width) * 8 / width;
+                        uRow[x] = sReplayBars[bar][1];
+                        uRow[x + 1] = sReplayBars[bar][2];
+                    }
+                    for (y = 1; y < height / 2; y++)
+                        memcpy(uRow + y * width, uRow, width);
+                }else{
+                    vRow = uRow + width * height / 4;
+                    for (x = 0; x < width; x += 2){
+                        bar = ((x + shift) % width) * 8 / width;
+                        uRow[x / 2] = sReplayBars[bar][1];
+                        vRow[x / 2] = sReplayBars[bar][2];
+                    }
+                    for (y = 1; y < height / 2; y++){
+                        memcpy(uRow + y * width / 2, uRow, width / 2);
+                        memcpy(vRow + y * width / 2, vRow, width / 2);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+};
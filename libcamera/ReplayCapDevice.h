@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#ifndef REPLAY_CAP_DEVICE_H
+#define REPLAY_CAP_DEVICE_H
+
+#include <linux/videodev2.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#include "CaptureDeviceInterface.h"
+#include "Camera_mjpeg.h"
+
+#define REPLAY_MAX_BUF_QUE_NUM      6
+#define REPLAY_MAX_FRAMES           256
+#define REPLAY_NAME_LENGTH          32
+#define REPLAY_DEFAULT_FPS          30
+#define REPLAY_DEFAULT_SIZE         "640x480"
+#define REPLAY_DEFAULT_FMT          "NV12"
+#define REPLAY_ENUM_FMT_NUM         3
+#define REPLAY_MJPEG_FMT_NUM        2
+#define REPLAY_ENUM_SIZE_NUM        4
+/* a QBUF has to come back within this while streaming, as on the driver */
+#define REPLAY_DEQUEUE_TIMEOUT      1000000000LL
+
+namespace android{
+
+    /*
+     * A capture device without a sensor. "replay" gives moving color bars
+     * in any of the enumerated formats and sizes, with
+     * rw.camera.replay.file set it plays a raw NV12/YU12/YUYV file
+     * (rw.camera.replay.size and rw.camera.replay.fmt) or a MJPEG file
+     * in a loop, decoded to NV12 or YU12 like the uvc device does. Frames come at rw.camera.replay.fps into as many buffers
+     * as the HAL allocates or imports, and a buffer is only filled after
+     * it was queued back, so the pipeline sees the same back pressure.
+     */
+    class ReplayCapDevice : public CaptureDeviceInterface{
+    public:
+        ReplayCapDevice();
+        virtual ~ReplayCapDevice();
+
+        virtual CAPTURE_DEVICE_ERR_RET SetDevName(char * deviceName);
+        virtual CAPTURE_DEVICE_ERR_RET GetDevName(char * deviceName);
+        virtual CAPTURE_DEVICE_ERR_RET DevOpen();
+        virtual CAPTURE_DEVICE_ERR_RET EnumDevParam(DevParamType devParamType, void *retParam);
+        virtual CAPTURE_DEVICE_ERR_RET DevSetConfig(struct capture_config_t *pCapcfg);
+        virtual CAPTURE_DEVICE_ERR_RET DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum);
+        virtual CAPTURE_DEVICE_ERR_RET DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+                unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType);
+        virtual CAPTURE_DEVICE_ERR_RET DevPrepare();
+        virtual CAPTURE_DEVICE_ERR_RET DevStart();
+        virtual CAPTURE_DEVICE_ERR_RET DevDequeue(unsigned int *pBufQueIdx);
+        virtual CAPTURE_DEVICE_ERR_RET DevQueue(unsigned int BufQueIdx);
+        virtual CAPTURE_DEVICE_ERR_RET DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo);
+        virtual CAPTURE_DEVICE_ERR_RET DevStop();
+        virtual CAPTURE_DEVICE_ERR_RET DevDeAllocate();
+        virtual CAPTURE_DEVICE_ERR_RET DevClose();
+        virtual void DevDump(String8 &result);
+
+    private:
+        CAPTURE_DEVICE_ERR_RET openFile(const char *path);
+        void closeFile();
+        int indexJpegFrames();
+        static unsigned int frameSize(unsigned int fmt, unsigned int width, unsigned int height);
+        static unsigned int parseFourcc(const char *str);
+        void fillFrame(unsigned char *dst, unsigned int length, unsigned int frame);
+        void fillPattern(unsigned char *dst, unsigned int frame);
+
+        char         mDevName[REPLAY_NAME_LENGTH];
+        bool         mOpened;
+        bool         mStreaming;
+        unsigned int mFmtParamIdx;
+        unsigned int mSizeFPSParamIdx;
+        unsigned int mFps;
+
+        /* the file, or none for the pattern */
+        unsigned char *mFileData;
+        size_t       mFileSize;
+        unsigned int mFileFmt;
+        unsigned int mFileWidth;
+        unsigned int mFileHeight;
+        unsigned int mFileFrames;
+        unsigned int mJpegOffset[REPLAY_MAX_FRAMES];
+        unsigned int mJpegLength[REPLAY_MAX_FRAMES];
+        CameraMjpegDecoder mDecoder;
+
+        struct capture_config_t mCapCfg;
+        DMA_BUFFER   mBuffers[REPLAY_MAX_BUF_QUE_NUM];
+        unsigned int mBufQueNum;
+        bool         mOwnBuffers;
+        struct capture_frame_info_t mFrameInfo[REPLAY_MAX_BUF_QUE_NUM];
+
+        /* the buffers queued and not yet filled, oldest first */
+        Mutex        mLock;
+        Condition    mQueuedCond;
+        unsigned int mQueued[REPLAY_MAX_BUF_QUE_NUM];
+        unsigned int mQueuedHead;
+        unsigned int mQueuedNum;
+
+        nsecs_t      mStartTime;
+        unsigned int mFrameCount;
+    };
+
+};
+#endif
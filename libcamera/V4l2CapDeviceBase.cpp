@@ -46,10 +46,17 @@ namespace android{
         mSizeFPSParamIdx(0),
         mRequiredFmt(0),
         mBufQueNum(0),
-        mQueuedBufNum(0)
+        mQueuedBufNum(0),
+        mMemoryType(CAPTURE_MEMORY_MMAP),
+        mUserPtrPhys(false),
+        mDeviceKeyValid(false),
+        mCachedFmtNum(0),
+        mCachedSizeFmt(0),
+        mCachedSizeNum(0)
 
     {
         mCaptureDeviceName[0] = '#';
+        memset(mFrameInfo, 0, sizeof(mFrameInfo));
     }
 
     V4l2CapDeviceBase :: ~V4l2CapDeviceBase()
@@ -112,6 +119,16 @@ namespace android{
             return V4l2AllocateBuf(DevBufQue, pBufQueNum);
     }
 
+    CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+            unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType){
+
+        CAMERA_HAL_LOG_FUNC;
+        if (mCameraDevice <= 0){
+            return CAPTURE_DEVICE_ERR_OPEN;
+        }else
+            return V4l2ImportBuf(DevBufQue, pDmaFd, pBufQueNum, memType);
+    }
+
     CAPTURE_DEVICE_ERR_RET  V4l2CapDeviceBase :: DevPrepare(){
 
         CAMERA_HAL_LOG_FUNC;
@@ -150,6 +167,15 @@ namespace android{
         }
     }
 
+    CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo){
+
+        if (pInfo == NULL || BufQueIdx >= mBufQueNum){
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        }
+        *pInfo = mFrameInfo[BufQueIdx];
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
     CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: DevStop(){
         CAMERA_HAL_LOG_FUNC;
         if (mCameraDevice <= 0){
@@ -180,6 +206,10 @@ namespace android{
         }
     }
 
+    void V4l2CapDeviceBase :: DevDump(String8 &result){
+        //the HAL already counts what the driver tells
+    }
+
     CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2Open(){
         CAMERA_HAL_LOG_FUNC;
         int fd = 0, i, j, is_found = 0;
@@ -200,7 +230,10 @@ namespace android{
             mCameraDevice = open(mCaptureDeviceName, O_RDWR, O_NONBLOCK);
             if (mCameraDevice < 0)
                 return CAPTURE_DEVICE_ERR_OPEN;
+            mDeviceKeyValid = CameraDeviceCache::queryKey(mCameraDevice, &mDeviceKey);
         }
+        else if (V4l2OpenCachedNode())
+            return ret;
         else{
             CAMERA_HAL_LOG_RUNTIME("deviceName is %s", mInitalDeviceName);
             v4l_dir = opendir("/sys/class/video4linux");
@@ -232,10 +265,43 @@ namespace android{
                 CAMERA_HAL_ERR("The device name is not correct or the device is error");
                 return CAPTURE_DEVICE_ERR_OPEN;
             }
+            if (is_found)
+                V4l2CacheNode(mInitalDeviceName);
         }
         return ret; 
     }
 
+    bool V4l2CapDeviceBase :: V4l2OpenCachedNode(){
+        CAMERA_HAL_LOG_FUNC;
+        char node[CAMERA_CACHE_NODE_LENGTH];
+        char sensor[CAMERA_CACHE_NAME_LENGTH];
+        int fd;
+
+        if (!CameraDeviceCache::findNode(mInitalDeviceName, node, sensor))
+            return false;
+        if ((fd = open(node, O_RDWR, O_NONBLOCK)) < 0){
+            CameraDeviceCache::invalidate(mInitalDeviceName);
+            return false;
+        }
+        if (!CameraDeviceCache::verifyNode(mInitalDeviceName, fd, &mDeviceKey)){
+            close(fd);
+            return false;
+        }
+        strcpy(mCaptureDeviceName, node);
+        strcpy(mInitalDeviceName, sensor);
+        mCameraDevice = fd;
+        mDeviceKeyValid = true;
+        CAMERA_HAL_LOG_INFO("device name is %s from the cache", mCaptureDeviceName);
+        return true;
+    }
+
+    void V4l2CapDeviceBase :: V4l2CacheNode(const char *name){
+        CAMERA_HAL_LOG_FUNC;
+        mDeviceKeyValid = CameraDeviceCache::queryKey(mCameraDevice, &mDeviceKey);
+        if (mDeviceKeyValid)
+            CameraDeviceCache::addNode(name, mInitalDeviceName, mCaptureDeviceName, mCameraDevice);
+    }
+
     CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2EnumParam(DevParamType devParamType, void *retParam){
         CAPTURE_DEVICE_ERR_RET ret = CAPTURE_DEVICE_ERR_NONE; 
 
@@ -246,11 +312,11 @@ namespace android{
             return CAPTURE_DEVICE_ERR_OPEN;
         switch(devParamType){
             case OUTPU_FMT: 
-                ret = V4l2EnumFmt(retParam);
+                ret = V4l2EnumCachedFmt(retParam);
                 break;
             case FRAME_SIZE_FPS:
                 {
-                    ret = V4l2EnumSizeFps(retParam);
+                    ret = V4l2EnumCachedSizeFps(retParam);
                     break;
                 }
             default:
@@ -263,6 +329,72 @@ namespace android{
 
     }
 
+    /*
+     * The whole format list is read from the device (or the cache) when
+     * the enumeration starts, and then handed out one entry per call.
+     */
+    CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2EnumCachedFmt(void *retParam){
+        CAMERA_HAL_LOG_FUNC;
+        unsigned int *pParamVal = (unsigned int *)retParam;
+
+        if (!mDeviceKeyValid)
+            return V4l2EnumFmt(retParam);
+
+        if (mFmtParamIdx == 0 &&
+                !CameraDeviceCache::getFormats(&mDeviceKey, mCachedFmt, &mCachedFmtNum)){
+            mCachedFmtNum = 0;
+            while (mCachedFmtNum < CAMERA_CACHE_MAX_FMT &&
+                    V4l2EnumFmt(&mCachedFmt[mCachedFmtNum]) == CAPTURE_DEVICE_ERR_ENUM_CONTINUE)
+                mCachedFmtNum ++;
+            mFmtParamIdx = 0;
+            CameraDeviceCache::setFormats(&mDeviceKey, mCachedFmt, mCachedFmtNum);
+        }
+
+        if ((int)mFmtParamIdx < mCachedFmtNum){
+            *pParamVal = mCachedFmt[mFmtParamIdx];
+            mFmtParamIdx ++;
+            return CAPTURE_DEVICE_ERR_ENUM_CONTINUE;
+        }
+        mFmtParamIdx = 0;
+        return CAPTURE_DEVICE_ERR_GET_PARAM;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2EnumCachedSizeFps(void *retParam){
+        CAMERA_HAL_LOG_FUNC;
+        struct capture_config_t *pCapCfg =(struct capture_config_t *) retParam;
+        struct capture_config_t query;
+
+        if (!mDeviceKeyValid)
+            return V4l2EnumSizeFps(retParam);
+
+        if (mSizeFPSParamIdx == 0){
+            mCachedSizeFmt = pCapCfg->fmt;
+            if (!CameraDeviceCache::getSizes(&mDeviceKey, pCapCfg->fmt, mCachedSize, &mCachedSizeNum)){
+                query = *pCapCfg;
+                mCachedSizeNum = 0;
+                while (mCachedSizeNum < CAMERA_CACHE_MAX_SIZE &&
+                        V4l2EnumSizeFps(&query) == CAPTURE_DEVICE_ERR_ENUM_CONTINUE){
+                    mCachedSize[mCachedSizeNum].width = query.width;
+                    mCachedSize[mCachedSizeNum].height = query.height;
+                    mCachedSize[mCachedSizeNum].tv = query.tv;
+                    mCachedSizeNum ++;
+                }
+                mSizeFPSParamIdx = 0;
+                CameraDeviceCache::setSizes(&mDeviceKey, pCapCfg->fmt, mCachedSize, mCachedSizeNum);
+            }
+        }
+
+        if (pCapCfg->fmt == mCachedSizeFmt && (int)mSizeFPSParamIdx < mCachedSizeNum){
+            pCapCfg->width = mCachedSize[mSizeFPSParamIdx].width;
+            pCapCfg->height = mCachedSize[mSizeFPSParamIdx].height;
+            pCapCfg->tv = mCachedSize[mSizeFPSParamIdx].tv;
+            mSizeFPSParamIdx ++;
+            return CAPTURE_DEVICE_ERR_ENUM_CONTINUE;
+        }
+        mSizeFPSParamIdx = 0;
+        return CAPTURE_DEVICE_ERR_SET_PARAM;
+    }
+
     CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2EnumFmt(void *retParam){
         CAMERA_HAL_LOG_FUNC;
         CAPTURE_DEVICE_ERR_RET ret = CAPTURE_DEVICE_ERR_NONE; 
@@ -442,6 +574,7 @@ namespace android{
         }
 
         mBufQueNum = *pBufQueNum;
+        mMemoryType = CAPTURE_MEMORY_MMAP;
 
         memset(&req, 0, sizeof (req));
         req.count = mBufQueNum;
@@ -479,16 +612,102 @@ namespace android{
         return CAPTURE_DEVICE_ERR_NONE;
     }
 
+    CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2ImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+            unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType){
+        unsigned int i;
+        struct v4l2_requestbuffers req;
+
+        CAMERA_HAL_LOG_FUNC;
+        if (memType == CAPTURE_MEMORY_MMAP)
+            return V4l2AllocateBuf(DevBufQue, pBufQueNum);
+        if (mCameraDevice <= 0 || DevBufQue == NULL || pBufQueNum == NULL || *pBufQueNum == 0 ||
+                *pBufQueNum > MAX_CAPTURE_BUF_QUE_NUM || (memType == CAPTURE_MEMORY_DMABUF && pDmaFd == NULL)){
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        }
+#ifndef VIDIOC_EXPBUF
+        if (memType == CAPTURE_MEMORY_DMABUF){
+            CAMERA_HAL_ERR("The kernel headers have no dma-buf capture");
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        }
+#endif
+        for (i = 0; i < *pBufQueNum; i++){
+            if (DevBufQue[i].length < mCapCfg.framesize){
+                CAMERA_HAL_ERR("The buffer %d of %d bytes can not take a %d bytes frame",
+                        i, DevBufQue[i].length, mCapCfg.framesize);
+                return CAPTURE_DEVICE_ERR_BAD_PARAM;
+            }
+            //the driver would DMA to physical address 0
+            if (memType == CAPTURE_MEMORY_USERPTR && mUserPtrPhys && DevBufQue[i].phy_offset == 0){
+                CAMERA_HAL_ERR("The buffer %d has no physical address for the driver", i);
+                return CAPTURE_DEVICE_ERR_BAD_PARAM;
+            }
+        }
+
+        memset(&req, 0, sizeof (req));
+        req.count = *pBufQueNum;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+#ifdef VIDIOC_EXPBUF
+        req.memory = (memType == CAPTURE_MEMORY_DMABUF) ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_USERPTR;
+#else
+        req.memory = V4L2_MEMORY_USERPTR;
+#endif
+        if (ioctl(mCameraDevice, VIDIOC_REQBUFS, &req) < 0) {
+            CAMERA_HAL_ERR("The driver can not import the capture buffers");
+            return CAPTURE_DEVICE_ERR_SYS_CALL;
+        }
+        if (req.count == 0 || req.count > *pBufQueNum){
+            CAMERA_HAL_ERR("The driver asks for %d imported buffers, %d are given", req.count, *pBufQueNum);
+            return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+        }
+
+        /*the driver may can't meet the request, and return the buf num it can handle*/
+        *pBufQueNum = mBufQueNum = req.count;
+        mMemoryType = memType;
+        for (i = 0; i < mBufQueNum; i++){
+            mCaptureBuffers[i] = DevBufQue[i];
+            mDmaFd[i] = (memType == CAPTURE_MEMORY_DMABUF) ? pDmaFd[i] : -1;
+            CAMERA_HAL_LOG_RUNTIME("imported buffers[%d] virt 0x%x phy 0x%x length %d", i,
+                    (unsigned int)mCaptureBuffers[i].virt_start, mCaptureBuffers[i].phy_offset,
+                    mCaptureBuffers[i].length);
+        }
+
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    /* the memory fields of a QBUF for the buffer at index */
+    void V4l2CapDeviceBase :: V4l2FillBuffer(struct v4l2_buffer *buf, unsigned int index){
+        memset(buf, 0, sizeof (struct v4l2_buffer));
+        buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf->index = index;
+        switch (mMemoryType){
+            case CAPTURE_MEMORY_USERPTR:
+                buf->memory = V4L2_MEMORY_USERPTR;
+                buf->length = mCaptureBuffers[index].length;
+                if (mUserPtrPhys)
+                    buf->m.offset = mCaptureBuffers[index].phy_offset;
+                else
+                    buf->m.userptr = (unsigned long)mCaptureBuffers[index].virt_start;
+                break;
+#ifdef VIDIOC_EXPBUF
+            case CAPTURE_MEMORY_DMABUF:
+                buf->memory = V4L2_MEMORY_DMABUF;
+                buf->length = mCaptureBuffers[index].length;
+                buf->m.fd = mDmaFd[index];
+                break;
+#endif
+            default:
+                buf->memory = V4L2_MEMORY_MMAP;
+                buf->m.offset = mCaptureBuffers[index].phy_offset;
+                break;
+        }
+    }
+
     CAPTURE_DEVICE_ERR_RET V4l2CapDeviceBase :: V4l2Prepare(){
         CAMERA_HAL_LOG_FUNC;
         struct v4l2_buffer buf;
         mQueuedBufNum = 0;
         for (unsigned int i = 0; i < mBufQueNum; i++) {
-            memset(&buf, 0, sizeof (struct v4l2_buffer));
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
-            buf.index = i;
-            buf.m.offset = mCaptureBuffers[i].phy_offset;
+            V4l2FillBuffer(&buf, i);
 
             if (ioctl (mCameraDevice, VIDIOC_QBUF, &buf) < 0) {
                 CAMERA_HAL_ERR("VIDIOC_QBUF error\n");
@@ -524,15 +743,19 @@ namespace android{
         if (mCameraDevice <= 0 || mBufQueNum == 0 || mCaptureBuffers == NULL){
             return CAPTURE_DEVICE_ERR_OPEN;
         }
-        memset(&cfilledbuffer, 0, sizeof (cfilledbuffer));
-        cfilledbuffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        cfilledbuffer.memory = V4L2_MEMORY_MMAP;
+        V4l2FillBuffer(&cfilledbuffer, 0);
         ret = ioctl(mCameraDevice, VIDIOC_DQBUF, &cfilledbuffer);
         if (ret < 0) {
             CAMERA_HAL_ERR("Camera VIDIOC_DQBUF failure, ret=%d", ret);
             return CAPTURE_DEVICE_ERR_SYS_CALL;
         }
         *pBufQueIdx = cfilledbuffer.index;
+        if (cfilledbuffer.index < MAX_CAPTURE_BUF_QUE_NUM){
+            mFrameInfo[cfilledbuffer.index].sequence = cfilledbuffer.sequence;
+            mFrameInfo[cfilledbuffer.index].timestamp =
+                (nsecs_t)cfilledbuffer.timestamp.tv_sec * 1000000000LL +
+                (nsecs_t)cfilledbuffer.timestamp.tv_usec * 1000;
+        }
 
         mQueuedBufNum --;
 
@@ -546,10 +769,10 @@ namespace android{
         if (mCameraDevice <= 0 || mBufQueNum == 0 || mCaptureBuffers == NULL){
             return CAPTURE_DEVICE_ERR_OPEN;
         }
-        memset(&cfilledbuffer, 0, sizeof (struct v4l2_buffer));
-        cfilledbuffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        cfilledbuffer.memory = V4L2_MEMORY_MMAP;
-        cfilledbuffer.index = BufQueIdx;
+        if (BufQueIdx >= mBufQueNum){
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        }
+        V4l2FillBuffer(&cfilledbuffer, BufQueIdx);
         ret = ioctl(mCameraDevice, VIDIOC_QBUF, &cfilledbuffer);
         if (ret < 0) {
             CAMERA_HAL_ERR("Camera VIDIOC_DQBUF failure, ret=%d", ret);
@@ -585,8 +808,29 @@ namespace android{
             return CAPTURE_DEVICE_ERR_BAD_PARAM;
         }
 
+        if (mMemoryType != CAPTURE_MEMORY_MMAP){
+            struct v4l2_requestbuffers req;
+
+            //the buffers are the caller's, only the driver lets them go
+            memset(&req, 0, sizeof (req));
+            req.count = 0;
+            req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            req.memory = V4L2_MEMORY_USERPTR;
+#ifdef VIDIOC_EXPBUF
+            if (mMemoryType == CAPTURE_MEMORY_DMABUF)
+                req.memory = V4L2_MEMORY_DMABUF;
+#endif
+            ioctl(mCameraDevice, VIDIOC_REQBUFS, &req);
+            for (unsigned int i = 0; i < mBufQueNum; i++) {
+                mCaptureBuffers[i].length = 0;
+                mDmaFd[i] = -1;
+            }
+            mMemoryType = CAPTURE_MEMORY_MMAP;
+            return CAPTURE_DEVICE_ERR_NONE;
+        }
+
         for (unsigned int i = 0; i < mBufQueNum; i++) {
-            if (mCaptureBuffers[i].length && (mCaptureBuffers[i].virt_start > 0)) {
+            if (mCaptureBuffers[i].length && (mCaptureBuffers[i].virt_start != NULL)) {
                 munmap(mCaptureBuffers[i].virt_start, mCaptureBuffers[i].length);
                 mCaptureBuffers[i].length = 0;
                 CAMERA_HAL_LOG_RUNTIME("munmap buffers 0x%x\n", (unsigned int)(mCaptureBuffers[i].virt_start));
@@ -22,6 +22,7 @@
 #include <linux/videodev2.h>
 
 #include "CaptureDeviceInterface.h"
+#include "Camera_devcache.h"
 
 #define CAMAERA_FILENAME_LENGTH     256
 #define MAX_CAPTURE_BUF_QUE_NUM     6
@@ -38,13 +39,17 @@ namespace android{
         virtual CAPTURE_DEVICE_ERR_RET EnumDevParam(DevParamType devParamType, void *retParam);
         virtual CAPTURE_DEVICE_ERR_RET DevSetConfig(struct capture_config_t *pCapcfg);
         virtual CAPTURE_DEVICE_ERR_RET DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum);
+        virtual CAPTURE_DEVICE_ERR_RET DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+                unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType);
         virtual CAPTURE_DEVICE_ERR_RET DevPrepare();
         virtual CAPTURE_DEVICE_ERR_RET DevStart();
         virtual CAPTURE_DEVICE_ERR_RET DevDequeue(unsigned int *pBufQueIdx);
         virtual CAPTURE_DEVICE_ERR_RET DevQueue( unsigned int BufQueIdx);
+        virtual CAPTURE_DEVICE_ERR_RET DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo);
         virtual CAPTURE_DEVICE_ERR_RET DevStop();
         virtual CAPTURE_DEVICE_ERR_RET DevDeAllocate();
         virtual CAPTURE_DEVICE_ERR_RET DevClose();
+        virtual void DevDump(String8 &result);
 
     protected:
 
@@ -56,6 +61,8 @@ namespace android{
         virtual CAPTURE_DEVICE_ERR_RET V4l2EnumSizeFps(void *retParam);
         virtual CAPTURE_DEVICE_ERR_RET V4l2SetConfig(struct capture_config_t *pCapcfg);
         virtual CAPTURE_DEVICE_ERR_RET V4l2AllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum);
+        virtual CAPTURE_DEVICE_ERR_RET V4l2ImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+                unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType);
         virtual CAPTURE_DEVICE_ERR_RET V4l2Prepare();
         virtual CAPTURE_DEVICE_ERR_RET V4l2Start();
         virtual CAPTURE_DEVICE_ERR_RET V4l2Dequeue(unsigned int *pBufQueIdx);
@@ -67,6 +74,12 @@ namespace android{
         virtual CAPTURE_DEVICE_ERR_RET V4l2GetCaptureMode(struct capture_config_t *pCapcfg, unsigned int *pMode); 
         virtual CAPTURE_DEVICE_ERR_RET V4l2SetRot(struct capture_config_t *pCapcfg);
 
+        bool V4l2OpenCachedNode();
+        void V4l2CacheNode(const char *name);
+        CAPTURE_DEVICE_ERR_RET V4l2EnumCachedFmt(void *retParam);
+        CAPTURE_DEVICE_ERR_RET V4l2EnumCachedSizeFps(void *retParam);
+        void V4l2FillBuffer(struct v4l2_buffer *buf, unsigned int index);
+
         char         mCaptureDeviceName[CAMAERA_FILENAME_LENGTH];
         char         mInitalDeviceName[CAMAERA_SENSOR_LENGTH];
         int          mCameraDevice;
@@ -75,9 +88,24 @@ namespace android{
         unsigned int mRequiredFmt;
         unsigned int mBufQueNum;
         int          mQueuedBufNum;
+        /* the buffer of every v4l2 index, the driver's or imported */
         DMA_BUFFER mCaptureBuffers[MAX_CAPTURE_BUF_QUE_NUM];
+        int          mDmaFd[MAX_CAPTURE_BUF_QUE_NUM];
+        CAPTURE_MEMORY_TYPE mMemoryType;
+        /* the driver takes the physical address of a USERPTR buffer in m.offset */
+        bool         mUserPtrPhys;
+        struct capture_frame_info_t mFrameInfo[MAX_CAPTURE_BUF_QUE_NUM];
         struct   capture_config_t mCapCfg;
 
+        /* what the opened device reported, served from CameraDeviceCache */
+        CAMERA_DEVICE_KEY mDeviceKey;
+        bool         mDeviceKeyValid;
+        unsigned int mCachedFmt[CAMERA_CACHE_MAX_FMT];
+        int          mCachedFmtNum;
+        unsigned int mCachedSizeFmt;
+        CAMERA_CACHE_SIZE_FPS mCachedSize[CAMERA_CACHE_MAX_SIZE];
+        int          mCachedSizeNum;
+
     };
 };
 
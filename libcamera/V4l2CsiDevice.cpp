@@ -42,6 +42,8 @@ namespace android{
         mSupportedFmt[0] = v4l2_fourcc('N','V','1','2');
         mSupportedFmt[1] = v4l2_fourcc('Y','U','1','2');
         mSupportedFmt[2] = v4l2_fourcc('Y','U','Y','V');
+        //the mxc capture driver DMAs to the physical address of a USERPTR buffer
+        mUserPtrPhys = true;
 
     }
     V4l2CsiDevice :: ~V4l2CsiDevice()
@@ -55,6 +57,7 @@ namespace android{
         const char *flags[] = {"uncompressed", "compressed"};
 
         char	dev_node[CAMAERA_FILENAME_LENGTH];
+        char    name[CAMAERA_SENSOR_LENGTH];
         DIR *v4l_dir = NULL;
         struct dirent *dir_entry;
         struct v4l2_dbg_chip_ident vid_chip;
@@ -69,9 +72,13 @@ namespace android{
             mCameraDevice = open(mCaptureDeviceName, O_RDWR, O_NONBLOCK);
             if (mCameraDevice < 0)
                 return CAPTURE_DEVICE_ERR_OPEN;
+            mDeviceKeyValid = CameraDeviceCache::queryKey(mCameraDevice, &mDeviceKey);
         }
+        else if (V4l2OpenCachedNode())
+            return ret;
         else{
             CAMERA_HAL_LOG_RUNTIME("deviceName is %s", mInitalDeviceName);
+            strcpy(name, mInitalDeviceName);
             v4l_dir = opendir("/sys/class/video4linux");
             if (v4l_dir){
                 while((dir_entry = readdir(v4l_dir))) {
@@ -104,6 +111,9 @@ namespace android{
                 CAMERA_HAL_ERR("The device name is not correct or the device is error");
                 return CAPTURE_DEVICE_ERR_OPEN;
             }
+            //the lookup name, not the sensor name it was resolved to
+            if (is_found)
+                V4l2CacheNode(name);
         }
         return ret; 
     }
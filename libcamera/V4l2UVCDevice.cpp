@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+
+#include "V4l2UVCDevice.h"
+
+namespace android{
+
+    V4l2UVCDevice :: V4l2UVCDevice()
+        : mEnumFmtNum(0),
+        mEnumFmtIdx(0),
+        mDecodedFmtFirst(0),
+        mHasMjpeg(false),
+        mDecodeFmt(0),
+        mDecodeWidth(0),
+        mDecodeHeight(0),
+        mDecodeFrameSize(0),
+        mDecodeAllocator(NULL),
+        mDecodeAllocated(0),
+        mDecoderNum(0),
+        mFreeNum(0),
+        mReadyHead(0),
+        mReadyNum(0),
+        mStreaming(false),
+        mFailed(false),
+        mNextReady(0),
+        mNextTicket(0),
+        mDecodedFrames(0),
+        mBrokenFrames(0),
+        mStreamStart(0),
+        mStreamStop(0)
+    {
+        memset(mDecodeBuffers, 0, sizeof(mDecodeBuffers));
+        memset(mDecodeInfo, 0, sizeof(mDecodeInfo));
+        memset(mPending, 0, sizeof(mPending));
+        for (int i = 0; i < UVC_MAX_DECODE_THREADS; i++)
+            mDecoders[i] = NULL;
+        mDecodeLatency.reset("decode");
+    }
+
+    V4l2UVCDevice :: ~V4l2UVCDevice()
+    {
+        StopDecoders();
+        FreeDecodeBuf();
+        for (int i = 0; i < UVC_MAX_DECODE_THREADS; i++)
+            delete mDecoders[i];
+    }
+
+    bool V4l2UVCDevice :: isDecodedFmt(unsigned int fmt)
+    {
+        if (!mHasMjpeg)
+            return false;
+        for (int i = mDecodedFmtFirst; i < mEnumFmtNum; i++) {
+            if (mEnumFmt[i] == fmt)
+                return true;
+        }
+        return false;
+    }
+
+    /*
+     * The camera's formats, with MJPEG replaced by the formats it is
+     * decoded to when the camera does not send those itself.
+     */
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: EnumDecodedFmt(unsigned int *pFmt)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        const unsigned int decoded[] = {V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_YUV420};
+        char value[PROPERTY_VALUE_MAX];
+        unsigned int fmt;
+        bool useMjpeg;
+        int i, j;
+
+        if (mEnumFmtIdx == 0){
+            property_get("rw.camera.uvc.mjpeg", value, "1");
+            useMjpeg = (atoi(value) != 0);
+            mEnumFmtNum = 0;
+            mHasMjpeg = false;
+            while (V4l2CapDeviceBase::EnumDevParam(OUTPU_FMT, &fmt) == CAPTURE_DEVICE_ERR_ENUM_CONTINUE){
+                if (useMjpeg && fmt == V4L2_PIX_FMT_MJPEG)
+                    mHasMjpeg = true;
+                else if (mEnumFmtNum < UVC_MAX_ENUM_FMT)
+                    mEnumFmt[mEnumFmtNum++] = fmt;
+            }
+            mDecodedFmtFirst = mEnumFmtNum;
+            for (i = 0; mHasMjpeg && i < (int)(sizeof(decoded)/sizeof(decoded[0])); i++){
+                for (j = 0; j < mDecodedFmtFirst; j++){
+                    if (mEnumFmt[j] == decoded[i])
+                        break;
+                }
+                if (j == mDecodedFmtFirst && mEnumFmtNum < UVC_MAX_ENUM_FMT)
+                    mEnumFmt[mEnumFmtNum++] = decoded[i];
+            }
+            if (mHasMjpeg)
+                CAMERA_HAL_LOG_INFO("The uvc camera has MJPEG, %d formats are decoded from it",
+                        mEnumFmtNum - mDecodedFmtFirst);
+        }
+
+        if (mEnumFmtIdx < mEnumFmtNum){
+            *pFmt = mEnumFmt[mEnumFmtIdx];
+            mEnumFmtIdx ++;
+            return CAPTURE_DEVICE_ERR_ENUM_CONTINUE;
+        }
+        mEnumFmtIdx = 0;
+        return CAPTURE_DEVICE_ERR_GET_PARAM;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: EnumDevParam(DevParamType devParamType, void *retParam)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        struct capture_config_t *pCapCfg = (struct capture_config_t *)retParam;
+        struct capture_config_t query;
+        CAPTURE_DEVICE_ERR_RET ret;
+
+        if (mCameraDevice <= 0)
+            return CAPTURE_DEVICE_ERR_OPEN;
+        if (retParam == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        if (devParamType == OUTPU_FMT)
+            return EnumDecodedFmt((unsigned int *)retParam);
+        if (devParamType != FRAME_SIZE_FPS || !isDecodedFmt(pCapCfg->fmt))
+            return V4l2CapDeviceBase::EnumDevParam(devParamType, retParam);
+
+        //a decoded format has the sizes and rates of the MJPEG stream
+        query = *pCapCfg;
+        query.fmt = V4L2_PIX_FMT_MJPEG;
+        ret = V4l2CapDeviceBase::EnumDevParam(FRAME_SIZE_FPS, &query);
+        pCapCfg->width = query.width;
+        pCapCfg->height = query.height;
+        pCapCfg->tv = query.tv;
+        return ret;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevSetConfig(struct capture_config_t *pCapcfg)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        struct capture_config_t mjpegCfg;
+        CAPTURE_DEVICE_ERR_RET ret;
+
+        if (mCameraDevice <= 0 || pCapcfg == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        if (!isDecodedFmt(pCapcfg->fmt)){
+            mDecodeFmt = 0;
+            return V4l2CapDeviceBase::DevSetConfig(pCapcfg);
+        }
+
+        mjpegCfg = *pCapcfg;
+        mjpegCfg.fmt = V4L2_PIX_FMT_MJPEG;
+        ret = V4l2CapDeviceBase::DevSetConfig(&mjpegCfg);
+        if (ret != CAPTURE_DEVICE_ERR_NONE)
+            return ret;
+
+        //the driver was given the size rounded down to 8
+        mDecodeFmt = pCapcfg->fmt;
+        mDecodeWidth = pCapcfg->width & 0xFFFFFFF8;
+        mDecodeHeight = pCapcfg->height & 0xFFFFFFF8;
+        mDecodeFrameSize = mDecodeWidth * mDecodeHeight * 3 / 2;
+        pCapcfg->framesize = mDecodeFrameSize;
+        pCapcfg->picture_waite_number = mjpegCfg.picture_waite_number;
+        CAMERA_HAL_LOG_INFO("Capture MJPEG %dx%d decoded to %c%c%c%c", mDecodeWidth, mDecodeHeight,
+                mDecodeFmt & 0xFF, (mDecodeFmt >> 8) & 0xFF, (mDecodeFmt >> 16) & 0xFF, (mDecodeFmt >> 24) & 0xFF);
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    /* the compressed frames always go to the driver's own buffers */
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: AllocateJpegBuf(unsigned int *pBufQueNum)
+    {
+        DMA_BUFFER jpegBuffers[MAX_CAPTURE_BUF_QUE_NUM];
+
+        if (*pBufQueNum > MAX_CAPTURE_BUF_QUE_NUM)
+            *pBufQueNum = MAX_CAPTURE_BUF_QUE_NUM;
+        return V4l2AllocateBuf(jpegBuffers, pBufQueNum);
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret;
+        unsigned int i;
+
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevAllocateBuf(DevBufQue, pBufQueNum);
+        if (mCameraDevice <= 0 || DevBufQue == NULL || pBufQueNum == NULL || *pBufQueNum == 0)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        if ((ret = AllocateJpegBuf(pBufQueNum)) != CAPTURE_DEVICE_ERR_NONE)
+            return ret;
+
+        //pmem, so that the post process and the encoders get a physical address
+        mDecodeAllocator = new PmemAllocator(mBufQueNum, mDecodeFrameSize);
+        if (mDecodeAllocator == NULL || mDecodeAllocator->err_ret < 0){
+            CAMERA_HAL_ERR("No memory for the decoded frames");
+            FreeDecodeBuf();
+            V4l2DeAlloc();
+            return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+        }
+        for (i = 0; i < mBufQueNum; i++){
+            if (mDecodeAllocator->allocate(&mDecodeBuffers[i], mDecodeFrameSize) < 0){
+                CAMERA_HAL_ERR("No memory for the decoded frame %d", i);
+                FreeDecodeBuf();
+                V4l2DeAlloc();
+                return CAPTURE_DEVICE_ERR_ALLOCATE_BUF;
+            }
+            mDecodeAllocated ++;
+            DevBufQue[i] = mDecodeBuffers[i];
+        }
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    /* the frames are decoded into the caller's buffers, the driver keeps its own */
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+            unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType)
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret;
+        unsigned int i;
+
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevImportBuf(DevBufQue, pDmaFd, pBufQueNum, memType);
+        if (memType == CAPTURE_MEMORY_MMAP)
+            return DevAllocateBuf(DevBufQue, pBufQueNum);
+        if (mCameraDevice <= 0 || DevBufQue == NULL || pBufQueNum == NULL || *pBufQueNum == 0)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        for (i = 0; i < *pBufQueNum && i < MAX_CAPTURE_BUF_QUE_NUM; i++){
+            if (DevBufQue[i].virt_start == NULL || DevBufQue[i].length < mDecodeFrameSize){
+                CAMERA_HAL_ERR("The buffer %d can not take a %d bytes decoded frame", i, mDecodeFrameSize);
+                return CAPTURE_DEVICE_ERR_BAD_PARAM;
+            }
+        }
+
+        if ((ret = AllocateJpegBuf(pBufQueNum)) != CAPTURE_DEVICE_ERR_NONE)
+            return ret;
+        for (i = 0; i < mBufQueNum; i++)
+            mDecodeBuffers[i] = DevBufQue[i];
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    void V4l2UVCDevice :: FreeDecodeBuf()
+    {
+        if (mDecodeAllocator != NULL){
+            for (unsigned int i = 0; i < mDecodeAllocated; i++)
+                mDecodeAllocator->deAllocate(&mDecodeBuffers[i]);
+        }
+        mDecodeAllocated = 0;
+        mDecodeAllocator = NULL;
+        memset(mDecodeBuffers, 0, sizeof(mDecodeBuffers));
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevPrepare()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret;
+
+        if ((ret = V4l2CapDeviceBase::DevPrepare()) != CAPTURE_DEVICE_ERR_NONE || mDecodeFmt == 0)
+            return ret;
+
+        //the HAL has queued all the output buffers
+        Mutex::Autolock lock(mLock);
+        for (unsigned int i = 0; i < mBufQueNum; i++){
+            mFree[i] = i;
+            mPending[i] = false;
+        }
+        mFreeNum = mBufQueNum;
+        mReadyHead = 0;
+        mReadyNum = 0;
+        mNextReady = 0;
+        mNextTicket = 0;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevStart()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        char value[PROPERTY_VALUE_MAX];
+        CAPTURE_DEVICE_ERR_RET ret;
+        int num;
+
+        if ((ret = V4l2CapDeviceBase::DevStart()) != CAPTURE_DEVICE_ERR_NONE || mDecodeFmt == 0)
+            return ret;
+
+        property_get("rw.camera.uvc.decoders", value, "0");
+        num = atoi(value);
+        if (num <= 0){
+            num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (num > UVC_DEFAULT_DECODE_THREADS)
+                num = UVC_DEFAULT_DECODE_THREADS;
+        }
+        //a worker holds an output buffer while it waits, leave one to the HAL
+        if (num > (int)mBufQueNum - 1)
+            num = (int)mBufQueNum - 1;
+        if (num > UVC_MAX_DECODE_THREADS)
+            num = UVC_MAX_DECODE_THREADS;
+        if (num < 1)
+            num = 1;
+
+        {
+            Mutex::Autolock lock(mLock);
+            mStreaming = true;
+            mFailed = false;
+        }
+        mDecodeLatency.reset("decode");
+        android_atomic_release_store(0, &mDecodedFrames);
+        android_atomic_release_store(0, &mBrokenFrames);
+        mStreamStart = systemTime();
+        mStreamStop = 0;
+
+        for (mDecoderNum = 0; mDecoderNum < num; mDecoderNum++){
+            if (mDecoders[mDecoderNum] == NULL)
+                mDecoders[mDecoderNum] = new CameraMjpegDecoder();
+            if (mDecoders[mDecoderNum] == NULL)
+                break;
+            mDecodeThreads[mDecoderNum] = new DecodeThread(this, mDecoderNum);
+            if (mDecodeThreads[mDecoderNum]->run("CameraUvcDecode", PRIORITY_URGENT_DISPLAY) != NO_ERROR){
+                CAMERA_HAL_ERR("Fail to start the mjpeg decoder %d", mDecoderNum);
+                mDecodeThreads[mDecoderNum].clear();
+                break;
+            }
+        }
+        if (mDecoderNum == 0){
+            StopDecoders();
+            return CAPTURE_DEVICE_ERR_SYS_CALL;
+        }
+        CAMERA_HAL_LOG_INFO("%d mjpeg decoders started", mDecoderNum);
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    /*
+     * The frames come out of the driver one at a time, so a worker that
+     * has one does not hold the others back. Returns 0 with a frame, 1
+     * when there was none for a while, -1 when the stream is gone.
+     */
+    int V4l2UVCDevice :: takeFrame(unsigned int *pJpegIdx, unsigned int *pBytes, struct capture_frame_info_t *pInfo)
+    {
+        struct pollfd pfd;
+        struct v4l2_buffer buf;
+        int ret;
+
+        pfd.fd = mCameraDevice;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ret = poll(&pfd, 1, UVC_POLL_TIMEOUT_MS);
+        if (ret == 0 || (ret < 0 && errno == EINTR))
+            return 1;
+        if (ret < 0)
+            return -1;
+
+        V4l2FillBuffer(&buf, 0);
+        if (ioctl(mCameraDevice, VIDIOC_DQBUF, &buf) < 0)
+            return (errno == EAGAIN || errno == EINTR) ? 1 : -1;
+        if (buf.index >= mBufQueNum)
+            return -1;
+        android_atomic_dec(&mQueuedBufNum);
+
+        *pJpegIdx = buf.index;
+        *pBytes = (buf.bytesused > 0 && buf.bytesused <= mCaptureBuffers[buf.index].length) ?
+            buf.bytesused : mCaptureBuffers[buf.index].length;
+        pInfo->sequence = buf.sequence;
+        pInfo->timestamp = (nsecs_t)buf.timestamp.tv_sec * 1000000000LL +
+            (nsecs_t)buf.timestamp.tv_usec * 1000;
+        return 0;
+    }
+
+    bool V4l2UVCDevice :: decodeLoop(int id)
+    {
+        struct capture_frame_info_t info;
+        struct v4l2_buffer buf;
+        unsigned int outIdx, jpegIdx = 0, bytes = 0, ticket = 0;
+        nsecs_t start;
+        bool decoded;
+        int ret;
+
+        {
+            Mutex::Autolock lock(mLock);
+            while (mStreaming && mFreeNum == 0)
+                mFreeCond.wait(mLock);
+            if (!mStreaming)
+                return false;
+            mFreeNum --;
+            outIdx = mFree[mFreeNum];
+        }
+
+        {
+            Mutex::Autolock lock(mDequeueLock);
+            ret = takeFrame(&jpegIdx, &bytes, &info);
+            if (ret == 0)
+                ticket = mNextTicket ++;
+        }
+        if (ret != 0){
+            Mutex::Autolock lock(mLock);
+            mFree[mFreeNum++] = outIdx;
+            mFreeCond.signal();
+            if (ret < 0 && mStreaming){
+                CAMERA_HAL_ERR("The uvc camera stopped sending frames");
+                mFailed = true;
+                mReadyCond.broadcast();
+                return false;
+            }
+            return mStreaming;
+        }
+
+        start = systemTime();
+        decoded = mDecoders[id]->decode(mCaptureBuffers[jpegIdx].virt_start, bytes,
+                mDecodeBuffers[outIdx].virt_start, mDecodeFmt, mDecodeWidth, mDecodeHeight);
+        if (decoded){
+            mDecodeLatency.record(systemTime() - start);
+            android_atomic_inc(&mDecodedFrames);
+        }else
+            android_atomic_inc(&mBrokenFrames);
+
+        //the compressed frame goes back to the camera before it is handed out
+        V4l2FillBuffer(&buf, jpegIdx);
+        if (ioctl(mCameraDevice, VIDIOC_QBUF, &buf) < 0)
+            CAMERA_HAL_ERR("Fail to give the mjpeg buffer %d back, %s", jpegIdx, strerror(errno));
+        else
+            android_atomic_inc(&mQueuedBufNum);
+
+        finishFrame(outIdx, ticket, decoded, &info);
+        return true;
+    }
+
+    void V4l2UVCDevice :: finishFrame(unsigned int outIdx, unsigned int ticket, bool decoded,
+            const struct capture_frame_info_t *pInfo)
+    {
+        Mutex::Autolock lock(mLock);
+        unsigned int i = 0;
+
+        mPending[outIdx] = true;
+        mBroken[outIdx] = !decoded;
+        mPendingTicket[outIdx] = ticket;
+        mDecodeInfo[outIdx] = *pInfo;
+
+        //hand out what is next in the camera's order, a broken frame is skipped
+        while (i < mBufQueNum){
+            if (!mPending[i] || mPendingTicket[i] != mNextReady){
+                i ++;
+                continue;
+            }
+            mPending[i] = false;
+            mNextReady ++;
+            if (mBroken[i]){
+                mFree[mFreeNum++] = i;
+                mFreeCond.signal();
+            }else{
+                mReady[(mReadyHead + mReadyNum) % MAX_CAPTURE_BUF_QUE_NUM] = i;
+                mReadyNum ++;
+                mReadyCond.signal();
+            }
+            i = 0;
+        }
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevDequeue(unsigned int *pBufQueIdx)
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevDequeue(pBufQueIdx);
+        if (pBufQueIdx == NULL)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        Mutex::Autolock lock(mLock);
+        while (mStreaming && !mFailed && mReadyNum == 0){
+            if (mReadyCond.waitRelative(mLock, UVC_DEQUEUE_TIMEOUT) != NO_ERROR){
+                CAMERA_HAL_ERR("No frame was decoded from the uvc camera");
+                return CAPTURE_DEVICE_ERR_SYS_CALL;
+            }
+        }
+        if (mReadyNum == 0)
+            return CAPTURE_DEVICE_ERR_SYS_CALL;
+        *pBufQueIdx = mReady[mReadyHead];
+        mReadyHead = (mReadyHead + 1) % MAX_CAPTURE_BUF_QUE_NUM;
+        mReadyNum --;
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevQueue(unsigned int BufQueIdx)
+    {
+        CAMERA_HAL_LOG_FUNC;
+
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevQueue(BufQueIdx);
+
+        Mutex::Autolock lock(mLock);
+        if (BufQueIdx >= mBufQueNum || mFreeNum >= mBufQueNum)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+        mFree[mFreeNum++] = BufQueIdx;
+        mFreeCond.signal();
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo)
+    {
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevGetFrameInfo(BufQueIdx, pInfo);
+        if (pInfo == NULL || BufQueIdx >= mBufQueNum)
+            return CAPTURE_DEVICE_ERR_BAD_PARAM;
+
+        Mutex::Autolock lock(mLock);
+        *pInfo = mDecodeInfo[BufQueIdx];
+        return CAPTURE_DEVICE_ERR_NONE;
+    }
+
+    void V4l2UVCDevice :: StopDecoders()
+    {
+        {
+            Mutex::Autolock lock(mLock);
+            mStreaming = false;
+            mFreeCond.broadcast();
+            mReadyCond.broadcast();
+        }
+        for (int i = 0; i < mDecoderNum; i++){
+            if (mDecodeThreads[i] != 0){
+                mDecodeThreads[i]->requestExitAndWait();
+                mDecodeThreads[i].clear();
+            }
+        }
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevStop()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret;
+
+        if (mDecodeFmt == 0)
+            return V4l2CapDeviceBase::DevStop();
+
+        //the stream off wakes up the worker waiting for the driver
+        {
+            Mutex::Autolock lock(mLock);
+            mStreaming = false;
+        }
+        ret = V4l2CapDeviceBase::DevStop();
+        StopDecoders();
+        if (mStreamStart != 0 && mStreamStop == 0)
+            mStreamStop = systemTime();
+        return ret;
+    }
+
+    CAPTURE_DEVICE_ERR_RET V4l2UVCDevice :: DevDeAllocate()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        CAPTURE_DEVICE_ERR_RET ret;
+
+        ret = V4l2CapDeviceBase::DevDeAllocate();
+        FreeDecodeBuf();
+        return ret;
+    }
+
+    void V4l2UVCDevice :: DevDump(String8 &result)
+    {
+        const size_t SIZE = 256;
+        char buffer[SIZE];
+        unsigned int frames = android_atomic_acquire_load(&mDecodedFrames);
+        nsecs_t elapsed;
+
+        if (mDecodeFmt == 0 || mStreamStart == 0)
+            return;
+        elapsed = (mStreamStop != 0 ? mStreamStop : systemTime()) - mStreamStart;
+        snprintf(buffer, SIZE, "  uvc mjpeg %ux%u to %c%c%c%c, %d decoders, frames %u broken %d, %lld.%02lld fps\n",
+                mDecodeWidth, mDecodeHeight,
+                mDecodeFmt & 0xFF, (mDecodeFmt >> 8) & 0xFF, (mDecodeFmt >> 16) & 0xFF, (mDecodeFmt >> 24) & 0xFF,
+                mDecoderNum, frames, android_atomic_acquire_load(&mBrokenFrames),
+                elapsed > 0 ? (nsecs_t)frames * 1000000000LL / elapsed : 0LL,
+                elapsed > 0 ? ((nsecs_t)frames * 100000000000LL / elapsed) % 100 : 0LL);
+        result.append(buffer);
+        if (mDecodeLatency.getCount() > 0){
+            snprintf(buffer, SIZE, "  latency %-12s frames %u p50 %u p90 %u p99 %u max %u us\n",
+                    mDecodeLatency.getName(), mDecodeLatency.getCount(), mDecodeLatency.getPercentile(50),
+                    mDecodeLatency.getPercentile(90), mDecodeLatency.getPercentile(99), mDecodeLatency.getMax());
+            result.append(buffer);
+        }
+    }
+
+};
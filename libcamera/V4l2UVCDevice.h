@@ -21,19 +21,128 @@
 #define V4L2_UVC_DEVICE_H
 
 #include <linux/videodev2.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
 
 
 #include "V4l2CapDeviceBase.h"
+#include "Camera_pmem.h"
+#include "Camera_stage.h"
+#include "Camera_mjpeg.h"
 
 #define MAX_DEV_NAME_LENGTH 10
+#define UVC_MAX_DECODE_THREADS      4
+#define UVC_DEFAULT_DECODE_THREADS  2
+#define UVC_MAX_ENUM_FMT            16
+/* how long a worker waits for a frame before it looks for a stop */
+#define UVC_POLL_TIMEOUT_MS         100
+#define UVC_DEQUEUE_TIMEOUT         2000000000LL
 
 namespace android{
 
+    /*
+     * A UVC webcam. Above VGA the usb bandwidth only leaves a few fps of
+     * YUYV, so when the camera has MJPEG (and rw.camera.uvc.mjpeg is not
+     * 0) it is offered to the HAL as NV12, NV21 and YU12 frames of the
+     * MJPEG sizes. The compressed frames stay in the driver's buffers and
+     * a few worker threads (rw.camera.uvc.decoders) decode them into the
+     * buffers the HAL sees, which are pmem or the HAL's own ones, in the
+     * order the camera sent them. A worker takes a free output buffer
+     * before it takes a frame, so when the HAL holds on to its buffers the
+     * driver drops frames as it would without the decoders.
+     */
     class V4l2UVCDevice : public V4l2CapDeviceBase{
     public:
-        V4l2UVCDevice(){}
-        ~V4l2UVCDevice(){}
+        V4l2UVCDevice();
+        ~V4l2UVCDevice();
 
+        virtual CAPTURE_DEVICE_ERR_RET EnumDevParam(DevParamType devParamType, void *retParam);
+        virtual CAPTURE_DEVICE_ERR_RET DevSetConfig(struct capture_config_t *pCapcfg);
+        virtual CAPTURE_DEVICE_ERR_RET DevAllocateBuf(DMA_BUFFER *DevBufQue, unsigned int *pBufQueNum);
+        virtual CAPTURE_DEVICE_ERR_RET DevImportBuf(DMA_BUFFER *DevBufQue, const int *pDmaFd,
+                unsigned int *pBufQueNum, CAPTURE_MEMORY_TYPE memType);
+        virtual CAPTURE_DEVICE_ERR_RET DevPrepare();
+        virtual CAPTURE_DEVICE_ERR_RET DevStart();
+        virtual CAPTURE_DEVICE_ERR_RET DevDequeue(unsigned int *pBufQueIdx);
+        virtual CAPTURE_DEVICE_ERR_RET DevQueue(unsigned int BufQueIdx);
+        virtual CAPTURE_DEVICE_ERR_RET DevGetFrameInfo(unsigned int BufQueIdx, struct capture_frame_info_t *pInfo);
+        virtual CAPTURE_DEVICE_ERR_RET DevStop();
+        virtual CAPTURE_DEVICE_ERR_RET DevDeAllocate();
+        virtual void DevDump(String8 &result);
+
+    private:
+        class DecodeThread : public Thread {
+            V4l2UVCDevice* mDevice;
+            int mId;
+        public:
+            DecodeThread(V4l2UVCDevice* device, int id)
+                : Thread(false), mDevice(device), mId(id) { }
+
+            virtual bool threadLoop() {
+                return mDevice->decodeLoop(mId);
+            }
+        };
+
+        bool isDecodedFmt(unsigned int fmt);
+        CAPTURE_DEVICE_ERR_RET EnumDecodedFmt(unsigned int *pFmt);
+        CAPTURE_DEVICE_ERR_RET AllocateJpegBuf(unsigned int *pBufQueNum);
+        void FreeDecodeBuf();
+        void StopDecoders();
+        bool decodeLoop(int id);
+        int takeFrame(unsigned int *pJpegIdx, unsigned int *pBytes, struct capture_frame_info_t *pInfo);
+        void finishFrame(unsigned int outIdx, unsigned int ticket, bool decoded,
+                const struct capture_frame_info_t *pInfo);
+
+        /* the formats the HAL is told about, MJPEG replaced by the decoded ones */
+        unsigned int mEnumFmt[UVC_MAX_ENUM_FMT];
+        int          mEnumFmtNum;
+        int          mEnumFmtIdx;
+        int          mDecodedFmtFirst;
+        bool         mHasMjpeg;
+
+        /* 0 when the camera sends the format the HAL asked for */
+        unsigned int mDecodeFmt;
+        unsigned int mDecodeWidth;
+        unsigned int mDecodeHeight;
+        unsigned int mDecodeFrameSize;
+        DMA_BUFFER   mDecodeBuffers[MAX_CAPTURE_BUF_QUE_NUM];
+        struct capture_frame_info_t mDecodeInfo[MAX_CAPTURE_BUF_QUE_NUM];
+        sp<PmemAllocator> mDecodeAllocator;
+        unsigned int mDecodeAllocated;
+
+        int          mDecoderNum;
+        sp<DecodeThread> mDecodeThreads[UVC_MAX_DECODE_THREADS];
+        CameraMjpegDecoder *mDecoders[UVC_MAX_DECODE_THREADS];
+
+        /* the output buffers the HAL queued, and the decoded ones in order */
+        Mutex        mLock;
+        Condition    mFreeCond;
+        Condition    mReadyCond;
+        unsigned int mFree[MAX_CAPTURE_BUF_QUE_NUM];
+        unsigned int mFreeNum;
+        unsigned int mReady[MAX_CAPTURE_BUF_QUE_NUM];
+        unsigned int mReadyHead;
+        unsigned int mReadyNum;
+        bool         mStreaming;
+        bool         mFailed;
+        /*
+         * Every frame taken from the driver gets a ticket. A finished frame
+         * waits in its output buffer until the ones before it are done.
+         */
+        unsigned int mNextReady;
+        bool         mPending[MAX_CAPTURE_BUF_QUE_NUM];
+        bool         mBroken[MAX_CAPTURE_BUF_QUE_NUM];
+        unsigned int mPendingTicket[MAX_CAPTURE_BUF_QUE_NUM];
+
+        /* one worker at a time waits for the driver, mNextTicket is under it */
+        Mutex        mDequeueLock;
+        unsigned int mNextTicket;
+
+        CameraLatencyHistogram mDecodeLatency;
+        volatile int32_t mDecodedFrames;
+        volatile int32_t mBrokenFrames;
+        nsecs_t      mStreamStart;
+        nsecs_t      mStreamStop;
     };
 
 };
@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Drives the camera HAL on the host with the replay capture device and
+ * reports what a throughput regression would show: the callback rates
+ * and their jitter, the picture latencies, the CPU time of every phase
+ * and the per-stage latency percentiles of CameraHal::dump(). See
+ * Makefile for how to build and run it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <cutils/properties.h>
+#include <camera/CameraHardwareInterface.h>
+
+#define BENCH_PICTURE_TIMEOUT   10000000000LL
+
+namespace android {
+
+    /* arrival times of one callback stream */
+    class BenchStream
+    {
+    public:
+        BenchStream(const char *name) : mName(name) { }
+
+        void reset()
+        {
+            Mutex::Autolock lock(mLock);
+            mArrivals.clear();
+        }
+
+        void record(nsecs_t now)
+        {
+            Mutex::Autolock lock(mLock);
+            mArrivals.push_back(now);
+        }
+
+        void report(nsecs_t wall);
+
+    private:
+        const char             *mName;
+        Mutex                   mLock;
+        std::vector<nsecs_t>    mArrivals;
+    };
+
+    typedef struct {
+        Mutex lock;
+        Condition cond;
+        nsecs_t takeTime;
+        nsecs_t shutterTime;
+        nsecs_t jpegTime;
+        size_t jpegSize;
+        sp<IMemory> jpeg;
+        bool done;
+    }BENCH_PICTURE;
+
+    typedef struct {
+        BenchStream *preview;
+        BenchStream *video;
+        BENCH_PICTURE picture;
+        sp<CameraHardwareInterface> hardware;
+    }BENCH_CONTEXT;
+
+    static nsecs_t percentile(std::vector<nsecs_t> &values, int percent)
+    {
+        size_t index;
+
+        if (values.empty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        index = (values.size() * percent + 99) / 100;
+        return values[index > 0 ? index - 1 : 0];
+    }
+
+    void BenchStream :: report(nsecs_t wall)
+    {
+        Mutex::Autolock lock(mLock);
+        std::vector<nsecs_t> intervals;
+        double fps = 0;
+
+        for (size_t i = 1; i < mArrivals.size(); i++)
+            intervals.push_back(mArrivals[i] - mArrivals[i - 1]);
+        if (mArrivals.size() > 1)
+            fps = (mArrivals.size() - 1) * 1e9 / (mArrivals.back() - mArrivals.front());
+        printf("  %-8s frames %u in %lld ms, %.2f fps, interval p50 %lld p90 %lld p99 %lld max %lld us\n",
+                mName, (unsigned int)mArrivals.size(), (long long)ns2ms(wall), fps,
+                (long long)ns2us(percentile(intervals, 50)), (long long)ns2us(percentile(intervals, 90)),
+                (long long)ns2us(percentile(intervals, 99)), (long long)ns2us(percentile(intervals, 100)));
+    }
+
+    static void notifyCallback(int32_t msgType, int32_t ext1, int32_t ext2, void *user)
+    {
+        BENCH_CONTEXT *context = (BENCH_CONTEXT *)user;
+
+        if (msgType == CAMERA_MSG_SHUTTER) {
+            Mutex::Autolock lock(context->picture.lock);
+            if (context->picture.shutterTime == 0)
+                context->picture.shutterTime = systemTime();
+        }
+    }
+
+    static void dataCallback(int32_t msgType, const sp<IMemory> &dataPtr, void *user)
+    {
+        BENCH_CONTEXT *context = (BENCH_CONTEXT *)user;
+
+        if (msgType == CAMERA_MSG_PREVIEW_FRAME) {
+            context->preview->record(systemTime());
+        } else if (msgType == CAMERA_MSG_COMPRESSED_IMAGE) {
+            Mutex::Autolock lock(context->picture.lock);
+            context->picture.jpegTime = systemTime();
+            context->picture.jpegSize = dataPtr != 0 ? dataPtr->size() : 0;
+            context->picture.jpeg = dataPtr;
+            context->picture.done = true;
+            context->picture.cond.broadcast();
+        }
+    }
+
+    static void dataCallbackTimestamp(nsecs_t timestamp, int32_t msgType,
+            const sp<IMemory> &dataPtr, void *user)
+    {
+        BENCH_CONTEXT *context = (BENCH_CONTEXT *)user;
+
+        if (msgType != CAMERA_MSG_VIDEO_FRAME)
+            return;
+        context->video->record(systemTime());
+        //the recorder gives the buffer back right away, the bench measures the HAL only
+        context->hardware->releaseRecordingFrame(dataPtr);
+    }
+
+    static nsecs_t cpuTime()
+    {
+        struct rusage usage;
+
+        getrusage(RUSAGE_SELF, &usage);
+        return s2ns(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+            us2ns(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+    }
+
+    static void reportCpu(nsecs_t wall, nsecs_t cpu)
+    {
+        printf("  cpu      %lld ms, %.1f%% of one core\n", (long long)ns2ms(cpu),
+                wall > 0 ? cpu * 100.0 / wall : 0);
+    }
+
+    static void dumpHal(BENCH_CONTEXT *context, bool verbose)
+    {
+        Vector<String16> args;
+
+        if (!verbose)
+            return;
+        fflush(stdout);
+        context->hardware->dump(STDOUT_FILENO, args);
+    }
+
+    static int runStreams(BENCH_CONTEXT *context, const char *name, int seconds,
+            bool record, bool verbose)
+    {
+        nsecs_t wall, cpu;
+
+        printf("%s:\n", name);
+        context->preview->reset();
+        context->video->reset();
+        if (!context->hardware->previewEnabled() && context->hardware->startPreview() != NO_ERROR) {
+            fprintf(stderr, "startPreview failed\n");
+            return -1;
+        }
+        if (record && context->hardware->startRecording() != NO_ERROR) {
+            fprintf(stderr, "startRecording failed\n");
+            return -1;
+        }
+
+        wall = systemTime();
+        cpu = cpuTime();
+        sleep(seconds);
+        wall = systemTime() - wall;
+        cpu = cpuTime() - cpu;
+
+        if (record)
+            context->hardware->stopRecording();
+        context->preview->report(wall);
+        if (record)
+            context->video->report(wall);
+        reportCpu(wall, cpu);
+        dumpHal(context, verbose);
+        return 0;
+    }
+
+    static int runPictures(BENCH_CONTEXT *context, int count, const char *output, bool verbose)
+    {
+        BENCH_PICTURE *picture = &context->picture;
+        std::vector<nsecs_t> shutter, jpeg;
+        nsecs_t wall, cpu;
+        size_t bytes = 0;
+        int taken = 0;
+
+        printf("picture:\n");
+        wall = systemTime();
+        cpu = cpuTime();
+        for (int i = 0; i < count; i++) {
+            //takePicture leaves the preview stopped, as a camera app would start it again
+            if (!context->hardware->previewEnabled() && context->hardware->startPreview() != NO_ERROR) {
+                fprintf(stderr, "startPreview failed\n");
+                break;
+            }
+
+            picture->lock.lock();
+            picture->shutterTime = 0;
+            picture->jpegTime = 0;
+            picture->jpeg.clear();
+            picture->done = false;
+            picture->takeTime = systemTime();
+            picture->lock.unlock();
+
+            if (context->hardware->takePicture() != NO_ERROR) {
+                fprintf(stderr, "takePicture failed\n");
+                break;
+            }
+
+            picture->lock.lock();
+            while (!picture->done) {
+                if (picture->cond.waitRelative(picture->lock, BENCH_PICTURE_TIMEOUT) == TIMED_OUT)
+                    break;
+            }
+            if (picture->done) {
+                if (picture->shutterTime != 0)
+                    shutter.push_back(picture->shutterTime - picture->takeTime);
+                jpeg.push_back(picture->jpegTime - picture->takeTime);
+                bytes += picture->jpegSize;
+                taken++;
+            }
+            picture->lock.unlock();
+            if (!picture->done) {
+                fprintf(stderr, "no picture after %lld ms\n", (long long)ns2ms(BENCH_PICTURE_TIMEOUT));
+                break;
+            }
+        }
+        wall = systemTime() - wall;
+        cpu = cpuTime() - cpu;
+
+        printf("  pictures %d of %d, %u bytes each\n", taken, count,
+                taken > 0 ? (unsigned int)(bytes / taken) : 0);
+        printf("  shutter  p50 %lld p90 %lld max %lld ms after takePicture\n",
+                (long long)ns2ms(percentile(shutter, 50)), (long long)ns2ms(percentile(shutter, 90)),
+                (long long)ns2ms(percentile(shutter, 100)));
+        printf("  jpeg     p50 %lld p90 %lld max %lld ms after takePicture\n",
+                (long long)ns2ms(percentile(jpeg, 50)), (long long)ns2ms(percentile(jpeg, 90)),
+                (long long)ns2ms(percentile(jpeg, 100)));
+        reportCpu(wall, cpu);
+        dumpHal(context, verbose);
+
+        if (output != NULL && picture->jpeg != 0) {
+            FILE *file = fopen(output, "wb");
+            if (file == NULL || fwrite(picture->jpeg->pointer(), 1, picture->jpegSize, file) != picture->jpegSize)
+                fprintf(stderr, "Can not write %s\n", output);
+            if (file != NULL)
+                fclose(file);
+        }
+        picture->jpeg.clear();
+        return taken == count ? 0 : -1;
+    }
+
+    static void usage(const char *name)
+    {
+        fprintf(stderr,
+                "usage: %s [options]\n"
+                "  -t seconds   length of the preview and the record phase (5)\n"
+                "  -s WxH       preview size (the HAL default)\n"
+                "  -S WxH       picture size (the preview size)\n"
+                "  -f fps       replay frame rate (30)\n"
+                "  -n count     pictures to take (3)\n"
+                "  -i file      replay a raw or mjpeg file instead of color bars\n"
+                "  -F fourcc    format of the raw file (NV12)\n"
+                "  -z WxH       size of the raw file frames (640x480)\n"
+                "  -p phases    any of preview,record,picture (all)\n"
+                "  -o file      write the last picture there\n"
+                "  -d           print the HAL dump after every phase\n"
+                "Any other rw.camera.* property is read from the environment with\n"
+                "the dots as underscores, e.g. rw_camera_mem_backend=memfd.\n", name);
+    }
+
+};
+
+using namespace android;
+
+int main(int argc, char **argv)
+{
+    BenchStream preview("preview"), video("video");
+    BENCH_CONTEXT context;
+    CameraParameters params;
+    const char *previewSize = NULL;
+    const char *pictureSize = NULL;
+    const char *phases = "preview,record,picture";
+    const char *output = NULL;
+    const char *supported;
+    char size[32];
+    int width, height;
+    int seconds = 5;
+    int pictures = 3;
+    bool verbose = false;
+    int ret = 0;
+    int opt;
+
+    property_set("back_camera_name", "replay");
+    property_set("front_camera_name", "#");
+    //the fsl encoder library is arm only
+    property_set("rw.camera.jpeg.encoder", "libjpeg");
+
+    while ((opt = getopt(argc, argv, "t:s:S:f:n:i:F:z:p:o:dh")) != -1) {
+        switch (opt) {
+            case 't': seconds = atoi(optarg); break;
+            case 's': previewSize = optarg; break;
+            case 'S': pictureSize = optarg; break;
+            case 'f': property_set("rw.camera.replay.fps", optarg); break;
+            case 'n': pictures = atoi(optarg); break;
+            case 'i': property_set("rw.camera.replay.file", optarg); break;
+            case 'F': property_set("rw.camera.replay.fmt", optarg); break;
+            case 'z': property_set("rw.camera.replay.size", optarg); break;
+            case 'p': phases = optarg; break;
+            case 'o': output = optarg; break;
+            case 'd': verbose = true; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    context.preview = &preview;
+    context.video = &video;
+    context.picture.shutterTime = 0;
+    context.picture.jpegTime = 0;
+    context.picture.jpegSize = 0;
+    context.picture.done = false;
+
+    if (HAL_getNumberOfCameras() == 0 || (context.hardware = HAL_openCameraHardware(0)) == 0) {
+        fprintf(stderr, "Can not open the replay camera\n");
+        return 1;
+    }
+    context.hardware->setCallbacks(notifyCallback, dataCallback, dataCallbackTimestamp, &context);
+    context.hardware->enableMsgType(CAMERA_MSG_PREVIEW_FRAME | CAMERA_MSG_VIDEO_FRAME |
+            CAMERA_MSG_SHUTTER | CAMERA_MSG_COMPRESSED_IMAGE);
+
+    params = context.hardware->getParameters();
+    supported = params.get(CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES);
+    params.getPreviewSize(&width, &height);
+    snprintf(size, sizeof(size), "%dx%d", width, height);
+    //the HAL default may not be a size the replay file has
+    if (previewSize == NULL && supported != NULL && strstr(supported, size) == NULL)
+        previewSize = supported;
+    if (previewSize != NULL && sscanf(previewSize, "%dx%d", &width, &height) == 2)
+        params.setPreviewSize(width, height);
+    if (pictureSize == NULL)
+        params.getPreviewSize(&width, &height);
+    else if (sscanf(pictureSize, "%dx%d", &width, &height) != 2)
+        width = height = -1;
+    if (width > 0 && height > 0)
+        params.setPictureSize(width, height);
+    if (context.hardware->setParameters(params) != NO_ERROR) {
+        fprintf(stderr, "The HAL refused preview %s picture %s\n", params.get(CameraParameters::KEY_PREVIEW_SIZE),
+                params.get(CameraParameters::KEY_PICTURE_SIZE));
+        context.hardware->release();
+        return 1;
+    }
+    params = context.hardware->getParameters();
+    printf("replay camera, preview %s, picture %s\n", params.get(CameraParameters::KEY_PREVIEW_SIZE),
+            params.get(CameraParameters::KEY_PICTURE_SIZE));
+
+    if (ret == 0 && strstr(phases, "preview"))
+        ret = runStreams(&context, "preview", seconds, false, verbose);
+    if (ret == 0 && strstr(phases, "record"))
+        ret = runStreams(&context, "record", seconds, true, verbose);
+    if (ret == 0 && strstr(phases, "picture"))
+        ret = runPictures(&context, pictures, output, verbose);
+
+    context.hardware->stopPreview();
+    context.hardware->release();
+    context.hardware.clear();
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Checks that every Camera_convert kernel set gives the same bytes as the
+ * scalar one, on row lengths that leave every possible vector tail and on
+ * frames whose chroma is an odd number of samples wide and high, then
+ * reports the throughput of the kernels the host runs:
+ *
+ *   make -C libcamera/hosttest test
+ *   out/convert_test -s 1920x1080 -t 500
+ *
+ * The NEON kernels are built against include/arm_neon.h, which emulates
+ * the intrinsics lane by lane, so they are only checked, not timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include "Camera_convert.h"
+
+using namespace android;
+
+#define GUARD_BYTES 64
+
+static int sFailures;
+static int sChecks;
+static unsigned int sSeed = 1;
+
+static void fillRandom(uint8_t *p, int size)
+{
+    for (int i = 0; i < size; i++) {
+        sSeed = sSeed * 1103515245 + 12345;
+        p[i] = sSeed >> 16;
+    }
+}
+
+static bool compare(const CONVERT_KERNELS *k, const char *what, int width, int height,
+        const uint8_t *expect, const uint8_t *got, int size)
+{
+    sChecks ++;
+    for (int i = 0; i < size; i++) {
+        if (expect[i] != got[i]) {
+            printf("FAIL %s %s %dx%d: byte %d of %d is 0x%02x, scalar gives 0x%02x\n",
+                    k->name, what, width, height, i, size, got[i], expect[i]);
+            sFailures ++;
+            return false;
+        }
+    }
+    return true;
+}
+
+//the outputs are compared with their guard bytes, so a kernel writing past the end fails
+static uint8_t *allocOut(int size)
+{
+    uint8_t *p = (uint8_t *)malloc(size + GUARD_BYTES);
+    memset(p, 0xA5, size + GUARD_BYTES);
+    return p;
+}
+
+static void checkRows(const CONVERT_KERNELS *k)
+{
+    const CONVERT_KERNELS *ref = getScalarConvertKernels();
+    const int maxN = 100;
+    static const int fracs[] = {0, 1, 77, 128, 255};
+    //one byte in, so no load or store is aligned
+    uint8_t *in0 = (uint8_t *)malloc(8 * maxN + 1) + 1;
+    uint8_t *in1 = (uint8_t *)malloc(8 * maxN + 1) + 1;
+    uint8_t *a[3], *b[3];
+    int n, i, j;
+
+    fillRandom(in0, 8 * maxN);
+    fillRandom(in1, 8 * maxN);
+    for (i = 0; i < 3; i++) {
+        a[i] = allocOut(8 * maxN);
+        b[i] = allocOut(8 * maxN);
+    }
+
+    for (n = 1; n <= maxN; n++) {
+        int size = 8 * maxN + GUARD_BYTES;
+
+        ref->swapUV(in0, a[0], n);
+        k->swapUV(in0, b[0], n);
+        compare(k, "swapUV", n, 1, a[0], b[0], size);
+
+        ref->splitUV(in0, a[0], a[1], n);
+        k->splitUV(in0, b[0], b[1], n);
+        compare(k, "splitUV", n, 1, a[0], b[0], size);
+        compare(k, "splitUV", n, 1, a[1], b[1], size);
+
+        ref->mergeUV(in0, in1, a[0], n);
+        k->mergeUV(in0, in1, b[0], n);
+        compare(k, "mergeUV", n, 1, a[0], b[0], size);
+
+        //the sums wrap like the 16 bit vector adds
+        memcpy(a[0], in1, 2 * n);
+        memcpy(b[0], in1, 2 * n);
+        ref->addRow(in0, (uint16_t *)a[0], n);
+        k->addRow(in0, (uint16_t *)b[0], n);
+        compare(k, "addRow", n, 1, a[0], b[0], size);
+
+        for (j = 0; j < (int)(sizeof(fracs) / sizeof(fracs[0])); j++) {
+            ref->blendRows(in0, in1, a[0], n, fracs[j]);
+            k->blendRows(in0, in1, b[0], n, fracs[j]);
+            compare(k, "blendRows", n, fracs[j], a[0], b[0], size);
+        }
+
+        for (j = 0; j < 2; j++) {
+            ref->packedRowsToNV12(in0, in1, a[0], a[1], a[2], n, j);
+            k->packedRowsToNV12(in0, in1, b[0], b[1], b[2], n, j);
+            for (i = 0; i < 3; i++)
+                compare(k, j == 0 ? "YUYV rows" : "UYVY rows", n, 2, a[i], b[i], size);
+        }
+
+        ref->nv12RowToRGB565(in0, in1, (uint16_t *)a[0], 2 * n);
+        k->nv12RowToRGB565(in0, in1, (uint16_t *)b[0], 2 * n);
+        compare(k, "nv12RowToRGB565", 2 * n, 1, a[0], b[0], size);
+    }
+
+    for (i = 0; i < 3; i++) {
+        free(a[i]);
+        free(b[i]);
+    }
+    free(in0 - 1);
+    free(in1 - 1);
+}
+
+//the 4:2:0 frames, the chroma planes are odd in both directions
+static const struct { int width, height; } sFrameSizes[] = {
+    {2, 2}, {18, 14}, {30, 10}, {174, 98}, {322, 242}, {646, 486},
+};
+
+static void checkFrames(const CONVERT_KERNELS *k)
+{
+    const CONVERT_KERNELS *ref = getScalarConvertKernels();
+    static const unsigned int fmts[] = {
+        V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_YVU420,
+    };
+    static const unsigned int seconds[] = {0, V4L2_PIX_FMT_YVU420, V4L2_PIX_FMT_NV21};
+
+    for (unsigned int s = 0; s < sizeof(sFrameSizes) / sizeof(sFrameSizes[0]); s++) {
+        int width = sFrameSizes[s].width;
+        int height = sFrameSizes[s].height;
+        int size = getYV12FrameSize(width, height) > (unsigned int)(width * height * 2) ?
+            getYV12FrameSize(width, height) : width * height * 2;
+        uint8_t *src = (uint8_t *)malloc(width * height * 2);
+        uint8_t *a = allocOut(size), *b = allocOut(size);
+        uint8_t *a2 = allocOut(size), *b2 = allocOut(size);
+
+        fillRandom(src, width * height * 2);
+
+        convertNV12toNV21(ref, src, a, width, height);
+        convertNV12toNV21(k, src, b, width, height);
+        compare(k, "NV12 to NV21", width, height, a, b, size + GUARD_BYTES);
+        convertNV12toI420(ref, src, a, width, height);
+        convertNV12toI420(k, src, b, width, height);
+        compare(k, "NV12 to I420", width, height, a, b, size + GUARD_BYTES);
+        convertNV12toYV12(ref, src, a, width, height);
+        convertNV12toYV12(k, src, b, width, height);
+        compare(k, "NV12 to YV12", width, height, a, b, size + GUARD_BYTES);
+        convertNV12toRGB565(ref, src, a, width, height);
+        convertNV12toRGB565(k, src, b, width, height);
+        compare(k, "NV12 to RGB565", width, height, a, b, size + GUARD_BYTES);
+
+        for (int lumaOffset = 0; lumaOffset < 2; lumaOffset++) {
+            unsigned int srcFmt = lumaOffset == 0 ? V4L2_PIX_FMT_YUYV : V4L2_PIX_FMT_UYVY;
+            for (unsigned int f = 0; f < sizeof(fmts) / sizeof(fmts[0]); f++) {
+                for (unsigned int t = 0; t < sizeof(seconds) / sizeof(seconds[0]); t++) {
+                    char what[64];
+                    snprintf(what, sizeof(what), "%s to %.4s%s%.4s", lumaOffset == 0 ? "YUYV" : "UYVY",
+                            (const char *)&fmts[f], seconds[t] ? " and " : "",
+                            seconds[t] ? (const char *)&seconds[t] : "");
+                    if (convertPacked422(ref, src, srcFmt, width, height, a, fmts[f],
+                                seconds[t] ? a2 : NULL, seconds[t]) != 0 ||
+                            convertPacked422(k, src, srcFmt, width, height, b, fmts[f],
+                                seconds[t] ? b2 : NULL, seconds[t]) != 0) {
+                        printf("FAIL %s %s %dx%d: not converted\n", k->name, what, width, height);
+                        sFailures ++;
+                        continue;
+                    }
+                    compare(k, what, width, height, a, b, size + GUARD_BYTES);
+                    if (seconds[t])
+                        compare(k, what, width, height, a2, b2, size + GUARD_BYTES);
+                }
+            }
+            //a packed 4:2:2 frame of odd size has no 4:2:0 layout
+            sChecks ++;
+            if (convertPacked422(k, src, srcFmt, width + 1, height, b, V4L2_PIX_FMT_NV12, NULL, 0) != -1 ||
+                    convertPacked422(k, src, srcFmt, width, height - 1, b, V4L2_PIX_FMT_NV12, NULL, 0) != -1) {
+                printf("FAIL %s packed 4:2:2 of odd size converted\n", k->name);
+                sFailures ++;
+            }
+        }
+
+        free(src);
+        free(a);
+        free(b);
+        free(a2);
+        free(b2);
+    }
+}
+
+//the scaler takes any size, odd ones included
+static const struct { int srcWidth, srcHeight, dstWidth, dstHeight; } sScaleSizes[] = {
+    {641, 479, 319, 239}, {1281, 721, 427, 241}, {33, 17, 101, 57},
+    {97, 63, 97, 63}, {1279, 719, 641, 359}, {175, 99, 3, 1},
+};
+
+static void checkScale(const CONVERT_KERNELS *k)
+{
+    const CONVERT_KERNELS *ref = getScalarConvertKernels();
+
+    for (unsigned int s = 0; s < sizeof(sScaleSizes) / sizeof(sScaleSizes[0]); s++) {
+        int srcWidth = sScaleSizes[s].srcWidth, srcHeight = sScaleSizes[s].srcHeight;
+        int dstWidth = sScaleSizes[s].dstWidth, dstHeight = sScaleSizes[s].dstHeight;
+        int planeSize = dstWidth * dstHeight;
+        uint8_t *src = (uint8_t *)malloc(srcWidth * srcHeight * 4);
+
+        fillRandom(src, srcWidth * srcHeight * 4);
+        for (int channels = 1; channels <= 4; channels++) {
+            uint8_t *a[4], *b[4];
+            char what[32];
+            int c;
+
+            for (c = 0; c < channels; c++) {
+                a[c] = allocOut(planeSize);
+                b[c] = allocOut(planeSize);
+            }
+            snprintf(what, sizeof(what), "scale %dx%d, %d channels", dstWidth, dstHeight, channels);
+            if (scalePlane(ref, src, srcWidth, srcHeight, channels, a, dstWidth, dstHeight) != 0 ||
+                    scalePlane(k, src, srcWidth, srcHeight, channels, b, dstWidth, dstHeight) != 0) {
+                printf("FAIL %s %s %dx%d: not scaled\n", k->name, what, srcWidth, srcHeight);
+                sFailures ++;
+            }else{
+                for (c = 0; c < channels; c++)
+                    compare(k, what, srcWidth, srcHeight, a[c], b[c], planeSize + GUARD_BYTES);
+            }
+            for (c = 0; c < channels; c++) {
+                free(a[c]);
+                free(b[c]);
+            }
+        }
+        free(src);
+    }
+}
+
+static double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum {
+    BENCH_NV21,
+    BENCH_I420,
+    BENCH_YV12,
+    BENCH_RGB565,
+    BENCH_YUYV_NV12,
+    BENCH_YUYV_TWO,
+    BENCH_SCALE,
+    BENCH_NUM,
+};
+
+static const char *sBenchNames[BENCH_NUM] = {
+    "NV12 to NV21",
+    "NV12 to I420",
+    "NV12 to YV12",
+    "NV12 to RGB565",
+    "YUYV to NV12",
+    "YUYV to NV21 and YV12",
+    "NV12 Y scale to 1/2",
+};
+
+static void runBench(const CONVERT_KERNELS *k, int which, const uint8_t *src, uint8_t *dst,
+        uint8_t *second, int width, int height)
+{
+    uint8_t *half = dst;
+
+    switch (which) {
+        case BENCH_NV21:
+            convertNV12toNV21(k, src, dst, width, height);
+            break;
+        case BENCH_I420:
+            convertNV12toI420(k, src, dst, width, height);
+            break;
+        case BENCH_YV12:
+            convertNV12toYV12(k, src, dst, width, height);
+            break;
+        case BENCH_RGB565:
+            convertNV12toRGB565(k, src, dst, width, height);
+            break;
+        case BENCH_YUYV_NV12:
+            convertPacked422(k, src, V4L2_PIX_FMT_YUYV, width, height, dst, V4L2_PIX_FMT_NV12, NULL, 0);
+            break;
+        case BENCH_YUYV_TWO:
+            convertPacked422(k, src, V4L2_PIX_FMT_YUYV, width, height, dst, V4L2_PIX_FMT_NV21,
+                    second, V4L2_PIX_FMT_YVU420);
+            break;
+        case BENCH_SCALE:
+            scalePlane(k, src, width, height, 1, &half, width / 2, height / 2);
+            break;
+    }
+}
+
+//MB of source frame per second
+static double benchRate(const CONVERT_KERNELS *k, int which, const uint8_t *src, uint8_t *dst,
+        uint8_t *second, int width, int height, int ms)
+{
+    int srcBytes = which == BENCH_YUYV_NV12 || which == BENCH_YUYV_TWO ? width * height * 2 :
+        (which == BENCH_SCALE ? width * height : width * height * 3 / 2);
+    double start, elapsed;
+    int frames = 0;
+
+    runBench(k, which, src, dst, second, width, height);
+    start = nowSeconds();
+    do {
+        runBench(k, which, src, dst, second, width, height);
+        frames ++;
+        elapsed = nowSeconds() - start;
+    } while (elapsed * 1000 < ms);
+    return (double)srcBytes * frames / elapsed / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    const CONVERT_KERNELS *host = getConvertKernels();
+    const CONVERT_KERNELS *checked[2];
+    int checkedNum = 0;
+    int width = 1280, height = 720, ms = 200;
+    int opt, i, j;
+
+    while ((opt = getopt(argc, argv, "s:t:")) != -1) {
+        switch (opt) {
+            case 's':
+                if (sscanf(optarg, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0 ||
+                        (width & 1) || (height & 1)) {
+                    fprintf(stderr, "bad size %s, it must be an even WxH\n", optarg);
+                    return 2;
+                }
+                break;
+            case 't':
+                ms = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s WxH] [-t ms per conversion]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (host != getScalarConvertKernels())
+        checked[checkedNum++] = host;
+#ifdef CAMERA_CONVERT_HAVE_NEON
+    checked[checkedNum++] = &gNeonConvertKernels;
+#endif
+    for (i = 0; i < checkedNum; i++) {
+        int failures = sFailures;
+        checkRows(checked[i]);
+        checkFrames(checked[i]);
+        checkScale(checked[i]);
+        printf("convert: %s kernels %s against scalar\n", checked[i]->name,
+                sFailures == failures ? "match" : "do NOT match");
+    }
+    printf("convert: %d checks, %d failures\n", sChecks, sFailures);
+
+    if (ms > 0) {
+        uint8_t *src = (uint8_t *)malloc(width * height * 2);
+        uint8_t *dst = (uint8_t *)malloc(getYV12FrameSize(width, height) + width * height * 2);
+        uint8_t *second = (uint8_t *)malloc(getYV12FrameSize(width, height));
+
+        fillRandom(src, width * height * 2);
+        printf("convert: %dx%d, MB/s of source\n", width, height);
+        printf("  %-24s %10s", "", "scalar");
+        if (host != getScalarConvertKernels())
+            printf(" %10s %8s", host->name, "speedup");
+        printf("\n");
+        for (j = 0; j < BENCH_NUM; j++) {
+            double scalar = benchRate(getScalarConvertKernels(), j, src, dst, second, width, height, ms);
+            printf("  %-24s %10.1f", sBenchNames[j], scalar);
+            if (host != getScalarConvertKernels()) {
+                double rate = benchRate(host, j, src, dst, second, width, height, ms);
+                printf(" %10.1f %7.2fx", rate, rate / scalar);
+            }
+            printf("\n");
+        }
+        free(src);
+        free(dst);
+        free(second);
+    }
+    return sFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,769 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host implementation of the Android library calls the camera HAL makes:
+ * libutils, libcutils, libbinder memory, CameraParameters and the wake
+ * locks. Only what the HAL needs to run the replay device, see Makefile.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <map>
+#include <string>
+
+#include <utils/Log.h>
+#include <utils/threads.h>
+#include <utils/String8.h>
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+#include <binder/MemoryHeapBase.h>
+#include <camera/CameraParameters.h>
+#include <hardware_legacy/power.h>
+
+/* ---------------------------------------------------------------------- */
+/* liblog */
+
+extern "C" int host_log_enabled(int prio)
+{
+    static int verbose = -1;
+    char value[PROPERTY_VALUE_MAX];
+
+    if (prio >= HOST_LOG_WARN)
+        return 1;
+    if (verbose < 0) {
+        property_get("rw.camera.host.log", value, "0");
+        verbose = atoi(value);
+    }
+    return verbose;
+}
+
+extern "C" void host_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    static const char prioChars[] = "??VDIWEF";
+    va_list ap;
+
+    flockfile(stderr);
+    fprintf(stderr, "%c/%s: ", prioChars[prio & 7], tag ? tag : "");
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    if (fmt[0] == '\0' || fmt[strlen(fmt) - 1] != '\n')
+        fputc('\n', stderr);
+    funlockfile(stderr);
+}
+
+/* ---------------------------------------------------------------------- */
+/* libcutils */
+
+static pthread_mutex_t sPropertyLock = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, std::string> sProperties;
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    std::map<std::string, std::string>::const_iterator it;
+    char name[PROPERTY_KEY_MAX * 2];
+    const char *found = NULL;
+    size_t i, len;
+
+    pthread_mutex_lock(&sPropertyLock);
+    it = sProperties.find(key);
+    if (it != sProperties.end())
+        found = it->second.c_str();
+    if (found == NULL) {
+        for (i = 0; key[i] != '\0' && i < sizeof(name) - 1; i++)
+            name[i] = key[i] == '.' ? '_' : key[i];
+        name[i] = '\0';
+        found = getenv(name);
+    }
+    if (found == NULL)
+        found = default_value ? default_value : "";
+    //no padding, the callers may pass less than PROPERTY_VALUE_MAX for short values
+    len = strlen(found);
+    if (len > PROPERTY_VALUE_MAX - 1)
+        len = PROPERTY_VALUE_MAX - 1;
+    memcpy(value, found, len);
+    value[len] = '\0';
+    pthread_mutex_unlock(&sPropertyLock);
+    return len;
+}
+
+extern "C" int property_set(const char *key, const char *value)
+{
+    pthread_mutex_lock(&sPropertyLock);
+    sProperties[key] = value ? value : "";
+    pthread_mutex_unlock(&sPropertyLock);
+    return 0;
+}
+
+extern "C" {
+
+int32_t android_atomic_inc(volatile int32_t *addr) { return __sync_fetch_and_add(addr, 1); }
+int32_t android_atomic_dec(volatile int32_t *addr) { return __sync_fetch_and_sub(addr, 1); }
+int32_t android_atomic_add(int32_t value, volatile int32_t *addr) { return __sync_fetch_and_add(addr, value); }
+int32_t android_atomic_and(int32_t value, volatile int32_t *addr) { return __sync_fetch_and_and(addr, value); }
+int32_t android_atomic_or(int32_t value, volatile int32_t *addr) { return __sync_fetch_and_or(addr, value); }
+
+int32_t android_atomic_acquire_load(volatile const int32_t *addr)
+{
+    int32_t value = *addr;
+    __sync_synchronize();
+    return value;
+}
+
+int32_t android_atomic_release_load(volatile const int32_t *addr)
+{
+    __sync_synchronize();
+    return *addr;
+}
+
+void android_atomic_acquire_store(int32_t value, volatile int32_t *addr)
+{
+    *addr = value;
+    __sync_synchronize();
+}
+
+void android_atomic_release_store(int32_t value, volatile int32_t *addr)
+{
+    __sync_synchronize();
+    *addr = value;
+}
+
+int android_atomic_acquire_cas(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr)
+{
+    return !__sync_bool_compare_and_swap(addr, oldvalue, newvalue);
+}
+
+int android_atomic_release_cas(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr)
+{
+    return !__sync_bool_compare_and_swap(addr, oldvalue, newvalue);
+}
+
+int android_atomic_cmpxchg(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr)
+{
+    return !__sync_bool_compare_and_swap(addr, oldvalue, newvalue);
+}
+
+}
+
+/* ---------------------------------------------------------------------- */
+/* libhardware_legacy */
+
+static volatile int32_t sWakeLocks;
+
+extern "C" int acquire_wake_lock(int lock, const char *id)
+{
+    android_atomic_inc(&sWakeLocks);
+    return 0;
+}
+
+extern "C" int release_wake_lock(const char *id)
+{
+    android_atomic_dec(&sWakeLocks);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* libutils */
+
+nsecs_t systemTime(int clock)
+{
+    static const clockid_t clocks[] = {
+        CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_PROCESS_CPUTIME_ID, CLOCK_THREAD_CPUTIME_ID
+    };
+    struct timespec t;
+
+    clock_gettime(clocks[clock & 3], &t);
+    return nsecs_t(t.tv_sec) * 1000000000LL + t.tv_nsec;
+}
+
+namespace android {
+
+#define INITIAL_STRONG_VALUE (1 << 28)
+
+    class RefBase::weakref_impl : public RefBase::weakref_type
+    {
+    public:
+        weakref_impl(RefBase *base)
+            : mStrong(INITIAL_STRONG_VALUE), mWeak(0), mBase(base) { }
+
+        volatile int32_t    mStrong;
+        volatile int32_t    mWeak;
+        RefBase * const     mBase;
+    };
+
+    RefBase :: RefBase()
+        : mRefs(new weakref_impl(this))
+    {
+    }
+
+    RefBase :: ~RefBase()
+    {
+        //never strongly referenced, nobody else will free the counts
+        if (mRefs->mStrong == INITIAL_STRONG_VALUE)
+            delete mRefs;
+    }
+
+    void RefBase :: onFirstRef()
+    {
+    }
+
+    void RefBase :: incStrong(const void *id) const
+    {
+        weakref_impl *const refs = mRefs;
+        int32_t c;
+
+        refs->incWeak(id);
+        c = android_atomic_inc(&refs->mStrong);
+        if (c != INITIAL_STRONG_VALUE)
+            return;
+        android_atomic_add(-INITIAL_STRONG_VALUE, &refs->mStrong);
+        const_cast<RefBase *>(this)->onFirstRef();
+    }
+
+    void RefBase :: decStrong(const void *id) const
+    {
+        weakref_impl *const refs = mRefs;
+
+        if (android_atomic_dec(&refs->mStrong) == 1)
+            delete this;
+        refs->decWeak(id);
+    }
+
+    int32_t RefBase :: getStrongCount() const
+    {
+        return mRefs->mStrong;
+    }
+
+    RefBase::weakref_type *RefBase :: createWeak(const void *id) const
+    {
+        mRefs->incWeak(id);
+        return mRefs;
+    }
+
+    RefBase *RefBase::weakref_type :: refBase() const
+    {
+        return static_cast<const weakref_impl *>(this)->mBase;
+    }
+
+    void RefBase::weakref_type :: incWeak(const void *id)
+    {
+        android_atomic_inc(&static_cast<weakref_impl *>(this)->mWeak);
+    }
+
+    void RefBase::weakref_type :: decWeak(const void *id)
+    {
+        weakref_impl *const impl = static_cast<weakref_impl *>(this);
+
+        if (android_atomic_dec(&impl->mWeak) != 1)
+            return;
+        //the object went with its last strong reference, only a weak one kept the counts
+        if (impl->mStrong != INITIAL_STRONG_VALUE)
+            delete impl;
+        else
+            delete impl->mBase;
+    }
+
+    bool RefBase::weakref_type :: attemptIncStrong(const void *id)
+    {
+        weakref_impl *const impl = static_cast<weakref_impl *>(this);
+        int32_t curCount;
+
+        incWeak(id);
+        curCount = impl->mStrong;
+        while (curCount > 0 && curCount != INITIAL_STRONG_VALUE) {
+            if (android_atomic_cmpxchg(curCount, curCount + 1, &impl->mStrong) == 0)
+                return true;
+            curCount = impl->mStrong;
+        }
+        if (curCount == INITIAL_STRONG_VALUE &&
+                android_atomic_cmpxchg(curCount, 1, &impl->mStrong) == 0) {
+            impl->mBase->onFirstRef();
+            return true;
+        }
+        decWeak(id);
+        return false;
+    }
+
+    Condition :: Condition()
+    {
+        pthread_condattr_t attr;
+
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&mCond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+
+    status_t Condition :: waitRelative(Mutex &mutex, nsecs_t reltime)
+    {
+        struct timespec ts;
+        nsecs_t abstime;
+
+        abstime = systemTime(SYSTEM_TIME_MONOTONIC) + reltime;
+        ts.tv_sec = abstime / 1000000000;
+        ts.tv_nsec = abstime % 1000000000;
+        return -pthread_cond_timedwait(&mCond, &mutex.mMutex, &ts);
+    }
+
+    Thread :: Thread(bool canCallJava)
+        : mStatus(NO_ERROR), mExitPending(false), mRunning(false)
+    {
+    }
+
+    Thread :: ~Thread()
+    {
+    }
+
+    status_t Thread :: readyToRun()
+    {
+        return NO_ERROR;
+    }
+
+    status_t Thread :: run(const char *name, int32_t priority, size_t stack)
+    {
+        Mutex::Autolock _l(mLock);
+        pthread_attr_t attr;
+        int ret;
+
+        if (mRunning)
+            return INVALID_OPERATION;
+        mStatus = NO_ERROR;
+        mExitPending = false;
+        mRunning = true;
+        mHoldSelf = this;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (stack)
+            pthread_attr_setstacksize(&attr, stack);
+        ret = pthread_create(&mThread, &attr, threadEntry, this);
+        pthread_attr_destroy(&attr);
+        if (ret != 0) {
+            mStatus = UNKNOWN_ERROR;
+            mRunning = false;
+            mHoldSelf.clear();
+            return UNKNOWN_ERROR;
+        }
+        return NO_ERROR;
+    }
+
+    void *Thread :: threadEntry(void *user)
+    {
+        Thread *const self = static_cast<Thread *>(user);
+        sp<Thread> strong;
+        bool first = true;
+        bool result;
+
+        {
+            //the reference run() took is now owned by this thread
+            Mutex::Autolock _l(self->mLock);
+            strong = self->mHoldSelf;
+            self->mHoldSelf.clear();
+        }
+        for (;;) {
+            if (first) {
+                first = false;
+                self->mStatus = self->readyToRun();
+                result = self->mStatus == NO_ERROR;
+                if (result && !self->exitPending())
+                    result = self->threadLoop();
+            } else {
+                result = self->threadLoop();
+            }
+
+            if (!result || self->exitPending()) {
+                Mutex::Autolock _l(self->mLock);
+                self->mExitPending = true;
+                self->mRunning = false;
+                self->mThreadExitedCondition.broadcast();
+                break;
+            }
+        }
+        return NULL;
+    }
+
+    void Thread :: requestExit()
+    {
+        mExitPending = true;
+    }
+
+    status_t Thread :: requestExitAndWait()
+    {
+        Mutex::Autolock _l(mLock);
+
+        if (mRunning && pthread_equal(mThread, pthread_self())) {
+            LOGW("Thread (this=%p): don't call waitForExit() from this Thread object's thread.", this);
+            return WOULD_BLOCK;
+        }
+        mExitPending = true;
+        while (mRunning)
+            mThreadExitedCondition.wait(mLock);
+        mExitPending = false;
+        return mStatus;
+    }
+
+    bool Thread :: isRunning() const
+    {
+        Mutex::Autolock _l(mLock);
+        return mRunning;
+    }
+
+    bool Thread :: exitPending() const
+    {
+        return mExitPending;
+    }
+
+    status_t String8 :: appendFormat(const char *fmt, ...)
+    {
+        char buffer[1024];
+        va_list ap;
+
+        va_start(ap, fmt);
+        vsnprintf(buffer, sizeof(buffer), fmt, ap);
+        va_end(ap);
+        mString += buffer;
+        return NO_ERROR;
+    }
+
+/* ---------------------------------------------------------------------- */
+/* libbinder, the heaps are not shared with any other process */
+
+    void *IMemory :: pointer() const
+    {
+        ssize_t offset;
+        sp<IMemoryHeap> heap = getMemory(&offset);
+        void *const base = heap != 0 ? heap->getBase() : MAP_FAILED;
+
+        if (base == MAP_FAILED)
+            return 0;
+        return static_cast<char *>(base) + offset;
+    }
+
+    size_t IMemory :: size() const
+    {
+        size_t size;
+        getMemory(NULL, &size);
+        return size;
+    }
+
+    ssize_t IMemory :: offset() const
+    {
+        ssize_t offset;
+        getMemory(&offset);
+        return offset;
+    }
+
+    MemoryHeapBase :: MemoryHeapBase(size_t size, uint32_t flags, char const *name)
+        : mFD(-1), mSize(0), mBase(MAP_FAILED), mFlags(flags)
+    {
+        const size_t pagesize = getpagesize();
+
+        size = ((size + pagesize - 1) & ~(pagesize - 1));
+        mFD = syscall(__NR_memfd_create, name ? name : "MemoryHeapBase", 0);
+        if (mFD < 0)
+            return;
+        if (ftruncate(mFD, size) == 0)
+            mBase = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFD, 0);
+        if (mBase == MAP_FAILED) {
+            LOGE("mmap(fd=%d, size=%u) failed (%s)", mFD, (unsigned int)size, strerror(errno));
+            close(mFD);
+            mFD = -1;
+            return;
+        }
+        mSize = size;
+    }
+
+    MemoryHeapBase :: ~MemoryHeapBase()
+    {
+        if (mBase != MAP_FAILED)
+            munmap(mBase, mSize);
+        if (mFD >= 0)
+            close(mFD);
+    }
+
+/* ---------------------------------------------------------------------- */
+/* libcamera_client */
+
+    const char CameraParameters::KEY_PREVIEW_SIZE[] = "preview-size";
+    const char CameraParameters::KEY_SUPPORTED_PREVIEW_SIZES[] = "preview-size-values";
+    const char CameraParameters::KEY_PREVIEW_FPS_RANGE[] = "preview-fps-range";
+    const char CameraParameters::KEY_SUPPORTED_PREVIEW_FPS_RANGE[] = "preview-fps-range-values";
+    const char CameraParameters::KEY_PREVIEW_FORMAT[] = "preview-format";
+    const char CameraParameters::KEY_SUPPORTED_PREVIEW_FORMATS[] = "preview-format-values";
+    const char CameraParameters::KEY_PREVIEW_FRAME_RATE[] = "preview-frame-rate";
+    const char CameraParameters::KEY_SUPPORTED_PREVIEW_FRAME_RATES[] = "preview-frame-rate-values";
+    const char CameraParameters::KEY_PICTURE_SIZE[] = "picture-size";
+    const char CameraParameters::KEY_SUPPORTED_PICTURE_SIZES[] = "picture-size-values";
+    const char CameraParameters::KEY_PICTURE_FORMAT[] = "picture-format";
+    const char CameraParameters::KEY_SUPPORTED_PICTURE_FORMATS[] = "picture-format-values";
+    const char CameraParameters::KEY_JPEG_THUMBNAIL_WIDTH[] = "jpeg-thumbnail-width";
+    const char CameraParameters::KEY_JPEG_THUMBNAIL_HEIGHT[] = "jpeg-thumbnail-height";
+    const char CameraParameters::KEY_SUPPORTED_JPEG_THUMBNAIL_SIZES[] = "jpeg-thumbnail-size-values";
+    const char CameraParameters::KEY_JPEG_THUMBNAIL_QUALITY[] = "jpeg-thumbnail-quality";
+    const char CameraParameters::KEY_JPEG_QUALITY[] = "jpeg-quality";
+    const char CameraParameters::KEY_ROTATION[] = "rotation";
+    const char CameraParameters::KEY_GPS_LATITUDE[] = "gps-latitude";
+    const char CameraParameters::KEY_GPS_LONGITUDE[] = "gps-longitude";
+    const char CameraParameters::KEY_GPS_ALTITUDE[] = "gps-altitude";
+    const char CameraParameters::KEY_GPS_TIMESTAMP[] = "gps-timestamp";
+    const char CameraParameters::KEY_GPS_PROCESSING_METHOD[] = "gps-processing-method";
+    const char CameraParameters::KEY_WHITE_BALANCE[] = "whitebalance";
+    const char CameraParameters::KEY_SUPPORTED_WHITE_BALANCE[] = "whitebalance-values";
+    const char CameraParameters::KEY_EFFECT[] = "effect";
+    const char CameraParameters::KEY_SUPPORTED_EFFECTS[] = "effect-values";
+    const char CameraParameters::KEY_ANTIBANDING[] = "antibanding";
+    const char CameraParameters::KEY_SUPPORTED_ANTIBANDING[] = "antibanding-values";
+    const char CameraParameters::KEY_SCENE_MODE[] = "scene-mode";
+    const char CameraParameters::KEY_SUPPORTED_SCENE_MODES[] = "scene-mode-values";
+    const char CameraParameters::KEY_FLASH_MODE[] = "flash-mode";
+    const char CameraParameters::KEY_SUPPORTED_FLASH_MODES[] = "flash-mode-values";
+    const char CameraParameters::KEY_FOCUS_MODE[] = "focus-mode";
+    const char CameraParameters::KEY_SUPPORTED_FOCUS_MODES[] = "focus-mode-values";
+    const char CameraParameters::KEY_FOCAL_LENGTH[] = "focal-length";
+    const char CameraParameters::KEY_HORIZONTAL_VIEW_ANGLE[] = "horizontal-view-angle";
+    const char CameraParameters::KEY_VERTICAL_VIEW_ANGLE[] = "vertical-view-angle";
+    const char CameraParameters::KEY_EXPOSURE_COMPENSATION[] = "exposure-compensation";
+    const char CameraParameters::KEY_MAX_EXPOSURE_COMPENSATION[] = "max-exposure-compensation";
+    const char CameraParameters::KEY_MIN_EXPOSURE_COMPENSATION[] = "min-exposure-compensation";
+    const char CameraParameters::KEY_EXPOSURE_COMPENSATION_STEP[] = "exposure-compensation-step";
+    const char CameraParameters::KEY_ZOOM[] = "zoom";
+    const char CameraParameters::KEY_MAX_ZOOM[] = "max-zoom";
+    const char CameraParameters::KEY_ZOOM_RATIOS[] = "zoom-ratios";
+    const char CameraParameters::KEY_ZOOM_SUPPORTED[] = "zoom-supported";
+    const char CameraParameters::KEY_SMOOTH_ZOOM_SUPPORTED[] = "smooth-zoom-supported";
+    const char CameraParameters::KEY_FOCUS_DISTANCES[] = "focus-distances";
+    const char CameraParameters::KEY_VIDEO_FRAME_FORMAT[] = "video-frame-format";
+
+    const char CameraParameters::TRUE[] = "true";
+    const char CameraParameters::FALSE[] = "false";
+
+    const char CameraParameters::WHITE_BALANCE_AUTO[] = "auto";
+    const char CameraParameters::WHITE_BALANCE_INCANDESCENT[] = "incandescent";
+    const char CameraParameters::WHITE_BALANCE_FLUORESCENT[] = "fluorescent";
+    const char CameraParameters::WHITE_BALANCE_DAYLIGHT[] = "daylight";
+    const char CameraParameters::WHITE_BALANCE_SHADE[] = "shade";
+
+    const char CameraParameters::EFFECT_NONE[] = "none";
+    const char CameraParameters::EFFECT_MONO[] = "mono";
+    const char CameraParameters::EFFECT_NEGATIVE[] = "negative";
+    const char CameraParameters::EFFECT_SOLARIZE[] = "solarize";
+    const char CameraParameters::EFFECT_SEPIA[] = "sepia";
+
+    const char CameraParameters::ANTIBANDING_AUTO[] = "auto";
+    const char CameraParameters::ANTIBANDING_50HZ[] = "50hz";
+    const char CameraParameters::ANTIBANDING_60HZ[] = "60hz";
+    const char CameraParameters::ANTIBANDING_OFF[] = "off";
+
+    const char CameraParameters::FLASH_MODE_OFF[] = "off";
+    const char CameraParameters::FLASH_MODE_AUTO[] = "auto";
+    const char CameraParameters::FLASH_MODE_ON[] = "on";
+    const char CameraParameters::FLASH_MODE_RED_EYE[] = "red-eye";
+    const char CameraParameters::FLASH_MODE_TORCH[] = "torch";
+
+    const char CameraParameters::SCENE_MODE_AUTO[] = "auto";
+    const char CameraParameters::SCENE_MODE_PORTRAIT[] = "portrait";
+    const char CameraParameters::SCENE_MODE_LANDSCAPE[] = "landscape";
+    const char CameraParameters::SCENE_MODE_NIGHT[] = "night";
+    const char CameraParameters::SCENE_MODE_NIGHT_PORTRAIT[] = "night-portrait";
+    const char CameraParameters::SCENE_MODE_SPORTS[] = "sports";
+    const char CameraParameters::SCENE_MODE_FIREWORKS[] = "fireworks";
+
+    const char CameraParameters::PIXEL_FORMAT_YUV422SP[] = "yuv422sp";
+    const char CameraParameters::PIXEL_FORMAT_YUV420SP[] = "yuv420sp";
+    const char CameraParameters::PIXEL_FORMAT_YUV422I[] = "yuv422i-yuyv";
+    const char CameraParameters::PIXEL_FORMAT_YUV420P[] = "yuv420p";
+    const char CameraParameters::PIXEL_FORMAT_RGB565[] = "rgb565";
+    const char CameraParameters::PIXEL_FORMAT_JPEG[] = "jpeg";
+
+    const char CameraParameters::FOCUS_MODE_AUTO[] = "auto";
+    const char CameraParameters::FOCUS_MODE_INFINITY[] = "infinity";
+    const char CameraParameters::FOCUS_MODE_MACRO[] = "macro";
+    const char CameraParameters::FOCUS_MODE_FIXED[] = "fixed";
+    const char CameraParameters::FOCUS_MODE_EDOF[] = "edof";
+    const char CameraParameters::FOCUS_MODE_CONTINUOUS_VIDEO[] = "continuous-video";
+
+    String8 CameraParameters :: flatten() const
+    {
+        std::map<std::string, std::string>::const_iterator it;
+        String8 flattened;
+
+        for (it = mMap.begin(); it != mMap.end(); ++it) {
+            if (it != mMap.begin())
+                flattened.append(";");
+            flattened.append(it->first.c_str());
+            flattened.append("=");
+            flattened.append(it->second.c_str());
+        }
+        return flattened;
+    }
+
+    void CameraParameters :: unflatten(const String8 &params)
+    {
+        const char *a = params.string();
+        const char *b, *c;
+
+        mMap.clear();
+        for (;;) {
+            b = strchr(a, '=');
+            if (b == NULL)
+                break;
+            c = strchr(b + 1, ';');
+            if (c == NULL) {
+                mMap[std::string(a, b - a)] = b + 1;
+                break;
+            }
+            mMap[std::string(a, b - a)] = std::string(b + 1, c - b - 1);
+            a = c + 1;
+        }
+    }
+
+    void CameraParameters :: set(const char *key, const char *value)
+    {
+        //same refusal as libcamera_client, they would break flatten()
+        if (strchr(key, '=') || strchr(key, ';') || strchr(value, '=') || strchr(value, ';'))
+            return;
+        mMap[key] = value;
+    }
+
+    void CameraParameters :: set(const char *key, int value)
+    {
+        char str[16];
+        snprintf(str, sizeof(str), "%d", value);
+        set(key, str);
+    }
+
+    void CameraParameters :: setFloat(const char *key, float value)
+    {
+        char str[16];
+        snprintf(str, sizeof(str), "%g", value);
+        set(key, str);
+    }
+
+    const char *CameraParameters :: get(const char *key) const
+    {
+        std::map<std::string, std::string>::const_iterator it = mMap.find(key);
+        return it != mMap.end() ? it->second.c_str() : NULL;
+    }
+
+    int CameraParameters :: getInt(const char *key) const
+    {
+        const char *v = get(key);
+        return v != NULL ? strtol(v, 0, 0) : -1;
+    }
+
+    float CameraParameters :: getFloat(const char *key) const
+    {
+        const char *v = get(key);
+        return v != NULL ? strtof(v, 0) : -1;
+    }
+
+    void CameraParameters :: remove(const char *key)
+    {
+        mMap.erase(key);
+    }
+
+    static void parseSize(const char *str, int *width, int *height)
+    {
+        char *end;
+        int w, h;
+
+        *width = -1;
+        *height = -1;
+        if (str == NULL)
+            return;
+        w = (int)strtol(str, &end, 10);
+        if (*end != 'x')
+            return;
+        h = (int)strtol(end + 1, &end, 10);
+        *width = w;
+        *height = h;
+    }
+
+    void CameraParameters :: setPreviewSize(int width, int height)
+    {
+        char str[32];
+        snprintf(str, sizeof(str), "%dx%d", width, height);
+        set(KEY_PREVIEW_SIZE, str);
+    }
+
+    void CameraParameters :: getPreviewSize(int *width, int *height) const
+    {
+        parseSize(get(KEY_PREVIEW_SIZE), width, height);
+    }
+
+    void CameraParameters :: setPreviewFrameRate(int fps)
+    {
+        set(KEY_PREVIEW_FRAME_RATE, fps);
+    }
+
+    int CameraParameters :: getPreviewFrameRate() const
+    {
+        return getInt(KEY_PREVIEW_FRAME_RATE);
+    }
+
+    void CameraParameters :: getPreviewFpsRange(int *min_fps, int *max_fps) const
+    {
+        const char *p = get(KEY_PREVIEW_FPS_RANGE);
+
+        *min_fps = -1;
+        *max_fps = -1;
+        if (p != NULL)
+            sscanf(p, "%d,%d", min_fps, max_fps);
+    }
+
+    void CameraParameters :: setPreviewFormat(const char *format)
+    {
+        set(KEY_PREVIEW_FORMAT, format);
+    }
+
+    const char *CameraParameters :: getPreviewFormat() const
+    {
+        return get(KEY_PREVIEW_FORMAT);
+    }
+
+    void CameraParameters :: setPictureSize(int width, int height)
+    {
+        char str[32];
+        snprintf(str, sizeof(str), "%dx%d", width, height);
+        set(KEY_PICTURE_SIZE, str);
+    }
+
+    void CameraParameters :: getPictureSize(int *width, int *height) const
+    {
+        parseSize(get(KEY_PICTURE_SIZE), width, height);
+    }
+
+    void CameraParameters :: setPictureFormat(const char *format)
+    {
+        set(KEY_PICTURE_FORMAT, format);
+    }
+
+    const char *CameraParameters :: getPictureFormat() const
+    {
+        return get(KEY_PICTURE_FORMAT);
+    }
+
+};
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The Freescale IPU and jpeg codec libraries are arm only. On the host the
+ * IPU task and the fsl encoder never initialize, the HAL then uses the
+ * software post process device and the libjpeg encoder.
+ */
+
+#include <stddef.h>
+#include "jpeg_enc_interface.h"
+extern "C" {
+#include "mxc_ipu_hl_lib.h"
+}
+
+extern "C" int mxc_ipu_lib_task_init(ipu_lib_input_param_t *input, ipu_lib_input_param_t *overlay,
+        ipu_lib_output_param_t *output, int mode, ipu_lib_handle_t *ipu_handle)
+{
+    return -1;
+}
+
+extern "C" void mxc_ipu_lib_task_uninit(ipu_lib_handle_t *ipu_handle)
+{
+}
+
+extern "C" int mxc_ipu_lib_task_buf_update(ipu_lib_handle_t *ipu_handle, int new_inbuf_paddr,
+        int new_ovbuf_paddr, int new_ovbuf_alpha_paddr, void (output_callback)(void *, int),
+        void *output_cb_arg)
+{
+    return -1;
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_query_mem_req(jpeg_enc_object *obj_ptr)
+{
+    obj_ptr->mem_infos.no_entries = 0;
+    return JPEG_ENC_ERR_NO_ERROR;
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_init(jpeg_enc_object *obj_ptr)
+{
+    return JPEG_ENC_ERR_INVALID_PARAM;
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_encodeframe(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT8 *i_buff,
+        JPEG_ENC_UINT8 *y_buff, JPEG_ENC_UINT8 *u_buff, JPEG_ENC_UINT8 *v_buff)
+{
+    return JPEG_ENC_ERR_INVALID_PARAM;
+}
+
+void jpeg_enc_find_length_position(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT32 *length_positions,
+        JPEG_ENC_UINT8 *num_positions, JPEG_ENC_UINT8 *app1_present)
+{
+    *num_positions = 0;
+    *app1_present = 0;
+}
+
+int jpeg_enc_set_exifheaderinfo(jpeg_enc_object *obj_ptr, int parameter, unsigned int value)
+{
+    return 0;
+}
+
+const char *jpege_CodecVersionInfo()
+{
+    return "host stub";
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The part of arm_neon.h Camera_convert_neon.cpp uses, written out lane by
+ * lane, so the NEON kernels can be built and compared against the scalar
+ * ones on the host, see hosttest/Makefile. It follows the ARM semantics,
+ * not its speed.
+ */
+
+#ifndef HOSTTEST_ARM_NEON_H
+#define HOSTTEST_ARM_NEON_H
+
+#include <stdint.h>
+
+typedef struct { uint8_t v[8]; } uint8x8_t;
+typedef struct { uint8_t v[16]; } uint8x16_t;
+typedef struct { uint16_t v[8]; } uint16x8_t;
+typedef struct { int16_t v[8]; } int16x8_t;
+typedef struct { uint8x8_t val[2]; } uint8x8x2_t;
+typedef struct { uint8x16_t val[2]; } uint8x16x2_t;
+typedef struct { uint8x16_t val[4]; } uint8x16x4_t;
+typedef struct { int16x8_t val[2]; } int16x8x2_t;
+
+static inline int16_t neonSat16(int v)
+{
+    return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+static inline uint8x16_t vld1q_u8(const uint8_t *p)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i++)
+        r.v[i] = p[i];
+    return r;
+}
+
+static inline void vst1q_u8(uint8_t *p, uint8x16_t a)
+{
+    for (int i = 0; i < 16; i++)
+        p[i] = a.v[i];
+}
+
+static inline uint16x8_t vld1q_u16(const uint16_t *p)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = p[i];
+    return r;
+}
+
+static inline void vst1q_u16(uint16_t *p, uint16x8_t a)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = a.v[i];
+}
+
+static inline uint8x8x2_t vld2_u8(const uint8_t *p)
+{
+    uint8x8x2_t r;
+    for (int i = 0; i < 8; i++) {
+        r.val[0].v[i] = p[2 * i];
+        r.val[1].v[i] = p[2 * i + 1];
+    }
+    return r;
+}
+
+static inline uint8x16x2_t vld2q_u8(const uint8_t *p)
+{
+    uint8x16x2_t r;
+    for (int i = 0; i < 16; i++) {
+        r.val[0].v[i] = p[2 * i];
+        r.val[1].v[i] = p[2 * i + 1];
+    }
+    return r;
+}
+
+static inline void vst2q_u8(uint8_t *p, uint8x16x2_t a)
+{
+    for (int i = 0; i < 16; i++) {
+        p[2 * i] = a.val[0].v[i];
+        p[2 * i + 1] = a.val[1].v[i];
+    }
+}
+
+static inline uint8x16x4_t vld4q_u8(const uint8_t *p)
+{
+    uint8x16x4_t r;
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 4; j++)
+            r.val[j].v[i] = p[4 * i + j];
+    }
+    return r;
+}
+
+static inline uint8x8_t vdup_n_u8(uint8_t a)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = a;
+    return r;
+}
+
+static inline int16x8_t vdupq_n_s16(int16_t a)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = a;
+    return r;
+}
+
+static inline uint8x8_t vget_low_u8(uint8x16_t a)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = a.v[i];
+    return r;
+}
+
+static inline uint8x8_t vget_high_u8(uint8x16_t a)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = a.v[i + 8];
+    return r;
+}
+
+static inline uint8x16_t vcombine_u8(uint8x8_t lo, uint8x8_t hi)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 8; i++) {
+        r.v[i] = lo.v[i];
+        r.v[i + 8] = hi.v[i];
+    }
+    return r;
+}
+
+static inline int16x8_t vreinterpretq_s16_u16(uint16x8_t a)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (int16_t)a.v[i];
+    return r;
+}
+
+static inline uint8x16_t vrev16q_u8(uint8x16_t a)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i += 2) {
+        r.v[i] = a.v[i + 1];
+        r.v[i + 1] = a.v[i];
+    }
+    return r;
+}
+
+static inline uint16x8_t vmovl_u8(uint8x8_t a)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = a.v[i];
+    return r;
+}
+
+static inline uint16x8_t vshll_n_u8(uint8x8_t a, int n)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (uint16_t)(a.v[i] << n);
+    return r;
+}
+
+/* shift b right by n and insert it below the top n bits of a */
+static inline uint16x8_t vsriq_n_u16(uint16x8_t a, uint16x8_t b, int n)
+{
+    uint16_t keep = (uint16_t)~(0xFFFF >> n);
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (a.v[i] & keep) | (b.v[i] >> n);
+    return r;
+}
+
+static inline int16x8_t vsubq_s16(int16x8_t a, int16x8_t b)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (int16_t)(a.v[i] - b.v[i]);
+    return r;
+}
+
+static inline int16x8_t vmulq_n_s16(int16x8_t a, int16_t b)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (int16_t)(a.v[i] * b);
+    return r;
+}
+
+static inline int16x8_t vmlaq_n_s16(int16x8_t a, int16x8_t b, int16_t c)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (int16_t)(a.v[i] + b.v[i] * c);
+    return r;
+}
+
+static inline int16x8_t vqaddq_s16(int16x8_t a, int16x8_t b)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = neonSat16(a.v[i] + b.v[i]);
+    return r;
+}
+
+static inline int16x8_t vqsubq_s16(int16x8_t a, int16x8_t b)
+{
+    int16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = neonSat16(a.v[i] - b.v[i]);
+    return r;
+}
+
+static inline int16x8x2_t vzipq_s16(int16x8_t a, int16x8_t b)
+{
+    int16x8x2_t r;
+    for (int i = 0; i < 8; i++) {
+        r.val[i / 4].v[(2 * i) % 8] = a.v[i];
+        r.val[i / 4].v[(2 * i) % 8 + 1] = b.v[i];
+    }
+    return r;
+}
+
+/* rounding shift right, saturated to 0..255 */
+static inline uint8x8_t vqrshrun_n_s16(int16x8_t a, int n)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++) {
+        int v = (a.v[i] + (1 << (n - 1))) >> n;
+        r.v[i] = v > 255 ? 255 : (v < 0 ? 0 : v);
+    }
+    return r;
+}
+
+/* rounding shift right, truncated to 8 bits */
+static inline uint8x8_t vrshrn_n_u16(uint16x8_t a, int n)
+{
+    uint8x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (uint8_t)((a.v[i] + (1 << (n - 1))) >> n);
+    return r;
+}
+
+static inline uint16x8_t vaddw_u8(uint16x8_t a, uint8x8_t b)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (uint16_t)(a.v[i] + b.v[i]);
+    return r;
+}
+
+static inline uint16x8_t vmull_u8(uint8x8_t a, uint8x8_t b)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (uint16_t)(a.v[i] * b.v[i]);
+    return r;
+}
+
+static inline uint16x8_t vmlal_u8(uint16x8_t a, uint8x8_t b, uint8x8_t c)
+{
+    uint16x8_t r;
+    for (int i = 0; i < 8; i++)
+        r.v[i] = (uint16_t)(a.v[i] + b.v[i] * c.v[i]);
+    return r;
+}
+
+static inline uint8x16_t vrhaddq_u8(uint8x16_t a, uint8x16_t b)
+{
+    uint8x16_t r;
+    for (int i = 0; i < 16; i++)
+        r.v[i] = (a.v[i] + b.v[i] + 1) >> 1;
+    return r;
+}
+
+#endif
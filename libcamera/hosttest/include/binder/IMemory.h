@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile. The heaps are memfd backed, there is no binder.
+ */
+
+#ifndef HOSTTEST_BINDER_IMEMORY_H
+#define HOSTTEST_BINDER_IMEMORY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/RefBase.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+    class IMemoryHeap : public virtual RefBase
+    {
+    public:
+        virtual int getHeapID() const = 0;
+        virtual void *getBase() const = 0;
+        virtual size_t getSize() const = 0;
+        virtual uint32_t getFlags() const = 0;
+    };
+
+    class IMemory : public virtual RefBase
+    {
+    public:
+        virtual sp<IMemoryHeap> getMemory(ssize_t *offset = 0, size_t *size = 0) const = 0;
+
+        void *pointer() const;
+        size_t size() const;
+        ssize_t offset() const;
+    };
+
+};
+
+#endif
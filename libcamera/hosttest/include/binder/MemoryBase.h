@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_BINDER_MEMORYBASE_H
+#define HOSTTEST_BINDER_MEMORYBASE_H
+
+#include <binder/IMemory.h>
+
+namespace android {
+
+    class MemoryBase : public IMemory
+    {
+    public:
+        MemoryBase(const sp<IMemoryHeap> &heap, ssize_t offset, size_t size)
+            : mSize(size), mOffset(offset), mHeap(heap) { }
+
+        virtual sp<IMemoryHeap> getMemory(ssize_t *offset = 0, size_t *size = 0) const
+        {
+            if (offset)
+                *offset = mOffset;
+            if (size)
+                *size = mSize;
+            return mHeap;
+        }
+
+    private:
+        size_t          mSize;
+        ssize_t         mOffset;
+        sp<IMemoryHeap> mHeap;
+    };
+
+};
+
+#endif
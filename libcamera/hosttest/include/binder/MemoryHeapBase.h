@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_BINDER_MEMORYHEAPBASE_H
+#define HOSTTEST_BINDER_MEMORYHEAPBASE_H
+
+#include <binder/IMemory.h>
+
+namespace android {
+
+    class MemoryHeapBase : public virtual IMemoryHeap
+    {
+    public:
+        MemoryHeapBase(size_t size, uint32_t flags = 0, char const *name = NULL);
+        virtual ~MemoryHeapBase();
+
+        virtual int getHeapID() const { return mFD; }
+        virtual void *getBase() const { return mBase; }
+        virtual size_t getSize() const { return mSize; }
+        virtual uint32_t getFlags() const { return mFlags; }
+
+    private:
+        int         mFD;
+        size_t      mSize;
+        void       *mBase;
+        uint32_t    mFlags;
+    };
+
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_CAMERA_CAMERAHARDWAREINTERFACE_H
+#define HOSTTEST_CAMERA_CAMERAHARDWAREINTERFACE_H
+
+#include <utils/RefBase.h>
+#include <utils/Errors.h>
+#include <utils/String16.h>
+#include <utils/Vector.h>
+#include <utils/Timers.h>
+#include <binder/IMemory.h>
+#include <binder/MemoryHeapBase.h>
+#include <camera/CameraParameters.h>
+#include <ui/Overlay.h>
+
+struct ANativeWindow;
+
+enum {
+    CAMERA_MSG_ERROR            = 0x001,
+    CAMERA_MSG_SHUTTER          = 0x002,
+    CAMERA_MSG_FOCUS            = 0x004,
+    CAMERA_MSG_ZOOM             = 0x008,
+    CAMERA_MSG_PREVIEW_FRAME    = 0x010,
+    CAMERA_MSG_VIDEO_FRAME      = 0x020,
+    CAMERA_MSG_POSTVIEW_FRAME   = 0x040,
+    CAMERA_MSG_RAW_IMAGE        = 0x080,
+    CAMERA_MSG_COMPRESSED_IMAGE = 0x100,
+    CAMERA_MSG_ALL_MSGS         = 0x1FF
+};
+
+enum {
+    CAMERA_CMD_START_SMOOTH_ZOOM     = 1,
+    CAMERA_CMD_STOP_SMOOTH_ZOOM      = 2,
+    CAMERA_CMD_SET_DISPLAY_ORIENTATION = 3
+};
+
+enum {
+    CAMERA_FACING_BACK = 0,
+    CAMERA_FACING_FRONT = 1
+};
+
+namespace android {
+
+    struct CameraInfo {
+        int facing;
+        int orientation;
+    };
+
+    typedef void (*notify_callback)(int32_t msgType, int32_t ext1, int32_t ext2, void *user);
+    typedef void (*data_callback)(int32_t msgType, const sp<IMemory> &dataPtr, void *user);
+    typedef void (*data_callback_timestamp)(nsecs_t timestamp, int32_t msgType,
+            const sp<IMemory> &dataPtr, void *user);
+
+    class CameraHardwareInterface : public virtual RefBase
+    {
+    public:
+        virtual ~CameraHardwareInterface() { }
+
+        virtual sp<IMemoryHeap> getPreviewHeap() const = 0;
+        virtual sp<IMemoryHeap> getRawHeap() const = 0;
+        virtual void setCallbacks(notify_callback notify_cb, data_callback data_cb,
+                data_callback_timestamp data_cb_timestamp, void *user) = 0;
+        virtual void enableMsgType(int32_t msgType) = 0;
+        virtual void disableMsgType(int32_t msgType) = 0;
+        virtual bool msgTypeEnabled(int32_t msgType) = 0;
+        virtual bool useOverlay() { return false; }
+        virtual status_t setOverlay(const sp<Overlay> &overlay) { return BAD_VALUE; }
+        virtual status_t startPreview() = 0;
+        virtual void stopPreview() = 0;
+        virtual bool previewEnabled() = 0;
+        virtual status_t startRecording() = 0;
+        virtual void stopRecording() = 0;
+        virtual bool recordingEnabled() = 0;
+        virtual void releaseRecordingFrame(const sp<IMemory> &mem) = 0;
+        virtual status_t autoFocus() = 0;
+        virtual status_t cancelAutoFocus() = 0;
+        virtual status_t takePicture() = 0;
+        virtual status_t cancelPicture() = 0;
+        virtual status_t setParameters(const CameraParameters &params) = 0;
+        virtual CameraParameters getParameters() const = 0;
+        virtual status_t sendCommand(int32_t cmd, int32_t arg1, int32_t arg2) = 0;
+        virtual void release() = 0;
+        virtual status_t dump(int fd, const Vector<String16> &args) const = 0;
+    };
+
+    extern "C" int HAL_getNumberOfCameras();
+    extern "C" void HAL_getCameraInfo(int cameraId, struct CameraInfo *cameraInfo);
+    extern "C" sp<CameraHardwareInterface> HAL_openCameraHardware(int cameraId);
+
+};
+
+#endif
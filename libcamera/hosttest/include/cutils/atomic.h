@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_CUTILS_ATOMIC_H
+#define HOSTTEST_CUTILS_ATOMIC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t android_atomic_inc(volatile int32_t *addr);
+int32_t android_atomic_dec(volatile int32_t *addr);
+int32_t android_atomic_add(int32_t value, volatile int32_t *addr);
+int32_t android_atomic_and(int32_t value, volatile int32_t *addr);
+int32_t android_atomic_or(int32_t value, volatile int32_t *addr);
+int32_t android_atomic_acquire_load(volatile const int32_t *addr);
+int32_t android_atomic_release_load(volatile const int32_t *addr);
+void android_atomic_acquire_store(int32_t value, volatile int32_t *addr);
+void android_atomic_release_store(int32_t value, volatile int32_t *addr);
+/* 0 when *addr was oldvalue and got newvalue */
+int android_atomic_acquire_cas(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr);
+int android_atomic_release_cas(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr);
+int android_atomic_cmpxchg(int32_t oldvalue, int32_t newvalue, volatile int32_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile. property_get() looks at the values set with
+ * property_set(), then at the environment with the dots turned into
+ * underscores (rw_camera_pp=software), then takes the default.
+ */
+
+#ifndef HOSTTEST_CUTILS_PROPERTIES_H
+#define HOSTTEST_CUTILS_PROPERTIES_H
+
+#define PROPERTY_KEY_MAX   32
+#define PROPERTY_VALUE_MAX 92
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int property_get(const char *key, char *value, const char *default_value);
+int property_set(const char *key, const char *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile. The wake locks are only counted.
+ */
+
+#ifndef HOSTTEST_HARDWARE_LEGACY_POWER_H
+#define HOSTTEST_HARDWARE_LEGACY_POWER_H
+
+enum {
+    PARTIAL_WAKE_LOCK = 1,
+    FULL_WAKE_LOCK = 2
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int acquire_wake_lock(int lock, const char *id);
+int release_wake_lock(const char *id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The part of the Freescale jpeg encoder API JpegEncoderSoftware uses,
+ * for the host build, see hosttest/Makefile. The codec library is arm
+ * only, on the host jpeg_enc_init() fails: set rw.camera.jpeg.encoder to
+ * libjpeg.
+ */
+
+#ifndef HOSTTEST_JPEG_ENC_INTERFACE_H
+#define HOSTTEST_JPEG_ENC_INTERFACE_H
+
+typedef unsigned char JPEG_ENC_UINT8;
+typedef unsigned short JPEG_ENC_UINT16;
+typedef unsigned int JPEG_ENC_UINT32;
+
+#define JPEG_ENC_NUM_OF_OFFSETS     8
+#define JPEG_ENC_MAX_NUM_MEM_REQS   8
+
+typedef enum {
+    JPEG_ENC_MAIN_ONLY,
+    JPEG_ENC_THUMB,
+    JPEG_ENC_MAIN
+} JPEG_ENC_MODE;
+
+typedef enum {
+    JPEG_ENC_SEQUENTIAL,
+    JPEG_ENC_PROGRESSIVE
+} JPEG_ENC_COMPRESSION_METHOD;
+
+typedef enum {
+    JPEG_ENC_YUV_420_NONINTERLEAVED,
+    JPEG_ENC_YUV_422_NONINTERLEAVED,
+    JPEG_ENC_YUV_444_NONINTERLEAVED,
+    JPEG_ENC_YU_YV_422_INTERLEAVED
+} JPEG_ENC_YUV_FORMAT;
+
+typedef enum {
+    JPEG_ENC_ERR_NO_ERROR = 0,
+    JPEG_ENC_ERR_ENCODINGCOMPLETE = 1,
+    JPEG_ENC_ERR_INVALID_PARAM = 2
+} JPEG_ENC_RET_TYPE;
+
+typedef enum {
+    JPEGE_ENC_SET_HEADER_ORIENTATION,
+    JPEGE_ENC_SET_HEADER_WHITEBALANCE,
+    JPEGE_ENC_SET_HEADER_FLASH,
+    JPEGE_ENC_SET_HEADER_MAKE,
+    JPEGE_ENC_SET_HEADER_MAKERNOTE,
+    JPEGE_ENC_SET_HEADER_MODEL,
+    JPEGE_ENC_SET_HEADER_DATETIME,
+    JPEGE_ENC_SET_HEADER_FOCALLENGTH,
+    JPEGE_ENC_SET_HEADER_GPS
+} JPEGE_ENC_SET_HEADER;
+
+typedef struct {
+    int density_unit;
+    int X_density;
+    int Y_density;
+} jpeg_enc_jfif_params;
+
+typedef struct {
+    JPEG_ENC_COMPRESSION_METHOD compression_method;
+    JPEG_ENC_MODE mode;
+    int quality;
+    int restart_markers;
+    int y_width;
+    int y_height;
+    int u_width;
+    int u_height;
+    int v_width;
+    int v_height;
+    int primary_image_width;
+    int primary_image_height;
+    JPEG_ENC_YUV_FORMAT yuv_format;
+    int exif_flag;
+    int y_left;
+    int y_top;
+    int y_total_width;
+    int y_total_height;
+    int u_left;
+    int u_top;
+    int u_total_width;
+    int u_total_height;
+    int v_left;
+    int v_top;
+    int v_total_width;
+    int v_total_height;
+    int raw_dat_flag;
+    jpeg_enc_jfif_params jfif_params;
+} jpeg_enc_parameters;
+
+typedef struct {
+    int size;
+    int alignment;
+    int memory_type;
+    void *memptr;
+} jpeg_enc_memory_info;
+
+typedef struct {
+    int no_entries;
+    jpeg_enc_memory_info mem_info[JPEG_ENC_MAX_NUM_MEM_REQS];
+} jpeg_enc_memory_infos;
+
+typedef struct jpeg_enc_object {
+    jpeg_enc_parameters parameters;
+    jpeg_enc_memory_infos mem_infos;
+    JPEG_ENC_UINT8 (*jpeg_enc_push_output)(JPEG_ENC_UINT8 **out_buf_ptrptr,
+            JPEG_ENC_UINT32 *out_buf_len_ptr, JPEG_ENC_UINT8 flush, void *context,
+            JPEG_ENC_MODE enc_mode);
+    void *context;
+} jpeg_enc_object;
+
+JPEG_ENC_RET_TYPE jpeg_enc_query_mem_req(jpeg_enc_object *obj_ptr);
+JPEG_ENC_RET_TYPE jpeg_enc_init(jpeg_enc_object *obj_ptr);
+JPEG_ENC_RET_TYPE jpeg_enc_encodeframe(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT8 *i_buff,
+        JPEG_ENC_UINT8 *y_buff, JPEG_ENC_UINT8 *u_buff, JPEG_ENC_UINT8 *v_buff);
+void jpeg_enc_find_length_position(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT32 *length_positions,
+        JPEG_ENC_UINT8 *num_positions, JPEG_ENC_UINT8 *app1_present);
+int jpeg_enc_set_exifheaderinfo(jpeg_enc_object *obj_ptr, int parameter, unsigned int value);
+const char *jpege_CodecVersionInfo();
+
+#endif
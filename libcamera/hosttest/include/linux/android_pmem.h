@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The kernel headers of the Freescale BSP the HAL includes, for the host
+ * build, see hosttest/Makefile. There is no /dev/pmem_adsp on the host,
+ * the memory pool falls back to memfd.
+ */
+
+#ifndef HOSTTEST_LINUX_ANDROID_PMEM_H
+#define HOSTTEST_LINUX_ANDROID_PMEM_H
+
+#include <linux/ioctl.h>
+
+#define PMEM_IOCTL_MAGIC 'p'
+#define PMEM_GET_PHYS           _IOW(PMEM_IOCTL_MAGIC, 1, unsigned int)
+#define PMEM_MAP                _IOW(PMEM_IOCTL_MAGIC, 2, unsigned int)
+#define PMEM_GET_SIZE           _IOW(PMEM_IOCTL_MAGIC, 3, unsigned int)
+#define PMEM_UNMAP              _IOW(PMEM_IOCTL_MAGIC, 4, unsigned int)
+#define PMEM_ALLOCATE           _IOW(PMEM_IOCTL_MAGIC, 5, unsigned int)
+#define PMEM_CONNECT            _IOW(PMEM_IOCTL_MAGIC, 6, unsigned int)
+#define PMEM_GET_TOTAL_SIZE     _IOW(PMEM_IOCTL_MAGIC, 7, unsigned int)
+
+struct pmem_region {
+    unsigned long offset;
+    unsigned long len;
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The kernel headers of the Freescale BSP the HAL includes, for the host
+ * build, see hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_LINUX_MXC_V4L2_H
+#define HOSTTEST_LINUX_MXC_V4L2_H
+
+#include <linux/videodev2.h>
+
+#define V4L2_CID_MXC_ROT                (V4L2_CID_PRIVATE_BASE + 0)
+#define V4L2_CID_MXC_FLASH              (V4L2_CID_PRIVATE_BASE + 1)
+
+#define V4L2_MXC_ROTATE_NONE            0
+#define V4L2_MXC_ROTATE_VERT_FLIP       1
+#define V4L2_MXC_ROTATE_HORIZ_FLIP      2
+#define V4L2_MXC_ROTATE_180             3
+#define V4L2_MXC_ROTATE_90_RIGHT        4
+
+#define V4L2_MXC_CAM_ROTATE_NONE        0
+#define V4L2_MXC_CAM_ROTATE_VERT_FLIP   1
+#define V4L2_MXC_CAM_ROTATE_HORIZ_FLIP  2
+#define V4L2_MXC_CAM_ROTATE_180         3
+
+/* dropped from the recent kernels, the BSP one still has it */
+#ifndef VIDIOC_DBG_G_CHIP_IDENT
+struct v4l2_dbg_chip_ident {
+    struct v4l2_dbg_match match;
+    __u32 ident;
+    __u32 revision;
+} __attribute__ ((packed));
+
+#define VIDIOC_DBG_G_CHIP_IDENT _IOWR('V', 81, struct v4l2_dbg_chip_ident)
+#endif
+
+#endif
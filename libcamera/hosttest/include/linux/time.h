@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The kernel headers of the Freescale BSP the HAL includes, for the host
+ * build, see hosttest/Makefile. The host <linux/time.h> clashes with the
+ * libc time types, bionic's does not.
+ */
+
+#ifndef HOSTTEST_LINUX_TIME_H
+#define HOSTTEST_LINUX_TIME_H
+
+#include <sys/time.h>
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * The part of the Freescale IPU library API PP_ipulib uses, for the host
+ * build, see hosttest/Makefile. The host has no IPU, task init always
+ * fails and the HAL uses the software post process device.
+ */
+
+#ifndef HOSTTEST_MXC_IPU_HL_LIB_H
+#define HOSTTEST_MXC_IPU_HL_LIB_H
+
+enum {
+    OP_NORMAL_MODE = 0x0,
+    OP_STREAM_MODE = 0x1
+};
+
+enum {
+    TASK_ENC_MODE = 0x8,
+    TASK_VF_MODE = 0x10,
+    TASK_PP_MODE = 0x20
+};
+
+typedef struct {
+    struct {
+        int x;
+        int y;
+    } pos;
+    int win_w;
+    int win_h;
+} ipu_lib_win_t;
+
+typedef struct {
+    int width;
+    int height;
+    int fmt;
+    ipu_lib_win_t input_crop_win;
+    int user_def_paddr[3];
+} ipu_lib_input_param_t;
+
+typedef struct {
+    int width;
+    int height;
+    int fmt;
+    int rot;
+    int show_to_fb;
+    int fb_disp;
+    ipu_lib_win_t output_win;
+    int user_def_paddr[3];
+} ipu_lib_output_param_t;
+
+typedef struct {
+    void *inbuf_start[3];
+    void *outbuf_start[3];
+    int ifr_size;
+    int ofr_size;
+    void *priv;
+} ipu_lib_handle_t;
+
+int mxc_ipu_lib_task_init(ipu_lib_input_param_t *input, ipu_lib_input_param_t *overlay,
+        ipu_lib_output_param_t *output, int mode, ipu_lib_handle_t *ipu_handle);
+void mxc_ipu_lib_task_uninit(ipu_lib_handle_t *ipu_handle);
+int mxc_ipu_lib_task_buf_update(ipu_lib_handle_t *ipu_handle, int new_inbuf_paddr,
+        int new_ovbuf_paddr, int new_ovbuf_alpha_paddr, void (output_callback)(void *, int),
+        void *output_cb_arg);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile. There is no display on the host, the HAL never gets
+ * an overlay.
+ */
+
+#ifndef HOSTTEST_UI_OVERLAY_H
+#define HOSTTEST_UI_OVERLAY_H
+
+#include <utils/RefBase.h>
+#include <utils/Errors.h>
+
+typedef void *overlay_buffer_t;
+
+enum {
+    OVERLAY_DITHER = 3,
+    OVERLAY_TRANSFORM = 4,
+    OVERLAY_MODE = 5
+};
+
+enum {
+    OVERLAY_PUSH_MODE = 1
+};
+
+namespace android {
+
+    class Overlay : public virtual RefBase
+    {
+    public:
+        status_t setParameter(int param, int value) { return NO_ERROR; }
+        status_t queueBuffer(overlay_buffer_t buffer) { return NO_ERROR; }
+    };
+
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, only the part
+ * of the API the HAL uses. See hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_ERRORS_H
+#define HOSTTEST_UTILS_ERRORS_H
+
+#include <errno.h>
+#include <sys/types.h>
+
+namespace android {
+
+    typedef int32_t status_t;
+
+    enum {
+        OK                = 0,
+        NO_ERROR          = 0,
+        UNKNOWN_ERROR     = 0x80000000,
+        NO_MEMORY         = -ENOMEM,
+        INVALID_OPERATION = -ENOSYS,
+        BAD_VALUE         = -EINVAL,
+        BAD_TYPE          = 0x80000001,
+        NAME_NOT_FOUND    = -ENOENT,
+        PERMISSION_DENIED = -EPERM,
+        NO_INIT           = -ENODEV,
+        ALREADY_EXISTS    = -EEXIST,
+        DEAD_OBJECT       = -EPIPE,
+        WOULD_BLOCK       = -EWOULDBLOCK,
+        TIMED_OUT         = -ETIMEDOUT
+    };
+
+};
+
+#endif
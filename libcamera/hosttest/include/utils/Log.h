@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_LOG_H
+#define HOSTTEST_UTILS_LOG_H
+
+#include <stdio.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG NULL
+#endif
+
+/* rw.camera.host.log=1 prints the info and debug logs too, errors are always printed */
+extern "C" int host_log_enabled(int prio);
+extern "C" void host_log_print(int prio, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define HOST_LOG_VERBOSE    2
+#define HOST_LOG_DEBUG      3
+#define HOST_LOG_INFO       4
+#define HOST_LOG_WARN       5
+#define HOST_LOG_ERROR      6
+
+#define HOST_LOG(prio, ...) \
+    do { if (host_log_enabled(prio)) host_log_print(prio, LOG_TAG, __VA_ARGS__); } while (0)
+
+#define LOGV(...) HOST_LOG(HOST_LOG_VERBOSE, __VA_ARGS__)
+#define LOGD(...) HOST_LOG(HOST_LOG_DEBUG, __VA_ARGS__)
+#define LOGI(...) HOST_LOG(HOST_LOG_INFO, __VA_ARGS__)
+#define LOGW(...) HOST_LOG(HOST_LOG_WARN, __VA_ARGS__)
+#define LOGE(...) HOST_LOG(HOST_LOG_ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android strong/weak pointers, see hosttest/Makefile.
+ * Same counting rules as libutils: onFirstRef() on the first strong
+ * reference, the object is deleted with its last strong reference and a
+ * wp only promotes while one is left.
+ */
+
+#ifndef HOSTTEST_UTILS_REFBASE_H
+#define HOSTTEST_UTILS_REFBASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+    template<typename T> class wp;
+
+    class RefBase
+    {
+    public:
+        void incStrong(const void *id) const;
+        void decStrong(const void *id) const;
+        int32_t getStrongCount() const;
+
+        class weakref_type
+        {
+        public:
+            RefBase *refBase() const;
+            void incWeak(const void *id);
+            void decWeak(const void *id);
+            bool attemptIncStrong(const void *id);
+        };
+
+        weakref_type *createWeak(const void *id) const;
+
+    protected:
+        RefBase();
+        virtual ~RefBase();
+
+        virtual void onFirstRef();
+
+    private:
+        friend class weakref_type;
+        class weakref_impl;
+
+        RefBase(const RefBase &o);
+        RefBase &operator=(const RefBase &o);
+
+        weakref_impl *const mRefs;
+    };
+
+    template<typename T>
+    class sp
+    {
+    public:
+        sp() : m_ptr(0) { }
+        sp(T *other) : m_ptr(other) { if (other) other->incStrong(this); }
+        sp(const sp<T> &other) : m_ptr(other.m_ptr) { if (m_ptr) m_ptr->incStrong(this); }
+        template<typename U> sp(U *other) : m_ptr(other) { if (other) other->incStrong(this); }
+        template<typename U> sp(const sp<U> &other) : m_ptr(other.get()) { if (m_ptr) m_ptr->incStrong(this); }
+        ~sp() { if (m_ptr) m_ptr->decStrong(this); }
+
+        sp &operator=(const sp<T> &other) { return assign(other.m_ptr); }
+        sp &operator=(T *other) { return assign(other); }
+        template<typename U> sp &operator=(const sp<U> &other) { return assign(other.get()); }
+        template<typename U> sp &operator=(U *other) { return assign(other); }
+
+        void clear() { assign(0); }
+
+        T &operator*() const { return *m_ptr; }
+        T *operator->() const { return m_ptr; }
+        T *get() const { return m_ptr; }
+
+        bool operator==(const sp<T> &o) const { return m_ptr == o.m_ptr; }
+        bool operator!=(const sp<T> &o) const { return m_ptr != o.m_ptr; }
+        bool operator==(const T *o) const { return m_ptr == o; }
+        bool operator!=(const T *o) const { return m_ptr != o; }
+        template<typename U> bool operator==(const sp<U> &o) const { return m_ptr == o.get(); }
+        template<typename U> bool operator!=(const sp<U> &o) const { return m_ptr != o.get(); }
+
+    private:
+        template<typename Y> friend class wp;
+
+        sp &assign(T *other)
+        {
+            if (other)
+                other->incStrong(this);
+            if (m_ptr)
+                m_ptr->decStrong(this);
+            m_ptr = other;
+            return *this;
+        }
+
+        T *m_ptr;
+    };
+
+    template<typename T>
+    class wp
+    {
+    public:
+        wp() : m_ptr(0), m_refs(0) { }
+        wp(T *other) : m_ptr(other), m_refs(other ? other->createWeak(this) : 0) { }
+        wp(const sp<T> &other) : m_ptr(other.get()), m_refs(m_ptr ? m_ptr->createWeak(this) : 0) { }
+        wp(const wp<T> &other) : m_ptr(other.m_ptr), m_refs(other.m_refs) { if (m_refs) m_refs->incWeak(this); }
+        ~wp() { if (m_refs) m_refs->decWeak(this); }
+
+        wp &operator=(T *other) { return assign(other, other ? other->createWeak(this) : 0); }
+        wp &operator=(const sp<T> &other)
+        {
+            T *p = other.get();
+            return assign(p, p ? p->createWeak(this) : 0);
+        }
+        wp &operator=(const wp<T> &other)
+        {
+            if (other.m_refs)
+                other.m_refs->incWeak(this);
+            return assign(other.m_ptr, other.m_refs);
+        }
+
+        sp<T> promote() const
+        {
+            sp<T> result;
+            if (m_ptr && m_refs->attemptIncStrong(&result))
+                result.m_ptr = m_ptr;
+            return result;
+        }
+
+        void clear() { assign(0, 0); }
+
+        bool operator==(const T *o) const { return m_ptr == o; }
+        bool operator!=(const T *o) const { return m_ptr != o; }
+
+    private:
+        /* takes over the weak reference the caller made on refs */
+        wp &assign(T *other, RefBase::weakref_type *refs)
+        {
+            if (m_refs)
+                m_refs->decWeak(this);
+            m_ptr = other;
+            m_refs = refs;
+            return *this;
+        }
+
+        T *m_ptr;
+        RefBase::weakref_type *m_refs;
+    };
+
+};
+
+#endif
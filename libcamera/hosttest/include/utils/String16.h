@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_STRING16_H
+#define HOSTTEST_UTILS_STRING16_H
+
+#include <utils/String8.h>
+
+namespace android {
+
+    /* the HAL only passes them through dump(), kept as utf-8 */
+    class String16
+    {
+    public:
+        String16() { }
+        String16(const char *o) : mString(o) { }
+
+        const char *string() const { return mString.string(); }
+
+    private:
+        String8 mString;
+    };
+
+};
+
+#endif
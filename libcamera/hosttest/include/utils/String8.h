@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_STRING8_H
+#define HOSTTEST_UTILS_STRING8_H
+
+#include <string>
+#include <utils/Errors.h>
+
+namespace android {
+
+    class String8
+    {
+    public:
+        String8() { }
+        String8(const char *o) : mString(o) { }
+
+        const char *string() const { return mString.c_str(); }
+        size_t size() const { return mString.size(); }
+        size_t length() const { return mString.size(); }
+
+        status_t setTo(const char *o) { mString = o; return NO_ERROR; }
+        status_t append(const char *o) { mString += o; return NO_ERROR; }
+        status_t append(const String8 &o) { mString += o.mString; return NO_ERROR; }
+        status_t appendFormat(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+        operator const char *() const { return mString.c_str(); }
+
+    private:
+        std::string mString;
+    };
+
+};
+
+#endif
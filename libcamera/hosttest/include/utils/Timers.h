@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_TIMERS_H
+#define HOSTTEST_UTILS_TIMERS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef int64_t nsecs_t;
+
+enum {
+    SYSTEM_TIME_REALTIME = 0,
+    SYSTEM_TIME_MONOTONIC = 1,
+    SYSTEM_TIME_PROCESS = 2,
+    SYSTEM_TIME_THREAD = 3
+};
+
+nsecs_t systemTime(int clock = SYSTEM_TIME_MONOTONIC);
+
+static inline nsecs_t seconds_to_nanoseconds(nsecs_t secs) { return secs * 1000000000; }
+static inline nsecs_t milliseconds_to_nanoseconds(nsecs_t secs) { return secs * 1000000; }
+static inline nsecs_t microseconds_to_nanoseconds(nsecs_t secs) { return secs * 1000; }
+static inline nsecs_t nanoseconds_to_seconds(nsecs_t secs) { return secs / 1000000000; }
+static inline nsecs_t nanoseconds_to_milliseconds(nsecs_t secs) { return secs / 1000000; }
+static inline nsecs_t nanoseconds_to_microseconds(nsecs_t secs) { return secs / 1000; }
+
+static inline nsecs_t s2ns(nsecs_t v) { return seconds_to_nanoseconds(v); }
+static inline nsecs_t ms2ns(nsecs_t v) { return milliseconds_to_nanoseconds(v); }
+static inline nsecs_t us2ns(nsecs_t v) { return microseconds_to_nanoseconds(v); }
+static inline nsecs_t ns2s(nsecs_t v) { return nanoseconds_to_seconds(v); }
+static inline nsecs_t ns2ms(nsecs_t v) { return nanoseconds_to_milliseconds(v); }
+static inline nsecs_t ns2us(nsecs_t v) { return nanoseconds_to_microseconds(v); }
+
+#endif
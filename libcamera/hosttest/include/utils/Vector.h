@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android headers the camera HAL includes, see
+ * hosttest/Makefile.
+ */
+
+#ifndef HOSTTEST_UTILS_VECTOR_H
+#define HOSTTEST_UTILS_VECTOR_H
+
+#include <vector>
+#include <sys/types.h>
+
+namespace android {
+
+    template<typename T>
+    class Vector
+    {
+    public:
+        size_t size() const { return mItems.size(); }
+        bool isEmpty() const { return mItems.empty(); }
+        const T &itemAt(size_t index) const { return mItems[index]; }
+        const T &operator[](size_t index) const { return mItems[index]; }
+        T &editItemAt(size_t index) { return mItems[index]; }
+        ssize_t add(const T &item) { mItems.push_back(item); return mItems.size() - 1; }
+        ssize_t push_back(const T &item) { return add(item); }
+        void clear() { mItems.clear(); }
+
+    private:
+        std::vector<T> mItems;
+    };
+
+};
+
+#endif
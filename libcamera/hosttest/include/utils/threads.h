@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Host build of the Android thread classes, see hosttest/Makefile. The
+ * priorities are accepted and ignored.
+ */
+
+#ifndef HOSTTEST_UTILS_THREADS_H
+#define HOSTTEST_UTILS_THREADS_H
+
+#include <pthread.h>
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+enum {
+    PRIORITY_LOWEST         =  19,
+    PRIORITY_BACKGROUND     =  10,
+    PRIORITY_NORMAL         =   0,
+    PRIORITY_FOREGROUND     =  -2,
+    PRIORITY_DISPLAY        =  -4,
+    PRIORITY_URGENT_DISPLAY =  -8,
+    PRIORITY_AUDIO          = -16,
+    PRIORITY_URGENT_AUDIO   = -19,
+    PRIORITY_HIGHEST        = -20,
+    PRIORITY_DEFAULT        = 0
+};
+
+namespace android {
+
+    class Condition;
+
+    class Mutex
+    {
+    public:
+        Mutex() { pthread_mutex_init(&mMutex, NULL); }
+        Mutex(const char *name) { pthread_mutex_init(&mMutex, NULL); }
+        ~Mutex() { pthread_mutex_destroy(&mMutex); }
+
+        status_t lock() { return -pthread_mutex_lock(&mMutex); }
+        void unlock() { pthread_mutex_unlock(&mMutex); }
+        status_t tryLock() { return -pthread_mutex_trylock(&mMutex); }
+
+        class Autolock
+        {
+        public:
+            Autolock(Mutex &mutex) : mLock(mutex) { mLock.lock(); }
+            Autolock(Mutex *mutex) : mLock(*mutex) { mLock.lock(); }
+            ~Autolock() { mLock.unlock(); }
+        private:
+            Mutex &mLock;
+        };
+
+    private:
+        friend class Condition;
+
+        Mutex(const Mutex &);
+        Mutex &operator=(const Mutex &);
+
+        pthread_mutex_t mMutex;
+    };
+
+    typedef Mutex::Autolock AutoMutex;
+
+    class Condition
+    {
+    public:
+        Condition();
+        ~Condition() { pthread_cond_destroy(&mCond); }
+
+        status_t wait(Mutex &mutex) { return -pthread_cond_wait(&mCond, &mutex.mMutex); }
+        status_t waitRelative(Mutex &mutex, nsecs_t reltime);
+        void signal() { pthread_cond_signal(&mCond); }
+        void broadcast() { pthread_cond_broadcast(&mCond); }
+
+    private:
+        pthread_cond_t mCond;
+    };
+
+    /*
+     * threadLoop() runs until it returns false or an exit is requested. The
+     * thread keeps a strong reference on itself while it runs, like the
+     * libutils one, so the owner may drop its sp at any time.
+     */
+    class Thread : virtual public RefBase
+    {
+    public:
+        Thread(bool canCallJava = true);
+        virtual ~Thread();
+
+        virtual status_t run(const char *name = 0, int32_t priority = PRIORITY_DEFAULT,
+                size_t stack = 0);
+        virtual void requestExit();
+        virtual status_t readyToRun();
+        status_t requestExitAndWait();
+        bool isRunning() const;
+
+    protected:
+        bool exitPending() const;
+
+    private:
+        virtual bool threadLoop() = 0;
+        static void *threadEntry(void *user);
+
+        Thread &operator=(const Thread &);
+
+        mutable Mutex   mLock;
+        Condition       mThreadExitedCondition;
+        status_t        mStatus;
+        volatile bool   mExitPending;
+        volatile bool   mRunning;
+        pthread_t       mThread;
+        sp<Thread>      mHoldSelf;
+    };
+
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Checks that PPIpuLib sets the IPU task up once per configuration. It is
+ * linked against a counting IPU library instead of host_vendor.cpp:
+ *
+ *   make -C libcamera/hosttest test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "PP_ipulib.h"
+
+using namespace android;
+
+static int sTaskInits, sTaskUninits, sBufUpdates;
+static int sLastInPaddr, sLastOutPaddr;
+static bool sFailUpdate;
+
+extern "C" int mxc_ipu_lib_task_init(ipu_lib_input_param_t *input, ipu_lib_input_param_t *overlay,
+        ipu_lib_output_param_t *output, int mode, ipu_lib_handle_t *ipu_handle)
+{
+    sTaskInits ++;
+    return 0;
+}
+
+extern "C" void mxc_ipu_lib_task_uninit(ipu_lib_handle_t *ipu_handle)
+{
+    sTaskUninits ++;
+}
+
+extern "C" int mxc_ipu_lib_task_buf_update(ipu_lib_handle_t *ipu_handle, int new_inbuf_paddr,
+        int new_ovbuf_paddr, int new_ovbuf_alpha_paddr, void (output_callback)(void *, int),
+        void *output_cb_arg)
+{
+    sBufUpdates ++;
+    sLastInPaddr = new_inbuf_paddr;
+    sLastOutPaddr = new_ovbuf_paddr;
+    return sFailUpdate ? -1 : 0;
+}
+
+static int sFailures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            sFailures ++; \
+        } \
+    } while (0)
+
+static void setConfig(pp_input_param_t *in, pp_output_param_t *out, unsigned int width, unsigned int height)
+{
+    memset(in, 0, sizeof(*in));
+    memset(out, 0, sizeof(*out));
+    in->width = width;
+    in->height = height;
+    in->fmt = v4l2_fourcc('Y', 'U', 'Y', 'V');
+    in->input_crop_win.win_w = width;
+    in->input_crop_win.win_h = height;
+    out->width = width;
+    out->height = height;
+    out->fmt = v4l2_fourcc('N', 'V', '1', '2');
+    out->output_win.win_w = width;
+    out->output_win.win_h = height;
+}
+
+//one preview frame, as the HAL post process thread does it
+static PPDEVICE_ERR_RET runFrame(const sp<PostProcessDeviceInterface> &device, pp_input_param_t *in,
+        pp_output_param_t *out, int frame)
+{
+    DMA_BUFFER inBuf, outBuf;
+    PPDEVICE_ERR_RET ret;
+
+    in->user_def_paddr = 0x10000000 + frame * 0x100000;
+    out->user_def_paddr = 0x20000000 + frame * 0x100000;
+    if ((ret = device->PPDeviceInit(in, out)) != PPDEVICE_ERROR_NONE)
+        return ret;
+    memset(&inBuf, 0, sizeof(inBuf));
+    memset(&outBuf, 0, sizeof(outBuf));
+    inBuf.phy_offset = in->user_def_paddr;
+    outBuf.phy_offset = out->user_def_paddr;
+    return device->DoPorcess(&inBuf, &outBuf);
+}
+
+int main()
+{
+    sp<PostProcessDeviceInterface> device = PPIpuLib::createInstance();
+    pp_input_param_t in;
+    pp_output_param_t out;
+    int frame;
+
+    //the same configuration frame after frame, only the buffers change
+    setConfig(&in, &out, 640, 480);
+    for (frame = 0; frame < 30; frame++)
+        CHECK(runFrame(device, &in, &out, frame) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 1);
+    CHECK(sTaskUninits == 0);
+    CHECK(sBufUpdates == 30);
+    CHECK(sLastInPaddr == 0x10000000 + 29 * 0x100000);
+    CHECK(sLastOutPaddr == 0x20000000 + 29 * 0x100000);
+
+    //any change of the size, the window or the rotation sets the task up again
+    setConfig(&in, &out, 1280, 720);
+    for (frame = 0; frame < 10; frame++)
+        CHECK(runFrame(device, &in, &out, frame) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 2);
+    CHECK(sTaskUninits == 1);
+    out.rot = 4;
+    CHECK(runFrame(device, &in, &out, 0) == PPDEVICE_ERROR_NONE);
+    CHECK(runFrame(device, &in, &out, 1) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 3);
+    in.input_crop_win.pos.x = 16;
+    in.input_crop_win.win_w -= 32;
+    CHECK(runFrame(device, &in, &out, 2) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 4);
+    CHECK(sTaskUninits == 3);
+
+    //back to the first configuration
+    setConfig(&in, &out, 640, 480);
+    CHECK(runFrame(device, &in, &out, 0) == PPDEVICE_ERROR_NONE);
+    CHECK(runFrame(device, &in, &out, 1) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 5);
+
+    //a deinit, at the end of a preview, drops the task
+    CHECK(device->PPDeviceDeInit() == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskUninits == 5);
+    CHECK(device->PPDeviceDeInit() == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskUninits == 5);
+    CHECK(runFrame(device, &in, &out, 0) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 6);
+
+    //a failed frame drops the task, the next frame sets it up again
+    sFailUpdate = true;
+    CHECK(runFrame(device, &in, &out, 1) == PPDEVICE_ERROR_PROCESS);
+    CHECK(sTaskUninits == 6);
+    sFailUpdate = false;
+    CHECK(runFrame(device, &in, &out, 2) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 7);
+
+    //the device is shared, a second user gets the same task
+    CHECK(PPIpuLib::createInstance() == device);
+    CHECK(runFrame(PPIpuLib::createInstance(), &in, &out, 3) == PPDEVICE_ERROR_NONE);
+    CHECK(sTaskInits == 7);
+
+    device.clear();
+    CHECK(sTaskUninits == 7);
+
+    printf("ipu task: %d inits, %d uninits, %d buffer updates, %s\n", sTaskInits, sTaskUninits,
+            sBufUpdates, sFailures == 0 ? "ok" : "FAILED");
+    return sFailures == 0 ? 0 : 1;
+}
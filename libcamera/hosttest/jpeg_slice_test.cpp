@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * Encodes pictures with JpegEncoderSoftware split into 1 to 8 slices and
+ * checks the joined stream: the SOF carries the picture height, the scan
+ * has one restart marker per MCU row in RST0..RST7 order, and it decodes
+ * to the same pixels as the picture encoded in one piece. The Freescale
+ * codec is arm only, this test links a stand-in for its API built on
+ * libjpeg instead of host_vendor.cpp:
+ *
+ *   make -C libcamera/hosttest test
+ *   out/jpeg_slice_test -r 5
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <jpeglib.h>
+#include <cutils/properties.h>
+#include <utils/Timers.h>
+#include "JpegEncoderSoftware.h"
+
+using namespace android;
+
+/* ---------------------------------------------------------------------- */
+/* the Freescale codec API on libjpeg, planar 4:2:0 and 4:2:2 input only */
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} HOST_JPEG_ERROR;
+
+typedef struct {
+    struct jpeg_destination_mgr pub;
+    jpeg_enc_object *obj;
+    JPEG_ENC_UINT8 *buf;
+    JPEG_ENC_UINT32 len;
+    HOST_JPEG_ERROR *err;
+} HOST_JPEG_DEST;
+
+static void hostJpegErrorExit(j_common_ptr cinfo)
+{
+    longjmp(((HOST_JPEG_ERROR *)cinfo->err)->jump, 1);
+}
+
+static void hostJpegInitDest(j_compress_ptr cinfo)
+{
+    HOST_JPEG_DEST *dest = (HOST_JPEG_DEST *)cinfo->dest;
+
+    dest->buf = NULL;
+    dest->len = 0;
+    dest->obj->jpeg_enc_push_output(&dest->buf, &dest->len, 0, dest->obj->context,
+            dest->obj->parameters.mode);
+    dest->pub.next_output_byte = dest->buf;
+    dest->pub.free_in_buffer = dest->buf != NULL ? dest->len : 0;
+}
+
+//the whole jpeg has to fit the buffer the HAL gave
+static boolean hostJpegEmptyDest(j_compress_ptr cinfo)
+{
+    HOST_JPEG_DEST *dest = (HOST_JPEG_DEST *)cinfo->dest;
+
+    dest->obj->jpeg_enc_push_output(&dest->buf, &dest->len, 0, dest->obj->context,
+            dest->obj->parameters.mode);
+    longjmp(dest->err->jump, 1);
+    return FALSE;
+}
+
+static void hostJpegTermDest(j_compress_ptr cinfo)
+{
+    HOST_JPEG_DEST *dest = (HOST_JPEG_DEST *)cinfo->dest;
+
+    dest->len = dest->pub.next_output_byte - dest->buf;
+    dest->obj->jpeg_enc_push_output(&dest->buf, &dest->len, 1, dest->obj->context,
+            dest->obj->parameters.mode);
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_query_mem_req(jpeg_enc_object *obj_ptr)
+{
+    obj_ptr->mem_infos.no_entries = 0;
+    return JPEG_ENC_ERR_NO_ERROR;
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_init(jpeg_enc_object *obj_ptr)
+{
+    jpeg_enc_parameters *params = &obj_ptr->parameters;
+
+    if (params->compression_method != JPEG_ENC_SEQUENTIAL ||
+            (params->yuv_format != JPEG_ENC_YUV_420_NONINTERLEAVED &&
+             params->yuv_format != JPEG_ENC_YUV_422_NONINTERLEAVED))
+        return JPEG_ENC_ERR_INVALID_PARAM;
+    return JPEG_ENC_ERR_NO_ERROR;
+}
+
+JPEG_ENC_RET_TYPE jpeg_enc_encodeframe(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT8 *i_buff,
+        JPEG_ENC_UINT8 *y_buff, JPEG_ENC_UINT8 *u_buff, JPEG_ENC_UINT8 *v_buff)
+{
+    jpeg_enc_parameters *params = &obj_ptr->parameters;
+    int vSamp = params->yuv_format == JPEG_ENC_YUV_420_NONINTERLEAVED ? 2 : 1;
+    int lines = DCTSIZE * vSamp;
+    struct jpeg_compress_struct cinfo;
+    HOST_JPEG_ERROR err;
+    HOST_JPEG_DEST dest;
+    JSAMPROW yRows[2 * DCTSIZE], uRows[DCTSIZE], vRows[DCTSIZE];
+    JSAMPARRAY planes[3] = {yRows, uRows, vRows};
+    int i;
+
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = hostJpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        return JPEG_ENC_ERR_INVALID_PARAM;
+    }
+    jpeg_create_compress(&cinfo);
+
+    memset(&dest, 0, sizeof(dest));
+    dest.pub.init_destination = hostJpegInitDest;
+    dest.pub.empty_output_buffer = hostJpegEmptyDest;
+    dest.pub.term_destination = hostJpegTermDest;
+    dest.obj = obj_ptr;
+    dest.err = &err;
+    cinfo.dest = &dest.pub;
+
+    cinfo.image_width = params->y_width;
+    cinfo.image_height = params->y_height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+    jpeg_set_quality(&cinfo, params->quality, TRUE);
+    cinfo.raw_data_in = TRUE;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = vSamp;
+    cinfo.comp_info[1].h_samp_factor = cinfo.comp_info[1].v_samp_factor = 1;
+    cinfo.comp_info[2].h_samp_factor = cinfo.comp_info[2].v_samp_factor = 1;
+    cinfo.restart_interval = params->restart_markers;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    //the last MCU row repeats the bottom line
+    while (cinfo.next_scanline < cinfo.image_height) {
+        int line = cinfo.next_scanline;
+        for (i = 0; i < lines; i++) {
+            int y = line + i < params->y_height ? line + i : params->y_height - 1;
+            yRows[i] = y_buff + y * params->y_width;
+        }
+        for (i = 0; i < DCTSIZE; i++) {
+            int c = line / vSamp + i < params->u_height ? line / vSamp + i : params->u_height - 1;
+            uRows[i] = u_buff + c * params->u_width;
+            vRows[i] = v_buff + c * params->v_width;
+        }
+        jpeg_write_raw_data(&cinfo, planes, lines);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return JPEG_ENC_ERR_ENCODINGCOMPLETE;
+}
+
+void jpeg_enc_find_length_position(jpeg_enc_object *obj_ptr, JPEG_ENC_UINT32 *length_positions,
+        JPEG_ENC_UINT8 *num_positions, JPEG_ENC_UINT8 *app1_present)
+{
+    *num_positions = 0;
+    *app1_present = 0;
+}
+
+int jpeg_enc_set_exifheaderinfo(jpeg_enc_object *obj_ptr, int parameter, unsigned int value)
+{
+    return 0;
+}
+
+const char *jpege_CodecVersionInfo()
+{
+    return "libjpeg stand-in";
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int sFailures;
+
+#define FAIL(fmt, ...) do { \
+        printf("FAIL " fmt "\n", ##__VA_ARGS__); \
+        sFailures ++; \
+    } while (0)
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+    int restartInterval;
+    int restarts;
+    bool inOrder;
+} STREAM_SUMMARY;
+
+//walks the markers of a jpeg and the restart markers in its scan
+static bool summarize(const unsigned char *data, unsigned int len, STREAM_SUMMARY *s)
+{
+    unsigned int pos = 2;
+
+    memset(s, 0, sizeof(*s));
+    s->inOrder = true;
+    if (len < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+    while (pos + 4 <= len) {
+        unsigned char marker = data[pos + 1];
+        unsigned int segLen = (data[pos + 2] << 8) | data[pos + 3];
+
+        if (data[pos] != 0xFF || pos + 2 + segLen > len)
+            return false;
+        if (marker == 0xC0) {
+            s->height = (data[pos + 5] << 8) | data[pos + 6];
+            s->width = (data[pos + 7] << 8) | data[pos + 8];
+        }else if (marker == 0xDD) {
+            s->restartInterval = (data[pos + 4] << 8) | data[pos + 5];
+        }
+        pos += 2 + segLen;
+        if (marker == 0xDA)
+            break;
+    }
+    for (; pos + 1 < len; pos++) {
+        if (data[pos] != 0xFF || data[pos + 1] == 0x00)
+            continue;
+        if (data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7) {
+            if (data[pos + 1] != 0xD0 + (s->restarts & 7))
+                s->inOrder = false;
+            s->restarts ++;
+        }else if (data[pos + 1] == 0xD9) {
+            return pos + 2 == len;
+        }else{
+            return false;
+        }
+    }
+    return false;
+}
+
+//decodes to YCbCr, with any libjpeg warning, a bad restart marker included, as an error
+static unsigned char *decode(const unsigned char *data, unsigned int len, unsigned int *size)
+{
+    struct jpeg_decompress_struct cinfo;
+    HOST_JPEG_ERROR err;
+    unsigned char *pixels = NULL;
+    JSAMPROW row;
+
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = hostJpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(pixels);
+        return NULL;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)data, len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_YCbCr;
+    jpeg_start_decompress(&cinfo);
+    *size = cinfo.output_width * cinfo.output_height * cinfo.output_components;
+    pixels = (unsigned char *)malloc(*size);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        row = pixels + cinfo.output_scanline * cinfo.output_width * cinfo.output_components;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    if (err.pub.num_warnings > 0) {
+        printf("  libjpeg: %ld warnings decoding the stream\n", err.pub.num_warnings);
+        free(pixels);
+        pixels = NULL;
+    }
+    jpeg_destroy_decompress(&cinfo);
+    return pixels;
+}
+
+//a smooth picture with a noisy band, so the scan has 0xFF bytes to stuff
+static void fillPicture(unsigned char *p, unsigned int fmt, int width, int height)
+{
+    int chromaHeight = fmt == v4l2_fourcc('N','V','1','6') ? height : height / 2;
+    unsigned int seed = 1;
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            seed = seed * 1103515245 + 12345;
+            p[y * width + x] = (x + y) / 4 + ((x / 64 + y / 64) & 1 ? (seed >> 16) & 0x3F : 0);
+        }
+    }
+    p += width * height;
+    for (y = 0; y < chromaHeight; y++) {
+        for (x = 0; x < width; x++)
+            p[y * width + x] = 128 + ((x * 3 + y * 5) & 0x3F) - 32;
+    }
+}
+
+static unsigned int frameSize(unsigned int fmt, int width, int height)
+{
+    return fmt == v4l2_fourcc('N','V','1','6') ? width * height * 2 : width * height * 3 / 2;
+}
+
+static const struct {
+    int width, height;
+    unsigned int fmt;
+} sPictures[] = {
+    {1280, 720, v4l2_fourcc('N','V','1','2')},
+    {2592, 1944, v4l2_fourcc('N','V','1','2')},
+    {1296, 970, v4l2_fourcc('Y','U','1','2')},
+    {640, 480, v4l2_fourcc('N','V','1','6')},
+    {1920, 1080, v4l2_fourcc('N','V','2','1')},
+};
+
+int main(int argc, char **argv)
+{
+    sp<JpegEncoderInterface> encoder;
+    int repeats = 2, maxSlices = MAX_JPEG_ENC_SLICE_NUM;
+    int opt, i, t, r;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r':
+                repeats = atoi(optarg);
+                if (repeats < 1)
+                    repeats = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r encodes per slice count]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    //the pool has to have a thread for every slice
+    property_set("rw.camera.threads", "8");
+    encoder = JpegEncoderSoftware::createInstance();
+
+    printf("jpeg slices: encode ms for 1..%d slices, %ld cpus\n", maxSlices, sysconf(_SC_NPROCESSORS_ONLN));
+    for (i = 0; i < (int)(sizeof(sPictures) / sizeof(sPictures[0])); i++) {
+        int width = sPictures[i].width, height = sPictures[i].height;
+        unsigned int fmt = sPictures[i].fmt;
+        int mcuHeight = fmt == v4l2_fourcc('N','V','1','6') ? 8 : 16;
+        int mcuRows = (height + mcuHeight - 1) / mcuHeight;
+        int bands = (mcuRows + JPEG_ENC_SLICE_MCU_ROWS - 1) / JPEG_ENC_SLICE_MCU_ROWS;
+        unsigned int outSize = width * height * 3 / 2;
+        unsigned char *picture = (unsigned char *)malloc(frameSize(fmt, width, height));
+        unsigned char *jpeg = (unsigned char *)malloc(outSize);
+        unsigned char *reference = NULL;
+        unsigned int referenceSize = 0;
+        enc_cfg_param cfg;
+        DMA_BUFFER inBuf, outBuf;
+        struct jpeg_encoding_conf conf;
+
+        fillPicture(picture, fmt, width, height);
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.PicWidth = width;
+        cfg.PicHeight = height;
+        cfg.BufFmt = fmt;
+        cfg.Quality = 90;
+        memset(&inBuf, 0, sizeof(inBuf));
+        inBuf.virt_start = picture;
+        inBuf.length = frameSize(fmt, width, height);
+        memset(&outBuf, 0, sizeof(outBuf));
+        outBuf.virt_start = jpeg;
+        outBuf.length = outSize;
+
+        printf("  %4dx%-4d %.4s", width, height, (const char *)&fmt);
+        for (t = 1; t <= maxSlices; t++) {
+            int slices = t < bands ? t : bands;
+            nsecs_t best = 0;
+            STREAM_SUMMARY s;
+            unsigned char *pixels;
+            unsigned int size;
+            char value[PROPERTY_VALUE_MAX];
+
+            snprintf(value, sizeof(value), "%d", t);
+            property_set("rw.camera.jpeg.threads", value);
+            if (encoder->JpegEncoderInit(&cfg) != JPEG_ENC_ERROR_NONE) {
+                FAIL("%dx%d: JpegEncoderInit", width, height);
+                break;
+            }
+            for (r = 0; r < repeats; r++) {
+                nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+                conf.output_jpeg_size = 0;
+                if (encoder->DoEncode(&inBuf, &outBuf, &conf) != JPEG_ENC_ERROR_NONE) {
+                    FAIL("%dx%d, %d slices: DoEncode", width, height, t);
+                    break;
+                }
+                start = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+                if (r == 0 || start < best)
+                    best = start;
+            }
+            printf(" %6.1f", best / 1e6);
+            fflush(stdout);
+
+            if (!summarize(jpeg, conf.output_jpeg_size, &s)) {
+                FAIL("%dx%d, %d slices: the stream does not parse", width, height, t);
+                continue;
+            }
+            if (s.width != (unsigned int)width || s.height != (unsigned int)height)
+                FAIL("%dx%d, %d slices: the SOF says %ux%u", width, height, t, s.width, s.height);
+            //one slice is the picture in one piece, without restart markers
+            if (slices > 1 && (s.restartInterval != (width + 15) / 16 || s.restarts != mcuRows - 1 || !s.inOrder))
+                FAIL("%dx%d, %d slices: restart interval %d, %d restart markers%s, %d MCU rows",
+                        width, height, t, s.restartInterval, s.restarts, s.inOrder ? "" : " out of order", mcuRows);
+            if (slices == 1 && s.restarts != 0)
+                FAIL("%dx%d, one slice: %d restart markers", width, height, s.restarts);
+
+            pixels = decode(jpeg, conf.output_jpeg_size, &size);
+            if (pixels == NULL) {
+                FAIL("%dx%d, %d slices: the stream does not decode cleanly", width, height, t);
+            }else if (reference == NULL) {
+                reference = pixels;
+                referenceSize = size;
+            }else{
+                if (size != referenceSize || memcmp(pixels, reference, size) != 0)
+                    FAIL("%dx%d, %d slices: decodes to other pixels than one slice", width, height, t);
+                free(pixels);
+            }
+        }
+        printf("\n");
+        free(reference);
+        free(picture);
+        free(jpeg);
+    }
+
+    encoder.clear();
+    printf("jpeg slices: %s\n", sFailures == 0 ? "ok" : "FAILED");
+    return sFailures == 0 ? 0 : 1;
+}
@@ -26,7 +26,14 @@ LOCAL_SRC_FILES:=    \
 	PostProcessDeviceInterface.cpp \
 	PP_ipulib.cpp    \
 	JpegEncoderInterface.cpp \
-    JpegEncoderSoftware.cpp
+    JpegEncoderSoftware.cpp \
+	Camera_convert.cpp \
+	Camera_stage.cpp
+
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_SRC_FILES += Camera_convert_neon.cpp.neon
+    LOCAL_CPPFLAGS += -DCAMERA_CONVERT_HAVE_NEON
+endif
 
 LOCAL_CPPFLAGS +=
 
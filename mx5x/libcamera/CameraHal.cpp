@@ -57,6 +57,8 @@ namespace android {
         mPreviewRunning(0),
         mPreviewFormat(V4L2_PIX_FMT_NV12), //the optimized selected format, hard code
         mPreviewFrameSize(0),
+        mPreviewCbFormat(V4L2_PIX_FMT_NV21),
+        mPreviewCbFrameSize(0),
         mTakePicFlag(false),
         mUvcSpecialCaptureFormat(V4L2_PIX_FMT_YUYV),
         mCaptureFrameSize(0),
@@ -75,6 +77,7 @@ namespace android {
 		bDerectInput(false),
         mPPDeviceNeedForPic(false),
         mPowerLock(false),
+        mStageAborted(false),
         mPreviewRotate(CAMERA_PREVIEW_BACK_REF)
     {
         CAMERA_HAL_LOG_FUNC;
@@ -444,6 +447,23 @@ namespace android {
 
     status_t CameraHal::dump(int fd, const Vector<String16>& args) const
     {
+        const size_t SIZE = 256;
+        char buffer[SIZE];
+        String8 result;
+        const CameraStageSignal *signals[] = {&avab_dequeue_frame, &avab_pp_in_frame,
+            &avab_pp_out_frame, &avab_show_frame, &avab_enc_frame, &avab_enc_frame_finish};
+
+        snprintf(buffer, SIZE, "Camera HAL: preview %s, record %s, error %d\n",
+                mPreviewRunning ? "running" : "stopped",
+                mRecordRunning ? "running" : "stopped", error_status);
+        result.append(buffer);
+        for (unsigned int i = 0; i < sizeof(signals)/sizeof(signals[0]); i++) {
+            snprintf(buffer, SIZE, "  stage %-12s pending %d posts %u wakeups %u\n",
+                    signals[i]->getName(), signals[i]->getCount(),
+                    signals[i]->getPosts(), signals[i]->getWakeups());
+            result.append(buffer);
+        }
+        write(fd, result.string(), result.size());
         return NO_ERROR;
     }
 
@@ -810,11 +830,11 @@ namespace android {
 		if (bDerectInput == true) {
 			if (!mPPDeviceNeed){
 				for(i = 0 ; i < mCaptureBufNum; i ++) {
-					sem_post(&avab_enc_frame_finish);
+					avab_enc_frame_finish.post();
 				}
 			}else{
 				for(i = 0 ; i < mPPbufNum; i ++) {
-					sem_post(&avab_enc_frame_finish);
+					avab_enc_frame_finish.post();
 				}
 			}
 
@@ -832,7 +852,7 @@ namespace android {
         mRecordRunning = false;
 		if (bDerectInput == true) 
 			//bDerectInput = false;
-			sem_post(&avab_enc_frame_finish);
+			avab_enc_frame_finish.post();
 		}
 
     void CameraHal::releaseRecordingFrame(const sp<IMemory>& mem)
@@ -848,7 +868,7 @@ namespace android {
         mVideoBufferUsing[index] = 0;
 
 		if (bDerectInput == true)
-			sem_post(&avab_enc_frame_finish);
+			avab_enc_frame_finish.post();
     }
 
     bool CameraHal::recordingEnabled()
@@ -1014,7 +1034,6 @@ namespace android {
             mPPOutputParam.user_def_paddr = mPPbuf[0].phy_offset;
             mPPDevice->PPDeviceInit(&mPPInputParam, &mPPOutputParam);
             mPPDevice->DoPorcess(&(mCaptureBuffers[DeQueBufIdx]), &(mPPbuf[0]));
-            mPPDevice->PPDeviceDeInit();
             Buf_input = mPPbuf[0];
         }else{
             Buf_input = mCaptureBuffers[DeQueBufIdx];
@@ -1036,6 +1055,8 @@ namespace android {
         JpegMemBase = new MemoryBase(JpegImageHeap, 0, JpegEncConf.output_jpeg_size);
 
 Pic_out:
+        if (mPPDeviceNeedForPic)
+            mPPDevice->PPDeviceDeInit();
         mCaptureDevice->DevStop();
         //mCaptureDevice->DevDeAllocate();
         freeBuffersToNativeWindow();
@@ -1438,6 +1459,7 @@ Pic_out:
     {
         CAMERA_HAL_LOG_FUNC;
         mPreviewRunning = 0;
+        AbortStageSignals();
         if (mCaptureFrameThread!= 0){
             mCaptureFrameThread->requestExitAndWait();
             mCaptureFrameThread.clear();
@@ -1460,18 +1482,24 @@ Pic_out:
         return ;
     }
 
+    void CameraHal :: AbortStageSignals()
+    {
+        CAMERA_HAL_LOG_FUNC;
+        //wake up every stage thread, they will leave their loop
+        mStageAborted = true;
+        avab_dequeue_frame.abort();
+        avab_show_frame.abort();
+        avab_enc_frame.abort();
+        avab_enc_frame_finish.abort();
+        avab_pp_in_frame.abort();
+        avab_pp_out_frame.abort();
+    }
+
     void CameraHal :: CameraHALStopMisc()
     {
         CAMERA_HAL_LOG_FUNC;
-        sem_destroy(&avab_dequeue_frame);
-        sem_destroy(&avab_show_frame);
-        sem_destroy(&avab_enc_frame);
-        sem_destroy(&avab_enc_frame_finish);
-        if(mPPDeviceNeed){
-            sem_destroy(&avab_pp_in_frame);
-            sem_destroy(&avab_pp_out_frame);
-        }
         if(mPPDeviceNeed){
+            mPPDevice->PPDeviceDeInit();
             for (unsigned int i = 0; i < mPPbufNum; i++){
                 mPmemAllocator->deAllocate(&mPPbuf[i]);
             }
@@ -1586,15 +1614,23 @@ Pic_out:
             else 
                 mPreviewFrameSize = mCaptureDeviceCfg.width*mCaptureDeviceCfg.height *2;
 
-            //now the preview fmt is supposed to be YUV420SP, so, it is now hard code here
+            //the callback buffers hold the frame in the format the application asked for
+            if (strcmp(mParameters.getPreviewFormat(), "yuv420p") == 0) {
+                mPreviewCbFormat = V4L2_PIX_FMT_YVU420;
+                mPreviewCbFrameSize = getYV12FrameSize(mCaptureDeviceCfg.width, mCaptureDeviceCfg.height);
+            }else{
+                mPreviewCbFormat = V4L2_PIX_FMT_NV21;
+                mPreviewCbFrameSize = mCaptureDeviceCfg.width*mCaptureDeviceCfg.height*3/2;
+            }
+
             mPreviewHeap.clear();
             for (i = 0; i< mPreviewHeapBufNum; i++)
                 mPreviewBuffers[i].clear();
-            mPreviewHeap = new MemoryHeapBase(mPreviewFrameSize * mPreviewHeapBufNum);
+            mPreviewHeap = new MemoryHeapBase(mPreviewCbFrameSize * mPreviewHeapBufNum);
             if (mPreviewHeap == NULL)
                 return NO_MEMORY;
             for (i = 0; i < mPreviewHeapBufNum; i++)
-                mPreviewBuffers[i] = new MemoryBase(mPreviewHeap, mPreviewFrameSize* i, mPreviewFrameSize);
+                mPreviewBuffers[i] = new MemoryBase(mPreviewHeap, mPreviewCbFrameSize* i, mPreviewCbFrameSize);
         }
         /*allocate the buffer for IPU process*/
         if (mPPDeviceNeed || mPPDeviceNeedForPic){
@@ -1623,16 +1659,17 @@ Pic_out:
         pp_in_head   = 0;
         pp_out_head  = 0;
         error_status = 0;
+        mStageAborted = false;
         is_first_buffer = 1;
         last_display_index = 0;
 
-        sem_init(&avab_dequeue_frame, 0, mCaptureBufNum);
-        sem_init(&avab_show_frame, 0, 0);
-        sem_init(&avab_enc_frame, 0, 0);
-		sem_init(&avab_enc_frame_finish, 0, 0);
+        avab_dequeue_frame.reset("capture", mCaptureBufNum);
+        avab_show_frame.reset("display", 0);
+        avab_enc_frame.reset("encode", 0);
+		avab_enc_frame_finish.reset("encode-done", 0);
 		if(mPPDeviceNeed){
-            sem_init(&avab_pp_in_frame, 0, 0);
-            sem_init(&avab_pp_out_frame, 0, mPPbufNum);
+            avab_pp_in_frame.reset("pp-in", 0);
+            avab_pp_out_frame.reset("pp-out", mPPbufNum);
         }
         return ret;
     }
@@ -1669,17 +1706,16 @@ Pic_out:
         CAMERA_HAL_LOG_FUNC;
 
         unsigned int DeqBufIdx = 0;
-        struct timespec ts;
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_dequeue_frame, &ts) != 0) );
 
-        if(!mPreviewRunning || error_status)
+        if (!avab_dequeue_frame.wait())
             return UNKNOWN_ERROR;
 
-        mCaptureDevice->DevDequeue(&DeqBufIdx);
+        if (mCaptureDevice->DevDequeue(&DeqBufIdx) < 0){
+            CAMERA_HAL_ERR("The Capture device dequeue buf error !!!!");
+            error_status = 1;
+            AbortStageSignals();
+            return INVALID_OPERATION;
+        }
 
         nCameraBuffersQueued--;
 
@@ -1688,10 +1724,10 @@ Pic_out:
         dequeue_head %= mCaptureBufNum;
 
         if(!mPPDeviceNeed){
-            sem_post(&avab_show_frame);
-            sem_post(&avab_enc_frame);
+            avab_show_frame.post();
+            avab_enc_frame.post();
         }else{
-            sem_post(&avab_pp_in_frame);
+            avab_pp_in_frame.post();
         }
 
         return NO_ERROR;
@@ -1702,20 +1738,10 @@ Pic_out:
         CAMERA_HAL_LOG_FUNC;
         int PPInIdx = 0, PPoutIdx = 0;
         DMA_BUFFER PPInBuf, PPoutBuf;
-        struct timespec ts;
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_pp_in_frame, &ts) != 0) );
-
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (mPreviewRunning && !error_status &&(sem_timedwait(&avab_pp_out_frame, &ts) != 0) );
-
 
-        if(!mPreviewRunning || error_status)
+        if (!avab_pp_in_frame.wait())
+            return UNKNOWN_ERROR;
+        if (!avab_pp_out_frame.wait())
             return UNKNOWN_ERROR;
         PPInIdx = buffer_index_maps[pp_in_head];
         PPInBuf = mCaptureBuffers[PPInIdx];
@@ -1730,20 +1756,20 @@ Pic_out:
         pthread_mutex_lock(&mPPIOParamMutex);
         mPPInputParam.user_def_paddr = PPInBuf.phy_offset;
         mPPOutputParam.user_def_paddr = PPoutBuf.phy_offset;
+        //only set up the IPU task again when the config is changed
         mPPDevice->PPDeviceInit(&mPPInputParam, &mPPOutputParam);
         mPPDevice->DoPorcess(&PPInBuf, &PPoutBuf);
-        mPPDevice->PPDeviceDeInit();
         pthread_mutex_unlock(&mPPIOParamMutex);
 
-        sem_post(&avab_show_frame);
-        sem_post(&avab_enc_frame);
+        avab_show_frame.post();
+        avab_enc_frame.post();
 
         if (mCaptureDevice->DevQueue(PPInIdx) < 0){
             CAMERA_HAL_ERR("queue buf back error");
             return INVALID_OPERATION;
         }
         nCameraBuffersQueued ++;
-        sem_post(&avab_dequeue_frame);
+        avab_dequeue_frame.post();
 
         return NO_ERROR;
     }
@@ -1765,18 +1791,12 @@ Pic_out:
     int CameraHal ::previewshowFrameThread()
     {
         CAMERA_HAL_LOG_FUNC;
-        struct timespec ts;
         int display_index = 0;
         //DMA_BUFFER InBuf;
         DMA_BUFFER *pInBuf = NULL;
         unsigned int queue_back_index = 0;
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while (!error_status && mPreviewRunning &&(sem_timedwait(&avab_show_frame, &ts) != 0) );
-
-        if ((mPreviewRunning == 0) || error_status)
+        if (!avab_show_frame.wait())
             return UNKNOWN_ERROR;
 
         if (!mPPDeviceNeed){
@@ -1794,7 +1814,7 @@ Pic_out:
         }
 
         if (mMsgEnabled & CAMERA_MSG_PREVIEW_FRAME) {
-            convertNV12toYUV420SP((uint8_t*)(pInBuf->virt_start),
+            convertPreviewFrame((uint8_t*)(pInBuf->virt_start),
                     (uint8_t*)(mPreviewBuffers[preview_heap_buf_head]->pointer()),mCaptureDeviceCfg.width, mCaptureDeviceCfg.height);
             mDataCb(CAMERA_MSG_PREVIEW_FRAME, mPreviewBuffers[preview_heap_buf_head], mCallbackCookie);
             preview_heap_buf_head ++;
@@ -1833,10 +1853,8 @@ Pic_out:
             }
         }
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=200000; // 100ms
-        } while ((sem_timedwait(&avab_enc_frame_finish, &ts) != 0)&&!error_status && mPreviewRunning );
+        if (!avab_enc_frame_finish.wait())
+            return UNKNOWN_ERROR;
 
         if (!mPPDeviceNeed && mNativeWindow != 0){
             //queue the v4l2 buf back
@@ -1857,14 +1875,14 @@ Pic_out:
                 mCaptureBuffers[queue_back_index].buf_state = WINDOW_BUFS_DEQUEUED;
                 nCameraBuffersQueued++;
                 mEnqueuedBufs --;
-                sem_post(&avab_dequeue_frame);
+                avab_dequeue_frame.post();
             }else {
                 mNativeWindow->cancelBuffer(mNativeWindow.get(), buf);
                 CAMERA_HAL_ERR("dequeue invalide buffer!!!!");
                 return INVALID_OPERATION;
             }
         }else{
-            sem_post(&avab_pp_out_frame);
+            avab_pp_out_frame.post();
         }
 
         return NO_ERROR;
@@ -1873,16 +1891,10 @@ Pic_out:
     int CameraHal :: encodeframeThread()
     {
         CAMERA_HAL_LOG_FUNC;
-        struct timespec ts;
         unsigned int enc_index = 0, i = 0;
         DMA_BUFFER EncBuf;
 
-        do {
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec +=100000; // 100ms
-        } while ((sem_timedwait(&avab_enc_frame, &ts) != 0) && !error_status &&  mPreviewRunning );
-
-        if ((mPreviewRunning == 0) || error_status)
+        if (!avab_enc_frame.wait())
             return UNKNOWN_ERROR;
 
         if (!mPPDeviceNeed){
@@ -1919,7 +1931,7 @@ Pic_out:
         }
 
 		if (!(bDerectInput == true && mRecordRunning == true))
-			sem_post(&avab_enc_frame_finish);
+			avab_enc_frame_finish.post();
 
         return NO_ERROR;
 
@@ -1965,32 +1977,16 @@ Pic_out:
         }
     }
 
-    void CameraHal::convertNV12toYUV420SP(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height)
+    void CameraHal::convertPreviewFrame(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height)
     {
-        /* Color space conversion from I420 to YUV420SP */
-        int Ysize = 0, UVsize = 0;
-        uint8_t *Yin, *Uin, *Vin, *Yout, *Uout, *Vout;
-
-        Ysize = width * height;
-        UVsize = width *  height >> 2;
-
-        Yin = inputBuffer;
-        Uin = Yin + Ysize;
-        Vin = Uin + 1;
-
-        Yout = outputBuffer;
-        Vout = Yout + Ysize;
-        Uout = Vout + 1;
-
-        memcpy(Yout, Yin, Ysize);
-
-        for(int k = 0; k < UVsize; k++) {
-            *Uout = *Uin;
-            *Vout = *Vin;
-            Uout += 2;
-            Vout += 2;
-            Uin  += 2;
-            Vin += 2;
+        /* Convert the captured NV12 or I420 frame to the callback format */
+        if (mPreviewCbFormat == V4L2_PIX_FMT_YVU420) {
+            if (mCaptureDeviceCfg.fmt == v4l2_fourcc('Y','U','1','2'))
+                convertI420toYV12(inputBuffer, outputBuffer, width, height);
+            else
+                convertNV12toYV12(inputBuffer, outputBuffer, width, height);
+        }else{
+            convertNV12toNV21(inputBuffer, outputBuffer, width, height);
         }
     }
 
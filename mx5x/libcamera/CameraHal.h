@@ -34,16 +34,18 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <utils/threads.h>
+#include <utils/String8.h>
 #include <binder/MemoryBase.h>
 #include <binder/MemoryHeapBase.h>
 #include <camera/CameraHardwareInterface.h>
 //#include <ui/Overlay.h>
-#include <semaphore.h>
 
 #include "Camera_pmem.h"
 #include "CaptureDeviceInterface.h"
 #include "PostProcessDeviceInterface.h"
 #include "JpegEncoderInterface.h"
+#include "Camera_convert.h"
+#include "Camera_stage.h"
 
 
 #define EXIF_MAKENOTE "fsl_makernote"
@@ -144,7 +146,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->captureframeThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -158,7 +160,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->postprocessThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -173,7 +175,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->previewshowFrameThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -187,7 +189,7 @@ namespace android {
             }
             virtual bool threadLoop() {
                 mHardware->encodeframeThread();
-                return true;
+                return !mHardware->mStageAborted;
             }
         };
 
@@ -246,6 +248,7 @@ namespace android {
 
         status_t CameraHALStartPreview();
         void     CameraHALStopPreview();
+        void     AbortStageSignals();
 
         status_t PreparePreviwBuf();
         status_t PrepareCaptureDevices();
@@ -265,7 +268,7 @@ namespace android {
         int cameraHALTakePicture();
         void CameraHALStopMisc();
         int PrepareJpegEncoder();
-        void convertNV12toYUV420SP(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height);
+        void convertPreviewFrame(uint8_t *inputBuffer, uint8_t *outputBuffer, int width, int height);
 
         int stringTodegree(char* cAttribute, unsigned int &degree, unsigned int &minute, unsigned int &second);
 
@@ -327,6 +330,8 @@ namespace android {
         volatile bool       mPreviewRunning;
         unsigned int        mPreviewFormat;
         unsigned int 		mPreviewFrameSize;
+        unsigned int        mPreviewCbFormat;
+        unsigned int        mPreviewCbFrameSize;
         unsigned int        mPreviewCapturedFormat;
 
         bool                mTakePicFlag;
@@ -359,6 +364,7 @@ namespace android {
 		bool bDerectInput;
 
         int error_status;
+        volatile bool mStageAborted;
         unsigned int preview_heap_buf_head;
         unsigned int display_head;
         unsigned int enc_head;
@@ -369,12 +375,12 @@ namespace android {
         unsigned int pp_out_head;
         unsigned int buffer_index_maps[PREVIEW_CAPTURE_BUFFER_NUM];
 
-        sem_t avab_show_frame;
-        sem_t avab_dequeue_frame;
-        sem_t avab_enc_frame;
-        sem_t avab_enc_frame_finish;
-        sem_t avab_pp_in_frame;
-        sem_t avab_pp_out_frame;
+        CameraStageSignal avab_show_frame;
+        CameraStageSignal avab_dequeue_frame;
+        CameraStageSignal avab_enc_frame;
+        CameraStageSignal avab_enc_frame_finish;
+        CameraStageSignal avab_pp_in_frame;
+        CameraStageSignal avab_pp_out_frame;
 
         pthread_mutex_t mOverlayMutex;
         pthread_mutex_t mMsgMutex;
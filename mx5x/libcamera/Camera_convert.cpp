@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <cutils/properties.h>
+#include "Camera_utils.h"
+#include "Camera_convert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace android {
+
+    static inline int sat16(int v)
+    {
+        return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+    }
+
+    static inline uint8_t clampToByte(int v)
+    {
+        v = (sat16(v) + 32) >> 6;
+        return v > 255 ? 255 : (v < 0 ? 0 : v);
+    }
+
+    static inline uint16_t packRGB565(int y, int rv, int guv, int bu)
+    {
+        uint8_t r = clampToByte(y + rv);
+        uint8_t g = clampToByte(y - guv);
+        uint8_t b = clampToByte(y + bu);
+        return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    }
+
+    static void scalarSwapUV(const uint8_t *src, uint8_t *dst, int pairs)
+    {
+        for (int i = 0; i < pairs; i++) {
+            uint8_t first = src[0];
+            dst[0] = src[1];
+            dst[1] = first;
+            src += 2;
+            dst += 2;
+        }
+    }
+
+    static void scalarSplitUV(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs)
+    {
+        for (int i = 0; i < pairs; i++) {
+            first[i] = src[0];
+            second[i] = src[1];
+            src += 2;
+        }
+    }
+
+    static void scalarNV12RowToRGB565(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width)
+    {
+        for (int i = 0; i < width; i += 2) {
+            int u = uv[0] - 128;
+            int v = uv[1] - 128;
+            int rv = YUV2RGB_RV * v;
+            int guv = YUV2RGB_GV * v + YUV2RGB_GU * u;
+            int bu = YUV2RGB_BU * u;
+
+            dst[0] = packRGB565(YUV2RGB_Y * (y[0] - 16), rv, guv, bu);
+            dst[1] = packRGB565(YUV2RGB_Y * (y[1] - 16), rv, guv, bu);
+            y += 2;
+            uv += 2;
+            dst += 2;
+        }
+    }
+
+    static const CONVERT_KERNELS gScalarConvertKernels = {
+        "scalar",
+        scalarSwapUV,
+        scalarSplitUV,
+        scalarNV12RowToRGB565,
+    };
+
+#if defined(__SSE2__)
+    static void sse2SwapUV(const uint8_t *src, uint8_t *dst, int pairs)
+    {
+        int i = 0;
+        for (; i + 8 <= pairs; i += 8) {
+            __m128i uv = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            uv = _mm_or_si128(_mm_slli_epi16(uv, 8), _mm_srli_epi16(uv, 8));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i), uv);
+        }
+        scalarSwapUV(src + 2 * i, dst + 2 * i, pairs - i);
+    }
+
+    static void sse2SplitUV(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs)
+    {
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16) {
+            __m128i uv0 = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+            __m128i uv1 = _mm_loadu_si128((const __m128i *)(src + 2 * i + 16));
+            __m128i a = _mm_packus_epi16(_mm_and_si128(uv0, lowMask), _mm_and_si128(uv1, lowMask));
+            __m128i b = _mm_packus_epi16(_mm_srli_epi16(uv0, 8), _mm_srli_epi16(uv1, 8));
+            _mm_storeu_si128((__m128i *)(first + i), a);
+            _mm_storeu_si128((__m128i *)(second + i), b);
+        }
+        scalarSplitUV(src + 2 * i, first + i, second + i, pairs - i);
+    }
+
+    static inline __m128i sse2Pack565(__m128i r, __m128i g, __m128i b)
+    {
+        /* r, g, b hold 8 pixels as 16 bit values in 0..255 */
+        r = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+        g = _mm_slli_epi16(_mm_srli_epi16(g, 2), 5);
+        b = _mm_srli_epi16(b, 3);
+        return _mm_or_si128(_mm_or_si128(r, g), b);
+    }
+
+    static void sse2NV12RowToRGB565(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lowMask = _mm_set1_epi16(0x00FF);
+        const __m128i c16 = _mm_set1_epi16(16);
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i round = _mm_set1_epi16(32);
+        int i = 0;
+
+        for (; i + 16 <= width; i += 16) {
+            __m128i yy = _mm_loadu_si128((const __m128i *)(y + i));
+            __m128i cc = _mm_loadu_si128((const __m128i *)(uv + i));
+            __m128i u = _mm_sub_epi16(_mm_and_si128(cc, lowMask), c128);
+            __m128i v = _mm_sub_epi16(_mm_srli_epi16(cc, 8), c128);
+            __m128i rv = _mm_mullo_epi16(v, _mm_set1_epi16(YUV2RGB_RV));
+            __m128i guv = _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(YUV2RGB_GV)),
+                    _mm_mullo_epi16(u, _mm_set1_epi16(YUV2RGB_GU)));
+            __m128i bu = _mm_mullo_epi16(u, _mm_set1_epi16(YUV2RGB_BU));
+            /* the even pixels are in the low byte of every 16 bit lane */
+            __m128i ye = _mm_mullo_epi16(_mm_sub_epi16(_mm_and_si128(yy, lowMask), c16),
+                    _mm_set1_epi16(YUV2RGB_Y));
+            __m128i yo = _mm_mullo_epi16(_mm_sub_epi16(_mm_srli_epi16(yy, 8), c16),
+                    _mm_set1_epi16(YUV2RGB_Y));
+            __m128i re = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ye, rv), round), 6), zero);
+            __m128i ro = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yo, rv), round), 6), zero);
+            __m128i ge = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(ye, guv), round), 6), zero);
+            __m128i go = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(yo, guv), round), 6), zero);
+            __m128i be = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(ye, bu), round), 6), zero);
+            __m128i bo = _mm_packus_epi16(_mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yo, bu), round), 6), zero);
+            /* interleave even and odd pixels back into display order */
+            __m128i r = _mm_unpacklo_epi8(re, ro);
+            __m128i g = _mm_unpacklo_epi8(ge, go);
+            __m128i b = _mm_unpacklo_epi8(be, bo);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                    sse2Pack565(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero)));
+            _mm_storeu_si128((__m128i *)(dst + i + 8),
+                    sse2Pack565(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero)));
+        }
+        scalarNV12RowToRGB565(y + i, uv + i, dst + i, width - i);
+    }
+
+    static const CONVERT_KERNELS gSse2ConvertKernels = {
+        "sse2",
+        sse2SwapUV,
+        sse2SplitUV,
+        sse2NV12RowToRGB565,
+    };
+#endif
+
+#ifdef CAMERA_CONVERT_HAVE_NEON
+    static bool cpuHasNeon()
+    {
+        char line[512];
+        bool found = false;
+        FILE *fp = fopen("/proc/cpuinfo", "r");
+        if (fp == NULL)
+            return false;
+        while (!found && fgets(line, sizeof(line), fp) != NULL) {
+            if (strncmp(line, "Features", 8) == 0 && strstr(line, " neon") != NULL)
+                found = true;
+        }
+        fclose(fp);
+        return found;
+    }
+#endif
+
+    static const CONVERT_KERNELS *gConvertKernels = &gScalarConvertKernels;
+    static pthread_once_t gConvertKernelsOnce = PTHREAD_ONCE_INIT;
+
+    static void selectConvertKernels()
+    {
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("rw.camera.convert", value, "");
+        if (strcmp(value, "scalar") == 0) {
+            gConvertKernels = &gScalarConvertKernels;
+        }else{
+#if defined(CAMERA_CONVERT_HAVE_NEON)
+            if (cpuHasNeon())
+                gConvertKernels = &gNeonConvertKernels;
+#elif defined(__SSE2__)
+            gConvertKernels = &gSse2ConvertKernels;
+#endif
+        }
+        CAMERA_HAL_LOG_INFO("Using the %s color conversion kernels", gConvertKernels->name);
+    }
+
+    const CONVERT_KERNELS *getConvertKernels()
+    {
+        pthread_once(&gConvertKernelsOnce, selectConvertKernels);
+        return gConvertKernels;
+    }
+
+    const CONVERT_KERNELS *getScalarConvertKernels()
+    {
+        return &gScalarConvertKernels;
+    }
+
+    unsigned int getYV12FrameSize(int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        return yStride * height + cStride * height;
+    }
+
+    void convertNV12toNV21(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int Ysize = width * height;
+
+        memcpy(dst, src, Ysize);
+        k->swapUV(src + Ysize, dst + Ysize, Ysize >> 2);
+    }
+
+    void convertNV12toI420(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int Ysize = width * height;
+
+        memcpy(dst, src, Ysize);
+        k->splitUV(src + Ysize, dst + Ysize, dst + Ysize + (Ysize >> 2), Ysize >> 2);
+    }
+
+    void convertNV12toYV12(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        const uint8_t *uvIn = src + width * height;
+        uint8_t *vOut = dst + yStride * height;
+        uint8_t *uOut = vOut + cStride * (height >> 1);
+        int i;
+
+        if (yStride == width) {
+            memcpy(dst, src, width * height);
+        }else{
+            for (i = 0; i < height; i++)
+                memcpy(dst + i * yStride, src + i * width, width);
+        }
+
+        for (i = 0; i < (height >> 1); i++) {
+            k->splitUV(uvIn, uOut, vOut, width >> 1);
+            uvIn += width;
+            uOut += cStride;
+            vOut += cStride;
+        }
+    }
+
+    void convertNV12toRGB565(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        const uint8_t *uv = src + width * height;
+        uint16_t *out = (uint16_t *)dst;
+
+        for (int i = 0; i < height; i++) {
+            k->nv12RowToRGB565(src + i * width, uv + (i >> 1) * width, out, width);
+            out += width;
+        }
+    }
+
+    void convertNV12toNV21(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toNV21(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toI420(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toI420(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toYV12(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toYV12(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertNV12toRGB565(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        convertNV12toRGB565(getConvertKernels(), src, dst, width, height);
+    }
+
+    void convertI420toYV12(const uint8_t *src, uint8_t *dst, int width, int height)
+    {
+        int yStride = CAMERA_ALIGN_16(width);
+        int cStride = CAMERA_ALIGN_16(yStride / 2);
+        int cWidth = width >> 1;
+        const uint8_t *uIn = src + width * height;
+        const uint8_t *vIn = uIn + cWidth * (height >> 1);
+        uint8_t *vOut = dst + yStride * height;
+        uint8_t *uOut = vOut + cStride * (height >> 1);
+        int i;
+
+        for (i = 0; i < height; i++)
+            memcpy(dst + i * yStride, src + i * width, width);
+        for (i = 0; i < (height >> 1); i++) {
+            memcpy(vOut + i * cStride, vIn + i * cWidth, cWidth);
+            memcpy(uOut + i * cStride, uIn + i * cWidth, cWidth);
+        }
+    }
+
+};
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_CONVERT_H
+#define CAMERA_CONVERT_H
+
+#include <stdint.h>
+
+#define CAMERA_ALIGN_16(x) (((x) + 15) & ~15)
+
+/*
+ * BT.601 limited range to full range RGB in 6 bit fixed point. The same
+ * constants are used by every kernel so that all of them give bit exact
+ * results:
+ *   R = (74 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+ *   G = (74 * (Y - 16) -  52 * (V - 128) - 25 * (U - 128) + 32) >> 6
+ *   B = (74 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+ * The sums are saturated to 16 bit before the shift, as the vector units do.
+ */
+#define YUV2RGB_Y   74
+#define YUV2RGB_RV  102
+#define YUV2RGB_GV  52
+#define YUV2RGB_GU  25
+#define YUV2RGB_BU  129
+
+namespace android {
+
+    /*
+     * Row kernels used by the frame converters below. One table exists per
+     * instruction set (scalar, NEON, SSE2); the best one supported by the
+     * running cpu is picked once, the first time a converter is called.
+     * Every kernel handles any tail that does not fill a full vector.
+     */
+    typedef struct {
+        const char *name;
+        /* swap every U/V byte pair: NV12 chroma row <-> NV21 chroma row */
+        void (*swapUV)(const uint8_t *src, uint8_t *dst, int pairs);
+        /* de-interleave one semi-planar chroma row into two planar rows */
+        void (*splitUV)(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs);
+        /* one output row of BT.601 NV12 -> RGB565, width must be even */
+        void (*nv12RowToRGB565)(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width);
+    }CONVERT_KERNELS;
+
+    const CONVERT_KERNELS *getConvertKernels();
+    const CONVERT_KERNELS *getScalarConvertKernels();
+
+    /*
+     * Frame converters, all of them take a tightly packed NV12 (or I420)
+     * source of width x height. The YV12 output follows the android
+     * yuv420p layout: the Y stride is 16 aligned, the chroma stride is
+     * the 16 aligned half of the Y stride and V comes before U.
+     */
+    void convertNV12toNV21(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toI420(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toYV12(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertI420toYV12(const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toRGB565(const uint8_t *src, uint8_t *dst, int width, int height);
+
+    unsigned int getYV12FrameSize(int width, int height);
+
+    /* same as the converters above, but always with the given kernels */
+    void convertNV12toNV21(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toI420(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toYV12(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+    void convertNV12toRGB565(const CONVERT_KERNELS *k, const uint8_t *src, uint8_t *dst, int width, int height);
+
+#ifdef CAMERA_CONVERT_HAVE_NEON
+    extern const CONVERT_KERNELS gNeonConvertKernels;
+#endif
+
+}; //name space android
+
+#endif
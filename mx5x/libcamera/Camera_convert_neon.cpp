@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+/*
+ * NEON versions of the Camera_convert row kernels. This file is the only
+ * one built with -mfpu=neon, Camera_convert.cpp only calls into it after
+ * checking that the running cpu has NEON.
+ */
+
+#include "Camera_convert.h"
+
+#if defined(CAMERA_CONVERT_HAVE_NEON) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+namespace android {
+
+    static void neonSwapUV(const uint8_t *src, uint8_t *dst, int pairs)
+    {
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16) {
+            uint8x16_t a = vld1q_u8(src + 2 * i);
+            uint8x16_t b = vld1q_u8(src + 2 * i + 16);
+            vst1q_u8(dst + 2 * i, vrev16q_u8(a));
+            vst1q_u8(dst + 2 * i + 16, vrev16q_u8(b));
+        }
+        for (; i < pairs; i++) {
+            uint8_t first = src[2 * i];
+            dst[2 * i] = src[2 * i + 1];
+            dst[2 * i + 1] = first;
+        }
+    }
+
+    static void neonSplitUV(const uint8_t *src, uint8_t *first, uint8_t *second, int pairs)
+    {
+        int i = 0;
+        for (; i + 16 <= pairs; i += 16) {
+            uint8x16x2_t uv = vld2q_u8(src + 2 * i);
+            vst1q_u8(first + i, uv.val[0]);
+            vst1q_u8(second + i, uv.val[1]);
+        }
+        for (; i < pairs; i++) {
+            first[i] = src[2 * i];
+            second[i] = src[2 * i + 1];
+        }
+    }
+
+    static inline uint16x8_t neonPack565(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+    {
+        uint16x8_t rgb = vshll_n_u8(r, 8);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(b, 8), 11);
+        return rgb;
+    }
+
+    static void neonNV12RowToRGB565(const uint8_t *y, const uint8_t *uv, uint16_t *dst, int width)
+    {
+        const int16x8_t c16 = vdupq_n_s16(16);
+        const int16x8_t c128 = vdupq_n_s16(128);
+        int i = 0;
+
+        for (; i + 16 <= width; i += 16) {
+            uint8x8x2_t cc = vld2_u8(uv + i);
+            uint8x16_t yy = vld1q_u8(y + i);
+            int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cc.val[0])), c128);
+            int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cc.val[1])), c128);
+            int16x8_t rv = vmulq_n_s16(v, YUV2RGB_RV);
+            int16x8_t guv = vmlaq_n_s16(vmulq_n_s16(v, YUV2RGB_GV), u, YUV2RGB_GU);
+            int16x8_t bu = vmulq_n_s16(u, YUV2RGB_BU);
+            /* every chroma sample covers two neighbouring pixels */
+            int16x8x2_t r2 = vzipq_s16(rv, rv);
+            int16x8x2_t g2 = vzipq_s16(guv, guv);
+            int16x8x2_t b2 = vzipq_s16(bu, bu);
+            int16x8_t y0 = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yy))), c16), YUV2RGB_Y);
+            int16x8_t y1 = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yy))), c16), YUV2RGB_Y);
+
+            vst1q_u16(dst + i, neonPack565(vqrshrun_n_s16(vqaddq_s16(y0, r2.val[0]), 6),
+                        vqrshrun_n_s16(vqsubq_s16(y0, g2.val[0]), 6),
+                        vqrshrun_n_s16(vqaddq_s16(y0, b2.val[0]), 6)));
+            vst1q_u16(dst + i + 8, neonPack565(vqrshrun_n_s16(vqaddq_s16(y1, r2.val[1]), 6),
+                        vqrshrun_n_s16(vqsubq_s16(y1, g2.val[1]), 6),
+                        vqrshrun_n_s16(vqaddq_s16(y1, b2.val[1]), 6)));
+        }
+        if (i < width)
+            getScalarConvertKernels()->nv12RowToRGB565(y + i, uv + i, dst + i, width - i);
+    }
+
+    const CONVERT_KERNELS gNeonConvertKernels = {
+        "neon",
+        neonSwapUV,
+        neonSplitUV,
+        neonNV12RowToRGB565,
+    };
+
+};
+#endif
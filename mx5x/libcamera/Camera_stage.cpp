@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#include "Camera_stage.h"
+
+namespace android {
+
+    CameraStageSignal :: CameraStageSignal()
+        : mName(""),
+          mCount(0),
+          mAborted(false),
+          mWakeups(0),
+          mPosts(0)
+    {
+    }
+
+    void CameraStageSignal :: reset(const char *name, int count)
+    {
+        Mutex::Autolock lock(mLock);
+        mName = name;
+        mCount = count;
+        mAborted = false;
+        mWakeups = 0;
+        mPosts = 0;
+    }
+
+    bool CameraStageSignal :: wait()
+    {
+        Mutex::Autolock lock(mLock);
+        while (mCount == 0 && !mAborted) {
+            mCond.wait(mLock);
+            mWakeups ++;
+        }
+        if (mAborted)
+            return false;
+        mCount --;
+        return true;
+    }
+
+    void CameraStageSignal :: post()
+    {
+        Mutex::Autolock lock(mLock);
+        mCount ++;
+        mPosts ++;
+        mCond.signal();
+    }
+
+    void CameraStageSignal :: abort()
+    {
+        Mutex::Autolock lock(mLock);
+        mAborted = true;
+        mCond.broadcast();
+    }
+
+    int CameraStageSignal :: getCount() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mCount;
+    }
+
+    unsigned int CameraStageSignal :: getWakeups() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mWakeups;
+    }
+
+    unsigned int CameraStageSignal :: getPosts() const
+    {
+        Mutex::Autolock lock(mLock);
+        return mPosts;
+    }
+
+};
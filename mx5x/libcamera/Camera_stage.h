@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Copyright 2009-2011 Freescale Semiconductor, Inc. All Rights Reserved.
+ */
+
+#ifndef CAMERA_STAGE_H
+#define CAMERA_STAGE_H
+
+#include <utils/threads.h>
+
+namespace android {
+
+    /*
+     * Counting signal between two pipeline stages. It replaces the
+     * sem_timedwait polling: wait() blocks without any timeout until a
+     * post() or an abort(). Once aborted, every wait() returns false at
+     * once until the signal is reset, so the stage threads can leave
+     * cleanly on stop or on error.
+     */
+    class CameraStageSignal
+    {
+    public:
+        CameraStageSignal();
+
+        void reset(const char *name, int count);
+        bool wait();
+        void post();
+        void abort();
+
+        const char *getName() const { return mName; }
+        int getCount() const;
+        unsigned int getWakeups() const;
+        unsigned int getPosts() const;
+
+    private:
+        mutable Mutex   mLock;
+        Condition       mCond;
+        const char     *mName;
+        int             mCount;
+        bool            mAborted;
+        /* how many times a waiter blocked and was woken up again */
+        unsigned int    mWakeups;
+        unsigned int    mPosts;
+    };
+
+};
+
+#endif
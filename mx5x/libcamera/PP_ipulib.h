@@ -24,6 +24,7 @@ extern "C" {
 #include "mxc_ipu_hl_lib.h" 
 } 
 
+#include <utils/threads.h>
 #include "PostProcessDeviceInterface.h"
 
 namespace android{
@@ -37,8 +38,13 @@ namespace android{
     private:
         PPIpuLib();
         virtual ~PPIpuLib();
+        bool IsSameConfig(pp_input_param_t *pp_input, pp_output_param_t *pp_output);
         static wp<PostProcessDeviceInterface> singleton;
 
+        Mutex                   mLock;
+        bool                    mTaskReady;
+        unsigned int            mTaskInitCount;
+
         ipu_lib_input_param_t mIPUInputParam;	
         ipu_lib_output_param_t mIPUOutputParam; 
         ipu_lib_handle_t			mIPUHandle;